@@ -0,0 +1,502 @@
+#include <string>
+#include <functional>
+
+#include <QDir>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QThread>
+
+#include <QDebug>
+
+#include "entity/async_brain_repository.h"
+
+// Creation.
+
+AsyncBrainRepository::AsyncBrainRepository() {
+	m_worker = new QObject();
+	m_worker->moveToThread(&m_thread);
+	m_thread.setObjectName("brain-storage");
+	m_thread.start();
+}
+
+AsyncBrainRepository::~AsyncBrainRepository() {
+	// Let queued jobs finish, then close the database on its own thread.
+	blocking([this]() {
+		if (m_repo != nullptr) {
+			delete m_repo;
+			m_repo = nullptr;
+		}
+	});
+
+	m_thread.quit();
+	m_thread.wait();
+	delete m_worker;
+
+	if (m_state != nullptr)
+		delete m_state;
+}
+
+AsyncBrainRepository *AsyncBrainRepository::fromDir(
+	QDir root,
+	StorageProfile profile
+) {
+	AsyncBrainRepository *result = new AsyncBrainRepository();
+
+	// Connection can only be used on the thread that opened it.
+	result->blocking([result, root, profile]() {
+		DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(root, profile);
+		result->m_repo = repo;
+
+		if (repo != nullptr && repo->getState() != nullptr) {
+			result->m_state = repo->getState()->copy();
+			result->m_change = *repo->getChange();
+		}
+	});
+
+	if (result->m_repo == nullptr) {
+		delete result;
+		return nullptr;
+	}
+
+	return result;
+}
+
+// Graph repository.
+
+bool AsyncBrainRepository::select(ThoughtId id) {
+	return select(id, 1, 0);
+}
+
+bool AsyncBrainRepository::select(ThoughtId id, int depth, size_t budget) {
+	// Pending selections are replaced by this one.
+	m_selection++;
+
+	return await<bool>([this, id, depth, budget](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		postEdit<bool>(
+			[id, depth, budget](DatabaseBrainRepository *repo) {
+				return repo->select(id, depth, budget);
+			},
+			context,
+			callback
+		);
+	});
+}
+
+void AsyncBrainRepository::selectAsync(
+	ThoughtId id,
+	QObject *context,
+	std::function<void(bool)> callback
+) {
+	selectAsync(id, 1, 0, context, callback);
+}
+
+void AsyncBrainRepository::selectAsync(
+	ThoughtId id,
+	int depth,
+	size_t budget,
+	QObject *context,
+	std::function<void(bool)> callback
+) {
+	uint64_t selection = ++m_selection;
+	loadSelection(id, depth, budget, selection, context, callback);
+}
+
+void AsyncBrainRepository::loadSelection(
+	ThoughtId id,
+	int depth,
+	size_t budget,
+	uint64_t selection,
+	QPointer<QObject> target,
+	std::function<void(bool)> callback
+) {
+	uint64_t edits = m_edits;
+
+	post([this, id, depth, budget, selection, edits, target, callback]() {
+		// Replaced while waiting in the queue.
+		if (m_selection != selection)
+			return;
+
+		// Current state of the worker stays, edits queued in the meantime
+		// patch it.
+		State *state = m_repo->loadSelection(id, depth, budget);
+		State *copy = state != nullptr ? state->copy() : nullptr;
+
+		QMetaObject::invokeMethod(&m_relay, [this, id, depth, budget, selection, edits, target, callback, state, copy]() {
+			if (target.isNull() || m_selection != selection || m_edits != edits) {
+				delete state;
+				delete copy;
+
+				// Loaded before the edits, so load again after them.
+				if (!target.isNull() && m_selection == selection)
+					loadSelection(id, depth, budget, selection, target, callback);
+				return;
+			}
+
+			if (state == nullptr) {
+				callback(false);
+				return;
+			}
+
+			// Worker takes the same state before anything queued later.
+			post([this, id, depth, budget, state]() {
+				m_repo->setSelection(id, depth, budget, state);
+			});
+
+			handOver(StateChange(true), copy);
+			callback(true);
+		}, Qt::QueuedConnection);
+	});
+}
+
+const State* AsyncBrainRepository::getState() const {
+	return m_state;
+}
+
+const StateChange* AsyncBrainRepository::getChange() const {
+	return &m_change;
+}
+
+bool AsyncBrainRepository::updateThought(ThoughtId id, std::string& name) {
+	return await<bool>([this, id, name](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		updateThoughtAsync(id, name, context, callback);
+	});
+}
+
+CreateResult AsyncBrainRepository::createThought(
+	ThoughtId fromId,
+	ConnectionType type,
+	bool incoming,
+	std::string text
+) {
+	return await<CreateResult>([this, fromId, type, incoming, text](
+		QObject *context,
+		std::function<void(CreateResult)> callback
+	) {
+		createThoughtAsync(fromId, type, incoming, text, context, callback);
+	});
+}
+
+bool AsyncBrainRepository::connectThoughts(
+	ThoughtId fromId,
+	ThoughtId toId,
+	ConnectionType type
+) {
+	return await<bool>([this, fromId, toId, type](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		connectThoughtsAsync(fromId, toId, type, context, callback);
+	});
+}
+
+bool AsyncBrainRepository::deleteThought(ThoughtId id) {
+	return await<bool>([this, id](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		deleteThoughtAsync(id, context, callback);
+	});
+}
+
+bool AsyncBrainRepository::disconnectThoughts(ThoughtId from, ThoughtId to) {
+	return await<bool>([this, from, to](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		disconnectThoughtsAsync(from, to, context, callback);
+	});
+}
+
+void AsyncBrainRepository::updateThoughtAsync(
+	ThoughtId id,
+	std::string name,
+	QObject *context,
+	std::function<void(bool)> callback
+) {
+	postEdit<bool>(
+		[id, name](DatabaseBrainRepository *repo) mutable {
+			return repo->updateThought(id, name);
+		},
+		context,
+		callback
+	);
+}
+
+void AsyncBrainRepository::createThoughtAsync(
+	ThoughtId fromId,
+	ConnectionType type,
+	bool incoming,
+	std::string text,
+	QObject *context,
+	std::function<void(CreateResult)> callback
+) {
+	postEdit<CreateResult>(
+		[fromId, type, incoming, text](DatabaseBrainRepository *repo) {
+			return repo->createThought(fromId, type, incoming, text);
+		},
+		context,
+		callback
+	);
+}
+
+void AsyncBrainRepository::connectThoughtsAsync(
+	ThoughtId fromId,
+	ThoughtId toId,
+	ConnectionType type,
+	QObject *context,
+	std::function<void(bool)> callback
+) {
+	postEdit<bool>(
+		[fromId, toId, type](DatabaseBrainRepository *repo) {
+			return repo->connectThoughts(fromId, toId, type);
+		},
+		context,
+		callback
+	);
+}
+
+void AsyncBrainRepository::deleteThoughtAsync(
+	ThoughtId id,
+	QObject *context,
+	std::function<void(bool)> callback
+) {
+	postEdit<bool>(
+		[id](DatabaseBrainRepository *repo) {
+			return repo->deleteThought(id);
+		},
+		context,
+		callback
+	);
+}
+
+void AsyncBrainRepository::disconnectThoughtsAsync(
+	ThoughtId from,
+	ThoughtId to,
+	QObject *context,
+	std::function<void(bool)> callback
+) {
+	postEdit<bool>(
+		[from, to](DatabaseBrainRepository *repo) {
+			return repo->disconnectThoughts(from, to);
+		},
+		context,
+		callback
+	);
+}
+
+// Transactions are queued in order with the edits between them. Rollbacks
+// reload the state, so they are handed over like edits.
+
+bool AsyncBrainRepository::beginTransaction() {
+	return await<bool>([this](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		postEdit<bool>(
+			[](DatabaseBrainRepository *repo) { return repo->beginTransaction(); },
+			context,
+			callback
+		);
+	});
+}
+
+bool AsyncBrainRepository::commitTransaction() {
+	return await<bool>([this](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		postEdit<bool>(
+			[](DatabaseBrainRepository *repo) { return repo->commitTransaction(); },
+			context,
+			callback
+		);
+	});
+}
+
+bool AsyncBrainRepository::rollbackTransaction() {
+	return await<bool>([this](
+		QObject *context,
+		std::function<void(bool)> callback
+	) {
+		postEdit<bool>(
+			[](DatabaseBrainRepository *repo) { return repo->rollbackTransaction(); },
+			context,
+			callback
+		);
+	});
+}
+
+// Search repository.
+
+SearchResult AsyncBrainRepository::search(std::string term) {
+	return await<SearchResult>([this, term](
+		QObject *context,
+		std::function<void(SearchResult)> callback
+	) {
+		post<SearchResult>(
+			[term](DatabaseBrainRepository *repo) { return repo->search(term); },
+			context,
+			callback
+		);
+	});
+}
+
+SearchResult AsyncBrainRepository::searchTop(
+	std::string term,
+	size_t limit,
+	SearchScope scope
+) {
+	return await<SearchResult>([this, term, limit, scope](
+		QObject *context,
+		std::function<void(SearchResult)> callback
+	) {
+		post<SearchResult>(
+			[term, limit, scope](DatabaseBrainRepository *repo) {
+				return repo->searchTop(term, limit, scope);
+			},
+			context,
+			callback
+		);
+	});
+}
+
+void AsyncBrainRepository::searchAsync(
+	std::string term,
+	size_t limit,
+	SearchScope scope,
+	QObject *context,
+	std::function<void(SearchResult)> callback
+) {
+	std::shared_ptr<std::atomic<uint64_t>> current = searchGeneration(context);
+	uint64_t generation = ++(*current);
+
+	QPointer<QObject> target = context;
+	QObject *relay = &m_relay;
+	DatabaseBrainRepository *repo = m_repo;
+
+	post([repo, relay, term, limit, scope, target, callback, current, generation]() {
+		// Canceled while waiting in the queue.
+		if (*current != generation)
+			return;
+
+		SearchResult result = repo->searchTop(term, limit, scope);
+
+		QMetaObject::invokeMethod(relay, [target, result, callback, current, generation]() {
+			if (target.isNull() || *current != generation)
+				return;
+			callback(result);
+		}, Qt::QueuedConnection);
+	});
+}
+
+void AsyncBrainRepository::cancelSearches(QObject *context) {
+	auto it = m_searches.find(context);
+	if (it != m_searches.end())
+		(*(*it))++;
+}
+
+// Text repository.
+
+GetResult AsyncBrainRepository::getText(ThoughtId id) {
+	return await<GetResult>([this, id](
+		QObject *context,
+		std::function<void(GetResult)> callback
+	) {
+		getTextAsync(id, context, callback);
+	});
+}
+
+SaveResult AsyncBrainRepository::saveText(ThoughtId id, QString text) {
+	return await<SaveResult>([this, id, text](
+		QObject *context,
+		std::function<void(SaveResult)> callback
+	) {
+		saveTextAsync(id, text, context, callback);
+	});
+}
+
+void AsyncBrainRepository::getTextAsync(
+	ThoughtId id,
+	QObject *context,
+	std::function<void(GetResult)> callback
+) {
+	post<GetResult>(
+		[id](DatabaseBrainRepository *repo) { return repo->getText(id); },
+		context,
+		callback
+	);
+}
+
+void AsyncBrainRepository::saveTextAsync(
+	ThoughtId id,
+	QString text,
+	QObject *context,
+	std::function<void(SaveResult)> callback
+) {
+	post<SaveResult>(
+		[id, text](DatabaseBrainRepository *repo) {
+			return repo->saveText(id, text);
+		},
+		context,
+		callback
+	);
+}
+
+// Helpers.
+
+/**
+ * Copies what the last operation changed in the worker's state, to be handed
+ * over to the GUI. Runs on the worker.
+ */
+State *AsyncBrainRepository::copyChanges(const DatabaseBrainRepository *repo) {
+	const State *state = repo->getState();
+	const StateChange *change = repo->getChange();
+	if (state == nullptr || change->isEmpty())
+		return nullptr;
+
+	return change->reloaded() ? state->copy() : state->copyChanged(*change);
+}
+
+void AsyncBrainRepository::handOver(const StateChange& change, State *state) {
+	m_change = change;
+
+	if (change.reloaded()) {
+		if (m_state != nullptr)
+			delete m_state;
+		m_state = state;
+	} else if (m_state != nullptr) {
+		m_state->merge(change, state);
+	} else if (state != nullptr) {
+		delete state;
+	}
+}
+
+std::shared_ptr<std::atomic<uint64_t>> AsyncBrainRepository::searchGeneration(
+	QObject *context
+) {
+	auto it = m_searches.find(context);
+	if (it != m_searches.end())
+		return *it;
+
+	auto result = std::make_shared<std::atomic<uint64_t>>(0);
+	m_searches.insert(context, result);
+	QObject::connect(context, &QObject::destroyed, &m_relay, [this, context]() {
+		m_searches.remove(context);
+	});
+	return result;
+}
+
+void AsyncBrainRepository::blocking(std::function<void()> job) {
+	QMetaObject::invokeMethod(m_worker, job, Qt::BlockingQueuedConnection);
+}
+
+void AsyncBrainRepository::post(std::function<void()> job) {
+	QMetaObject::invokeMethod(m_worker, job, Qt::QueuedConnection);
+}
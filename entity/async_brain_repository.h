@@ -0,0 +1,260 @@
+#ifndef H_ASYNC_BRAIN_REPOSITORY
+#define H_ASYNC_BRAIN_REPOSITORY
+
+#include <string>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <cstdint>
+
+#include <QDir>
+#include <QEventLoop>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QThread>
+
+#include "model/model.h"
+#include "entity/base_repository.h"
+#include "entity/graph_repository.h"
+#include "entity/search_repository.h"
+#include "entity/text_repository.h"
+#include "entity/storage_profile.h"
+#include "entity/database_brain_repository.h"
+
+/**
+ * Runs a DatabaseBrainRepository on a dedicated worker thread, which owns
+ * the database connection and does all SQLite and file I/O.
+ *
+ * Requests are queued to the worker and their callbacks are delivered on the
+ * GUI thread, and are dropped if the context object is gone by then.
+ * Searches that have been canceled or replaced by a newer one for the same
+ * context are skipped by the worker, or dropped if already running.
+ *
+ * The worker's State is never read by the GUI. The GUI keeps its own copy,
+ * which getState() returns. After every edit the worker hands over copies of
+ * the thoughts it patched, or of the whole State if it was reloaded, and the
+ * GUI copy is updated right before the callback.
+ *
+ * Selections load the next State while the worker keeps the current one, so
+ * edits can still patch it. The GUI takes the loaded State right before the
+ * callback, and the worker takes it as well before anything queued later.
+ * Edits requested while it was loading make it outdated, in which case it's
+ * loaded again after them.
+ *
+ * Synchronous versions queue the same requests, and wait for them while
+ * processing events. Only construction and destruction block the GUI.
+ */
+class AsyncBrainRepository
+	: public BaseRepository,
+	public GraphRepository,
+	public SearchRepository,
+	public TextRepository
+{
+public:
+	// Constructor.
+	static AsyncBrainRepository *fromDir(
+		QDir,
+		StorageProfile = StorageProfile::defaultProfile()
+	);
+	~AsyncBrainRepository();
+	// Graph Repository.
+	bool select(ThoughtId) override;
+	bool select(ThoughtId, int, size_t) override;
+	void selectAsync(
+		ThoughtId,
+		QObject*,
+		std::function<void(bool)>
+	) override;
+	void selectAsync(
+		ThoughtId,
+		int,
+		size_t,
+		QObject*,
+		std::function<void(bool)>
+	) override;
+	const State* getState() const override;
+	const StateChange* getChange() const override;
+	bool updateThought(ThoughtId, std::string&) override;
+	CreateResult createThought(
+		ThoughtId fromId,
+		ConnectionType type,
+		bool incoming,
+		std::string text
+	) override;
+	bool connectThoughts(
+		ThoughtId fromId,
+		ThoughtId toId,
+		ConnectionType type
+	) override;
+	bool deleteThought(ThoughtId) override;
+	bool disconnectThoughts(ThoughtId, ThoughtId) override;
+	void updateThoughtAsync(
+		ThoughtId,
+		std::string,
+		QObject*,
+		std::function<void(bool)>
+	) override;
+	void createThoughtAsync(
+		ThoughtId fromId,
+		ConnectionType type,
+		bool incoming,
+		std::string text,
+		QObject*,
+		std::function<void(CreateResult)>
+	) override;
+	void connectThoughtsAsync(
+		ThoughtId fromId,
+		ThoughtId toId,
+		ConnectionType type,
+		QObject*,
+		std::function<void(bool)>
+	) override;
+	void deleteThoughtAsync(
+		ThoughtId,
+		QObject*,
+		std::function<void(bool)>
+	) override;
+	void disconnectThoughtsAsync(
+		ThoughtId,
+		ThoughtId,
+		QObject*,
+		std::function<void(bool)>
+	) override;
+	bool beginTransaction() override;
+	bool commitTransaction() override;
+	bool rollbackTransaction() override;
+	// Search repository.
+	SearchResult search(std::string) override;
+	SearchResult searchTop(std::string, size_t, SearchScope) override;
+	void searchAsync(
+		std::string,
+		size_t,
+		SearchScope,
+		QObject*,
+		std::function<void(SearchResult)>
+	) override;
+	void cancelSearches(QObject*) override;
+	// Text repository.
+	GetResult getText(ThoughtId) override;
+	SaveResult saveText(ThoughtId, QString) override;
+	void getTextAsync(
+		ThoughtId,
+		QObject*,
+		std::function<void(GetResult)>
+	) override;
+	void saveTextAsync(
+		ThoughtId,
+		QString,
+		QObject*,
+		std::function<void(SaveResult)>
+	) override;
+
+protected:
+	AsyncBrainRepository();
+
+private:
+	QThread m_thread;
+	// Lives on the worker thread.
+	QObject *m_worker = nullptr;
+	// Lives on the GUI thread, receives results from the worker.
+	QObject m_relay;
+	// Only used on the worker thread.
+	DatabaseBrainRepository *m_repo = nullptr;
+	// Copy of the worker's state and its last change, only used on the GUI
+	// thread.
+	State *m_state = nullptr;
+	StateChange m_change;
+	// Last search generation of every context. Only used on the GUI thread,
+	// the worker reads the counters.
+	QHash<QObject*, std::shared_ptr<std::atomic<uint64_t>>> m_searches;
+	// Last requested selection, read by the worker. Number of requested
+	// edits, only used on the GUI thread.
+	std::atomic<uint64_t> m_selection{0};
+	uint64_t m_edits = 0;
+	// Helpers.
+	void blocking(std::function<void()>);
+	void post(std::function<void()>);
+	std::shared_ptr<std::atomic<uint64_t>> searchGeneration(QObject*);
+	void loadSelection(
+		ThoughtId,
+		int,
+		size_t,
+		uint64_t,
+		QPointer<QObject>,
+		std::function<void(bool)>
+	);
+	static State *copyChanges(const DatabaseBrainRepository*);
+	void handOver(const StateChange&, State*);
+
+	// Runs the job on the worker, then the callback on the GUI thread.
+	template<typename T>
+	void post(
+		std::function<T(DatabaseBrainRepository*)> job,
+		QObject *context,
+		std::function<void(T)> callback
+	) {
+		QPointer<QObject> target = context;
+		QObject *relay = &m_relay;
+		DatabaseBrainRepository *repo = m_repo;
+
+		post([repo, relay, job, target, callback]() {
+			T result = job(repo);
+
+			QMetaObject::invokeMethod(relay, [target, result, callback]() {
+				// Context has been destroyed while the job was running.
+				if (target.isNull())
+					return;
+				callback(result);
+			}, Qt::QueuedConnection);
+		});
+	}
+
+	// Same for jobs that can change the state. Changes are handed over to
+	// the GUI right before the callback, even if the context is gone.
+	template<typename T>
+	void postEdit(
+		std::function<T(DatabaseBrainRepository*)> job,
+		QObject *context,
+		std::function<void(T)> callback
+	) {
+		QPointer<QObject> target = context;
+		DatabaseBrainRepository *repo = m_repo;
+		m_edits++;
+
+		post([this, repo, job, target, callback]() {
+			repo->clearChange();
+			T result = job(repo);
+			StateChange change = *repo->getChange();
+			State *state = copyChanges(repo);
+
+			QMetaObject::invokeMethod(&m_relay, [this, change, state, target, result, callback]() {
+				handOver(change, state);
+				if (target.isNull())
+					return;
+				callback(result);
+			}, Qt::QueuedConnection);
+		});
+	}
+
+	// Waits for the callback of an asynchronous request while processing
+	// events.
+	template<typename T>
+	T await(std::function<void(QObject*, std::function<void(T)>)> request) {
+		QEventLoop loop;
+		std::optional<T> result;
+
+		request(&loop, [&result, &loop](T value) {
+			result.emplace(value);
+			loop.quit();
+		});
+		if (!result.has_value())
+			loop.exec();
+
+		return result.value();
+	}
+};
+
+#endif
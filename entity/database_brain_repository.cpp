@@ -1,12 +1,13 @@
 #include <ctime>
+#include <algorithm>
+#include <unordered_set>
 
 #include <QDir>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QString>
+#include <QStringList>
 #include <QSqlError>
-#include <QSqlTableModel>
-#include <QSqlRecord>
 #include <QRegularExpression>
 
 #include <QDebug>
@@ -38,6 +39,15 @@
  * For possible values of conn_type, see ConnectionType enum from 
  * model/thought.h.
  *
+ * Connections are also indexed by (conn_to, conn_type) and
+ * (conn_from, conn_type). Schema changes are applied to existing brains by
+ * migrations, see `migrate` below.
+ *
+ * Names and note texts are also kept in `search_index`, an FTS5 table with
+ * rowid equal to the thought ID. It's not part of the migrations, because
+ * FTS5 may be missing from the SQLite library. In that case search falls
+ * back to matching names with LIKE.
+ *
  * When a new Brain is created, an initial node with ID = 0 is inserted
  * automatically as a root node. Every other node created from that
  * would get an ID from a current timestamp in milliseconds.
@@ -51,23 +61,60 @@
 
 DatabaseBrainRepository::DatabaseBrainRepository(
 	QDir root,
-	QSqlDatabase conn
+	QSqlDatabase conn,
+	StorageProfile profile
 ) : m_root(root), m_conn(conn), m_rootId(0), m_currentId(0) {
+	if (profile.wal && profile.checkpointInterval > 0) {
+		m_checkpointer = new DatabaseCheckpointer(
+			conn.databaseName(),
+			profile.checkpointInterval
+		);
+	}
+
+	m_fullText = setupSearchIndex();
+	prepareStatements();
+
+	if (profile.graphCache) {
+		m_cache = new GraphCache();
+		if (!loadCache()) {
+			delete m_cache;
+			m_cache = nullptr;
+		}
+	}
+
 	select(m_rootId);
 }
 
 DatabaseBrainRepository::~DatabaseBrainRepository() {
+	if (m_checkpointer != nullptr)
+		delete m_checkpointer;
+
+	if (m_cache != nullptr)
+		delete m_cache;
+
+	for (auto *query: m_statements) {
+		if (query != nullptr)
+			delete query;
+	}
+
 	if (m_state != nullptr)
 		delete m_state;
 }
 
-DatabaseBrainRepository *DatabaseBrainRepository::fromDir(QDir root) {
+DatabaseBrainRepository *DatabaseBrainRepository::fromDir(
+	QDir root,
+	StorageProfile profile
+) {
 	QSqlDatabase connection;
 	bool valid = DatabaseBrainRepository::verify(root, &connection);
 	if (!valid)
 		return nullptr;
 
-	return new DatabaseBrainRepository(root, connection);
+	valid = DatabaseBrainRepository::applyProfile(connection, profile);
+	if (!valid)
+		return nullptr;
+
+	return new DatabaseBrainRepository(root, connection, profile);
 }
 
 bool DatabaseBrainRepository::verify(QDir root, QSqlDatabase *conn) {
@@ -149,6 +196,11 @@ bool DatabaseBrainRepository::createDb(
 	if (!result)
 		return false;
 
+	// Bring the schema up to date.
+	result = DatabaseBrainRepository::migrate(db);
+	if (!result)
+		return false;
+
 	// Check if root thought exists.
 	QSqlQuery rootRecordQuery = QSqlQuery(
 		"SELECT * FROM thoughts WHERE id == 0;",
@@ -184,17 +236,446 @@ bool DatabaseBrainRepository::createDb(
 	return true;
 }
 
+bool DatabaseBrainRepository::applyProfile(
+	QSqlDatabase& db,
+	StorageProfile profile
+) {
+	qDebug() << "DB: Applying storage profile...";
+
+	QStringList pragmas = {
+		QString("PRAGMA journal_mode = %1;").arg(profile.wal ? "WAL" : "DELETE"),
+		QString("PRAGMA synchronous = %1;").arg(profile.relaxedSync ? "NORMAL" : "FULL"),
+		QString("PRAGMA mmap_size = %1;").arg(profile.mmapSize),
+		// Negative value is the size in KiB rather than in pages.
+		QString("PRAGMA cache_size = %1;").arg(-profile.cacheSize),
+	};
+
+	for (auto& pragma: pragmas) {
+		QSqlQuery query = QSqlQuery(db);
+		if (!query.exec(pragma)) {
+			qDebug() << "DB error:" << query.lastError().text();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Search index.
+
+/**
+ * Creates the full text search index if the brain doesn't have one yet, and
+ * fills it with names and texts of all existing thoughts. An existing index
+ * is checked first and rebuilt if it's damaged or out of sync with thoughts,
+ * e.g. after the brain was changed by a version without the index. Returns
+ * false if FTS5 is not available.
+ */
+bool DatabaseBrainRepository::setupSearchIndex() {
+	QSqlQuery query = QSqlQuery(m_conn);
+	if (!query.exec(
+		"SELECT 1 FROM sqlite_master "
+		"WHERE type == 'table' AND name == 'search_index';"
+	)) {
+		return false;
+	}
+
+	bool exists = query.first();
+	query.finish();
+
+	if (exists) {
+		if (checkSearchIndex())
+			return true;
+
+		qDebug() << "DB: Search index is out of date, rebuilding...";
+		if (!query.exec("DELETE FROM search_index;"))
+			return false;
+	} else if (!query.exec(
+		"CREATE VIRTUAL TABLE search_index USING fts5("
+			"name, body, tokenize = 'unicode61 remove_diacritics 2'"
+		");"
+	)) {
+		qDebug() << "DB: Full text search is not available"
+			<< query.lastError().text();
+		return false;
+	}
+
+	return fillSearchIndex();
+}
+
+/**
+ * Returns true if the index is intact and has a row with the current name for
+ * every thought and no others. Note texts are not compared, as that would
+ * mean reading every file on open.
+ */
+bool DatabaseBrainRepository::checkSearchIndex() {
+	QSqlQuery query = QSqlQuery(m_conn);
+	if (!query.exec(
+		"INSERT INTO search_index (search_index, rank) "
+		"VALUES ('integrity-check', 0);"
+	)) {
+		qDebug() << "DB: Search index is damaged" << query.lastError().text();
+		return false;
+	}
+
+	if (!query.exec(
+		"SELECT "
+			"(SELECT count(*) FROM thoughts), "
+			"(SELECT count(*) FROM search_index), "
+			"(SELECT count(*) FROM thoughts t "
+				"JOIN search_index s ON s.rowid == t.id "
+				"WHERE s.name == t.name);"
+	)) {
+		return false;
+	}
+	if (!query.first())
+		return false;
+
+	qlonglong thoughts = query.value(0).toLongLong();
+	return query.value(1).toLongLong() == thoughts &&
+		query.value(2).toLongLong() == thoughts;
+}
+
+/**
+ * Adds names and texts of all thoughts to the empty index.
+ */
+bool DatabaseBrainRepository::fillSearchIndex() {
+	qDebug() << "DB: Building search index...";
+
+	QSqlQuery query = QSqlQuery(m_conn);
+	std::vector<ThoughtEntity> thoughts;
+	if (!query.exec("SELECT id, name FROM thoughts;"))
+		return false;
+	while (query.next()) {
+		thoughts.push_back(
+			ThoughtEntity(
+				query.value(0).toULongLong(),
+				query.value(1).toString().toStdString()
+			)
+		);
+	}
+	query.finish();
+
+	m_conn.transaction();
+	QSqlQuery insert = QSqlQuery(m_conn);
+	insert.prepare(statementQuery(StatementIndexInsert));
+
+	for (auto& thought: thoughts) {
+		QString text;
+		if (!readText(thought, &text))
+			text = QString();
+
+		insert.bindValue(":id", (qlonglong)thought.id);
+		insert.bindValue(":name", QString::fromStdString(thought.name));
+		insert.bindValue(":body", text);
+		if (!insert.exec()) {
+			qDebug() << "DB error:" << insert.lastError().text();
+			m_conn.rollback();
+			return false;
+		}
+	}
+
+	return m_conn.commit();
+}
+
+// Migrations.
+
+/**
+ * Schema changes made after the initial layout. Brain's schema version is
+ * kept in `PRAGMA user_version`, which equals the number of migrations already
+ * applied to it. On open, every migration past that number is run in order,
+ * so existing brains pick up new indexes and tables automatically.
+ *
+ * Migrations are only ever appended to this list. Never change or reorder
+ * the ones already released.
+ */
+static const std::vector<std::vector<QString>> migrations = {
+	// 1: Indexes for looking up connections by either end and type.
+	{
+		"CREATE INDEX IF NOT EXISTS conn_to_type ON connections (conn_to, conn_type);",
+		"CREATE INDEX IF NOT EXISTS conn_from_type ON connections (conn_from, conn_type);",
+	},
+};
+
+bool DatabaseBrainRepository::migrate(QSqlDatabase& db) {
+	QSqlQuery versionQuery = QSqlQuery("PRAGMA user_version;", db);
+	if (!versionQuery.exec() || !versionQuery.first())
+		return false;
+
+	size_t version = versionQuery.value(0).toULongLong();
+	versionQuery.finish();
+
+	for (size_t idx = version; idx < migrations.size(); idx++) {
+		qDebug() << "DB: Migrating schema to version" << (idx + 1);
+
+		if (!db.transaction())
+			return false;
+
+		for (auto& sql: migrations[idx]) {
+			QSqlQuery query = QSqlQuery(db);
+			if (!query.exec(sql)) {
+				qDebug() << "DB error:" << query.lastError().text();
+				db.rollback();
+				return false;
+			}
+		}
+
+		// PRAGMA doesn't take bound parameters.
+		QSqlQuery bumpQuery = QSqlQuery(db);
+		if (!bumpQuery.exec(QString("PRAGMA user_version = %1;").arg(idx + 1))) {
+			db.rollback();
+			return false;
+		}
+
+		if (!db.commit())
+			return false;
+	}
+
+	return true;
+}
+
+// Prepared statements.
+
+// Columns telling whether thought `t` has any parents, children or links.
+static const QString flagColumns = QString(
+	"EXISTS (SELECT 1 FROM connections "
+		"WHERE conn_to == t.id AND conn_type == :child), "
+	"EXISTS (SELECT 1 FROM connections "
+		"WHERE conn_from == t.id AND conn_type == :child), "
+	"EXISTS (SELECT 1 FROM connections "
+		"WHERE conn_from == t.id AND conn_type == :link) "
+	"OR EXISTS (SELECT 1 FROM connections "
+		"WHERE conn_to == t.id AND conn_type == :link) "
+);
+
+// Set of thoughts making up the neighborhood of the `root`: the thought
+// itself, its direct neighbors and its siblings.
+static const QString hoodTables = QString(
+	"parents(id) AS ("
+		"SELECT conn_from FROM connections "
+		"WHERE conn_to == :root AND conn_type == :child"
+	"), hood(id) AS ("
+		"SELECT :root "
+		"UNION SELECT conn_to FROM connections WHERE conn_from == :root "
+		"UNION SELECT conn_from FROM connections WHERE conn_to == :root "
+		"UNION SELECT c.conn_to FROM connections c "
+			"JOIN parents p ON c.conn_from == p.id "
+			"WHERE c.conn_type == :child"
+	")"
+);
+
+static const QString hoodQuery = "WITH " + hoodTables + " ";
+
+// Neighborhood and thoughts up to `depth` hops away from it, ranked by
+// distance, number of connections and age. The neighborhood is always there,
+// other thoughts only while the total is under `budget`.
+//
+// The walk goes breadth first and stops after `walk` rows past the
+// neighborhood, so it doesn't cover the whole area of a large brain just to
+// keep the budget. When that cuts a hop short, thoughts of that hop found
+// first are ranked instead of the best connected ones of the whole hop,
+// which GraphCache::loadArea picks.
+static const QString areaQuery = QString(
+	"WITH RECURSIVE " + hoodTables + ", "
+	"edges(a, b) AS ("
+		"SELECT conn_from, conn_to FROM connections "
+		"UNION ALL SELECT conn_to, conn_from FROM connections"
+	"), reach(id, hops) AS ("
+		"SELECT id, 1 FROM hood "
+		"UNION SELECT e.b, r.hops + 1 FROM reach r "
+			"JOIN edges e ON e.a == r.id "
+			"WHERE r.hops < :depth AND e.b NOT IN (SELECT id FROM hood) "
+		"LIMIT (SELECT COUNT(*) FROM hood) + :walk"
+	"), ranked(id, hops, degree) AS ("
+		"SELECT r.id, MIN(r.hops), "
+			"(SELECT COUNT(*) FROM connections WHERE conn_from == r.id) "
+			"+ (SELECT COUNT(*) FROM connections WHERE conn_to == r.id) "
+		"FROM reach r GROUP BY r.id"
+	"), area(id, rank) AS ("
+		"SELECT id, ROW_NUMBER() OVER (ORDER BY hops, degree DESC, id DESC) "
+		"FROM ranked"
+	"), picked(id, rank) AS ("
+		"SELECT id, rank FROM area "
+		"WHERE rank <= MAX(:budget, (SELECT COUNT(*) FROM hood))"
+	") "
+);
+
+QString DatabaseBrainRepository::statementQuery(Statement statement) {
+	switch (statement) {
+		case StatementGetThought:
+			return "SELECT id, name FROM thoughts WHERE id == :id;";
+		case StatementInsertThought:
+			return "INSERT INTO thoughts (id, name) VALUES (:id, :name);";
+		case StatementRenameThought:
+			return "UPDATE thoughts SET name = :name WHERE id == :id;";
+		case StatementDeleteThought:
+			return "DELETE FROM thoughts WHERE id == :id;";
+		case StatementThoughtFlags:
+			return "SELECT " + flagColumns + "FROM thoughts t WHERE t.id == :id;";
+		case StatementInsertConnection:
+			return "INSERT INTO connections (conn_from, conn_to, conn_type) "
+				"VALUES (:from, :to, :type);";
+		case StatementDeleteConnections:
+			return "DELETE FROM connections "
+				"WHERE (conn_from == :f AND conn_to == :t) "
+				"OR (conn_from == :t AND conn_to == :f);";
+		case StatementDeleteThoughtConnections:
+			return "DELETE FROM connections "
+				"WHERE conn_from == :id OR conn_to == :id;";
+		case StatementConnectedIds:
+			return "SELECT conn_to FROM connections WHERE conn_from == :id "
+				"UNION SELECT conn_from FROM connections WHERE conn_to == :id;";
+		case StatementNeighborhoodThoughts:
+			return hoodQuery +
+				"SELECT t.id, t.name, " + flagColumns +
+				"FROM thoughts t JOIN hood h ON h.id == t.id;";
+		case StatementNeighborhoodConnections:
+			return hoodQuery +
+				"SELECT conn_from, conn_to, conn_type FROM connections "
+				"WHERE conn_from IN (SELECT id FROM hood) "
+				"OR (conn_to IN (SELECT id FROM hood) AND conn_type == :link) "
+				"OR conn_to == :root;";
+		case StatementAreaThoughts:
+			return areaQuery +
+				"SELECT t.id, t.name, " + flagColumns +
+				"FROM thoughts t JOIN picked p ON p.id == t.id ORDER BY p.rank;";
+		case StatementAreaConnections:
+			return areaQuery +
+				"SELECT conn_from, conn_to, conn_type FROM connections "
+				"WHERE conn_from IN (SELECT id FROM picked) "
+				"OR (conn_to IN (SELECT id FROM picked) AND conn_type == :link) "
+				"OR conn_to == :root;";
+		case StatementSearch:
+			return "SELECT id, name FROM thoughts WHERE name LIKE :term "
+				"LIMIT :limit;";
+		case StatementSearchIndex:
+			// Matches in names weigh more than matches in notes.
+			return "SELECT rowid, name, "
+				"snippet(search_index, 1, '', '', '...', 12) "
+				"FROM search_index WHERE search_index MATCH :query "
+				"ORDER BY bm25(search_index, 10.0, 1.0) "
+				"LIMIT :limit;";
+		case StatementIndexInsert:
+			return "INSERT INTO search_index (rowid, name, body) "
+				"VALUES (:id, :name, :body);";
+		case StatementIndexRename:
+			return "UPDATE search_index SET name = :name WHERE rowid == :id;";
+		case StatementIndexText:
+			return "UPDATE search_index SET body = :body WHERE rowid == :id;";
+		case StatementIndexDelete:
+			return "DELETE FROM search_index WHERE rowid == :id;";
+		case StatementAllThoughts:
+			return "SELECT id, name FROM thoughts;";
+		case StatementAllConnections:
+			return "SELECT conn_from, conn_to, conn_type FROM connections;";
+		case StatementCount:
+			break;
+	}
+
+	// Should not reach here.
+	return QString();
+}
+
+/**
+ * Every statement the repository runs is prepared once, when the repository
+ * is created, and then reused with new bindings. This way SQLite doesn't
+ * parse and plan the same SQL over and over, and we skip QSqlTableModel's
+ * record machinery on hot paths like loading a neighborhood or searching.
+ */
+void DatabaseBrainRepository::prepareStatements() {
+	for (int idx = 0; idx < StatementCount; idx++) {
+		QSqlQuery *query = new QSqlQuery(m_conn);
+		query->setForwardOnly(true);
+		m_statements[idx] = query;
+
+		// Without the index, its statements would fail to prepare.
+		if (!m_fullText && isIndexStatement(Statement(idx)))
+			continue;
+
+		if (!query->prepare(statementQuery(Statement(idx)))) {
+			qDebug() << "DB: Failed to prepare statement" << idx
+				<< query->lastError().text();
+		}
+	}
+}
+
+bool DatabaseBrainRepository::isIndexStatement(Statement statement) {
+	switch (statement) {
+		case StatementSearchIndex:
+		case StatementIndexInsert:
+		case StatementIndexRename:
+		case StatementIndexText:
+		case StatementIndexDelete:
+			return true;
+		default:
+			return false;
+	}
+}
+
+QSqlQuery *DatabaseBrainRepository::statement(Statement statement) {
+	return m_statements[statement];
+}
+
+bool DatabaseBrainRepository::exec(QSqlQuery *query) {
+	m_queryCount++;
+
+	if (!query->exec()) {
+		qDebug() << "DB error:" << query->lastError().text();
+		query->finish();
+		return false;
+	}
+
+	// Postpone the checkpoint while the brain is being edited.
+	if (!query->isSelect() && m_checkpointer != nullptr)
+		m_checkpointer->touch();
+
+	return true;
+}
+
 // Graph interface.
 
 bool DatabaseBrainRepository::select(ThoughtId id) {
+	return select(id, 1, 0);
+}
+
+bool DatabaseBrainRepository::select(ThoughtId id, int depth, size_t budget) {
 	m_currentId = id;
+	m_depth = std::max(1, depth);
+	m_budget = budget;
 	return loadState(id);
 }
 
+State *DatabaseBrainRepository::loadSelection(
+	ThoughtId id,
+	int depth,
+	size_t budget
+) {
+	return makeState(id, std::max(1, depth), budget);
+}
+
+void DatabaseBrainRepository::setSelection(
+	ThoughtId id,
+	int depth,
+	size_t budget,
+	State *state
+) {
+	m_currentId = id;
+	m_depth = std::max(1, depth);
+	m_budget = budget;
+	m_change = StateChange(true);
+
+	if (m_state != nullptr)
+		delete m_state;
+	m_state = state;
+}
+
 const State* DatabaseBrainRepository::getState() const {
 	return m_state;
 }
 
+const StateChange* DatabaseBrainRepository::getChange() const {
+	return &m_change;
+}
+
 bool DatabaseBrainRepository::updateThought(
 	ThoughtId id, std::string& name
 ) {
@@ -204,18 +685,14 @@ bool DatabaseBrainRepository::updateThought(
 	if (name.empty())
 		return false;
 
-	// Update the database row.
-	QSqlTableModel model = QSqlTableModel(nullptr, m_conn);
-	model.setTable("thoughts");
-	model.setFilter(QString("id == %1").arg(id));
-	model.select();
-
-	if (model.rowCount() == 0) {
+	// Find the database row.
+	ThoughtEntity thought = getThought(id, &result);
+	if (!result) {
 		return false;
 	}
 
 	// Try to rename the file first.
-	QString oldName = model.record(0).value("name").toString();
+	QString oldName = QString::fromStdString(thought.name);
 	QString oldFileName = filePathFromName(oldName, id);
 	QString newFileName = filePathFromName(nameStr, id);
 
@@ -226,8 +703,29 @@ bool DatabaseBrainRepository::updateThought(
 			return false;
 	}
 
-	model.setData(model.index(0, 1), nameStr);
-	if (!model.submitAll()) {
+	// Update the database row and the search index.
+	result = beginTransaction();
+	if (result) {
+		QSqlQuery *query = statement(StatementRenameThought);
+		query->bindValue(":id", (qlonglong)id);
+		query->bindValue(":name", nameStr);
+		result = exec(query);
+
+		if (result && m_fullText) {
+			query = statement(StatementIndexRename);
+			query->bindValue(":id", (qlonglong)id);
+			query->bindValue(":name", nameStr);
+			result = exec(query);
+		}
+
+		if (result) {
+			result = commitTransaction();
+		} else {
+			rollbackTransaction();
+		}
+	}
+
+	if (!result) {
 		// Revert file name change.
 		QFile newFile = QFile(newFileName);
 		newFile.rename(oldFileName);
@@ -235,7 +733,18 @@ bool DatabaseBrainRepository::updateThought(
 		return false;
 	}
 
-	loadState(m_currentId);
+	undoOnRollback([newFileName, oldFileName]() {
+		QFile newFile = QFile(newFileName);
+		if (newFile.exists())
+			newFile.rename(oldFileName);
+	});
+	afterCommit([this, id, name]() {
+		if (m_cache != nullptr)
+			m_cache->renameThought(id, name);
+	});
+
+	if (!patchRenamed(id, name))
+		loadState(m_currentId);
 	return true;
 }
 
@@ -251,32 +760,62 @@ CreateResult DatabaseBrainRepository::createThought(
 	timespec_get(&ts, TIME_UTC);
 	qlonglong time = ts.tv_sec * 1000000000 + ts.tv_nsec;
 
-	QSqlTableModel model = QSqlTableModel(nullptr, m_conn);
-	model.setTable("thoughts");
+	if (!beginTransaction())
+		return CreateResult(false, InvalidThoughtId);
 
 	// Create a new record.
-	QSqlRecord record = model.record();
-	record.setValue("id", (qlonglong)time);
-	record.setValue("name", QString::fromStdString(text));
+	QSqlQuery *query = statement(StatementInsertThought);
+	query->bindValue(":id", (qlonglong)time);
+	query->bindValue(":name", QString::fromStdString(text));
 
-	if (!model.insertRecord(-1, record)) {
-		qDebug() << "DB error:" << model.lastError().text();
+	if (!exec(query)) {
+		rollbackTransaction();
 		return CreateResult(false, InvalidThoughtId);
 	}
 
-	// Create a connection.
+	// Create a connection. The thought is new, so there's nothing to
+	// disconnect first.
 	if (incoming) {
-		result = connectThoughts(time, fromId, type);
+		result = insertConnection(time, fromId, type);
 	} else {
-		result = connectThoughts(fromId, time, type);
+		result = insertConnection(fromId, time, type);
 	}
 
 	if (!result) {
+		rollbackTransaction();
 		return CreateResult(false, InvalidThoughtId);
 	}
 
-	// Reload state.
-	loadState(m_currentId);
+	if (m_fullText) {
+		query = statement(StatementIndexInsert);
+		query->bindValue(":id", (qlonglong)time);
+		query->bindValue(":name", QString::fromStdString(text));
+		query->bindValue(":body", QString());
+
+		if (!exec(query)) {
+			rollbackTransaction();
+			return CreateResult(false, InvalidThoughtId);
+		}
+	}
+
+	if (!commitTransaction())
+		return CreateResult(false, InvalidThoughtId);
+
+	// Update state.
+	afterCommit([this, time, text, fromId, type, incoming]() {
+		if (m_cache == nullptr)
+			return;
+
+		m_cache->addThought(time, text);
+		if (incoming) {
+			m_cache->connect(time, fromId, type);
+		} else {
+			m_cache->connect(fromId, time, type);
+		}
+	});
+
+	if (!patchCreated(fromId, time, text, type, incoming))
+		loadState(m_currentId);
 	return CreateResult(true, time);
 }
 
@@ -285,164 +824,402 @@ bool DatabaseBrainRepository::connectThoughts(
 	ThoughtId toId,
 	ConnectionType type
 ) {
-	bool result = false;
-
-	result = disconnectThoughts(fromId, toId);
-	if (!result)
-		return false;
-
 	if (fromId == toId)
 		return false;
 
-	QSqlTableModel model = QSqlTableModel(nullptr, m_conn);
-	model.setTable("connections");
-
-	QSqlRecord record = model.record();
-	record.setValue("conn_from", (qlonglong)fromId);
-	record.setValue("conn_to", (qlonglong)toId);
-	record.setValue("conn_type", type);
+	if (!beginTransaction())
+		return false;
 
-	if (!model.insertRecord(-1, record)) {
-		qDebug("DB: Failed to insert connection record");
+	// Replace whatever connection existed between the two thoughts.
+	if (!deleteConnections(fromId, toId) || !insertConnection(fromId, toId, type)) {
+		rollbackTransaction();
 		return false;
 	}
 
-	loadState(m_currentId);
+	if (!commitTransaction())
+		return false;
+
+	afterCommit([this, fromId, toId, type]() {
+		if (m_cache != nullptr)
+			m_cache->connect(fromId, toId, type);
+	});
+
+	if (!patchConnected(fromId, toId, type))
+		loadState(m_currentId);
 	return true;
 }
 
 bool DatabaseBrainRepository::deleteThought(ThoughtId id) {
 	bool result = false;
-	QSqlQuery query;
+	QSqlQuery *query = nullptr;
 
 	ThoughtEntity thought = getThought(id, &result);
 	if (!result) {
 		return false;
 	}
 
+	// Remember connected thoughts to update them in the state.
+	std::vector<ThoughtId> connected;
+	bool canPatch = getConnectedIds(id, &connected);
+
+	if (!beginTransaction())
+		return false;
+
 	// Clear connections.
-	query = QSqlQuery(nullptr, m_conn);
-	query.prepare(
-		"DELETE FROM connections WHERE (conn_from == :f OR conn_to == :f)"
-	);
-	query.bindValue(":f", (qlonglong)id);
+	query = statement(StatementDeleteThoughtConnections);
+	query->bindValue(":id", (qlonglong)id);
 
-	result = query.exec();
-	if (!result)
+	if (!exec(query)) {
+		rollbackTransaction();
 		return false;
+	}
 
 	// Delete the thought from the DB.
-	query = QSqlQuery(nullptr, m_conn);
-	query.prepare(
-		"DELETE FROM thoughts WHERE (id == :tid)"
-	);
-	query.bindValue(":tid", (qlonglong)id);
+	query = statement(StatementDeleteThought);
+	query->bindValue(":id", (qlonglong)id);
 
-	result = query.exec();
-	if (!result)
+	if (!exec(query)) {
+		rollbackTransaction();
 		return false;
+	}
 
-	// Delete the text file.
-	QString filePath = filePathFromThought(thought);
-	QFile file = QFile(filePath);
-	if (file.exists()) {
-		file.remove();
+	if (m_fullText) {
+		query = statement(StatementIndexDelete);
+		query->bindValue(":id", (qlonglong)id);
+
+		if (!exec(query)) {
+			rollbackTransaction();
+			return false;
+		}
 	}
 
-	loadState(m_currentId);
+	if (!commitTransaction())
+		return false;
+
+	// Delete the text file only after the records are gone for good, which
+	// is after the outermost transaction is committed.
+	QString filePath = filePathFromThought(thought);
+	afterCommit([this, id, filePath]() {
+		QFile file = QFile(filePath);
+		if (file.exists()) {
+			file.remove();
+		}
+
+		if (m_cache != nullptr)
+			m_cache->removeThought(id);
+	});
+
+	if (!canPatch || !patchDeleted(id, connected))
+		loadState(m_currentId);
 	return true;
 }
 
 bool DatabaseBrainRepository::disconnectThoughts(
 	ThoughtId from, ThoughtId to
 ) {
-	bool result = false;
-	QSqlQuery query;
-
-	qDebug() << "DB: Deleting connections between" << from << "and" << to;
-
-	// Clear connections.
-	query = QSqlQuery(nullptr, m_conn);
-	query.prepare("DELETE FROM connections WHERE (conn_from == :f AND conn_to == :t) OR (conn_from == :t AND conn_to == :f)");
-	query.bindValue(":f", (qlonglong)from);
-	query.bindValue(":t", (qlonglong)to);
-
-	result = query.exec();
-	if (!result)
+	if (!deleteConnections(from, to))
 		return false;
 
-	qDebug() << "DB: Deleted connections between" << from << "and" << to;
+	afterCommit([this, from, to]() {
+		if (m_cache != nullptr)
+			m_cache->disconnect(from, to);
+	});
 
-	loadState(m_currentId);
+	if (!patchDisconnected(from, to))
+		loadState(m_currentId);
 	return true;
 }
 
-// SearchRepository.
+// Transactions.
 
-SearchResult DatabaseBrainRepository::search(std::string term) {
-	int idx;
-	std::vector<SearchItem> result;
-	QString qterm = QString::fromStdString(term);
+/**
+ * Transactions can be nested: only the outermost pair of begin/commit talks
+ * to the database, so compound operations like createThought can be batched
+ * into a bigger unit of work by the caller and still be committed once.
+ *
+ * Rolling back at any level dooms the whole transaction. The outermost commit
+ * will then roll everything back and report a failure. Since the state may
+ * have been patched by operations that are now undone, it's reloaded after
+ * every rollback.
+ *
+ * Changes outside of the database, like removal of text files and updates of
+ * the cache, wait for the outermost commit and are dropped on rollback.
+ */
+bool DatabaseBrainRepository::beginTransaction() {
+	if (m_transactionDepth == 0) {
+		if (!m_conn.transaction()) {
+			qDebug() << "DB: Failed to begin transaction"
+				<< m_conn.lastError().text();
+			return false;
+		}
+		m_transactionFailed = false;
+	}
 
-	QSqlTableModel model(nullptr, m_conn);
-	model.setTable("thoughts");
-	model.setFilter(
-		QString("name LIKE '%%%1%%'").arg(qterm)
-	);
+	m_transactionDepth++;
+	return true;
+}
 
-	model.select();
+bool DatabaseBrainRepository::commitTransaction() {
+	if (m_transactionDepth == 0)
+		return false;
 
-	for (idx = 0; idx < model.rowCount(); idx++) {
-		QSqlRecord record = model.record(idx);
-		qDebug() << "DB: loading search record" << idx;
+	m_transactionDepth--;
+	if (m_transactionDepth > 0)
+		return !m_transactionFailed;
 
-		result.push_back(
-			SearchItem{
-				.id = record.value("id").toULongLong(),
-				.name = record.value("name").toString().toStdString(),
-			}
-		);
+	if (m_transactionFailed) {
+		finishRollback();
+		return false;
 	}
 
-	return SearchResult{
-		.error = SearchErrorNone,
-		.items = result,
-	};
-}
+	if (!m_conn.commit()) {
+		qDebug() << "DB: Failed to commit transaction"
+			<< m_conn.lastError().text();
+		finishRollback();
+		return false;
+	}
 
-// TextRepository.
+	std::vector<std::function<void()>> pending;
+	pending.swap(m_pendingCommit);
+	m_pendingRollback.clear();
+	for (auto& apply: pending)
+		apply();
 
-GetResult DatabaseBrainRepository::getText(ThoughtId id) {
-	bool result = false;
+	return true;
+}
 
-	ThoughtEntity thought = getThought(id, &result);
-	if (!result) {
-		return GetResult(TextRepositoryErrorIO, "");
-	}
+bool DatabaseBrainRepository::rollbackTransaction() {
+	if (m_transactionDepth == 0)
+		return false;
 
-	QString filePath = filePathFromThought(thought);
-	QFile file = QFile(filePath);
+	m_transactionDepth--;
+	m_transactionFailed = true;
+	if (m_transactionDepth > 0)
+		return true;
 
-	if (!file.exists()) {
-		return GetResult(TextRepositoryErrorNone, "");
-	}
+	return finishRollback();
+}
 
-	if (!file.open(QFile::ReadOnly | QFile::Text)) {
-		return GetResult(TextRepositoryErrorIO, "");
+bool DatabaseBrainRepository::finishRollback() {
+	bool result = m_conn.rollback();
+	if (!result) {
+		qDebug() << "DB: Failed to roll back transaction"
+			<< m_conn.lastError().text();
 	}
 
-	QTextStream in = QTextStream(&file);
-	QString content = in.readAll();
-	file.close();
+	m_transactionFailed = false;
 
-	// Get rid of the header and/or other metadata.
-	QString name = QString::fromStdString(thought.name);
-	QString curedContent = stripMetadata(content, name);
+	// Changes waiting for the commit are dropped, the ones already made are
+	// undone in reverse order.
+	std::vector<std::function<void()>> pending;
+	pending.swap(m_pendingRollback);
+	m_pendingCommit.clear();
+	for (auto undo = pending.rbegin(); undo != pending.rend(); undo++)
+		(*undo)();
 
-	return GetResult(TextRepositoryErrorNone, curedContent);
+	loadState(m_currentId);
+	return result;
 }
 
-SaveResult DatabaseBrainRepository::saveText(
+void DatabaseBrainRepository::afterCommit(std::function<void()> apply) {
+	if (m_transactionDepth == 0) {
+		apply();
+	} else {
+		m_pendingCommit.push_back(apply);
+	}
+}
+
+void DatabaseBrainRepository::undoOnRollback(std::function<void()> undo) {
+	if (m_transactionDepth > 0)
+		m_pendingRollback.push_back(undo);
+}
+
+// Connection helpers.
+
+bool DatabaseBrainRepository::insertConnection(
+	ThoughtId fromId,
+	ThoughtId toId,
+	ConnectionType type
+) {
+	QSqlQuery *query = statement(StatementInsertConnection);
+	query->bindValue(":from", (qlonglong)fromId);
+	query->bindValue(":to", (qlonglong)toId);
+	query->bindValue(":type", type);
+
+	if (!exec(query)) {
+		qDebug("DB: Failed to insert connection record");
+		return false;
+	}
+
+	return true;
+}
+
+bool DatabaseBrainRepository::deleteConnections(
+	ThoughtId from, ThoughtId to
+) {
+	qDebug() << "DB: Deleting connections between" << from << "and" << to;
+
+	// Clear connections.
+	QSqlQuery *query = statement(StatementDeleteConnections);
+	query->bindValue(":f", (qlonglong)from);
+	query->bindValue(":t", (qlonglong)to);
+
+	if (!exec(query))
+		return false;
+
+	qDebug() << "DB: Deleted connections between" << from << "and" << to;
+	return true;
+}
+
+// SearchRepository.
+
+SearchResult DatabaseBrainRepository::search(std::string term) {
+	return searchTop(term, searchLimit, SearchScopeAll);
+}
+
+/**
+ * Names are always matched by substring, so a part of a word finds the
+ * thought too. With the full text index, matches by words of names and notes
+ * come first, followed by the rest of the name matches.
+ */
+SearchResult DatabaseBrainRepository::searchTop(
+	std::string term,
+	size_t limit,
+	SearchScope scope
+) {
+	QString qterm = QString::fromStdString(term);
+
+	if (!m_fullText || scope == SearchScopeNames)
+		return searchNames(qterm, limit);
+
+	SearchResult result = searchIndex(qterm, limit);
+	if (result.error != SearchErrorNone || result.items.size() >= limit)
+		return result;
+
+	// Name matches the index has found are fetched again, so ask for enough
+	// to fill the limit anyway.
+	SearchResult names = searchNames(qterm, limit);
+	if (names.error != SearchErrorNone)
+		return names;
+
+	std::unordered_set<ThoughtId> found;
+	for (auto& item: result.items)
+		found.insert(item.id);
+
+	for (auto& item: names.items) {
+		if (result.items.size() >= limit)
+			break;
+		if (found.count(item.id) == 0)
+			result.items.push_back(item);
+	}
+
+	return result;
+}
+
+SearchResult DatabaseBrainRepository::searchNames(QString term, size_t limit) {
+	std::vector<SearchItem> result;
+
+	QSqlQuery *query = statement(StatementSearch);
+	query->bindValue(":term", QString("%%1%").arg(term));
+	query->bindValue(":limit", (qlonglong)limit);
+
+	if (!exec(query)) {
+		return SearchResult{
+			.error = SearchErrorIO,
+			.items = result,
+		};
+	}
+
+	while (query->next()) {
+		result.push_back(
+			SearchItem{
+				.id = query->value(0).toULongLong(),
+				.name = query->value(1).toString().toStdString(),
+			}
+		);
+	}
+	query->finish();
+
+	return SearchResult{
+		.error = SearchErrorNone,
+		.items = result,
+	};
+}
+
+/**
+ * Full text search. Every word of the term is matched as a prefix of a word
+ * in either the name or the text of a thought. Results are ordered by
+ * relevance and come with a fragment of the text around the match.
+ */
+SearchResult DatabaseBrainRepository::searchIndex(QString term, size_t limit) {
+	std::vector<SearchItem> result;
+
+	QStringList words = term.split(
+		QRegularExpression("\\s+"),
+		Qt::SkipEmptyParts
+	);
+	if (words.isEmpty()) {
+		return SearchResult{
+			.error = SearchErrorNone,
+			.items = result,
+		};
+	}
+
+	// Quote every word, so FTS syntax characters are taken literally.
+	QStringList tokens;
+	for (auto& word: words) {
+		tokens.push_back(
+			QString("\"%1\"*").arg(QString(word).replace("\"", "\"\""))
+		);
+	}
+
+	QSqlQuery *query = statement(StatementSearchIndex);
+	query->bindValue(":query", tokens.join(" "));
+	query->bindValue(":limit", (qlonglong)limit);
+
+	if (!exec(query)) {
+		return SearchResult{
+			.error = SearchErrorIO,
+			.items = result,
+		};
+	}
+
+	while (query->next()) {
+		result.push_back(
+			SearchItem{
+				.id = query->value(0).toULongLong(),
+				.name = query->value(1).toString().toStdString(),
+				.snippet = query->value(2).toString().toStdString(),
+			}
+		);
+	}
+	query->finish();
+
+	return SearchResult{
+		.error = SearchErrorNone,
+		.items = result,
+	};
+}
+
+// TextRepository.
+
+GetResult DatabaseBrainRepository::getText(ThoughtId id) {
+	bool result = false;
+
+	ThoughtEntity thought = getThought(id, &result);
+	if (!result) {
+		return GetResult(TextRepositoryErrorIO, "");
+	}
+
+	QString text;
+	if (!readText(thought, &text)) {
+		return GetResult(TextRepositoryErrorIO, "");
+	}
+
+	return GetResult(TextRepositoryErrorNone, text);
+}
+
+SaveResult DatabaseBrainRepository::saveText(
 	ThoughtId id,
 	QString text
 ) {
@@ -469,11 +1246,44 @@ SaveResult DatabaseBrainRepository::saveText(
 	out << enrichedContent;
 	file.close();
 
+	// The text is saved anyway, so a failure here only makes search results
+	// stale until the next save.
+	if (m_fullText) {
+		QSqlQuery *query = statement(StatementIndexText);
+		query->bindValue(":id", (qlonglong)id);
+		query->bindValue(":body", text);
+		if (!exec(query))
+			qDebug() << "DB: Failed to index text of" << id;
+	}
+
 	return SaveResult(TextRepositoryErrorNone);
 }
 
 // Helpers.
 
+bool DatabaseBrainRepository::readText(ThoughtEntity& thought, QString *text) {
+	QString filePath = filePathFromThought(thought);
+	QFile file = QFile(filePath);
+
+	if (!file.exists()) {
+		*text = QString();
+		return true;
+	}
+
+	if (!file.open(QFile::ReadOnly | QFile::Text)) {
+		return false;
+	}
+
+	QTextStream in = QTextStream(&file);
+	QString content = in.readAll();
+	file.close();
+
+	// Get rid of the header and/or other metadata.
+	QString name = QString::fromStdString(thought.name);
+	*text = stripMetadata(content, name);
+	return true;
+}
+
 QString DatabaseBrainRepository::filePathFromThought(
 	ThoughtEntity& thought
 ) {
@@ -495,28 +1305,59 @@ QString DatabaseBrainRepository::filePathFromName(
 }
 
 bool DatabaseBrainRepository::loadState(ThoughtId rootId) {
-	bool success = false;
+	m_change = StateChange(true);
 
-	if (m_state != nullptr)
+	if (m_state != nullptr) {
 		delete m_state;
+		m_state = nullptr;
+	}
 
+	m_state = makeState(rootId, m_depth, m_budget);
+	return m_state != nullptr;
+}
+
+/**
+ * Builds the state of a selection from the database, or from the cache
+ * outside of transactions. Doesn't touch the current state.
+ */
+State *DatabaseBrainRepository::makeState(
+	ThoughtId rootId,
+	int depth,
+	size_t budget
+) {
 	qDebug() << "DB: Reloading state";
 
+	// Fetch everything we need in bulk.
+	NeighborhoodEntity hood(rootId);
+	bool loaded = false;
+	// Cache doesn't have changes of the open transaction yet.
+	bool cached = m_cache != nullptr && m_transactionDepth == 0;
+	if (depth > 1) {
+		loaded = cached
+			? m_cache->loadArea(rootId, depth, budget, &hood)
+			: loadArea(rootId, depth, budget, &hood);
+	} else {
+		loaded = cached
+			? m_cache->loadNeighborhood(rootId, &hood)
+			: loadNeighborhood(rootId, &hood);
+	}
+	if (!loaded)
+		return nullptr;
+
 	// Find root.
-	ThoughtEntity root = getThought(rootId, &success);
-	if (!success)
-		return false;
+	const NeighborhoodEntity::Node *root = hood.getThought(rootId);
+	if (root == nullptr)
+		return nullptr;
 
-	qDebug() << "Thought loaded:" << root.id << root.name;
-	qDebug() << "DB: Getting connections";
+	qDebug() << "Thought loaded:" << root->thought.id << root->thought.name;
 
-	std::vector<ConnectionEntity> childConns = getChildren(rootId);
-	std::vector<ConnectionEntity> parentConns = getParents(rootId);
-	std::vector<ConnectionEntity> linkConns = getLinks(rootId);
+	std::vector<ConnectionEntity> childConns = hood.getChildren(rootId);
+	std::vector<ConnectionEntity> parentConns = hood.getParents(rootId);
+	std::vector<ConnectionEntity> linkConns = hood.getLinks(rootId);
 
 	Thought *center = new Thought(
 		rootId,
-		std::string(root.name),
+		std::string(root->thought.name),
 		parentConns.size() > 0,
 		childConns.size() > 0,
 		linkConns.size() > 0
@@ -528,20 +1369,20 @@ bool DatabaseBrainRepository::loadState(ThoughtId rootId) {
 	// Children.
 	std::vector<ThoughtId> children;
 	for (auto& c: childConns) {
-		ThoughtEntity entity = getThought(c.to, &success);
-		if (!success)
+		const NeighborhoodEntity::Node *node = hood.getThought(c.to);
+		if (node == nullptr)
 			continue;
 
 		Thought *thought = new Thought(
-			entity.id,
-			std::string(entity.name),
-			getParents(entity.id).size() > 0,
-			getChildren(entity.id).size() > 0,
-			getLinks(entity.id).size() > 0
+			node->thought.id,
+			std::string(node->thought.name),
+			node->hasParents,
+			node->hasChildren,
+			node->hasLinks
 		);
 
-		children.push_back(entity.id);
-		siblings->insert({entity.id, thought});
+		children.push_back(node->thought.id);
+		siblings->insert({node->thought.id, thought});
 	}
 
 	center->children() = children;
@@ -549,20 +1390,20 @@ bool DatabaseBrainRepository::loadState(ThoughtId rootId) {
 	// Parents.
 	std::vector<ThoughtId> parents;
 	for (auto& c: parentConns) {
-		ThoughtEntity entity = getThought(c.from, &success);
-		if (!success)
+		const NeighborhoodEntity::Node *node = hood.getThought(c.from);
+		if (node == nullptr)
 			continue;
 
 		Thought *thought = new Thought(
-			entity.id,
-			std::string(entity.name),
-			getParents(entity.id).size() > 0,
-			getChildren(entity.id).size() > 0,
-			getLinks(entity.id).size() > 0
+			node->thought.id,
+			std::string(node->thought.name),
+			node->hasParents,
+			node->hasChildren,
+			node->hasLinks
 		);
 
-		parents.push_back(entity.id);
-		siblings->insert({entity.id, thought});
+		parents.push_back(node->thought.id);
+		siblings->insert({node->thought.id, thought});
 	}
 
 	center->parents() = parents;
@@ -571,20 +1412,20 @@ bool DatabaseBrainRepository::loadState(ThoughtId rootId) {
 	std::vector<ThoughtId> links;
 	for (auto& c: linkConns) {
 		ThoughtId linkId = (c.to == rootId ? c.from : c.to);
-		ThoughtEntity entity = getThought(linkId, &success);
-		if (!success)
+		const NeighborhoodEntity::Node *node = hood.getThought(linkId);
+		if (node == nullptr)
 			continue;
 
 		Thought *thought = new Thought(
-			entity.id,
-			std::string(entity.name),
-			getParents(entity.id).size() > 0,
-			getChildren(entity.id).size() > 0,
-			getLinks(entity.id).size() > 0
+			node->thought.id,
+			std::string(node->thought.name),
+			node->hasParents,
+			node->hasChildren,
+			node->hasLinks
 		);
 
-		links.push_back(entity.id);
-		siblings->insert({entity.id, thought});
+		links.push_back(node->thought.id);
+		siblings->insert({node->thought.id, thought});
 	}
 
 	center->links() = links;
@@ -592,29 +1433,29 @@ bool DatabaseBrainRepository::loadState(ThoughtId rootId) {
 	// Siblings.
 	std::vector<ThoughtId> siblingIds;
 	for (auto& parent: parents) {
-		for (auto& c: getChildren(parent)) {
+		for (auto& c: hood.getChildren(parent)) {
 			// Don't load those already loaded as links.
 			if (!listContains(links, c.to) && !listContains(parents, c.to)) {
-				if (auto found = getThought(c.to, &success); success) {
+				if (auto found = hood.getThought(c.to); found != nullptr) {
 					// Don't add duplicates if sibling has multiple parents.
 					if (!listContains(siblingIds, c.to)) {
 						siblingIds.push_back(c.to);
 
 						// Don't overwrite existing nodes.
 						if (
-							auto existing = siblings->find(found.id);
+							auto existing = siblings->find(found->thought.id);
 							existing == siblings->end()
 						) {
 							// Load thought and add to the map.
 							Thought *thought = new Thought(
-								found.id,
-								found.name,
-								getParents(found.id).size() > 0,
-								getChildren(found.id).size() > 0,
-								getLinks(found.id).size() > 0
+								found->thought.id,
+								found->thought.name,
+								found->hasParents,
+								found->hasChildren,
+								found->hasLinks
 							);
 
-							siblings->insert({found.id, thought});
+							siblings->insert({found->thought.id, thought});
 						}
 					}
 				}
@@ -632,13 +1473,13 @@ bool DatabaseBrainRepository::loadState(ThoughtId rootId) {
 			if (auto node = siblings->find(id); node != siblings->end()) {
 				Thought *thought = node->second;
 
-				std::vector<ConnectionEntity> childConns = getChildren(id);
+				std::vector<ConnectionEntity> childConns = hood.getChildren(id);
 				std::vector<ThoughtId> nchilds;
 				for (auto &c: childConns)
 					nchilds.push_back(c.to);
 				thought->children() = nchilds;
 
-				std::vector<ConnectionEntity> linkConns = getLinks(id);
+				std::vector<ConnectionEntity> linkConns = hood.getLinks(id);
 
 				std::vector<ThoughtId> nlinks;
 				for (auto &c: linkConns) {
@@ -662,11 +1503,179 @@ bool DatabaseBrainRepository::loadState(ThoughtId rootId) {
 		}
 	}
 
+	// Thoughts further away.
+	hood.addOuterThoughts(siblings);
+
 	qDebug() << "DB: creating state";
 
 	// Construct state.
-	State *state = new State(m_rootId, center, siblings);
-	m_state = state;
+	return new State(m_rootId, center, siblings);
+}
+
+/**
+ * Loads the neighborhood of a thought in two statements, regardless of the
+ * number of neighbors:
+ *
+ * 1. The root, its direct neighbors and its siblings (children of its
+ *    parents), together with flags telling whether each of them has any
+ *    parents, children or links.
+ * 2. All connections needed to assemble the State: everything going out of
+ *    the nodes from step 1, links coming into them, and the root's parents.
+ *
+ * Both statements share the same CTE describing the set of nodes, so SQLite
+ * resolves the neighborhood with joins instead of per-node lookups.
+ */
+bool DatabaseBrainRepository::loadNeighborhood(
+	ThoughtId rootId,
+	NeighborhoodEntity *result
+) {
+	// Nodes.
+	QSqlQuery *nodes = statement(StatementNeighborhoodThoughts);
+	nodes->bindValue(":root", (qlonglong)rootId);
+	nodes->bindValue(":child", ConnectionType::child);
+	nodes->bindValue(":link", ConnectionType::link);
+
+	if (!exec(nodes))
+		return false;
+
+	while (nodes->next()) {
+		result->addThought(
+			ThoughtEntity(
+				nodes->value(0).toULongLong(),
+				nodes->value(1).toString().toStdString()
+			),
+			nodes->value(2).toBool(),
+			nodes->value(3).toBool(),
+			nodes->value(4).toBool()
+		);
+	}
+	nodes->finish();
+
+	// Connections.
+	QSqlQuery *conns = statement(StatementNeighborhoodConnections);
+	conns->bindValue(":root", (qlonglong)rootId);
+	conns->bindValue(":child", ConnectionType::child);
+	conns->bindValue(":link", ConnectionType::link);
+
+	if (!exec(conns))
+		return false;
+
+	while (conns->next()) {
+		result->addConnection(
+			ConnectionEntity(
+				conns->value(0).toULongLong(),
+				conns->value(1).toULongLong(),
+				ConnectionType(conns->value(2).toInt())
+			)
+		);
+	}
+	conns->finish();
+
+	return true;
+}
+
+/**
+ * Loads the neighborhood with thoughts further away, up to the given depth
+ * and budget. Same two statements as loadNeighborhood, but the set of nodes
+ * is walked by a recursive CTE and ranked in SQL.
+ */
+bool DatabaseBrainRepository::loadArea(
+	ThoughtId rootId,
+	int depth,
+	size_t budget,
+	NeighborhoodEntity *result
+) {
+	// Nodes.
+	QSqlQuery *nodes = statement(StatementAreaThoughts);
+	nodes->bindValue(":root", (qlonglong)rootId);
+	nodes->bindValue(":child", ConnectionType::child);
+	nodes->bindValue(":link", ConnectionType::link);
+	nodes->bindValue(":depth", depth);
+	nodes->bindValue(":budget", (qlonglong)budget);
+	nodes->bindValue(":walk", (qlonglong)(budget * areaWalkFactor));
+
+	if (!exec(nodes))
+		return false;
+
+	while (nodes->next()) {
+		result->addThought(
+			ThoughtEntity(
+				nodes->value(0).toULongLong(),
+				nodes->value(1).toString().toStdString()
+			),
+			nodes->value(2).toBool(),
+			nodes->value(3).toBool(),
+			nodes->value(4).toBool()
+		);
+	}
+	nodes->finish();
+
+	// Connections.
+	QSqlQuery *conns = statement(StatementAreaConnections);
+	conns->bindValue(":root", (qlonglong)rootId);
+	conns->bindValue(":child", ConnectionType::child);
+	conns->bindValue(":link", ConnectionType::link);
+	conns->bindValue(":depth", depth);
+	conns->bindValue(":budget", (qlonglong)budget);
+	conns->bindValue(":walk", (qlonglong)(budget * areaWalkFactor));
+
+	if (!exec(conns))
+		return false;
+
+	while (conns->next()) {
+		result->addConnection(
+			ConnectionEntity(
+				conns->value(0).toULongLong(),
+				conns->value(1).toULongLong(),
+				ConnectionType(conns->value(2).toInt())
+			)
+		);
+	}
+	conns->finish();
+
+	return true;
+}
+
+/**
+ * Reads the whole graph into the in-memory cache. Done once when the brain is
+ * opened, after that the cache is updated along with the database.
+ */
+bool DatabaseBrainRepository::loadCache() {
+	std::vector<ThoughtEntity> thoughts;
+	std::vector<ConnectionEntity> connections;
+
+	QSqlQuery *query = statement(StatementAllThoughts);
+	if (!exec(query))
+		return false;
+
+	while (query->next()) {
+		thoughts.push_back(
+			ThoughtEntity(
+				query->value(0).toULongLong(),
+				query->value(1).toString().toStdString()
+			)
+		);
+	}
+	query->finish();
+
+	query = statement(StatementAllConnections);
+	if (!exec(query))
+		return false;
+
+	while (query->next()) {
+		connections.push_back(
+			ConnectionEntity(
+				query->value(0).toULongLong(),
+				query->value(1).toULongLong(),
+				ConnectionType(query->value(2).toInt())
+			)
+		);
+	}
+	query->finish();
+
+	m_cache->build(thoughts, connections);
+	qDebug() << "DB: Cached" << m_cache->size() << "thoughts,"
+		<< m_cache->memoryUsage() << "bytes";
 	return true;
 }
 
@@ -674,81 +1683,413 @@ ThoughtEntity DatabaseBrainRepository::getThought(
 	ThoughtId id,
 	bool *success
 ) {
-	QSqlTableModel model(nullptr, m_conn);
-	model.setTable("thoughts");
-	model.setFilter(QString("id == %1").arg(id));
-	model.select();
+	QSqlQuery *query = statement(StatementGetThought);
+	query->bindValue(":id", (qlonglong)id);
 
-	if (model.rowCount() > 0) {
+	if (exec(query) && query->next()) {
 		*success = true;
-		QSqlRecord rec = model.record(0);
-		return ThoughtEntity(
-			rec.value("id").toULongLong(),
-			rec.value("name").toString().toStdString()
+		ThoughtEntity result = ThoughtEntity(
+			query->value(0).toULongLong(),
+			query->value(1).toString().toStdString()
 		);
+		query->finish();
+		return result;
 	} else {
 		*success = false;
+		query->finish();
 		return ThoughtEntity(InvalidThoughtId, "");
 	}
 }
 
-std::vector<ConnectionEntity> DatabaseBrainRepository::getParents(
-	ThoughtId fromId
+// Incremental state updates.
+//
+// Most edits only touch a handful of thoughts in the loaded State, so instead
+// of rebuilding the whole neighborhood we patch the State in place, following
+// the same rules loadState() uses to build it. Which list a thought belongs to
+// (links, siblings, children, parents) only depends on connections of the
+// central thought and its parents, so edits touching either of those are not
+// patched. In that case patch methods return false, and the caller falls back
+// to a full reload. States loaded further than the direct neighborhood are
+// patched in place for renames. For other edits the area is loaded again and
+// compared with the loaded State, see patchArea().
+
+bool DatabaseBrainRepository::patchRenamed(ThoughtId id, std::string& name) {
+	if (m_state == nullptr)
+		return false;
+
+	m_change = StateChange(false);
+	for (auto *thought: stateThoughts(id)) {
+		thought->name() = name;
+		m_change.update(id);
+	}
+
+	return true;
+}
+
+bool DatabaseBrainRepository::patchCreated(
+	ThoughtId fromId,
+	ThoughtId id,
+	std::string& name,
+	ConnectionType type,
+	bool incoming
 ) {
-	return getConnections(fromId, ConnectionType::child, false);
+	if (m_state == nullptr)
+		return false;
+	if (m_depth > 1)
+		return patchArea();
+
+	Thought *center = m_state->centralThought();
+	std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
+
+	// New neighbor of the central thought.
+	if (fromId == center->id()) {
+		Thought *thought = nullptr;
+
+		if (type == ConnectionType::link) {
+			thought = new Thought(id, name, false, false, true);
+			thought->links().push_back(fromId);
+			center->links().push_back(id);
+			for (auto *node: stateThoughts(fromId))
+				node->hasLinks() = true;
+		} else if (!incoming) {
+			thought = new Thought(id, name, true, false, false);
+			for (auto *node: stateThoughts(fromId)) {
+				node->children().push_back(id);
+				node->hasChildren() = true;
+			}
+		} else {
+			// The first parent turns the central thought into a sibling of
+			// itself. Leave that to loadState().
+			if (center->parents().empty())
+				return false;
+
+			thought = new Thought(id, name, false, true, false);
+			thought->children().push_back(fromId);
+			center->parents().push_back(id);
+		}
+
+		m_change = StateChange(false);
+		thoughts->insert({id, thought});
+		m_change.add(id);
+		m_change.update(fromId);
+		return true;
+	}
+
+	m_change = StateChange(false);
+
+	// Connected to a thought outside of the State, nothing to update.
+	auto found = thoughts->find(fromId);
+	if (found == thoughts->end())
+		return true;
+
+	Thought *from = found->second;
+	if (type == ConnectionType::link) {
+		from->links().push_back(id);
+		from->hasLinks() = true;
+	} else if (incoming) {
+		from->hasParents() = true;
+	} else {
+		from->children().push_back(id);
+		from->hasChildren() = true;
+
+		// Children of central thought's parents are its siblings.
+		if (listContains(center->parents(), fromId)) {
+			thoughts->insert({id, new Thought(id, name, true, false, false)});
+			m_change.add(id);
+		}
+	}
+
+	m_change.update(fromId);
+	return true;
 }
 
-std::vector<ConnectionEntity> DatabaseBrainRepository::getLinks(
-	ThoughtId fromId
+bool DatabaseBrainRepository::patchConnected(
+	ThoughtId fromId,
+	ThoughtId toId,
+	ConnectionType type
 ) {
-	auto from = getConnections(fromId, ConnectionType::link, true);
-	auto to = getConnections(fromId, ConnectionType::link, false);
+	if (m_state == nullptr)
+		return false;
+	if (m_depth > 1)
+		return patchArea();
+	if (!isPatchable(fromId) || !isPatchable(toId))
+		return false;
+
+	m_change = StateChange(false);
+
+	// Any previous connection between the two was replaced.
+	for (auto *thought: stateThoughts(fromId)) {
+		removeId(thought->children(), toId);
+		removeId(thought->links(), toId);
+	}
+	for (auto *thought: stateThoughts(toId)) {
+		removeId(thought->children(), fromId);
+		removeId(thought->links(), fromId);
+	}
 
-	for (auto& node: to)
-		from.push_back(node);
+	if (type == ConnectionType::child) {
+		for (auto *thought: stateThoughts(fromId))
+			thought->children().push_back(toId);
+	} else {
+		int fromIndex = neighborIndex(fromId);
+		if (fromIndex != -1 && !isLinkExcluded(fromIndex, toId)) {
+			for (auto *thought: stateThoughts(fromId))
+				thought->links().push_back(toId);
+		}
+
+		int toIndex = neighborIndex(toId);
+		if (toIndex != -1 && !isLinkExcluded(toIndex, fromId)) {
+			for (auto *thought: stateThoughts(toId))
+				thought->links().push_back(fromId);
+		}
+	}
 
-	return from;
+	std::vector<ThoughtId> touched = {fromId, toId};
+	return refreshFlags(touched);
 }
 
-std::vector<ConnectionEntity> DatabaseBrainRepository::getChildren(
-	ThoughtId fromId
+bool DatabaseBrainRepository::patchDisconnected(
+	ThoughtId from,
+	ThoughtId to
 ) {
-	return getConnections(fromId, ConnectionType::child, true);
+	if (m_state == nullptr)
+		return false;
+	if (m_depth > 1)
+		return patchArea();
+	if (!isPatchable(from) || !isPatchable(to))
+		return false;
+
+	m_change = StateChange(false);
+
+	for (auto *thought: stateThoughts(from)) {
+		removeId(thought->children(), to);
+		removeId(thought->links(), to);
+	}
+	for (auto *thought: stateThoughts(to)) {
+		removeId(thought->children(), from);
+		removeId(thought->links(), from);
+	}
+
+	std::vector<ThoughtId> touched = {from, to};
+	return refreshFlags(touched);
 }
 
-std::vector<ConnectionEntity> DatabaseBrainRepository::getConnections(
+bool DatabaseBrainRepository::patchDeleted(
 	ThoughtId id,
-	ConnectionType type,
-	bool outgoing
+	std::vector<ThoughtId>& connected
 ) {
-	int idx;
-	std::vector<ConnectionEntity> result;
-
-	QSqlTableModel model(nullptr, m_conn);
-	model.setTable("connections");
-	model.setFilter(
-		QString(outgoing
-			? "(conn_from == %1 AND conn_type == %2)"
-			: "(conn_to == %1 AND conn_type == %2)"
-		).arg(id).arg(type)
-	);
-	model.select();
+	if (m_state == nullptr)
+		return false;
+	if (m_depth > 1)
+		return patchArea();
+	if (!isPatchable(id))
+		return false;
 
-	for (idx = 0; idx < model.rowCount(); idx++) {
-		QSqlRecord record = model.record(idx);
+	m_change = StateChange(false);
 
-		result.push_back(
-			ConnectionEntity(
-				record.value("conn_from").toULongLong(),
-				record.value("conn_to").toULongLong(),
-				ConnectionType(record.value("conn_type").toInt())
-			)
-		);
+	std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
+
+	if (auto found = thoughts->find(id); found != thoughts->end()) {
+		delete found->second;
+		thoughts->erase(found);
+		m_change.remove(id);
+	}
+
+	// Only thoughts connected to the deleted one can reference it. Some of
+	// them could skip it in their lists, but their flags might change anyway.
+	for (auto& connectedId: connected) {
+		for (auto *thought: stateThoughts(connectedId)) {
+			removeId(thought->children(), id);
+			removeId(thought->links(), id);
+			removeId(thought->parents(), id);
+		}
+	}
+
+	return refreshFlags(connected);
+}
+
+/**
+ * Which thoughts are further than the neighborhood depends on the ranking of
+ * the whole area, so it's loaded again. The difference is applied to the
+ * loaded State, which keeps the objects of unchanged thoughts, and is
+ * reported as a patch.
+ */
+bool DatabaseBrainRepository::patchArea() {
+	State *next = makeState(m_currentId, m_depth, m_budget);
+	if (next == nullptr)
+		return false;
+
+	m_change = StateChange(false);
+
+	Thought *center = m_state->centralThought();
+	if (!sameThought(*center, *next->centralThought())) {
+		*center = *next->centralThought();
+		m_change.update(center->id());
+	}
+
+	std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
+	std::unordered_map<ThoughtId, Thought*> *loaded = next->thoughts();
+
+	for (auto it = thoughts->begin(); it != thoughts->end();) {
+		if (loaded->count(it->first) > 0) {
+			it++;
+			continue;
+		}
+
+		m_change.remove(it->first);
+		delete it->second;
+		it = thoughts->erase(it);
+	}
+
+	for (auto& [id, thought]: *loaded) {
+		auto found = thoughts->find(id);
+		if (found == thoughts->end()) {
+			// Taken over from the loaded state.
+			thoughts->insert({id, thought});
+			thought = nullptr;
+			m_change.add(id);
+		} else if (!sameThought(*found->second, *thought)) {
+			*found->second = *thought;
+			m_change.update(id);
+		}
 	}
 
+	delete next;
+	return true;
+}
+
+bool DatabaseBrainRepository::sameThought(const Thought& a, const Thought& b) {
+	return a.name() == b.name()
+		&& a.hasParents() == b.hasParents()
+		&& a.hasChildren() == b.hasChildren()
+		&& a.hasLinks() == b.hasLinks()
+		&& a.parents() == b.parents()
+		&& a.children() == b.children()
+		&& a.links() == b.links();
+}
+
+bool DatabaseBrainRepository::getConnectedIds(
+	ThoughtId id,
+	std::vector<ThoughtId> *result
+) {
+	QSqlQuery *query = statement(StatementConnectedIds);
+	query->bindValue(":id", (qlonglong)id);
+
+	if (!exec(query))
+		return false;
+
+	while (query->next())
+		result->push_back(query->value(0).toULongLong());
+	query->finish();
+
+	return true;
+}
+
+bool DatabaseBrainRepository::refreshFlags(std::vector<ThoughtId>& ids) {
+	QSqlQuery *query = statement(StatementThoughtFlags);
+
+	for (auto& id: ids) {
+		std::vector<Thought*> thoughts = stateThoughts(id);
+		if (thoughts.empty())
+			continue;
+
+		query->bindValue(":id", (qlonglong)id);
+		query->bindValue(":child", ConnectionType::child);
+		query->bindValue(":link", ConnectionType::link);
+
+		if (!exec(query))
+			return false;
+
+		if (query->next()) {
+			for (auto *thought: thoughts) {
+				thought->hasParents() = query->value(0).toBool();
+				thought->hasChildren() = query->value(1).toBool();
+				thought->hasLinks() = query->value(2).toBool();
+			}
+			m_change.update(id);
+		}
+		query->finish();
+	}
+
+	return true;
+}
+
+std::vector<Thought*> DatabaseBrainRepository::stateThoughts(ThoughtId id) {
+	std::vector<Thought*> result;
+
+	// When the central thought has parents, it's also listed among the
+	// thoughts as its own sibling.
+	Thought *center = m_state->centralThought();
+	if (center != nullptr && center->id() == id)
+		result.push_back(center);
+
+	std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
+	if (auto found = thoughts->find(id); found != thoughts->end())
+		result.push_back(found->second);
+
 	return result;
 }
 
+bool DatabaseBrainRepository::isPatchable(ThoughtId id) {
+	Thought *center = m_state->centralThought();
+	return id != center->id() && !listContains(center->parents(), id);
+}
+
+bool DatabaseBrainRepository::isSibling(ThoughtId id) {
+	Thought *center = m_state->centralThought();
+	if (listContains(center->links(), id) || listContains(center->parents(), id))
+		return false;
+
+	std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
+	for (auto& parentId: center->parents()) {
+		if (auto parent = thoughts->find(parentId); parent != thoughts->end()) {
+			if (listContains(parent->second->children(), id))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+int DatabaseBrainRepository::neighborIndex(ThoughtId id) {
+	// Same order as in loadState(), later lists take precedence.
+	Thought *center = m_state->centralThought();
+	if (listContains(center->parents(), id))
+		return 3;
+	if (listContains(center->children(), id))
+		return 2;
+	if (isSibling(id))
+		return 1;
+	if (listContains(center->links(), id))
+		return 0;
+	return -1;
+}
+
+bool DatabaseBrainRepository::isLinkExcluded(int index, ThoughtId target) {
+	// Thoughts don't list links to nodes from the lists preceding their own,
+	// to avoid drawing the same link twice.
+	Thought *center = m_state->centralThought();
+	if (index > 0 && listContains(center->links(), target))
+		return true;
+	if (index > 1 && isSibling(target))
+		return true;
+	if (index > 2 && listContains(center->children(), target))
+		return true;
+	return false;
+}
+
+bool DatabaseBrainRepository::removeId(
+	std::vector<ThoughtId>& list,
+	ThoughtId id
+) {
+	auto it = std::remove(list.begin(), list.end(), id);
+	if (it == list.end())
+		return false;
+
+	list.erase(it, list.end());
+	return true;
+}
+
 bool DatabaseBrainRepository::listContains(
 	std::vector<ThoughtId>& list,
 	ThoughtId id
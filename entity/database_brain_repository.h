@@ -2,15 +2,22 @@
 #define H_DATABASE_BRAIN_REPOSITORY
 
 #include <string>
+#include <vector>
+#include <functional>
 
 #include <QDir>
 #include <QFile>
 #include <QString>
 #include <QSqlDatabase>
+#include <QSqlQuery>
 
 #include "model/model.h"
 #include "entity/thought_entity.h"
 #include "entity/connection_entity.h"
+#include "entity/neighborhood_entity.h"
+#include "entity/storage_profile.h"
+#include "entity/database_checkpointer.h"
+#include "entity/graph_cache.h"
 #include "entity/base_repository.h"
 #include "entity/graph_repository.h"
 #include "entity/search_repository.h"
@@ -24,11 +31,19 @@ class DatabaseBrainRepository
 {
 public:
 	// Constructor.
-	static DatabaseBrainRepository *fromDir(QDir);
+	static DatabaseBrainRepository *fromDir(
+		QDir,
+		StorageProfile = StorageProfile::defaultProfile()
+	);
 	~DatabaseBrainRepository();
 	// Graph Repository.
 	bool select(ThoughtId) override;
+	bool select(ThoughtId, int, size_t) override;
 	const State* getState() const override;
+	const StateChange* getChange() const override;
+	// Forgets the last change, so operations that don't touch the state
+	// report an empty one.
+	void clearChange() { m_change = StateChange(false); }
 	bool updateThought(ThoughtId, std::string&) override;
 	CreateResult createThought(
 		ThoughtId fromId,
@@ -43,31 +58,111 @@ public:
 	) override;
 	bool deleteThought(ThoughtId) override;
 	bool disconnectThoughts(ThoughtId, ThoughtId) override;
+	bool beginTransaction() override;
+	bool commitTransaction() override;
+	bool rollbackTransaction() override;
+	// Selection in two steps, so that the next state can be loaded while the
+	// current one is still in use. loadSelection() only reads, its result is
+	// made current, with the same arguments, by setSelection(), which takes
+	// ownership of it. Edits made in between only patch the current state, so
+	// the loaded one is outdated by them.
+	State *loadSelection(ThoughtId, int depth, size_t budget);
+	void setSelection(ThoughtId, int depth, size_t budget, State*);
 	// Search repository.
 	SearchResult search(std::string) override;
+	SearchResult searchTop(std::string, size_t, SearchScope) override;
 	// Text repository.
 	GetResult getText(ThoughtId) override;
 	SaveResult saveText(ThoughtId, QString) override;
+	// Diagnostics.
+	unsigned long queryCount() const { return m_queryCount; }
 
 protected:
-	DatabaseBrainRepository(QDir, QSqlDatabase);
+	// Maximum number of search results.
+	static const size_t searchLimit = 100;
+	// Walk for an area visits at most this many rows per thought of the
+	// budget past the neighborhood.
+	static const size_t areaWalkFactor = 8;
+	// Statements prepared once per connection.
+	enum Statement {
+		StatementGetThought,
+		StatementInsertThought,
+		StatementRenameThought,
+		StatementDeleteThought,
+		StatementThoughtFlags,
+		StatementInsertConnection,
+		StatementDeleteConnections,
+		StatementDeleteThoughtConnections,
+		StatementConnectedIds,
+		StatementNeighborhoodThoughts,
+		StatementNeighborhoodConnections,
+		StatementAreaThoughts,
+		StatementAreaConnections,
+		StatementSearch,
+		StatementSearchIndex,
+		StatementIndexInsert,
+		StatementIndexRename,
+		StatementIndexText,
+		StatementIndexDelete,
+		StatementAllThoughts,
+		StatementAllConnections,
+		StatementCount
+	};
+	DatabaseBrainRepository(QDir, QSqlDatabase, StorageProfile);
 	static bool verify(QDir, QSqlDatabase*);
 	static bool createDb(QString, QFile, QSqlDatabase*);
+	static bool applyProfile(QSqlDatabase&, StorageProfile);
+	bool setupSearchIndex();
+	bool checkSearchIndex();
+	bool fillSearchIndex();
+	SearchResult searchIndex(QString, size_t);
+	SearchResult searchNames(QString, size_t);
+	static bool migrate(QSqlDatabase&);
+	// Statements.
+	static QString statementQuery(Statement);
+	static bool isIndexStatement(Statement);
+	void prepareStatements();
+	QSqlQuery *statement(Statement);
+	bool exec(QSqlQuery*);
 	// Helpers.
 	bool listContains(
 		std::vector<ThoughtId>&,
 		ThoughtId
 	);
-	std::vector<ConnectionEntity> getConnections(
-		ThoughtId,
-		ConnectionType,
-		bool
-	);
-	std::vector<ConnectionEntity> getChildren(ThoughtId);
-	std::vector<ConnectionEntity> getLinks(ThoughtId);
-	std::vector<ConnectionEntity> getParents(ThoughtId);
 	ThoughtEntity getThought(ThoughtId, bool*);
+	bool insertConnection(ThoughtId, ThoughtId, ConnectionType);
+	bool deleteConnections(ThoughtId, ThoughtId);
+	bool finishRollback();
+	void afterCommit(std::function<void()>);
+	void undoOnRollback(std::function<void()>);
+	bool loadNeighborhood(ThoughtId, NeighborhoodEntity*);
+	bool loadArea(ThoughtId, int depth, size_t budget, NeighborhoodEntity*);
+	bool loadCache();
 	bool loadState(ThoughtId);
+	State *makeState(ThoughtId, int depth, size_t budget);
+	// Incremental state updates.
+	bool patchRenamed(ThoughtId, std::string&);
+	bool patchCreated(
+		ThoughtId fromId,
+		ThoughtId id,
+		std::string& name,
+		ConnectionType type,
+		bool incoming
+	);
+	bool patchConnected(ThoughtId, ThoughtId, ConnectionType);
+	bool patchDisconnected(ThoughtId, ThoughtId);
+	bool patchDeleted(ThoughtId, std::vector<ThoughtId>&);
+	bool patchArea();
+	static bool sameThought(const Thought&, const Thought&);
+	bool getConnectedIds(ThoughtId, std::vector<ThoughtId>*);
+	bool refreshFlags(std::vector<ThoughtId>&);
+	std::vector<Thought*> stateThoughts(ThoughtId);
+	bool isPatchable(ThoughtId);
+	bool isSibling(ThoughtId);
+	int neighborIndex(ThoughtId);
+	bool isLinkExcluded(int, ThoughtId);
+	static bool removeId(std::vector<ThoughtId>&, ThoughtId);
+	bool readText(ThoughtEntity&, QString*);
 	QString filePathFromThought(ThoughtEntity&);
 	QString filePathFromName(QString&, ThoughtId id);
 	QString stripMetadata(QString&, QString&);
@@ -77,10 +172,29 @@ private:
 	// Database.
 	QDir m_root;
 	QSqlDatabase m_conn;
+	QSqlQuery *m_statements[StatementCount] = {};
+	// Whether the full text search index is available.
+	bool m_fullText = false;
+	DatabaseCheckpointer *m_checkpointer = nullptr;
+	// In-memory copy of the graph, if enabled by the storage profile.
+	GraphCache *m_cache = nullptr;
+	// Nesting level of open transactions.
+	int m_transactionDepth = 0;
+	bool m_transactionFailed = false;
+	// Changes outside of the database made by operations in the open
+	// transaction: applied once it's committed, or undone on rollback.
+	std::vector<std::function<void()>> m_pendingCommit;
+	std::vector<std::function<void()>> m_pendingRollback;
 	// State.
 	State *m_state = nullptr;
+	StateChange m_change;
 	ThoughtId m_rootId;
 	ThoughtId m_currentId;
+	// Hops and max number of thoughts of the last selection.
+	int m_depth = 1;
+	size_t m_budget = 0;
+	// Number of statements sent to the database.
+	unsigned long m_queryCount = 0;
 };
 
 #endif
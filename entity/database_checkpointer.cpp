@@ -0,0 +1,78 @@
+#include <QString>
+#include <QTimer>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include <QDebug>
+
+#include "entity/database_checkpointer.h"
+
+DatabaseCheckpointer::DatabaseCheckpointer(QString path, int interval)
+	: m_path(path)
+{
+	m_timer.setSingleShot(true);
+	m_timer.setInterval(interval);
+	QObject::connect(&m_timer, &QTimer::timeout, [this]() {
+		checkpoint();
+	});
+}
+
+DatabaseCheckpointer::~DatabaseCheckpointer() {
+	m_timer.stop();
+
+	if (m_thread != nullptr) {
+		m_thread->wait();
+		delete m_thread;
+	}
+}
+
+void DatabaseCheckpointer::touch() {
+	m_timer.start();
+}
+
+void DatabaseCheckpointer::checkpoint() {
+	if (m_thread != nullptr) {
+		// Previous checkpoint is still running, try again later.
+		if (m_thread->isRunning()) {
+			m_timer.start();
+			return;
+		}
+
+		delete m_thread;
+	}
+
+	QString path = m_path;
+	m_thread = QThread::create([path]() {
+		DatabaseCheckpointer::run(path);
+	});
+	m_thread->start(QThread::LowPriority);
+}
+
+void DatabaseCheckpointer::run(QString path) {
+	// Connections can't be shared between threads, so the checkpoint gets
+	// its own one.
+	QString name = QString("checkpoint-%1").arg(
+		(quintptr)QThread::currentThreadId()
+	);
+
+	{
+		QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+		db.setDatabaseName(path);
+
+		if (db.open()) {
+			QSqlQuery query = QSqlQuery(db);
+			if (!query.exec("PRAGMA wal_checkpoint(PASSIVE);")) {
+				qDebug() << "DB: Checkpoint failed" << query.lastError().text();
+			}
+			query.finish();
+			db.close();
+		} else {
+			qDebug() << "DB: Failed to open checkpoint connection"
+				<< db.lastError().text();
+		}
+	}
+
+	QSqlDatabase::removeDatabase(name);
+}
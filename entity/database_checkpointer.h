@@ -0,0 +1,31 @@
+#ifndef H_DATABASE_CHECKPOINTER
+#define H_DATABASE_CHECKPOINTER
+
+#include <QString>
+#include <QTimer>
+#include <QThread>
+
+/**
+ * Runs WAL checkpoints for a database file in a background thread.
+ *
+ * Every write to the database should be reported with `touch`. Once there
+ * were no writes for the given interval, a passive checkpoint is started on
+ * a separate connection, so neither the GUI thread nor readers of the main
+ * connection ever wait for it.
+ */
+class DatabaseCheckpointer {
+public:
+	DatabaseCheckpointer(QString, int);
+	~DatabaseCheckpointer();
+	void touch();
+
+private:
+	QString m_path;
+	QTimer m_timer;
+	QThread *m_thread = nullptr;
+	// Helpers.
+	void checkpoint();
+	static void run(QString);
+};
+
+#endif
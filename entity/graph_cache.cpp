@@ -0,0 +1,464 @@
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "entity/graph_cache.h"
+
+GraphCache::GraphCache() {
+	m_outOffsets.push_back(0);
+	m_inOffsets.push_back(0);
+}
+
+// Loading.
+
+void GraphCache::build(
+	const std::vector<ThoughtEntity>& thoughts,
+	const std::vector<ConnectionEntity>& connections
+) {
+	uint32_t count = thoughts.size();
+
+	m_ids.clear();
+	m_names.clear();
+	m_alive.clear();
+	m_index.clear();
+	m_outOverrides.clear();
+	m_inOverrides.clear();
+
+	m_ids.reserve(count);
+	m_names.reserve(count);
+	m_alive.reserve(count);
+	m_index.reserve(count);
+
+	for (auto& thought: thoughts) {
+		m_index.insert({thought.id, m_ids.size()});
+		m_ids.push_back(thought.id);
+		m_names.push_back(thought.name);
+		m_alive.push_back(true);
+	}
+
+	// Count edges of every thought, turn counts into offsets, then put the
+	// edges in place.
+	m_outOffsets.assign(count + 1, 0);
+	m_inOffsets.assign(count + 1, 0);
+
+	for (auto& conn: connections) {
+		auto from = m_index.find(conn.from), to = m_index.find(conn.to);
+		if (from == m_index.end() || to == m_index.end())
+			continue;
+
+		m_outOffsets[from->second + 1]++;
+		m_inOffsets[to->second + 1]++;
+	}
+
+	for (uint32_t idx = 0; idx < count; idx++) {
+		m_outOffsets[idx + 1] += m_outOffsets[idx];
+		m_inOffsets[idx + 1] += m_inOffsets[idx];
+	}
+
+	m_outEdges.assign(m_outOffsets[count], Edge{0, ConnectionType::link});
+	m_inEdges.assign(m_inOffsets[count], Edge{0, ConnectionType::link});
+
+	std::vector<uint32_t> outNext(m_outOffsets.begin(), m_outOffsets.end() - 1);
+	std::vector<uint32_t> inNext(m_inOffsets.begin(), m_inOffsets.end() - 1);
+
+	for (auto& conn: connections) {
+		auto from = m_index.find(conn.from), to = m_index.find(conn.to);
+		if (from == m_index.end() || to == m_index.end())
+			continue;
+
+		m_outEdges[outNext[from->second]++] = Edge{to->second, conn.type};
+		m_inEdges[inNext[to->second]++] = Edge{from->second, conn.type};
+	}
+
+	m_compacted = count;
+}
+
+// Lookup.
+
+bool GraphCache::contains(ThoughtId id) const {
+	return m_index.find(id) != m_index.end();
+}
+
+/**
+ * Fills the neighborhood with the same data DatabaseBrainRepository gets from
+ * its neighborhood queries: the root, its neighbors and siblings, all their
+ * outgoing connections, and incoming links.
+ */
+bool GraphCache::loadNeighborhood(
+	ThoughtId rootId,
+	NeighborhoodEntity *result
+) const {
+	auto found = m_index.find(rootId);
+	if (found == m_index.end())
+		return false;
+
+	std::vector<uint32_t> members;
+	std::unordered_set<uint32_t> hood;
+	addNeighborhood(found->second, members, hood);
+	fill(members, hood, result);
+	return true;
+}
+
+/**
+ * Same as loadNeighborhood, with thoughts up to `depth` hops away from the
+ * neighborhood added. The neighborhood itself counts as the first hop and is
+ * always loaded in full. Further thoughts are added while the total is under
+ * the budget, closest first, then the ones with more connections, then the
+ * newest. Once a hop fills the budget, further hops are not visited at all.
+ */
+bool GraphCache::loadArea(
+	ThoughtId rootId,
+	int depth,
+	size_t budget,
+	NeighborhoodEntity *result
+) const {
+	auto found = m_index.find(rootId);
+	if (found == m_index.end())
+		return false;
+
+	std::vector<uint32_t> members;
+	std::unordered_set<uint32_t> hood;
+	addNeighborhood(found->second, members, hood);
+
+	std::vector<uint32_t> frontier = members;
+	std::vector<uint32_t> next;
+	std::unordered_set<uint32_t> reached;
+
+	for (int hop = 2; hop <= depth && members.size() < budget; hop++) {
+		next.clear();
+		reached.clear();
+		auto reach = [&hood, &reached, &next](const Edge& edge) {
+			if (hood.count(edge.node) == 0 && reached.insert(edge.node).second)
+				next.push_back(edge.node);
+		};
+
+		for (auto idx: frontier) {
+			for (auto& edge: outgoing(idx))
+				reach(edge);
+			for (auto& edge: incoming(idx))
+				reach(edge);
+		}
+
+		// Only part of the hop fits, keep the best connected thoughts.
+		size_t room = budget - members.size();
+		if (next.size() > room) {
+			std::vector<std::tuple<size_t, ThoughtId, uint32_t>> ranked;
+			ranked.reserve(next.size());
+			for (auto idx: next)
+				ranked.push_back({degree(idx), m_ids[idx], idx});
+
+			std::partial_sort(
+				ranked.begin(), ranked.begin() + room, ranked.end(),
+				std::greater<>()
+			);
+
+			next.resize(room);
+			for (size_t at = 0; at < room; at++)
+				next[at] = std::get<2>(ranked[at]);
+		}
+
+		for (auto idx: next) {
+			hood.insert(idx);
+			members.push_back(idx);
+		}
+		frontier.swap(next);
+	}
+
+	fill(members, hood, result);
+	return true;
+}
+
+size_t GraphCache::memoryUsage() const {
+	// Rough size of a node in an unordered_map: the value, the next pointer
+	// and the cached hash.
+	const size_t nodeOverhead = 2 * sizeof(void*);
+	size_t result = sizeof(GraphCache);
+
+	result += m_ids.capacity() * sizeof(ThoughtId);
+	result += m_alive.capacity() / 8;
+	result += m_names.capacity() * sizeof(std::string);
+	for (auto& name: m_names) {
+		// Short names are stored inside the string itself.
+		if (name.capacity() > sizeof(std::string) - 1)
+			result += name.capacity() + 1;
+	}
+
+	result += m_index.bucket_count() * sizeof(void*);
+	result += m_index.size()
+		* (sizeof(std::pair<ThoughtId, uint32_t>) + nodeOverhead);
+
+	result += (m_outOffsets.capacity() + m_inOffsets.capacity())
+		* sizeof(uint32_t);
+	result += (m_outEdges.capacity() + m_inEdges.capacity()) * sizeof(Edge);
+
+	for (auto *overrides: {&m_outOverrides, &m_inOverrides}) {
+		result += overrides->bucket_count() * sizeof(void*);
+		for (auto& [idx, list]: *overrides) {
+			result += sizeof(std::pair<uint32_t, std::vector<Edge>>)
+				+ nodeOverhead
+				+ list.capacity() * sizeof(Edge);
+		}
+	}
+
+	return result;
+}
+
+// Updates.
+
+void GraphCache::addThought(ThoughtId id, const std::string& name) {
+	if (contains(id))
+		return;
+
+	uint32_t idx = m_ids.size();
+	m_index.insert({id, idx});
+	m_ids.push_back(id);
+	m_names.push_back(name);
+	m_alive.push_back(true);
+
+	// New thoughts have no compressed adjacency, so they always live in the
+	// overrides until the next compaction.
+	m_outOverrides[idx];
+	m_inOverrides[idx];
+	compactIfNeeded();
+}
+
+void GraphCache::renameThought(ThoughtId id, const std::string& name) {
+	if (auto found = m_index.find(id); found != m_index.end())
+		m_names[found->second] = name;
+}
+
+void GraphCache::removeThought(ThoughtId id) {
+	auto found = m_index.find(id);
+	if (found == m_index.end())
+		return;
+
+	uint32_t idx = found->second;
+
+	std::vector<Edge>& out = editable(idx, m_outOffsets, m_outEdges, m_outOverrides);
+	for (auto& edge: out)
+		removeEdges(editable(edge.node, m_inOffsets, m_inEdges, m_inOverrides), idx);
+	out.clear();
+
+	std::vector<Edge>& in = editable(idx, m_inOffsets, m_inEdges, m_inOverrides);
+	for (auto& edge: in)
+		removeEdges(editable(edge.node, m_outOffsets, m_outEdges, m_outOverrides), idx);
+	in.clear();
+
+	m_index.erase(found);
+	m_alive[idx] = false;
+	m_names[idx] = std::string();
+	compactIfNeeded();
+}
+
+void GraphCache::connect(ThoughtId fromId, ThoughtId toId, ConnectionType type) {
+	auto from = m_index.find(fromId), to = m_index.find(toId);
+	if (from == m_index.end() || to == m_index.end())
+		return;
+
+	// Only one connection is allowed between two thoughts.
+	disconnect(fromId, toId);
+
+	editable(from->second, m_outOffsets, m_outEdges, m_outOverrides)
+		.push_back(Edge{to->second, type});
+	editable(to->second, m_inOffsets, m_inEdges, m_inOverrides)
+		.push_back(Edge{from->second, type});
+	compactIfNeeded();
+}
+
+void GraphCache::disconnect(ThoughtId fromId, ThoughtId toId) {
+	auto from = m_index.find(fromId), to = m_index.find(toId);
+	if (from == m_index.end() || to == m_index.end())
+		return;
+
+	uint32_t a = from->second, b = to->second;
+	removeEdges(editable(a, m_outOffsets, m_outEdges, m_outOverrides), b);
+	removeEdges(editable(a, m_inOffsets, m_inEdges, m_inOverrides), b);
+	removeEdges(editable(b, m_outOffsets, m_outEdges, m_outOverrides), a);
+	removeEdges(editable(b, m_inOffsets, m_inEdges, m_inOverrides), a);
+}
+
+// Helpers.
+
+void GraphCache::addNeighborhood(
+	uint32_t root,
+	std::vector<uint32_t>& members,
+	std::unordered_set<uint32_t>& hood
+) const {
+	auto add = [&members, &hood](uint32_t idx) {
+		if (hood.insert(idx).second)
+			members.push_back(idx);
+	};
+
+	add(root);
+	for (auto& edge: outgoing(root))
+		add(edge.node);
+
+	for (auto& edge: incoming(root)) {
+		add(edge.node);
+
+		if (edge.type != ConnectionType::child)
+			continue;
+
+		for (auto& sibling: outgoing(edge.node)) {
+			if (sibling.type == ConnectionType::child)
+				add(sibling.node);
+		}
+	}
+}
+
+void GraphCache::fill(
+	const std::vector<uint32_t>& members,
+	const std::unordered_set<uint32_t>& hood,
+	NeighborhoodEntity *result
+) const {
+	for (auto idx: members) {
+		result->addThought(
+			ThoughtEntity(m_ids[idx], m_names[idx]),
+			hasParents(idx),
+			hasChildren(idx),
+			hasLinks(idx)
+		);
+
+		for (auto& edge: outgoing(idx)) {
+			result->addConnection(
+				ConnectionEntity(m_ids[idx], m_ids[edge.node], edge.type)
+			);
+		}
+
+		// Incoming links from inside the neighborhood are outgoing links of
+		// another member, so they are already added.
+		for (auto& edge: incoming(idx)) {
+			if (edge.type != ConnectionType::link || hood.count(edge.node) > 0)
+				continue;
+
+			result->addConnection(
+				ConnectionEntity(m_ids[edge.node], m_ids[idx], edge.type)
+			);
+		}
+	}
+}
+
+GraphCache::Range GraphCache::outgoing(uint32_t idx) const {
+	return edges(idx, m_compacted, m_outOffsets, m_outEdges, m_outOverrides);
+}
+
+GraphCache::Range GraphCache::incoming(uint32_t idx) const {
+	return edges(idx, m_compacted, m_inOffsets, m_inEdges, m_inOverrides);
+}
+
+GraphCache::Range GraphCache::edges(
+	uint32_t idx,
+	uint32_t compacted,
+	const std::vector<uint32_t>& offsets,
+	const std::vector<Edge>& edges,
+	const Overrides& overrides
+) {
+	if (auto found = overrides.find(idx); found != overrides.end()) {
+		const std::vector<Edge>& list = found->second;
+		return Range{list.data(), list.data() + list.size()};
+	}
+
+	if (idx >= compacted)
+		return Range{nullptr, nullptr};
+
+	return Range{
+		edges.data() + offsets[idx],
+		edges.data() + offsets[idx + 1]
+	};
+}
+
+std::vector<GraphCache::Edge>& GraphCache::editable(
+	uint32_t idx,
+	const std::vector<uint32_t>& offsets,
+	const std::vector<Edge>& edges,
+	Overrides& overrides
+) {
+	if (auto found = overrides.find(idx); found != overrides.end())
+		return found->second;
+
+	std::vector<Edge>& list = overrides[idx];
+	if (idx < m_compacted) {
+		list.assign(
+			edges.begin() + offsets[idx],
+			edges.begin() + offsets[idx + 1]
+		);
+	}
+
+	return list;
+}
+
+void GraphCache::removeEdges(std::vector<Edge>& list, uint32_t node) {
+	for (auto it = list.begin(); it != list.end();) {
+		if (it->node == node) {
+			it = list.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+size_t GraphCache::degree(uint32_t idx) const {
+	Range out = outgoing(idx), in = incoming(idx);
+	return (out.to - out.from) + (in.to - in.from);
+}
+
+bool GraphCache::hasParents(uint32_t idx) const {
+	for (auto& edge: incoming(idx)) {
+		if (edge.type == ConnectionType::child)
+			return true;
+	}
+	return false;
+}
+
+bool GraphCache::hasChildren(uint32_t idx) const {
+	for (auto& edge: outgoing(idx)) {
+		if (edge.type == ConnectionType::child)
+			return true;
+	}
+	return false;
+}
+
+bool GraphCache::hasLinks(uint32_t idx) const {
+	for (auto& edge: outgoing(idx)) {
+		if (edge.type == ConnectionType::link)
+			return true;
+	}
+	for (auto& edge: incoming(idx)) {
+		if (edge.type == ConnectionType::link)
+			return true;
+	}
+	return false;
+}
+
+void GraphCache::compactIfNeeded() {
+	// Lookups in the overrides are slower than in the arrays, and copies of
+	// edited lists take extra memory. Keep them to a small share of the graph.
+	size_t limit = m_ids.size() / 8 + 64;
+	if (m_outOverrides.size() + m_inOverrides.size() > limit)
+		compact();
+}
+
+void GraphCache::compact() {
+	std::vector<ThoughtEntity> thoughts;
+	std::vector<ConnectionEntity> connections;
+	thoughts.reserve(m_index.size());
+	connections.reserve(m_outEdges.size());
+
+	for (uint32_t idx = 0; idx < m_ids.size(); idx++) {
+		if (!m_alive[idx])
+			continue;
+
+		thoughts.push_back(ThoughtEntity(m_ids[idx], m_names[idx]));
+		for (auto& edge: outgoing(idx)) {
+			connections.push_back(
+				ConnectionEntity(m_ids[idx], m_ids[edge.node], edge.type)
+			);
+		}
+	}
+
+	build(thoughts, connections);
+}
@@ -0,0 +1,112 @@
+#ifndef H_GRAPH_CACHE
+#define H_GRAPH_CACHE
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "model/thought.h"
+#include "entity/thought_entity.h"
+#include "entity/connection_entity.h"
+#include "entity/neighborhood_entity.h"
+
+/**
+ * In-memory copy of the whole brain graph, used to build neighborhoods
+ * without going to the storage.
+ *
+ * Thoughts are addressed by a dense index. Outgoing and incoming connections
+ * of every thought are kept in compressed sparse row form: one array of
+ * edges sorted by thought index, and an array of offsets into it. Edits don't
+ * touch those arrays. Instead, adjacency of an edited thought is copied into
+ * a separate list that takes precedence over the compressed one. Once there
+ * are too many of those, everything is compacted back into arrays.
+ */
+class GraphCache {
+public:
+	GraphCache();
+	// Loading.
+	void build(
+		const std::vector<ThoughtEntity>&,
+		const std::vector<ConnectionEntity>&
+	);
+	// Lookup.
+	size_t size() const { return m_index.size(); }
+	bool contains(ThoughtId) const;
+	bool loadNeighborhood(ThoughtId, NeighborhoodEntity*) const;
+	bool loadArea(ThoughtId, int, size_t, NeighborhoodEntity*) const;
+	// Approximate number of bytes used by the cache.
+	size_t memoryUsage() const;
+	// Updates.
+	void addThought(ThoughtId, const std::string&);
+	void renameThought(ThoughtId, const std::string&);
+	void removeThought(ThoughtId);
+	void connect(ThoughtId, ThoughtId, ConnectionType);
+	void disconnect(ThoughtId, ThoughtId);
+
+private:
+	struct Edge {
+		uint32_t node;
+		ConnectionType type;
+	};
+
+	struct Range {
+		const Edge *from;
+		const Edge *to;
+		const Edge *begin() const { return from; }
+		const Edge *end() const { return to; }
+	};
+
+	typedef std::unordered_map<uint32_t, std::vector<Edge>> Overrides;
+
+	// Thoughts.
+	std::vector<ThoughtId> m_ids;
+	std::vector<std::string> m_names;
+	std::vector<bool> m_alive;
+	std::unordered_map<ThoughtId, uint32_t> m_index;
+	// Compressed adjacency of the first `m_compacted` thoughts.
+	uint32_t m_compacted = 0;
+	std::vector<uint32_t> m_outOffsets;
+	std::vector<Edge> m_outEdges;
+	std::vector<uint32_t> m_inOffsets;
+	std::vector<Edge> m_inEdges;
+	// Adjacency of thoughts edited since the last compaction.
+	Overrides m_outOverrides;
+	Overrides m_inOverrides;
+	// Helpers.
+	void addNeighborhood(
+		uint32_t,
+		std::vector<uint32_t>&,
+		std::unordered_set<uint32_t>&
+	) const;
+	void fill(
+		const std::vector<uint32_t>&,
+		const std::unordered_set<uint32_t>&,
+		NeighborhoodEntity*
+	) const;
+	Range outgoing(uint32_t) const;
+	Range incoming(uint32_t) const;
+	static Range edges(
+		uint32_t,
+		uint32_t,
+		const std::vector<uint32_t>&,
+		const std::vector<Edge>&,
+		const Overrides&
+	);
+	std::vector<Edge>& editable(
+		uint32_t,
+		const std::vector<uint32_t>&,
+		const std::vector<Edge>&,
+		Overrides&
+	);
+	static void removeEdges(std::vector<Edge>&, uint32_t);
+	size_t degree(uint32_t) const;
+	bool hasParents(uint32_t) const;
+	bool hasChildren(uint32_t) const;
+	bool hasLinks(uint32_t) const;
+	void compactIfNeeded();
+	void compact();
+};
+
+#endif
@@ -1,6 +1,10 @@
 #ifndef H_GRAPH_REPOSITORY
 #define H_GRAPH_REPOSITORY
 
+#include <functional>
+
+#include <QObject>
+
 #include "model/model.h"
 
 struct CreateResult {
@@ -13,7 +17,35 @@ class GraphRepository {
 public:
 	// State.
 	virtual bool select(ThoughtId) = 0;
+	// Loads thoughts up to `depth` hops away from the direct neighborhood of
+	// the selected thought, which counts as the first hop. The neighborhood is
+	// always loaded, further thoughts only while there are fewer than `budget`.
+	virtual bool select(ThoughtId, int depth, size_t budget) = 0;
+	// Calls back with the result of select(ThoughtId) on the thread of the
+	// context object, unless the object is destroyed by then or another
+	// selection is requested. The state only changes right before the
+	// callback. Repositories that can't load in the background call back
+	// right away.
+	virtual void selectAsync(
+		ThoughtId id,
+		QObject*,
+		std::function<void(bool)> callback
+	) {
+		callback(select(id));
+	}
+	// Same for select(ThoughtId, int, size_t).
+	virtual void selectAsync(
+		ThoughtId id,
+		int depth,
+		size_t budget,
+		QObject*,
+		std::function<void(bool)> callback
+	) {
+		callback(select(id, depth, budget));
+	}
 	virtual const State* getState() const = 0;
+	// Describes how the state was modified by the last operation.
+	virtual const StateChange* getChange() const = 0;
 	// Update operations.
 	virtual bool updateThought(ThoughtId, std::string&) = 0;
 	virtual CreateResult createThought(
@@ -29,6 +61,56 @@ public:
 	) = 0;
 	virtual bool deleteThought(ThoughtId) = 0;
 	virtual bool disconnectThoughts(ThoughtId, ThoughtId) = 0;
+	// Asynchronous versions of the update operations. Same rules as in
+	// selectAsync apply, except that every operation calls back, and the
+	// state is updated even if the context object is gone.
+	virtual void updateThoughtAsync(
+		ThoughtId id,
+		std::string name,
+		QObject*,
+		std::function<void(bool)> callback
+	) {
+		callback(updateThought(id, name));
+	}
+	virtual void createThoughtAsync(
+		ThoughtId fromId,
+		ConnectionType type,
+		bool incoming,
+		std::string text,
+		QObject*,
+		std::function<void(CreateResult)> callback
+	) {
+		callback(createThought(fromId, type, incoming, text));
+	}
+	virtual void connectThoughtsAsync(
+		ThoughtId fromId,
+		ThoughtId toId,
+		ConnectionType type,
+		QObject*,
+		std::function<void(bool)> callback
+	) {
+		callback(connectThoughts(fromId, toId, type));
+	}
+	virtual void deleteThoughtAsync(
+		ThoughtId id,
+		QObject*,
+		std::function<void(bool)> callback
+	) {
+		callback(deleteThought(id));
+	}
+	virtual void disconnectThoughtsAsync(
+		ThoughtId from,
+		ThoughtId to,
+		QObject*,
+		std::function<void(bool)> callback
+	) {
+		callback(disconnectThoughts(from, to));
+	}
+	// Transactions. Update operations made between begin and commit are
+	// saved together, or not at all if any of them fails or is rolled back.
+	virtual bool beginTransaction() = 0;
+	virtual bool commitTransaction() = 0;
+	virtual bool rollbackTransaction() = 0;
 };
 
 #endif
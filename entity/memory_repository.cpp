@@ -1,6 +1,7 @@
 #include <vector>
 #include <unordered_map>
 #include <ctime>
+#include <algorithm>
 
 #include <QString>
 #include <QRegularExpression>
@@ -9,6 +10,8 @@
 #include "entity/thought_entity.h"
 #include "entity/brain_entity.h"
 #include "entity/connection_entity.h"
+#include "entity/neighborhood_entity.h"
+#include "entity/graph_cache.h"
 
 #include <QDebug>
 
@@ -18,6 +21,7 @@ MemoryRepository::MemoryRepository(
 	ThoughtId root
 ) : m_thoughts(thoughts), m_connections(connections), m_rootId(root)
 {
+	m_graph.build(m_thoughts, m_connections);
 	select(root);
 }
 
@@ -27,7 +31,13 @@ MemoryRepository::~MemoryRepository() {
 }
 
 bool MemoryRepository::select(ThoughtId id) {
+	return select(id, 1, 0);
+}
+
+bool MemoryRepository::select(ThoughtId id, int depth, size_t budget) {
 	m_currentId = id;
+	m_depth = std::max(1, depth);
+	m_budget = budget;
 	loadState(id);
 	return true;
 }
@@ -36,12 +46,17 @@ const State* MemoryRepository::getState() const {
 	return m_state;
 }
 
+const StateChange* MemoryRepository::getChange() const {
+	return &m_change;
+}
+
 bool MemoryRepository::updateThought(ThoughtId id, std::string& name) {
 	if (name.empty())
 		return false;
 
 	if (auto thought = getThought(id); thought != nullptr) {
 		thought->name = name;
+		m_graph.renameThought(id, name);
 		loadState(m_currentId);
 		return true;
 	}
@@ -60,11 +75,14 @@ CreateResult MemoryRepository::createThought(
 
 	std::time_t result = std::time(nullptr);
 	m_thoughts.push_back(ThoughtEntity(result, name));
+	m_graph.addThought(result, name);
 
 	if (incoming) {
 		m_connections.push_back(ConnectionEntity(result, fromId, type));
+		m_graph.connect(result, fromId, type);
 	} else {
 		m_connections.push_back(ConnectionEntity(fromId, result, type));
+		m_graph.connect(fromId, result, type);
 	}
 
 	loadState(m_currentId);
@@ -92,6 +110,7 @@ bool MemoryRepository::connectThoughts(
 	if (!found) {
 		m_connections.push_back(ConnectionEntity(fromId, toId, type));
 	}
+	m_graph.connect(fromId, toId, type);
 
 	loadState(m_currentId);
 	return true;
@@ -113,6 +132,7 @@ bool MemoryRepository::deleteThought(ThoughtId id) {
 
 	m_thoughts = newList;
 	m_connections = newConns;
+	m_graph.removeThought(id);
 	loadState(m_currentId);
 	return true;
 }
@@ -134,12 +154,62 @@ bool MemoryRepository::disconnectThoughts(ThoughtId from, ThoughtId to) {
 	}
 
 	if (found) {
+		m_graph.disconnect(from, to);
 		loadState(m_currentId);
 	}
 
 	return found;
 }
 
+// Transactions. Changes are rolled back by restoring a copy of the data made
+// when the outermost transaction began.
+
+bool MemoryRepository::beginTransaction() {
+	if (m_transactionDepth == 0) {
+		m_savedThoughts = m_thoughts;
+		m_savedConnections = m_connections;
+		m_transactionFailed = false;
+	}
+
+	m_transactionDepth++;
+	return true;
+}
+
+bool MemoryRepository::commitTransaction() {
+	if (m_transactionDepth == 0)
+		return false;
+
+	m_transactionDepth--;
+	if (m_transactionDepth == 0 && m_transactionFailed) {
+		restoreSaved();
+		return false;
+	}
+
+	return !m_transactionFailed;
+}
+
+bool MemoryRepository::rollbackTransaction() {
+	if (m_transactionDepth == 0)
+		return false;
+
+	m_transactionDepth--;
+	m_transactionFailed = true;
+	if (m_transactionDepth == 0)
+		restoreSaved();
+
+	return true;
+}
+
+void MemoryRepository::restoreSaved() {
+	m_thoughts = m_savedThoughts;
+	m_connections = m_savedConnections;
+	m_graph.build(m_thoughts, m_connections);
+	m_savedThoughts.clear();
+	m_savedConnections.clear();
+	m_transactionFailed = false;
+	loadState(m_currentId);
+}
+
 // Search.
 
 SearchResult MemoryRepository::search(std::string term) {
@@ -167,6 +237,8 @@ SearchResult MemoryRepository::search(std::string term) {
 // Helpers.
 
 void MemoryRepository::loadState(ThoughtId rootId) {
+	m_change = StateChange(true);
+
 	if (m_state != nullptr)
 		delete m_state;
 
@@ -323,6 +395,13 @@ void MemoryRepository::loadState(ThoughtId rootId) {
 		}
 	}
 
+	// Thoughts further away, walked over the indexed copy of the graph.
+	if (m_depth > 1) {
+		NeighborhoodEntity area(rootId);
+		if (m_graph.loadArea(rootId, m_depth, m_budget, &area))
+			area.addOuterThoughts(siblings);
+	}
+
 	// Construct state.
 	State *state = new State(m_rootId, center, siblings);
 	m_state = state;
@@ -13,6 +13,7 @@
 #include "entity/thought_entity.h"
 #include "entity/connection_entity.h"
 #include "entity/brain_entity.h"
+#include "entity/graph_cache.h"
 
 class MemoryRepository:
 	public BaseRepository,
@@ -28,7 +29,9 @@ public:
 	~MemoryRepository() override;
 	// GraphRepository.
 	bool select(ThoughtId) override;
+	bool select(ThoughtId, int, size_t) override;
 	const State* getState() const override;
+	const StateChange* getChange() const override;
 	bool updateThought(ThoughtId, std::string&) override;
 	CreateResult createThought(
 		ThoughtId fromId,
@@ -43,6 +46,9 @@ public:
 	) override;
 	bool deleteThought(ThoughtId) override;
 	bool disconnectThoughts(ThoughtId, ThoughtId) override;
+	bool beginTransaction() override;
+	bool commitTransaction() override;
+	bool rollbackTransaction() override;
 	// TextRepository.
 	GetResult getText(ThoughtId) override;
 	SaveResult saveText(ThoughtId, QString) override;
@@ -62,12 +68,24 @@ private:
 	// Brain.
 	std::vector<ThoughtEntity> m_thoughts;
 	std::vector<ConnectionEntity> m_connections;
+	// Indexed copy of the lists above, kept up to date with every edit.
+	GraphCache m_graph;
 	ThoughtId m_rootId;
 	ThoughtId m_currentId;
+	// Hops and max number of thoughts of the last selection.
+	int m_depth = 1;
+	size_t m_budget = 0;
 	State *m_state = nullptr;
+	StateChange m_change;
 	std::unordered_map<ThoughtId, QString> m_texts;
+	// Transactions.
+	int m_transactionDepth = 0;
+	bool m_transactionFailed = false;
+	std::vector<ThoughtEntity> m_savedThoughts;
+	std::vector<ConnectionEntity> m_savedConnections;
 	// Helpers.
 	void loadState(ThoughtId);
+	void restoreSaved();
 	ThoughtEntity *getThought(ThoughtId);
 	std::vector<ConnectionEntity> getParents(ThoughtId);
 	std::vector<ConnectionEntity> getChildren(ThoughtId);
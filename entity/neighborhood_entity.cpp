@@ -0,0 +1,129 @@
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "entity/neighborhood_entity.h"
+
+NeighborhoodEntity::NeighborhoodEntity(ThoughtId root)
+	: m_rootId(root) {}
+
+// Filling.
+
+void NeighborhoodEntity::addThought(
+	ThoughtEntity thought,
+	bool hasParents,
+	bool hasChildren,
+	bool hasLinks
+) {
+	ThoughtId id = thought.id;
+	if (m_nodes.find(id) == m_nodes.end())
+		m_order.push_back(id);
+
+	m_nodes.insert_or_assign(
+		id,
+		Node{
+			.thought = thought,
+			.hasParents = hasParents,
+			.hasChildren = hasChildren,
+			.hasLinks = hasLinks,
+		}
+	);
+}
+
+void NeighborhoodEntity::addConnection(ConnectionEntity conn) {
+	switch (conn.type) {
+		case ConnectionType::child:
+			m_children[conn.from].push_back(conn);
+			m_parents[conn.to].push_back(conn);
+			break;
+		case ConnectionType::link:
+			m_linksOut[conn.from].push_back(conn);
+			m_linksIn[conn.to].push_back(conn);
+			break;
+	}
+}
+
+// Lookup.
+
+const NeighborhoodEntity::Node *NeighborhoodEntity::getThought(
+	ThoughtId id
+) const {
+	if (auto found = m_nodes.find(id); found != m_nodes.end())
+		return &found->second;
+	return nullptr;
+}
+
+std::vector<ConnectionEntity> NeighborhoodEntity::getParents(
+	ThoughtId id
+) const {
+	return find(m_parents, id);
+}
+
+std::vector<ConnectionEntity> NeighborhoodEntity::getChildren(
+	ThoughtId id
+) const {
+	return find(m_children, id);
+}
+
+std::vector<ConnectionEntity> NeighborhoodEntity::getLinks(
+	ThoughtId id
+) const {
+	std::vector<ConnectionEntity> result = find(m_linksOut, id);
+	for (auto& conn: find(m_linksIn, id))
+		result.push_back(conn);
+	return result;
+}
+
+// Assembling.
+
+/**
+ * Thoughts already in the map list their links to the outer ones, so a link
+ * is only added to an outer thought if the other end is also outer and comes
+ * later. Same as in the direct neighborhood, parents are left empty, child
+ * connections are listed by the parent.
+ */
+void NeighborhoodEntity::addOuterThoughts(
+	std::unordered_map<ThoughtId, Thought*> *thoughts
+) const {
+	std::unordered_set<ThoughtId> listed;
+	listed.insert(m_rootId);
+	for (auto& [id, thought]: *thoughts)
+		listed.insert(id);
+
+	for (auto id: m_order) {
+		if (listed.count(id) > 0)
+			continue;
+
+		const Node& node = m_nodes.at(id);
+		Thought *thought = new Thought(
+			id,
+			node.thought.name,
+			node.hasParents,
+			node.hasChildren,
+			node.hasLinks
+		);
+
+		for (auto& conn: getChildren(id))
+			thought->children().push_back(conn.to);
+
+		for (auto& conn: getLinks(id)) {
+			ThoughtId targetId = (conn.to == id) ? conn.from : conn.to;
+			if (listed.count(targetId) == 0)
+				thought->links().push_back(targetId);
+		}
+
+		listed.insert(id);
+		thoughts->insert({id, thought});
+	}
+}
+
+// Helpers.
+
+std::vector<ConnectionEntity> NeighborhoodEntity::find(
+	const std::unordered_map<ThoughtId, std::vector<ConnectionEntity>>& map,
+	ThoughtId id
+) {
+	if (auto found = map.find(id); found != map.end())
+		return found->second;
+	return std::vector<ConnectionEntity>();
+}
@@ -0,0 +1,65 @@
+#ifndef H_NEIGHBORHOOD_ENTITY
+#define H_NEIGHBORHOOD_ENTITY
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "model/thought.h"
+#include "entity/thought_entity.h"
+#include "entity/connection_entity.h"
+
+/**
+ * Raw data needed to build a State around a thought: the thought itself, its
+ * direct neighbors and siblings, along with every child and link connection
+ * going out of any of them. Repositories fill it in with a few bulk reads, and
+ * the State is then assembled from memory without going back to the storage.
+ *
+ * Parent connections are only complete for the root thought. For all other
+ * thoughts only the presence of parents is known, through hasParents flag.
+ *
+ * An area loaded further than the direct neighborhood holds more thoughts,
+ * filled in the order of their distance from the root.
+ */
+class NeighborhoodEntity {
+public:
+	struct Node {
+		ThoughtEntity thought;
+		bool hasParents;
+		bool hasChildren;
+		bool hasLinks;
+	};
+
+	NeighborhoodEntity(ThoughtId);
+	// Filling.
+	void addThought(ThoughtEntity, bool, bool, bool);
+	void addConnection(ConnectionEntity);
+	// Lookup.
+	ThoughtId rootId() const { return m_rootId; }
+	size_t size() const { return m_nodes.size(); }
+	// Ids in the order thoughts were added.
+	const std::vector<ThoughtId>& ids() const { return m_order; }
+	const Node *getThought(ThoughtId) const;
+	std::vector<ConnectionEntity> getParents(ThoughtId) const;
+	std::vector<ConnectionEntity> getChildren(ThoughtId) const;
+	std::vector<ConnectionEntity> getLinks(ThoughtId) const;
+	// Assembling. Adds thoughts missing from the map, for states loaded
+	// further than the direct neighborhood.
+	void addOuterThoughts(std::unordered_map<ThoughtId, Thought*>*) const;
+
+private:
+	ThoughtId m_rootId;
+	std::unordered_map<ThoughtId, Node> m_nodes;
+	std::vector<ThoughtId> m_order;
+	std::unordered_map<ThoughtId, std::vector<ConnectionEntity>> m_parents;
+	std::unordered_map<ThoughtId, std::vector<ConnectionEntity>> m_children;
+	std::unordered_map<ThoughtId, std::vector<ConnectionEntity>> m_linksOut;
+	std::unordered_map<ThoughtId, std::vector<ConnectionEntity>> m_linksIn;
+	// Helpers.
+	static std::vector<ConnectionEntity> find(
+		const std::unordered_map<ThoughtId, std::vector<ConnectionEntity>>&,
+		ThoughtId
+	);
+};
+
+#endif
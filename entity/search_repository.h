@@ -2,6 +2,10 @@
 #define H_SEARCH_REPOSITORY
 
 #include <string>
+#include <vector>
+#include <functional>
+
+#include <QObject>
 
 #include "model/thought.h"
 
@@ -10,9 +14,18 @@ enum SearchError {
 	SearchErrorIO
 };
 
+enum SearchScope {
+	// Names and note texts, as far as the repository can search them.
+	SearchScopeAll,
+	// Only thought names that contain the term.
+	SearchScopeNames
+};
+
 struct SearchItem {
 	ThoughtId id;
 	std::string name;
+	// Fragment of the note text around the match, if available.
+	std::string snippet;
 };
 
 struct SearchResult {
@@ -23,6 +36,33 @@ struct SearchResult {
 class SearchRepository {
 public:
 	virtual SearchResult search(std::string) = 0;
+	// Returns at most `limit` best matches.
+	virtual SearchResult searchTop(
+		std::string term,
+		size_t limit,
+		SearchScope
+	) {
+		SearchResult result = search(term);
+		if (result.items.size() > limit)
+			result.items.resize(limit);
+		return result;
+	}
+	// Calls back with the result of searchTop on the thread of the context
+	// object, unless the object is destroyed by then or the search is
+	// canceled. Repositories that can't search in the background call back
+	// right away.
+	virtual void searchAsync(
+		std::string term,
+		size_t limit,
+		SearchScope scope,
+		QObject*,
+		std::function<void(SearchResult)> callback
+	) {
+		callback(searchTop(term, limit, scope));
+	}
+	// Drops searches requested for the context object that haven't called
+	// back yet. A new request for the same context cancels earlier ones too.
+	virtual void cancelSearches(QObject*) {}
 };
 
 #endif
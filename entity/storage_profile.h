@@ -0,0 +1,48 @@
+#ifndef H_STORAGE_PROFILE
+#define H_STORAGE_PROFILE
+
+#include <QtGlobal>
+
+/**
+ * SQLite settings a brain database is opened with.
+ *
+ * Default profile uses write-ahead logging, so reading the graph never waits
+ * for a write to finish, and syncs to disk only on checkpoints. WAL is folded
+ * back into the database by a background checkpoint once the brain has been
+ * idle for `checkpointInterval` milliseconds.
+ *
+ * Compatible profile keeps SQLite's defaults: rollback journal and full sync
+ * on every commit. Use it for brains stored on network filesystems, where WAL
+ * is not supported.
+ */
+struct StorageProfile {
+	// Write-ahead logging instead of the rollback journal.
+	bool wal = true;
+	// synchronous = NORMAL instead of FULL.
+	bool relaxedSync = true;
+	// Bytes of the database file to access through memory mapping.
+	qint64 mmapSize = 64 * 1024 * 1024;
+	// Page cache size in KiB.
+	int cacheSize = 16 * 1024;
+	// Idle time before a WAL checkpoint in milliseconds, 0 to disable.
+	int checkpointInterval = 5000;
+	// Keep the whole graph in memory and build states from it.
+	bool graphCache = false;
+
+	static StorageProfile defaultProfile() {
+		return StorageProfile();
+	}
+
+	static StorageProfile compatibleProfile() {
+		return StorageProfile{
+			.wal = false,
+			.relaxedSync = false,
+			.mmapSize = 0,
+			.cacheSize = 2 * 1024,
+			.checkpointInterval = 0,
+			.graphCache = false,
+		};
+	}
+};
+
+#endif
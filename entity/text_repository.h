@@ -1,6 +1,9 @@
 #ifndef H_TEXT_REPOSITORY
 #define H_TEXT_REPOSITORY
 
+#include <functional>
+
+#include <QObject>
 #include <QString>
 
 #include "model/model.h"
@@ -28,6 +31,23 @@ class TextRepository {
 public:
 	virtual GetResult getText(ThoughtId) = 0;
 	virtual SaveResult saveText(ThoughtId, QString) = 0;
+	// Asynchronous versions of the above. Same rules as in
+	// SearchRepository::searchAsync apply.
+	virtual void getTextAsync(
+		ThoughtId id,
+		QObject*,
+		std::function<void(GetResult)> callback
+	) {
+		callback(getText(id));
+	}
+	virtual void saveTextAsync(
+		ThoughtId id,
+		QString text,
+		QObject*,
+		std::function<void(SaveResult)> callback
+	) {
+		callback(saveText(id, text));
+	}
 	// This method copies the method from GraphRepository. I don't know
 	// if this is the "correct" way, but it feels right in terms of
 	// separation of data access interfaces for separate logical/UI
@@ -35,6 +55,15 @@ public:
 	// to remember that there are two places to modify the method. I
 	// might revert this change later, I don't know...
 	virtual bool connectThoughts(ThoughtId, ThoughtId, ConnectionType) = 0;
+	virtual void connectThoughtsAsync(
+		ThoughtId fromId,
+		ThoughtId toId,
+		ConnectionType type,
+		QObject*,
+		std::function<void(bool)> callback
+	) {
+		callback(connectThoughts(fromId, toId, type));
+	}
 };
 
 #endif
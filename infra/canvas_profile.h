@@ -0,0 +1,34 @@
+#ifndef H_CANVAS_PROFILE
+#define H_CANVAS_PROFILE
+
+#include <cstddef>
+
+#include "widgets/canvas_widget.h"
+
+/**
+ * How the canvas of a brain places and draws thoughts.
+ *
+ * Default profile places them on the fixed sides of DefaultLayout. Force
+ * layout places every loaded thought as one graph with ForceLayout instead,
+ * so thoughts are loaded several hops around the selected one.
+ *
+ * Connections are drawn by the retained renderer, which repaints only the
+ * part of the canvas around a hovered connection. Immediate renderer draws
+ * every connection on each paint and is left as a fallback.
+ */
+struct CanvasProfile {
+	// ForceLayout instead of DefaultLayout.
+	bool forceLayout = false;
+	// Hops loaded around the selected thought with the force layout, and max
+	// number of thoughts past its neighborhood. DefaultLayout only shows the
+	// neighborhood.
+	int depth = 3;
+	size_t budget = 300;
+	CanvasRenderer renderer = CanvasRenderer::Retained;
+
+	static CanvasProfile defaultProfile() {
+		return CanvasProfile();
+	}
+};
+
+#endif
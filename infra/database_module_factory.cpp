@@ -5,6 +5,7 @@
 #include "infra/memory_factory.h"
 #include "model/thought.h"
 #include "layout/default_layout.h"
+#include "layout/force_layout.h"
 #include "entity/thought_entity.h"
 #include "entity/connection_entity.h"
 #include "entity/memory_repository.h"
@@ -24,12 +25,14 @@
 #include "presenters/search_presenter.h"
 #include "presenters/history_presenter.h"
 #include "presenters/connections_presenter.h"
+#include "entity/async_brain_repository.h"
 #include "infra/database_module_factory.h"
 
 DatabaseModuleFactory::DatabaseModuleFactory(
 	Style *style,
-	ResourceProvider *provider
-) : m_style(style), m_provider(provider) {}
+	ResourceProvider *provider,
+	CanvasProfile canvas
+) : m_style(style), m_provider(provider), m_canvas(canvas) {}
 
 DismissableModule DatabaseModuleFactory::makeBrainsModule() {
 	QString path = m_provider->brainsFolderPath();
@@ -56,7 +59,7 @@ DismissableModule DatabaseModuleFactory::makeBrainModule(QString id) {
 		.arg(m_provider->brainsFolderPath())
 		.arg(id);
 	QDir dir = QDir(path);
-	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+	AsyncBrainRepository *repo = AsyncBrainRepository::fromDir(dir);
 
 	// Text editor widget and presenter.
 	MarkdownEditWidget *markdownWidget = new MarkdownEditWidget(nullptr, m_style);
@@ -80,14 +83,19 @@ DismissableModule DatabaseModuleFactory::makeBrainModule(QString id) {
 	);
 
 	// Canvas widget to draw connection graph.
-	DefaultLayout *layout = new DefaultLayout(m_style);
+	BaseLayout *layout = m_canvas.forceLayout
+		? (BaseLayout*)new ForceLayout(m_style)
+		: new DefaultLayout(m_style);
 	CanvasWidget *canvasWidget = new CanvasWidget(nullptr, m_style, layout);
+	canvasWidget->setRenderer(m_canvas.renderer);
 	CanvasPresenter *canvasPresenter = new CanvasPresenter(
 		layout,
 		repo,
 		repo,
 		canvasWidget
 	);
+	if (m_canvas.forceLayout)
+		canvasPresenter->setSelectionDepth(m_canvas.depth, m_canvas.budget);
 
 	// Canvas container with additional controls.
 	ContainerWidget *containerWidget = new ContainerWidget(
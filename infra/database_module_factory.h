@@ -9,18 +9,24 @@
 #include "infra/dismissable_module.h"
 #include "infra/module_factory.h"
 #include "infra/resource_provider.h"
+#include "infra/canvas_profile.h"
 #include "entity/database_brain_repository.h"
 #include "entity/folder_brains_repository.h"
 
 class DatabaseModuleFactory: public ModuleFactory {
 public:
-	DatabaseModuleFactory(Style*, ResourceProvider*);
+	DatabaseModuleFactory(
+		Style*,
+		ResourceProvider*,
+		CanvasProfile = CanvasProfile::defaultProfile()
+	);
 	DismissableModule makeBrainsModule() override;
 	DismissableModule makeBrainModule(QString) override;
 
 private:
 	Style *m_style;
 	ResourceProvider *m_provider;
+	CanvasProfile m_canvas;
 };
 
 #endif
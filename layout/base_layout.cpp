@@ -1,8 +1,13 @@
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <vector>
 #include <unordered_map>
 
 #include "model/thought.h"
 #include "layout/base_layout.h"
 #include "widgets/style.h"
+#include "layout/text_metrics.h"
 
 BaseLayout::BaseLayout(Style *style)
  : m_template(nullptr, style, 0, true, "", false, false, false)
@@ -15,6 +20,19 @@ void BaseLayout::setState(const State* state) {
 	reload();
 }
 
+void BaseLayout::setStateAsync(const State* state) {
+	setState(state);
+}
+
+void BaseLayout::applyChange(const StateChange& change) {
+	if (change.isEmpty())
+		return;
+
+	// Thoughts could be added or removed, so pointers to them held by the
+	// layout must be refreshed.
+	setState(m_state);
+}
+
 void BaseLayout::setSize(QSize size) {
 	m_size = size;
 	reload();
@@ -22,8 +40,53 @@ void BaseLayout::setSize(QSize size) {
 
 void BaseLayout::setStyle(Style* style) {
 	m_style = style;
+	// Cached measurements might be done with the old fonts.
+	TextMetrics::shared().clear();
 	reload();
 }
 
+void BaseLayout::connectionsOf(
+	ThoughtId id,
+	std::vector<ItemConnection> *connections,
+	std::vector<ItemConnection> *subconnections
+) const {
+	const std::vector<ItemConnection> *lists[] = {this->connections(), this->subconnections()};
+	std::vector<ItemConnection> *results[] = {connections, subconnections};
+
+	for (int idx = 0; idx < 2; idx++) {
+		if (lists[idx] == nullptr)
+			continue;
+
+		for (auto& connection: *lists[idx]) {
+			if (connection.from == id || connection.to == id)
+				results[idx]->push_back(connection);
+		}
+	}
+}
+
 void BaseLayout::onScroll(unsigned int, int) {}
 
+void BaseLayout::diffConnections(
+	std::vector<ItemConnection> before,
+	std::vector<ItemConnection> after,
+	std::unordered_set<ThoughtId>& ids
+) {
+	auto less = [](const ItemConnection& a, const ItemConnection& b) {
+		return std::tie(a.from, a.to, a.type) < std::tie(b.from, b.to, b.type);
+	};
+	std::sort(before.begin(), before.end(), less);
+	std::sort(after.begin(), after.end(), less);
+
+	std::vector<ItemConnection> difference;
+	std::set_symmetric_difference(
+		before.begin(), before.end(),
+		after.begin(), after.end(),
+		std::back_inserter(difference),
+		less
+	);
+
+	for (auto& connection: difference) {
+		ids.insert(connection.from);
+		ids.insert(connection.to);
+	}
+}
@@ -1,11 +1,14 @@
 #ifndef H_BASE_LAYOUT
 #define H_BASE_LAYOUT
 
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <QSize>
 
 #include "model/state.h"
+#include "model/state_change.h"
 #include "model/thought.h"
 #include "layout/item_layout.h"
 #include "layout/scroll_area_layout.h"
@@ -19,6 +22,11 @@ public:
 	virtual ~BaseLayout() {};
 	// State manipulation.
 	virtual void setState(const State*);
+	// Same as setState, but the layout may be computed on another thread, in
+	// which case the previous one is kept until onUpdated is called.
+	virtual void setStateAsync(const State*);
+	// Called when the current state was patched in place.
+	virtual void applyChange(const StateChange&);
 	virtual void setSize(QSize);
 	virtual void setStyle(Style*);
 	virtual void reload() = 0;
@@ -28,6 +36,15 @@ public:
 	virtual const std::unordered_map<unsigned int, ScrollAreaLayout>* scrollAreas() const = 0;
 	virtual const std::vector<ItemConnection>* connections() const = 0;
 	virtual const std::vector<ItemConnection>* subconnections() const = 0;
+	// Connections and subconnections that have the thought at either end.
+	virtual void connectionsOf(
+		ThoughtId,
+		std::vector<ItemConnection>*,
+		std::vector<ItemConnection>*
+	) const;
+	// Items added, moved or removed by the last update, or nullptr if the
+	// whole layout was rebuilt.
+	virtual const std::unordered_set<ThoughtId>* changedItems() const { return nullptr; }
 	// Sizes.
 	virtual const QSize defaultWidgetSize() const = 0;
 	// Callback.
@@ -37,6 +54,13 @@ public slots:
 	virtual void onScroll(unsigned int, int);
 
 protected:
+	// Adds both ends of connections that are in only one of the lists.
+	static void diffConnections(
+		std::vector<ItemConnection>,
+		std::vector<ItemConnection>,
+		std::unordered_set<ThoughtId>&
+	);
+	// State.
 	QSize m_size;
 	const State *m_state = nullptr;
 	Style *m_style = nullptr;
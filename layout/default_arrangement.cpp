@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unordered_map>
+
+#include "layout/default_arrangement.h"
+#include "widgets/thought_widget.h"
+
+DefaultArrangement::DefaultArrangement(Style *style) {
+	m_style = style;
+	m_sidePadding = style->browser.scrollWidth;
+}
+
+void DefaultArrangement::setStyle(Style *style) {
+	m_style = style;
+	m_sidePadding = style->browser.scrollWidth;
+}
+
+void DefaultArrangement::setWidgetSize(QSize size) {
+	m_widgetHeight = size.height();
+	m_verticalWidgetWidth = size.width();
+	m_widgetSpacing = size.height() / 2;
+}
+
+void DefaultArrangement::setSize(QSize size) {
+	m_size = size;
+	m_topSideHeight = (int)((float)size.height() * s_sideRatio);
+	m_leftSideWidth = (int)((float)size.width() * s_sideRatio);
+}
+
+DefaultArrangement DefaultArrangement::copySettings() const {
+	DefaultArrangement result(m_style);
+	result.m_offsets = m_offsets;
+	result.m_size = m_size;
+	result.m_verticalWidgetWidth = m_verticalWidgetWidth;
+	result.m_widgetHeight = m_widgetHeight;
+	result.m_widgetSpacing = m_widgetSpacing;
+	result.m_sidePadding = m_sidePadding;
+	result.m_topSideHeight = m_topSideHeight;
+	result.m_leftSideWidth = m_leftSideWidth;
+	result.m_minWidgetWidth = m_minWidgetWidth;
+	return result;
+}
+
+void DefaultArrangement::load(const State *state) {
+	m_state = state;
+	m_parents.clear();
+	m_links.clear();
+	m_children.clear();
+	m_siblings.clear();
+	m_sideIds.clear();
+	m_connections.clear();
+	m_subconnections.clear();
+
+	if (m_state == nullptr) {
+		return;
+	}
+
+	const Thought *thought = m_state->centralThought();
+	if (thought == nullptr) {
+		return;
+	}
+	ThoughtId mainId = thought->id();
+
+	const std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
+
+	// Order direct connected nodes.
+	sortNodes(
+		m_parents, thought->parents(), thoughts,
+		&m_connections, thought->id(), LayoutConnectionType::parent
+	);
+	sortNodes(
+		m_links, thought->links(), thoughts,
+		&m_connections, thought->id(), LayoutConnectionType::link
+	);
+	sortNodes(
+		m_children, thought->children(), thoughts,
+		&m_connections, thought->id(), LayoutConnectionType::child
+	);
+
+	// Gather siblings.
+	m_siblings.clear();
+	for (const auto *parent: m_parents) {
+		for (const auto& id: parent->children()) {
+			if (id == mainId)
+				continue;
+			if (auto found = thoughts->find(id); found != thoughts->end()) {
+				bool inLinks = listContains(m_links, id);
+				bool inParents = listContains(m_parents, id);
+
+				if (!inLinks && !inParents) {
+					m_siblings.push_back(found->second);
+				}
+
+				if (inParents) {
+					m_subconnections.push_back(ItemConnection{
+						.from = parent->id(),
+						.to = id,
+						.type = ConnectionType::child
+					});
+				} else {
+					m_connections.push_back(ItemConnection{
+						.from = parent->id(),
+						.to = id,
+						.type = ConnectionType::child
+					});
+				}
+			}
+		}
+	}
+	std::sort(m_siblings.begin(), m_siblings.end(), compareThoughts);
+
+	std::pair<ScrollBarPos, std::vector<Thought*>*> sides[] = {
+		{ScrollBarPos::Left, &m_links},
+		{ScrollBarPos::Top, &m_parents},
+		{ScrollBarPos::Bottom, &m_children},
+		{ScrollBarPos::Right, &m_siblings}
+	};
+	for (auto& [pos, list]: sides) {
+		std::vector<ThoughtId>& ids = m_sideIds[pos];
+		for (const auto *node: *list)
+			ids.push_back(node->id());
+	}
+
+	// Cross-links.
+	std::vector<Thought*> nodeLists[] = {m_parents, m_children, m_links, m_siblings};
+	for (auto list: nodeLists) {
+		for (const auto *node: list) {
+			for (const auto& id: node->links())
+				if (id != mainId)
+					m_subconnections.push_back(
+						ItemConnection{.from = node->id(), .to = id, .type = ConnectionType::link}
+					);
+			if (list != m_parents)
+				for (const auto& id: node->children())
+					if (id != mainId)
+						m_subconnections.push_back(
+							ItemConnection{.from = node->id(), .to = id, .type = ConnectionType::child}
+						);
+			for (const auto& id: node->parents())
+				if (id != mainId)
+					m_subconnections.push_back(
+						ItemConnection{.from = id, .to = node->id(), .type = ConnectionType::child}
+					);
+		}
+	}
+}
+
+void DefaultArrangement::layout() {
+	m_sides.clear();
+	m_scrollAreas.clear();
+	m_center.reset();
+
+	if (m_state == nullptr || m_state->centralThought() == nullptr)
+		return;
+
+	layoutCenter();
+
+	layoutSide(ScrollBarPos::Left);
+	layoutSide(ScrollBarPos::Top);
+	layoutSide(ScrollBarPos::Bottom);
+	layoutSide(ScrollBarPos::Right);
+}
+
+void DefaultArrangement::adoptLayout(const DefaultArrangement& other) {
+	m_center = other.m_center;
+	m_sides = other.m_sides;
+	m_scrollAreas = other.m_scrollAreas;
+	m_offsets = other.m_offsets;
+}
+
+// Scrolling.
+
+int DefaultArrangement::offset(unsigned int scrollId) const {
+	auto found = m_offsets.find(scrollId);
+	return found != m_offsets.end() ? found->second : 0;
+}
+
+void DefaultArrangement::setOffset(unsigned int scrollId, int offset) {
+	m_offsets.insert_or_assign(scrollId, offset);
+}
+
+// Getters.
+
+const std::vector<ItemLayout>& DefaultArrangement::side(unsigned int pos) const {
+	static const std::vector<ItemLayout> empty;
+
+	auto found = m_sides.find(pos);
+	return found != m_sides.end() ? found->second : empty;
+}
+
+QSize DefaultArrangement::defaultWidgetSize() const {
+	return QSize(
+		m_verticalWidgetWidth,
+		m_widgetHeight
+	);
+}
+
+void DefaultArrangement::layoutCenter() {
+	const Thought *thought = m_state->centralThought();
+
+	// Position the central element.
+	QSize centralSize = widgetSize(thought->name(), m_size.width() * 0.4);
+	ItemLayout centralLayout = ItemLayout(
+		thought->id(),
+		thought->name(),
+		(m_size.width() - centralSize.width()) / 2,
+		(m_size.height() - centralSize.height()) / 2,
+		centralSize.width(),
+		centralSize.height(),
+		true,
+		thought->hasParents(),
+		thought->hasChildren(),
+		thought->hasLinks(),
+		false,
+		false
+	);
+
+	// Save the central element.
+	m_center = centralLayout;
+}
+
+void DefaultArrangement::layoutSide(ScrollBarPos pos) {
+	m_sides.erase(pos);
+	m_scrollAreas.erase(pos);
+
+	switch (pos) {
+	case ScrollBarPos::Left:
+		if (m_links.size() > 0) {
+			layoutVerticalSide(
+				m_links,
+				QRect(
+					m_sidePadding,
+					m_sidePadding + m_topSideHeight,
+					m_leftSideWidth,
+					m_size.height() - (m_topSideHeight + m_sidePadding) * 2
+				),
+				ScrollBarPos::Left,
+				true
+			);
+		}
+		break;
+	case ScrollBarPos::Top:
+		if (m_parents.size() > 0) {
+			layoutHorizontalSide(
+				m_parents,
+				QRect(
+					m_sidePadding + m_leftSideWidth,
+					m_sidePadding,
+					m_size.width() - (m_leftSideWidth + m_sidePadding) * 2,
+					m_topSideHeight
+				),
+				ScrollBarPos::Top
+			);
+		}
+		break;
+	case ScrollBarPos::Bottom:
+		if (m_children.size() > 0) {
+			layoutHorizontalSide(
+				m_children,
+				QRect(
+					m_sidePadding + m_leftSideWidth,
+					m_size.height() - m_topSideHeight - m_sidePadding,
+					m_size.width() - (m_leftSideWidth + m_sidePadding) * 2,
+					m_topSideHeight
+				),
+				ScrollBarPos::Bottom
+			);
+		}
+		break;
+	case ScrollBarPos::Right:
+		if (m_siblings.size() > 0) {
+			layoutVerticalSide(
+				m_siblings,
+				QRect(
+					m_size.width() - m_leftSideWidth - m_sidePadding,
+					m_sidePadding + m_topSideHeight,
+					m_leftSideWidth,
+					m_size.height() - (m_topSideHeight + m_sidePadding) * 2
+				),
+				ScrollBarPos::Right,
+				false
+			);
+		}
+		break;
+	}
+}
+
+void DefaultArrangement::layoutVerticalSide(
+	const std::vector<Thought*>& sorted,
+	QRect rect,
+	ScrollBarPos scrollPos,
+	bool rightSideLink
+) {
+	ThoughtId rootId = m_state->rootId();
+
+	// Not enough space to layout anything, just return.
+	if (rect.width() < m_minWidgetWidth)
+		return;
+
+	// Measuring a widget is expensive, and a side can hold thousands of items,
+	// so sizes are calculated lazily, only for items that can end up on screen.
+	std::vector<QSize> sizes(sorted.size());
+	std::vector<bool> measured(sorted.size(), false);
+	auto sizeAt = [this, &sorted, &sizes, &measured](int idx) {
+		if (!measured[idx]) {
+			sizes[idx] = widgetSize(sorted[idx]->name(), m_leftSideWidth);
+			measured[idx] = true;
+		}
+		return sizes[idx];
+	};
+
+	// Total height = height of all widget + (count of widgets - 1) * spacer.
+	// Items are measured in order until they overflow the side, the rest can't
+	// fit anyway.
+	int totalHeight = 0, count = 0;
+	while (count < (int)sorted.size() && totalHeight <= rect.height()) {
+		totalHeight += sizeAt(count).height();
+		count++;
+	}
+
+	int totalSpaces = m_widgetSpacing * (count - 1);
+	int spacer = m_widgetSpacing;
+	int maxCount = count;
+
+	// If we can't fit all widgets, we fit max number of them.
+	if ((totalHeight + totalSpaces) > rect.height()) {
+		if (totalHeight <= rect.height()) {
+			spacer = (rect.height() - totalHeight) / (count - 1);
+			totalSpaces = spacer * (count - 1);
+		} else {
+			while (maxCount > 0 && totalHeight > rect.height()) {
+				maxCount -= 1;
+				totalHeight -= sizeAt(maxCount).height();
+			}
+
+			// Can't fit a single item, return.
+			if (maxCount == 0) {
+				return;
+			}
+
+			spacer = (maxCount > 1)
+				? (rect.height() - totalHeight) / (maxCount - 1)
+				: 0;
+			totalSpaces = spacer * (maxCount - 1);
+		}
+	}
+
+	// Apply offset. If the number of visible rows has changed, the cached
+	// offset value might invalid, i.e. trying to layout non-existent rows.
+	// So if number of visible rows after offset goes beyond total row count,
+	// we reduce the offset to fit into the layout.
+	auto cachedOffset = m_offsets.find(scrollPos);
+	int offset = 0;
+	if (cachedOffset != m_offsets.end()) {
+		if (cachedOffset->second + maxCount > sorted.size()) {
+			offset = std::max(0, (int)sorted.size() - maxCount);
+		} else {
+			offset = cachedOffset->second;
+		}
+		m_offsets.insert_or_assign(scrollPos, offset);
+	}
+
+	// Layout.
+	int y = rect.y() + (rect.height() - totalHeight - totalSpaces) / 2, idx;
+	for (idx = offset; idx < maxCount + offset; idx++) {
+		QSize size = sizeAt(idx);
+		Thought *thought = sorted[idx];
+
+		ItemLayout layout(
+			thought->id(),
+			thought->name(),
+			rect.x() + (rect.width() - size.width()) / 2,
+			y,
+			size.width(),
+			size.height(),
+			true,
+			thought->hasParents(),
+			thought->hasChildren(),
+			thought->hasLinks(),
+			rightSideLink,
+			thought->id() != rootId
+		);
+
+		m_sides[scrollPos].push_back(layout);
+		y += size.height() + spacer;
+	}
+
+	// We have items left outside, add scroll area.
+	if (maxCount < sorted.size()) {
+		int scrollWidth = m_style->browser.scrollWidth;
+		float barWidth = (float)maxCount / (float)sorted.size();
+		float relativeOffset = maxCount != 0 ? ((float)offset / (float)sorted.size()) : 0;
+
+		ScrollAreaLayout layout(
+			rect.x() - scrollWidth / 2,
+			rect.y(),
+			rect.width() + scrollWidth,
+			rect.height(),
+			scrollPos,
+			barWidth,
+			relativeOffset,
+			sorted.size() - maxCount
+		);
+		m_scrollAreas.insert_or_assign(scrollPos, layout);
+	}
+}
+
+void DefaultArrangement::layoutHorizontalSide(
+	const std::vector<Thought*>& sorted,
+	QRect rect,
+	ScrollBarPos scrollPos
+) {
+	ThoughtId rootId = m_state->rootId();
+
+	// Total column count from available space.
+	int visibleColumnCount, w = m_verticalWidgetWidth;
+	for (visibleColumnCount = 0; w < rect.width(); visibleColumnCount++) {
+		w += m_verticalWidgetWidth;
+	}
+
+	// Can't fit a single column.
+	if (visibleColumnCount == 0)
+		return;
+
+	// Number of items per column.
+	int columnCapacity = rect.height() / m_widgetHeight;
+
+	// Can't fit a single row.
+	if (columnCapacity == 0)
+		return;
+
+	// Number of columns required to fit all nodes.
+	int requiredColumnCount = (sorted.size() + columnCapacity - 1) / columnCapacity;
+
+	// We have two cases:
+	// 1. All items fit into the visible area, in which case we try layout items
+	//    to have equal number of items in each column.
+	// 2. There's more items than slots available in the visible area, in which
+	//    case we try to display as much items as possible in the visible area.
+	int itemsPerColumn = 0, columnCount = 0;
+	if (requiredColumnCount <= visibleColumnCount) {
+		itemsPerColumn = (sorted.size() + visibleColumnCount - 1) / visibleColumnCount;
+		columnCount = (sorted.size() + itemsPerColumn - 1) / itemsPerColumn;
+	} else {
+		itemsPerColumn = columnCapacity;
+		columnCount = visibleColumnCount;
+	}
+
+	int columnWidth = rect.width() / columnCount;
+
+	// Apply offset. If the number of visible columns has changed, the cached
+	// offset value might invalid, i.e. trying to layout non-existent columns.
+	// So if number of visible columns after offset goes beyond total column
+	// count, we reduce the offset to fit into the layout.
+	auto cachedOffset = m_offsets.find(scrollPos);
+	int offset = 0;
+	if (cachedOffset != m_offsets.end()) {
+		if (cachedOffset->second + columnCount > requiredColumnCount) {
+			offset = std::max(0, (int)requiredColumnCount - columnCount);
+		} else {
+			offset = cachedOffset->second;
+		}
+		m_offsets.insert_or_assign(scrollPos, offset);
+	}
+
+	// Layout columns.
+	int idx = offset * itemsPerColumn, col, row, x, y, height, rowCount;
+	for (col = 0; col < columnCount; col++) {
+
+		// Horizontal and vertical position of the column.
+		x = rect.x() + (columnWidth * col);
+		y = rect.y();
+
+		// Height of the column content: items in column * widget height.
+		rowCount = std::min(itemsPerColumn, (int)(sorted.size()) - idx);
+		height = rowCount * m_widgetHeight;
+
+		// Layout each item in the column.
+		for (row = 0; row < rowCount; row++) {
+			Thought *thought = sorted[idx];
+			QSize size = widgetSize(
+				thought->name(),
+				std::max(columnWidth - 2 * m_widgetSpacing, m_verticalWidgetWidth)
+			);
+
+			ItemLayout layout(
+				thought->id(),
+				thought->name(),
+				x + (columnWidth - size.width()) / 2,
+				y + ((rect.height() - height) / 2) + (row * m_widgetHeight),
+				size.width(),
+				size.height(),
+				true,
+				thought->hasParents(),
+				thought->hasChildren(),
+				thought->hasLinks(),
+				false,
+				thought->id() != rootId
+			);
+
+			m_sides[scrollPos].push_back(layout);
+
+			idx += 1;
+		}
+	}
+
+	// We have items left outside, add scroll area.
+	if (columnCount < requiredColumnCount) {
+		int scrollWidth = m_style->browser.scrollWidth;
+		float barWidth = (float)columnCount / (float)requiredColumnCount;
+		float relativeOffset = requiredColumnCount != 0
+			? ((float)offset / (float)requiredColumnCount)
+			: 0;
+
+		ScrollAreaLayout layout(
+			rect.x(),
+			rect.y() - scrollWidth,
+			rect.width(),
+			rect.height() + scrollWidth,
+			scrollPos,
+			barWidth,
+			relativeOffset,
+			requiredColumnCount - columnCount
+		);
+		m_scrollAreas.insert_or_assign(scrollPos, layout);
+	}
+}
+
+QSize DefaultArrangement::widgetSize(std::string text, int maxWidth) {
+	// Get size hint to estimate the full text length. Measurements are cached,
+	// so relayouts don't measure the same labels again.
+	QSize sizeHint = ThoughtWidget::sizeHintForText(
+		m_style,
+		QString::fromStdString(text)
+	);
+	// Actual width is the width of full text up to max allowed width.
+	int actualWidth = std::min(
+		maxWidth,
+		sizeHint.width()
+	);
+
+	return QSize(
+		actualWidth,
+		sizeHint.height()
+	);
+}
+
+// Utility functions.
+
+inline bool DefaultArrangement::compareThoughts(Thought *a, Thought *b) {
+	return (a->name().compare(b->name()) < 0);
+}
+
+inline bool DefaultArrangement::listContains(std::vector<Thought*>& list, ThoughtId id) {
+	for (auto *thought: list)
+		if (thought->id() == id)
+			return true;
+
+	return false;
+}
+
+inline void DefaultArrangement::sortNodes(
+	// Data to sort nodes.
+	std::vector<Thought*>& list,
+	const std::vector<ThoughtId>& ids,
+	const std::unordered_map<ThoughtId, Thought*>* map,
+	// Data to fill connections:
+	std::vector<ItemConnection>* connections,
+	ThoughtId from,
+	LayoutConnectionType conn
+) {
+	list.clear();
+	for (const auto& id: ids) {
+		if (auto found = map->find(id); found != map->end()) {
+			list.push_back(found->second);
+
+			switch (conn) {
+				case LayoutConnectionType::parent:
+					connections->push_back(ItemConnection{
+						.from = id,
+						.to = from,
+						.type = ConnectionType::child
+					});
+					break;
+				case LayoutConnectionType::child:
+					connections->push_back(ItemConnection{
+						.from = from,
+						.to = id,
+						.type = ConnectionType::child
+					});
+					break;
+				case LayoutConnectionType::link:
+					connections->push_back(ItemConnection{
+						.from = from,
+						.to = id,
+						.type = ConnectionType::link
+					});
+					break;
+			}
+		}
+	}
+	std::sort(list.begin(), list.end(), compareThoughts);
+}
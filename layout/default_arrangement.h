@@ -0,0 +1,111 @@
+#ifndef H_DEFAULT_ARRANGEMENT
+#define H_DEFAULT_ARRANGEMENT
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <QRect>
+#include <QSize>
+
+#include "model/state.h"
+#include "model/thought.h"
+#include "layout/item_layout.h"
+#include "layout/scroll_area_layout.h"
+#include "layout/item_connection.h"
+#include "widgets/style.h"
+
+/**
+ * Places the central thought of a State in the middle and its neighbors on
+ * the four sides around it, as DefaultLayout shows them.
+ *
+ * Holds no widgets, labels are measured through the shared TextMetrics, so
+ * an arrangement can be made on a worker thread. Sizes of widgets are
+ * measured once by the layout and passed in.
+ */
+class DefaultArrangement {
+	enum LayoutConnectionType { child, parent, link };
+
+public:
+	DefaultArrangement(Style*);
+	// Settings.
+	void setStyle(Style*);
+	// Size of a widget with a label of average length.
+	void setWidgetSize(QSize);
+	void setSize(QSize);
+	// Arrangement with the same settings and scroll offsets, with nothing
+	// loaded or laid out.
+	DefaultArrangement copySettings() const;
+	// Sorts neighbors of the central thought into sides and collects
+	// connections between them. Thoughts are kept by pointers, so the state
+	// must outlive them or be loaded again.
+	void load(const State*);
+	// Lays out the central thought and all sides.
+	void layout();
+	void layoutCenter();
+	void layoutSide(ScrollBarPos);
+	// Takes laid out items, scroll areas and offsets of another arrangement
+	// made from the same state.
+	void adoptLayout(const DefaultArrangement&);
+	// Scrolling.
+	int offset(unsigned int) const;
+	void setOffset(unsigned int, int);
+	// Results.
+	const std::optional<ItemLayout>& center() const { return m_center; }
+	const std::vector<ItemLayout>& side(unsigned int) const;
+	const std::unordered_map<unsigned int, ScrollAreaLayout>& scrollAreas() const { return m_scrollAreas; }
+	// IDs of thoughts of each side, in order. Unlike the thoughts, they are
+	// safe to read after thoughts were removed from the state.
+	const std::unordered_map<unsigned int, std::vector<ThoughtId>>& sideIds() const { return m_sideIds; }
+	const std::vector<ItemConnection>& connections() const { return m_connections; }
+	const std::vector<ItemConnection>& subconnections() const { return m_subconnections; }
+	QSize defaultWidgetSize() const;
+
+private:
+	// Helpers.
+	static inline bool compareThoughts(Thought*, Thought*);
+	static inline void sortNodes(
+		// Data to sort nodes.
+		std::vector<Thought*>&,
+		const std::vector<ThoughtId>&,
+		const std::unordered_map<ThoughtId, Thought*>*,
+		// Data to fill connections:
+		std::vector<ItemConnection>*,
+		ThoughtId,
+		LayoutConnectionType
+	);
+	static inline bool listContains(std::vector<Thought*>&, ThoughtId);
+	void layoutHorizontalSide(const std::vector<Thought*>&, QRect, ScrollBarPos);
+	void layoutVerticalSide(const std::vector<Thought*>&, QRect, ScrollBarPos, bool);
+	// Sizing helpers.
+	QSize widgetSize(std::string text, int);
+	// State.
+	const State *m_state = nullptr;
+	Style *m_style = nullptr;
+	std::vector<Thought*> m_siblings;
+	std::vector<Thought*> m_children;
+	std::vector<Thought*> m_parents;
+	std::vector<Thought*> m_links;
+	std::unordered_map<unsigned int, std::vector<ThoughtId>> m_sideIds;
+	std::vector<ItemConnection> m_connections;
+	std::vector<ItemConnection> m_subconnections;
+	// Items of the central thought and of each side.
+	std::optional<ItemLayout> m_center;
+	std::unordered_map<unsigned int, std::vector<ItemLayout>> m_sides;
+	std::unordered_map<unsigned int, ScrollAreaLayout> m_scrollAreas;
+	std::unordered_map<unsigned int, int> m_offsets;
+	// Layout settings.
+	QSize m_size;
+	int m_verticalWidgetWidth = 0;
+	int m_widgetHeight = 0;
+	int m_widgetSpacing = 0;
+	int m_sidePadding = 10;
+	int m_topSideHeight = 0;
+	int m_leftSideWidth = 0;
+	int m_minWidgetWidth = 40;
+	// Ratio.
+	static constexpr float s_sideRatio = 0.2;
+};
+
+#endif
@@ -1,21 +1,27 @@
+#include <memory>
+#include <utility>
+
 #include "layout/default_layout.h"
 #include "layout/item_layout.h"
 #include "layout/scroll_area_layout.h"
 
 DefaultLayout::DefaultLayout(Style* style)
-	: BaseLayout(style)
+	: BaseLayout(style), m_arrangement(style)
 {
 	// Sample text to estimate "average" widget width.
 	m_template.setText("xxxxxxxxxx");
-
-	QSize size = m_template.sizeHint();
-	m_widgetHeight = size.height();
-	m_verticalWidgetWidth = size.width();
-	m_widgetSpacing = size.height() / 2;
-	m_sidePadding = style->browser.scrollWidth;
+	m_arrangement.setWidgetSize(m_template.sizeHint());
 }
 
-DefaultLayout::~DefaultLayout() {}
+DefaultLayout::~DefaultLayout() {
+	// Let the running layout finish.
+	if (m_thread != nullptr) {
+		m_thread->quit();
+		m_thread->wait();
+		delete m_worker;
+		delete m_thread;
+	}
+}
 
 void DefaultLayout::reload() {
 	if (m_state == nullptr) {
@@ -27,12 +33,16 @@ void DefaultLayout::reload() {
 		return;
 	}
 
-	// Clear the previous layout.
-	m_layout.clear();
-	m_scrollAreas.clear();
+	// Thoughts of the arrangement still point to the previous state.
+	if (m_pending)
+		releasePending();
+
+	m_partial = false;
+	m_changed.clear();
 
 	// Recalculate widget positions.
-	updateWidgets();
+	m_arrangement.layout();
+	mergeLayout();
 
 	// Dispatch event.
 	if (onUpdated != nullptr)
@@ -41,445 +51,233 @@ void DefaultLayout::reload() {
 
 void DefaultLayout::setSize(QSize size) {
 	m_size = size;
-	m_topSideHeight = (int)((float)size.height() * s_sideRatio);
-	m_leftSideWidth = (int)((float)size.width() * s_sideRatio);
+	m_arrangement.setSize(size);
 	reload();
 }
 
+void DefaultLayout::setStyle(Style *style) {
+	m_arrangement.setStyle(style);
+	BaseLayout::setStyle(style);
+}
+
 void DefaultLayout::setState(const State *state) {
 	m_state = state;
-	m_connections.clear();
-	m_subconnections.clear();
+	m_pending = false;
 
-	loadSiblings();
+	loadArrangement();
 	reload();
 }
 
-void DefaultLayout::loadSiblings() {
-	if (m_state == nullptr) {
+void DefaultLayout::setStateAsync(const State *state) {
+	if (state == nullptr || state->centralThought() == nullptr) {
+		setState(state);
 		return;
 	}
 
-	const Thought *thought = m_state->centralThought();
-	if (thought == nullptr) {
-		return;
-	}
-	ThoughtId mainId = thought->id();
-
-	const std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
-
-	// Order direct connected nodes.
-	sortNodes(
-		m_parents, thought->parents(), thoughts,
-		&m_connections, thought->id(), LayoutConnectionType::parent
-	);
-	sortNodes(
-		m_links, thought->links(), thoughts,
-		&m_connections, thought->id(), LayoutConnectionType::link
-	);
-	sortNodes(
-		m_children, thought->children(), thoughts,
-		&m_connections, thought->id(), LayoutConnectionType::child
-	);
-
-	// Gather siblings.
-	m_siblings.clear();
-	for (const auto *parent: m_parents) {
-		for (const auto& id: parent->children()) {
-			if (id == mainId)
-				continue;
-			if (auto found = thoughts->find(id); found != thoughts->end()) {
-				bool inLinks = listContains(m_links, id);
-				bool inParents = listContains(m_parents, id);
-
-				if (!inLinks && !inParents) {
-					m_siblings.push_back(found->second);
-				}
-
-				if (inParents) {
-					m_subconnections.push_back(ItemConnection{
-						.from = parent->id(),
-						.to = id,
-						.type = ConnectionType::child
-					});
-				} else {
-					m_connections.push_back(ItemConnection{
-						.from = parent->id(),
-						.to = id,
-						.type = ConnectionType::child
-					});
-				}
-			}
-		}
-	}
-	std::sort(m_siblings.begin(), m_siblings.end(), compareThoughts);
-
-	// Cross-links.
-	std::vector<Thought*> nodeLists[] = {m_parents, m_children, m_links, m_siblings};
-	for (auto list: nodeLists) {
-		for (const auto *node: list) {
-			for (const auto& id: node->links())
-				if (id != mainId)
-					m_subconnections.push_back(
-						ItemConnection{.from = node->id(), .to = id, .type = ConnectionType::link}
-					);
-			if (list != m_parents)
-				for (const auto& id: node->children())
-					if (id != mainId)
-						m_subconnections.push_back(
-							ItemConnection{.from = node->id(), .to = id, .type = ConnectionType::child}
-						);
-			for (const auto& id: node->parents())
-				if (id != mainId)
-					m_subconnections.push_back(
-						ItemConnection{.from = id, .to = node->id(), .type = ConnectionType::child}
-					);
-		}
+	if (m_thread == nullptr) {
+		m_thread = new QThread();
+		m_thread->setObjectName("layout");
+		m_worker = new QObject();
+		m_worker->moveToThread(m_thread);
+		m_thread->start();
 	}
-}
 
-void DefaultLayout::updateWidgets() {
-	if (m_state == nullptr) {
-		return;
-	}
+	m_state = state;
+	m_pending = true;
+	uint64_t generation = ++m_generation;
+
+	// The repository patches its state in place, and settings of this layout
+	// can change at any time, so the worker only reads copies made here.
+	// Widget sizes measured by this layout are reused.
+	DefaultArrangement arrangement = m_arrangement.copySettings();
+	std::shared_ptr<State> snapshot(state->copy());
+	QObject *relay = &m_relay;
+
+	QMetaObject::invokeMethod(m_worker, [this, relay, arrangement, snapshot, generation]() mutable {
+		arrangement.load(snapshot.get());
+		arrangement.layout();
+		// Thoughts of the copy go away with it.
+		arrangement.load(nullptr);
+
+		// Dropped if the layout is gone by then.
+		QMetaObject::invokeMethod(relay, [this, generation, arrangement]() {
+			adoptArrangement(generation, arrangement);
+		}, Qt::QueuedConnection);
+	}, Qt::QueuedConnection);
+}
 
-	const Thought *thought = m_state->centralThought();
-	if (thought == nullptr) {
+void DefaultLayout::adoptArrangement(
+	uint64_t generation,
+	const DefaultArrangement& arrangement
+) {
+	// Layout was made again in the meantime, or a newer one is on its way.
+	if (!m_pending || generation != m_generation)
 		return;
-	}
-
-	// Position the central element.
-	QSize centralSize = widgetSize(thought->name(), m_size.width() * 0.4);
-	ItemLayout centralLayout = ItemLayout(
-		thought->id(),
-		thought->name(),
-		(m_size.width() - centralSize.width()) / 2,
-		(m_size.height() - centralSize.height()) / 2,
-		centralSize.width(),
-		centralSize.height(),
-		true,
-		thought->hasParents(),
-		thought->hasChildren(),
-		thought->hasLinks(),
-		false,
-		false
-	);
-
-	// Save the central element.
-	m_layout.insert_or_assign(thought->id(), centralLayout);
-
-	//  Left side.
-	if (m_links.size() > 0) {
-		layoutVerticalSide(
-			m_links,
-			QRect(
-				m_sidePadding,
-				m_sidePadding + m_topSideHeight,
-				m_leftSideWidth,
-				m_size.height() - (m_topSideHeight + m_sidePadding) * 2
-			),
-			ScrollBarPos::Left,
-			true
-		);
-	}
 
-	// Top side.
-	if (m_parents.size() > 0) {
-		layoutHorizontalSide(
-			m_parents,
-			QRect(
-				m_sidePadding + m_leftSideWidth,
-				m_sidePadding,
-				m_size.width() - (m_leftSideWidth + m_sidePadding) * 2,
-				m_topSideHeight
-			),
-			ScrollBarPos::Top
-		);
-	}
+	// State hasn't changed since it was copied, so thoughts loaded from it
+	// match the arrangement.
+	releasePending();
 
-	// Bottom side.
-	if (m_children.size() > 0) {
-		layoutHorizontalSide(
-			m_children,
-			QRect(
-				m_sidePadding + m_leftSideWidth,
-				m_size.height() - m_topSideHeight - m_sidePadding,
-				m_size.width() - (m_leftSideWidth + m_sidePadding) * 2,
-				m_topSideHeight
-			),
-			ScrollBarPos::Bottom
-		);
-	}
+	m_arrangement.adoptLayout(arrangement);
+	m_partial = false;
+	m_changed.clear();
+	mergeLayout();
 
-	// Right side.
-	if (m_siblings.size() > 0) {
-		layoutVerticalSide(
-			m_siblings,
-			QRect(
-				m_size.width() - m_leftSideWidth - m_sidePadding,
-				m_sidePadding + m_topSideHeight,
-				m_leftSideWidth,
-				m_size.height() - (m_topSideHeight + m_sidePadding) * 2
-			),
-			ScrollBarPos::Right,
-			false
-		);
-	}
+	if (onUpdated != nullptr)
+		onUpdated();
 }
 
-void DefaultLayout::layoutVerticalSide(
-	const std::vector<Thought*>& sorted,
-	QRect rect,
-	ScrollBarPos scrollPos,
-	bool rightSideLink
-) {
-	ThoughtId rootId = m_state->rootId();
+void DefaultLayout::releasePending() {
+	m_pending = false;
+	loadArrangement();
+}
 
-	// Not enough space to layout anything, just return.
-	if (rect.width() < m_minWidgetWidth)
+void DefaultLayout::applyChange(const StateChange& change) {
+	if (change.isEmpty())
 		return;
 
-	// Calculate all sized in order.
-	std::vector<QSize> sizes;
-	for (const auto thought: sorted) {
-		QSize size = widgetSize(thought->name(), m_leftSideWidth);
-		sizes.push_back(size);
-	}
+	if (m_state == nullptr || m_state->centralThought() == nullptr)
+		return;
 
-	// Total height = height of all widget + (count of widgets - 1) * spacer.
-	auto reducer = [](int acc, const QSize& size) { return acc + size.height(); };
-	int totalSpaces = m_widgetSpacing * (sizes.size() - 1);
-	int totalHeight = std::accumulate(sizes.begin(), sizes.end(), 0, reducer);
-	int spacer = m_widgetSpacing;
-	int maxCount = sizes.size();
-
-	// If we can't fit all widgets, we fit max number of them.
-	if ((totalHeight + totalSpaces) > rect.height()) {
-		if (totalHeight <= rect.height()) {
-			spacer = (rect.height() - totalHeight) / (sizes.size() - 1);
-			totalSpaces = spacer * (sizes.size() - 1);
-		} else {
-			while (maxCount > 0 && totalHeight > rect.height()) {
-				maxCount -= 1;
-				totalHeight -= sizes[maxCount].height();
-			}
-
-			// Can't fit a single item, return.
-			if (maxCount == 0) {
-				return;
-			}
-
-			spacer = (maxCount > 1)
-				? (rect.height() - totalHeight) / (maxCount - 1)
-				: 0;
-			totalSpaces = spacer * (maxCount - 1);
-		}
+	// Pending layout was made from the state before it was patched.
+	if (m_pending) {
+		reload();
+		return;
 	}
 
-	// Apply offset. If the number of visible rows has changed, the cached
-	// offset value might invalid, i.e. trying to layout non-existent rows.
-	// So if number of visible rows after offset goes beyond total row count,
-	// we reduce the offset to fit into the layout.
-	auto cachedOffset = m_offsets.find(scrollPos);
-	int offset = 0;
-	if (cachedOffset != m_offsets.end()) {
-		if (cachedOffset->second + maxCount > sorted.size()) {
-			offset = std::max(0, (int)sorted.size() - maxCount);
-		} else {
-			offset = cachedOffset->second;
-		}
-		m_offsets.insert_or_assign(scrollPos, offset);
+	// Thoughts of the sides could have been freed, so sides are loaded again
+	// and compared with the previous ones by IDs.
+	std::unordered_map<unsigned int, std::vector<ThoughtId>> previousIds =
+		m_arrangement.sideIds();
+	std::vector<ItemConnection> previousConnections = m_arrangement.connections();
+	std::vector<ItemConnection> previousSubconnections = m_arrangement.subconnections();
+
+	loadArrangement();
+
+	std::unordered_set<ThoughtId> touched;
+	for (auto id: change.added())
+		touched.insert(id);
+	for (auto id: change.removed())
+		touched.insert(id);
+	for (auto id: change.updated())
+		touched.insert(id);
+
+	std::unordered_map<ThoughtId, ItemLayout> previous;
+	previous.swap(m_layout);
+
+	// Items that could have moved.
+	std::vector<ThoughtId> ids;
+
+	ThoughtId centralId = m_state->centralThought()->id();
+	if (touched.count(centralId) > 0) {
+		m_arrangement.layoutCenter();
+		ids.push_back(centralId);
 	}
 
-	// Layout.
-	int y = rect.y() + (rect.height() - totalHeight - totalSpaces) / 2, idx;
-	for (idx = offset; idx < maxCount + offset; idx++) {
-		QSize size = sizes[idx];
-		Thought *thought = sorted[idx];
-
-		ItemLayout layout(
-			thought->id(),
-			thought->name(),
-			rect.x() + (rect.width() - size.width()) / 2,
-			y,
-			size.width(),
-			size.height(),
-			true,
-			thought->hasParents(),
-			thought->hasChildren(),
-			thought->hasLinks(),
-			rightSideLink,
-			thought->id() != rootId
-		);
-
-		m_layout.insert_or_assign(thought->id(), layout);
-		y += size.height() + spacer;
+	// Only sides with other thoughts, or with thoughts that were modified,
+	// are laid out again.
+	ScrollBarPos order[] = {
+		ScrollBarPos::Left,
+		ScrollBarPos::Top,
+		ScrollBarPos::Bottom,
+		ScrollBarPos::Right
+	};
+
+	const std::unordered_map<unsigned int, std::vector<ThoughtId>>& sides =
+		m_arrangement.sideIds();
+
+	for (auto pos: order) {
+		static const std::vector<ThoughtId> none;
+		auto current = sides.find(pos), before = previousIds.find(pos);
+		const std::vector<ThoughtId>& sideIds = current != sides.end() ? current->second : none;
+		const std::vector<ThoughtId>& beforeIds = before != previousIds.end() ? before->second : none;
+
+		bool modified = sideIds != beforeIds;
+		for (size_t idx = 0; !modified && idx < sideIds.size(); idx++)
+			modified = touched.count(sideIds[idx]) > 0;
+
+		if (!modified)
+			continue;
+
+		for (auto& item: m_arrangement.side(pos))
+			ids.push_back(item.id);
+		m_arrangement.layoutSide(pos);
+		for (auto& item: m_arrangement.side(pos))
+			ids.push_back(item.id);
 	}
 
-	// We have items left outside, add scroll area.
-	if (maxCount < sorted.size()) {
-		int scrollWidth = m_style->browser.scrollWidth;
-		float barWidth = (float)maxCount / (float)sorted.size();
-		float relativeOffset = maxCount != 0 ? ((float)offset / (float)sorted.size()) : 0;
-
-		ScrollAreaLayout layout(
-			rect.x() - scrollWidth / 2,
-			rect.y(),
-			rect.width() + scrollWidth,
-			rect.height(),
-			scrollPos,
-			barWidth,
-			relativeOffset,
-			sorted.size() - maxCount
-		);
-		m_scrollAreas.insert_or_assign(scrollPos, layout);
-	}
-}
+	mergeLayout();
 
-void DefaultLayout::layoutHorizontalSide(
-	const std::vector<Thought*>& sorted,
-	QRect rect,
-	ScrollBarPos scrollPos
-) {
-	ThoughtId rootId = m_state->rootId();
+	// Items that were modified, moved, or gained or lost a connection.
+	m_partial = true;
+	m_changed = touched;
+	for (auto id: ids) {
+		auto before = previous.find(id), after = m_layout.find(id);
+		bool hadItem = before != previous.end(), hasItem = after != m_layout.end();
 
-	// Total column count from available space.
-	int visibleColumnCount, w = m_verticalWidgetWidth;
-	for (visibleColumnCount = 0; w < rect.width(); visibleColumnCount++) {
-		w += m_verticalWidgetWidth;
+		if (hadItem != hasItem || (hasItem && !(before->second == after->second)))
+			m_changed.insert(id);
 	}
+	diffConnections(previousConnections, m_arrangement.connections(), m_changed);
+	diffConnections(previousSubconnections, m_arrangement.subconnections(), m_changed);
 
-	// Can't fit a single column.
-	if (visibleColumnCount == 0)
-		return;
+	if (onUpdated != nullptr)
+		onUpdated();
+}
 
-	// Number of items per column.
-	int columnCapacity = rect.height() / m_widgetHeight;
+void DefaultLayout::loadArrangement() {
+	m_arrangement.load(m_state);
+	indexConnections();
+}
 
-	// Can't fit a single row.
-	if (columnCapacity == 0)
-		return;
+void DefaultLayout::indexConnections() {
+	m_connectionsOf.clear();
+	m_subconnectionsOf.clear();
 
-	// Number of columns required to fit all nodes.
-	int requiredColumnCount = (sorted.size() + columnCapacity - 1) / columnCapacity;
-
-	// We have two cases:
-	// 1. All items fit into the visible area, in which case we try layout items
-	//    to have equal number of items in each column.
-	// 2. There's more items than slots available in the visible area, in which
-	//    case we try to display as much items as possible in the visible area.
-	int itemsPerColumn = 0, columnCount = 0;
-	if (requiredColumnCount <= visibleColumnCount) {
-		itemsPerColumn = (sorted.size() + visibleColumnCount - 1) / visibleColumnCount;
-		columnCount = (sorted.size() + itemsPerColumn - 1) / itemsPerColumn;
-	} else {
-		itemsPerColumn = columnCapacity;
-		columnCount = visibleColumnCount;
+	const std::vector<ItemConnection>& connections = m_arrangement.connections();
+	for (uint32_t idx = 0; idx < connections.size(); idx++) {
+		m_connectionsOf[connections[idx].from].push_back(idx);
+		m_connectionsOf[connections[idx].to].push_back(idx);
 	}
 
-	int columnWidth = rect.width() / columnCount;
-
-	// Apply offset. If the number of visible columns has changed, the cached
-	// offset value might invalid, i.e. trying to layout non-existent columns.
-	// So if number of visible columns after offset goes beyond total column
-	// count, we reduce the offset to fit into the layout.
-	auto cachedOffset = m_offsets.find(scrollPos);
-	int offset = 0;
-	if (cachedOffset != m_offsets.end()) {
-		if (cachedOffset->second + columnCount > requiredColumnCount) {
-			offset = std::max(0, (int)requiredColumnCount - columnCount);
-		} else {
-			offset = cachedOffset->second;
-		}
-		m_offsets.insert_or_assign(scrollPos, offset);
+	const std::vector<ItemConnection>& subconnections = m_arrangement.subconnections();
+	for (uint32_t idx = 0; idx < subconnections.size(); idx++) {
+		m_subconnectionsOf[subconnections[idx].from].push_back(idx);
+		m_subconnectionsOf[subconnections[idx].to].push_back(idx);
 	}
+}
 
-	// Layout columns.
-	int idx = offset * itemsPerColumn, col, row, x, y, height, rowCount;
-	for (col = 0; col < columnCount; col++) {
-
-		// Horizontal and vertical position of the column.
-		x = rect.x() + (columnWidth * col);
-		y = rect.y();
-
-		// Height of the column content: items in column * widget height.
-		rowCount = std::min(itemsPerColumn, (int)(sorted.size()) - idx);
-		height = rowCount * m_widgetHeight;
-
-		// Layout each item in the column.
-		for (row = 0; row < rowCount; row++) {
-			Thought *thought = sorted[idx];
-			QSize size = widgetSize(
-				thought->name(),
-				std::max(columnWidth - 2 * m_widgetSpacing, m_verticalWidgetWidth)
-			);
-
-			ItemLayout layout(
-				thought->id(),
-				thought->name(),
-				x + (columnWidth - size.width()) / 2,
-				y + ((rect.height() - height) / 2) + (row * m_widgetHeight),
-				size.width(),
-				size.height(),
-				true,
-				thought->hasParents(),
-				thought->hasChildren(),
-				thought->hasLinks(),
-				false,
-				thought->id() != rootId
-			);
-
-			m_layout.insert_or_assign(thought->id(), layout);
-
-			idx += 1;
-		}
-	}
+void DefaultLayout::mergeLayout() {
+	m_layout.clear();
 
-	// We have items left outside, add scroll area.
-	if (columnCount < requiredColumnCount) {
-		int scrollWidth = m_style->browser.scrollWidth;
-		float barWidth = (float)columnCount / (float)requiredColumnCount;
-		float relativeOffset = requiredColumnCount != 0
-			? ((float)offset / (float)requiredColumnCount)
-			: 0;
-
-		ScrollAreaLayout layout(
-			rect.x(),
-			rect.y() - scrollWidth,
-			rect.width(),
-			rect.height() + scrollWidth,
-			scrollPos,
-			barWidth,
-			relativeOffset,
-			requiredColumnCount - columnCount
-		);
-		m_scrollAreas.insert_or_assign(scrollPos, layout);
+	const std::optional<ItemLayout>& center = m_arrangement.center();
+	if (center.has_value())
+		m_layout.insert_or_assign(center->id, center.value());
+
+	// A thought can be on more than one side. Later sides take precedence, same
+	// as when all sides were laid out in this order.
+	ScrollBarPos order[] = {
+		ScrollBarPos::Left,
+		ScrollBarPos::Top,
+		ScrollBarPos::Bottom,
+		ScrollBarPos::Right
+	};
+
+	for (auto pos: order) {
+		for (auto& item: m_arrangement.side(pos))
+			m_layout.insert_or_assign(item.id, item);
 	}
 }
 
-QSize DefaultLayout::widgetSize(std::string text, int maxWidth) {
-	m_template.setText(QString::fromStdString(text));
-
-	// Get size hint to estimate the full text length.
-	QSize sizeHint = m_template.sizeHint();
-	// Actual width is the width of full text up to max allowed width.
-	int actualWidth = std::min(
-		maxWidth,
-		sizeHint.width()
-	);
-
-	return QSize(
-		actualWidth,
-		sizeHint.height()
-	);
-}
-
 // Getters.
 
 const ThoughtId* DefaultLayout::rootId() const {
-	if (m_state == nullptr)
+	// Central item of the current arrangement, which can lag behind the state
+	// while the next one is computed.
+	const std::optional<ItemLayout>& center = m_arrangement.center();
+	if (m_state == nullptr || !center.has_value())
 		return nullptr;
-	return m_state->centralThought()->idPtr();
+	return &center->id;
 }
 
 const std::unordered_map<ThoughtId, ItemLayout>* DefaultLayout::items() const {
@@ -487,99 +285,83 @@ const std::unordered_map<ThoughtId, ItemLayout>* DefaultLayout::items() const {
 }
 
 const std::unordered_map<unsigned int, ScrollAreaLayout>* DefaultLayout::scrollAreas() const {
-	return &m_scrollAreas;
+	return &m_arrangement.scrollAreas();
 }
 
 const std::vector<ItemConnection>* DefaultLayout::connections() const {
-	return &m_connections;
+	return &m_arrangement.connections();
 }
 
 const std::vector<ItemConnection>* DefaultLayout::subconnections() const {
-	return &m_subconnections;
+	return &m_arrangement.subconnections();
 }
 
-const QSize DefaultLayout::defaultWidgetSize() const {
-	return QSize(
-		m_verticalWidgetWidth,
-		m_widgetHeight
-	);
-}
-
-// Utility functions.
+void DefaultLayout::connectionsOf(
+	ThoughtId id,
+	std::vector<ItemConnection> *connections,
+	std::vector<ItemConnection> *subconnections
+) const {
+	if (auto found = m_connectionsOf.find(id); found != m_connectionsOf.end()) {
+		for (auto idx: found->second)
+			connections->push_back(m_arrangement.connections()[idx]);
+	}
 
-inline bool DefaultLayout::compareThoughts(Thought *a, Thought *b) {
-	return (a->name().compare(b->name()) < 0);
+	if (auto found = m_subconnectionsOf.find(id); found != m_subconnectionsOf.end()) {
+		for (auto idx: found->second)
+			subconnections->push_back(m_arrangement.subconnections()[idx]);
+	}
 }
 
-inline bool DefaultLayout::listContains(std::vector<Thought*>& list, ThoughtId id) {
-	for (auto *thought: list)
-		if (thought->id() == id)
-			return true;
-
-	return false;
+const std::unordered_set<ThoughtId>* DefaultLayout::changedItems() const {
+	return m_partial ? &m_changed : nullptr;
 }
 
-inline void DefaultLayout::sortNodes(
-	// Data to sort nodes.
-	std::vector<Thought*>& list,
-	const std::vector<ThoughtId>& ids,
-	const std::unordered_map<ThoughtId, Thought*>* map,
-	// Data to fill connections:
-	std::vector<ItemConnection>* connections,
-	ThoughtId from,
-	LayoutConnectionType conn
-) {
-	list.clear();
-	for (const auto& id: ids) {
-		if (auto found = map->find(id); found != map->end()) {
-			list.push_back(found->second);
-
-			switch (conn) {
-				case LayoutConnectionType::parent:
-					connections->push_back(ItemConnection{
-						.from = id,
-						.to = from,
-						.type = ConnectionType::child
-					});
-					break;
-				case LayoutConnectionType::child:
-					connections->push_back(ItemConnection{
-						.from = from,
-						.to = id,
-						.type = ConnectionType::child
-					});
-					break;
-				case LayoutConnectionType::link:
-					connections->push_back(ItemConnection{
-						.from = from,
-						.to = id,
-						.type = ConnectionType::link
-					});
-					break;
-			}
-		}
-	}
-	std::sort(list.begin(), list.end(), compareThoughts);
+const QSize DefaultLayout::defaultWidgetSize() const {
+	return m_arrangement.defaultWidgetSize();
 }
 
 // Slots.
 
 void DefaultLayout::onScroll(unsigned int scrollId, int change) {
-	int offset = 0;
-
-	auto layout = m_scrollAreas.find(scrollId);
-	if (layout == m_scrollAreas.end())
+	// Sides of the current arrangement are about to be replaced.
+	if (m_pending)
 		return;
 
-	auto cached = m_offsets.find(scrollId);
-	if (cached != m_offsets.end()) {
-		offset = cached->second;
-	}
+	const std::unordered_map<unsigned int, ScrollAreaLayout>& areas =
+		m_arrangement.scrollAreas();
+	auto layout = areas.find(scrollId);
+	if (layout == areas.end())
+		return;
 
+	int offset = m_arrangement.offset(scrollId);
 	offset = std::max(0, std::min(offset + change, layout->second.maxNodeOffset));
-	m_offsets.insert_or_assign(scrollId, offset);
+	m_arrangement.setOffset(scrollId, offset);
 
-	// TODO: Optimize. Doing full reload on changing one scroll area is wasting
-	// time.
-	reload();
+	// Only the scrolled side moves, so only its items are laid out again.
+	std::vector<ThoughtId> ids;
+	for (auto& item: m_arrangement.side(scrollId))
+		ids.push_back(item.id);
+
+	std::unordered_map<ThoughtId, ItemLayout> previous;
+	previous.swap(m_layout);
+
+	m_arrangement.layoutSide((ScrollBarPos)scrollId);
+	mergeLayout();
+
+	for (auto& item: m_arrangement.side(scrollId))
+		ids.push_back(item.id);
+
+	// Items that left or entered the side, or moved within it.
+	m_partial = true;
+	m_changed.clear();
+	for (auto id: ids) {
+		auto before = previous.find(id), after = m_layout.find(id);
+		bool hadItem = before != previous.end(), hasItem = after != m_layout.end();
+
+		if (hadItem != hasItem || (hasItem && !(before->second == after->second)))
+			m_changed.insert(id);
+	}
+
+	if (onUpdated != nullptr)
+		onUpdated();
 }
@@ -1,69 +1,68 @@
 #ifndef H_DEFAULT_LAYOUT
 #define H_DEFAULT_LAYOUT
 
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <QObject>
+#include <QThread>
+
 #include "layout/base_layout.h"
+#include "layout/default_arrangement.h"
 #include "layout/item_layout.h"
 #include "layout/scroll_area_layout.h"
 #include "layout/item_connection.h"
 
 class DefaultLayout: public BaseLayout {
-	enum LayoutConnectionType { child, parent, link };
-
 public:
 	DefaultLayout(Style*);
 	~DefaultLayout() override;
 	void reload() override;
 	void setSize(QSize) override;
+	void setStyle(Style*) override;
 	void setState(const State*) override;
+	void setStateAsync(const State*) override;
+	void applyChange(const StateChange&) override;
 	const ThoughtId* rootId() const override;
 	const std::unordered_map<ThoughtId, ItemLayout>* items() const override;
 	const std::unordered_map<unsigned int, ScrollAreaLayout>* scrollAreas() const override;
 	const std::vector<ItemConnection>* connections() const override;
 	const std::vector<ItemConnection>* subconnections() const override;
+	void connectionsOf(
+		ThoughtId,
+		std::vector<ItemConnection>*,
+		std::vector<ItemConnection>*
+	) const override;
+	const std::unordered_set<ThoughtId>* changedItems() const override;
 	const QSize defaultWidgetSize() const override;
 	void onScroll(unsigned int, int) override;
 
 private:
 	// Helpers.
-	static inline bool compareThoughts(Thought*, Thought*);
-	static inline void sortNodes(
-		// Data to sort nodes.
-		std::vector<Thought*>&,
-		const std::vector<ThoughtId>&,
-		const std::unordered_map<ThoughtId, Thought*>*,
-		// Data to fill connections:
-		std::vector<ItemConnection>*,
-		ThoughtId,
-		LayoutConnectionType
-	);
-	static inline bool listContains(std::vector<Thought*>&, ThoughtId);
-	void updateWidgets();
-	void loadSiblings();
-	void layoutHorizontalSide(const std::vector<Thought*>&, QRect, ScrollBarPos);
-	void layoutVerticalSide(const std::vector<Thought*>&, QRect, ScrollBarPos, bool);
-	// Sizing helpers.
-	QSize widgetSize(std::string text, int);
+	void loadArrangement();
+	void indexConnections();
+	void adoptArrangement(uint64_t, const DefaultArrangement&);
+	void releasePending();
+	void mergeLayout();
 	// State.
-	std::vector<Thought*> m_siblings;
-	std::vector<Thought*> m_children;
-	std::vector<Thought*> m_parents;
-	std::vector<Thought*> m_links;
+	DefaultArrangement m_arrangement;
 	std::unordered_map<ThoughtId, ItemLayout> m_layout;
-	std::unordered_map<unsigned int, ScrollAreaLayout> m_scrollAreas;
-	std::unordered_map<unsigned int, int> m_offsets;
-	std::vector<ItemConnection> m_connections;
-	std::vector<ItemConnection> m_subconnections;
-	// Layout settings.
-	int m_verticalWidgetWidth = 0;
-	int m_widgetHeight = 0;
-	int m_widgetSpacing = 0;
-	int m_sidePadding = 10;
-	int m_topSideHeight = 0;
-	int m_leftSideWidth = 0;
-	int m_minWidgetWidth = 40;
-	// Ratio.
-	static constexpr float s_sideRatio = 0.2;
+	// Items changed by the last partial update.
+	bool m_partial = false;
+	std::unordered_set<ThoughtId> m_changed;
+	// Positions of connections of the arrangement by both of their ends.
+	std::unordered_map<ThoughtId, std::vector<uint32_t>> m_connectionsOf;
+	std::unordered_map<ThoughtId, std::vector<uint32_t>> m_subconnectionsOf;
+	// Asynchronous layout. The worker arranges a copy of the state with an
+	// arrangement that has the settings of this one. Thoughts of the current
+	// arrangement still point to the previous state while one is pending.
+	QThread *m_thread = nullptr;
+	QObject *m_worker = nullptr;
+	QObject m_relay;
+	uint64_t m_generation = 0;
+	bool m_pending = false;
 };
 
 #endif
-
@@ -0,0 +1,463 @@
+#include <set>
+#include <deque>
+#include <cmath>
+#include <algorithm>
+
+#include <QString>
+#include <QRectF>
+
+#include "layout/force_layout.h"
+#include "layout/item_layout.h"
+
+ForceLayout::ForceLayout(Style *style)
+	: BaseLayout(style)
+{
+	// Sample text to estimate "average" widget width.
+	m_template.setText("xxxxxxxxxx");
+
+	QSize size = m_template.sizeHint();
+	m_widgetWidth = size.width();
+	m_widgetHeight = size.height();
+}
+
+ForceLayout::~ForceLayout() {}
+
+void ForceLayout::setMaxItems(int count) {
+	m_maxItems = std::max(1, count);
+	reload();
+}
+
+void ForceLayout::reload() {
+	m_layout.clear();
+	m_connections.clear();
+	m_subconnections.clear();
+	m_partial = false;
+	m_changed.clear();
+
+	if (m_state == nullptr || m_state->centralThought() == nullptr)
+		return;
+
+	collectNodes();
+	collectConnections();
+
+	const Thought *central = m_state->centralThought();
+	QRectF area = bounds();
+	QPointF center = area.center();
+
+	// Move the remembered placement so the central thought lands in the middle.
+	// Selecting a neighbor then looks like panning over the same graph.
+	QPointF shift(0, 0);
+	if (auto found = m_positions.find(central->id()); found != m_positions.end())
+		shift = center - found->second;
+
+	// Widget sizes are needed up front, repulsion accounts for them.
+	std::vector<QSize> sizes;
+	sizes.reserve(m_nodes.size());
+	for (size_t idx = 0; idx < m_nodes.size(); idx++)
+		sizes.push_back(nodeSize(idx));
+
+	size_t known = 0;
+	std::vector<QPointF> starts(m_nodes.size());
+	std::vector<bool> placed(m_nodes.size(), false);
+	m_solver.clear();
+	for (size_t idx = 0; idx < m_nodes.size(); idx++) {
+		ThoughtId id = m_nodes[idx]->id();
+		QPointF pos;
+
+		if (idx == 0) {
+			pos = center;
+		} else if (auto found = m_positions.find(id); found != m_positions.end()) {
+			pos = found->second + shift;
+			known++;
+		} else {
+			pos = startPosition(id, idx, center, starts, placed);
+		}
+
+		starts[idx] = pos;
+		placed[idx] = true;
+		m_solver.addNode(pos, idx == 0, sizes[idx]);
+	}
+
+	for (auto *list: {&m_connections, &m_subconnections}) {
+		for (auto& conn: *list)
+			m_solver.addEdge(m_nodeIndex[conn.from], m_nodeIndex[conn.to]);
+	}
+
+	// Ideal distance leaves room for a widget and its connection.
+	qreal idealLength = m_widgetWidth * 1.2;
+
+	// Mostly known placement only needs to settle new and moved thoughts.
+	bool warm = m_nodes.size() > 1 && known * 2 >= m_nodes.size() - 1;
+	m_solver.solve(
+		area,
+		idealLength,
+		warm ? s_warmIterations : s_coldIterations,
+		warm ? idealLength / 2 : std::max(area.width(), area.height()) / 4
+	);
+	m_solver.separate(area, s_spacing, s_separationPasses);
+
+	// Remember the placement of the thoughts that are still loaded.
+	m_positions.clear();
+	for (size_t idx = 0; idx < m_nodes.size(); idx++) {
+		QPointF pos = m_solver.position(idx);
+		m_positions.insert({m_nodes[idx]->id(), pos});
+		m_layout.insert_or_assign(m_nodes[idx]->id(), makeItem(idx, pos, sizes[idx]));
+	}
+
+	// Dispatch event.
+	if (onUpdated != nullptr)
+		onUpdated();
+}
+
+void ForceLayout::applyChange(const StateChange& change) {
+	if (change.isEmpty())
+		return;
+
+	if (m_state == nullptr || m_state->centralThought() == nullptr)
+		return;
+
+	// Nothing is placed yet.
+	if (m_positions.count(m_state->centralThought()->id()) == 0) {
+		reload();
+		return;
+	}
+
+	std::unordered_map<ThoughtId, ItemLayout> previous;
+	previous.swap(m_layout);
+	std::vector<ItemConnection> previousConnections, previousSubconnections;
+	previousConnections.swap(m_connections);
+	previousSubconnections.swap(m_subconnections);
+
+	// Thoughts could have been added or freed, so pointers to them are
+	// collected again.
+	collectNodes();
+	collectConnections();
+
+	std::unordered_set<ThoughtId> touched;
+	for (auto *ids: {&change.added(), &change.removed(), &change.updated()})
+		touched.insert(ids->begin(), ids->end());
+
+	// Thoughts placed again: modified ones, and ones that weren't shown before.
+	// The central thought stays in the middle.
+	std::vector<bool> moving(m_nodes.size(), false);
+	std::vector<size_t> movingNodes;
+	for (size_t idx = 1; idx < m_nodes.size(); idx++) {
+		ThoughtId id = m_nodes[idx]->id();
+		if (touched.count(id) > 0 || previous.count(id) == 0) {
+			moving[idx] = true;
+			movingNodes.push_back(idx);
+		}
+	}
+
+	// Too much of the graph changed to keep the rest in place.
+	if (movingNodes.size() > m_nodes.size() * s_patchRatio) {
+		reload();
+		return;
+	}
+
+	// Sizes of unmodified thoughts are kept, their labels are the same.
+	std::vector<QSize> sizes(m_nodes.size());
+	std::vector<QPointF> starts(m_nodes.size());
+	std::vector<bool> placed(m_nodes.size(), false);
+	qreal maxExtent = 0;
+	for (size_t idx = 0; idx < m_nodes.size(); idx++) {
+		ThoughtId id = m_nodes[idx]->id();
+		if (moving[idx] || touched.count(id) > 0) {
+			sizes[idx] = nodeSize(idx);
+		} else {
+			const ItemLayout& item = previous.at(id);
+			sizes[idx] = QSize(item.w, item.h);
+		}
+		maxExtent = std::max({maxExtent, (qreal)sizes[idx].width(), (qreal)sizes[idx].height()});
+
+		if (!moving[idx]) {
+			starts[idx] = m_positions.at(id);
+			placed[idx] = true;
+		}
+	}
+
+	for (auto idx: movingNodes) {
+		ThoughtId id = m_nodes[idx]->id();
+		if (auto found = m_positions.find(id); found != m_positions.end()) {
+			starts[idx] = found->second;
+		} else {
+			starts[idx] = startPosition(id, idx, starts[0], starts, placed);
+		}
+		placed[idx] = true;
+	}
+
+	// The solver only gets the moving thoughts, and the ones that are
+	// connected to them or close enough to push them away, pinned where they
+	// are, so a patch costs about the same for any size of the graph.
+	qreal idealLength = m_widgetWidth * 1.2;
+	qreal reach = 3 * idealLength + maxExtent;
+	std::vector<size_t> local(movingNodes);
+	std::unordered_map<size_t, size_t> localOf;
+	for (size_t at = 0; at < local.size(); at++)
+		localOf.insert({local[at], at});
+
+	auto include = [&local, &localOf](size_t idx) {
+		if (localOf.insert({idx, local.size()}).second)
+			local.push_back(idx);
+	};
+
+	for (auto *list: {&m_connections, &m_subconnections}) {
+		for (auto& conn: *list) {
+			size_t from = m_nodeIndex[conn.from], to = m_nodeIndex[conn.to];
+			if (moving[from] || moving[to]) {
+				include(from);
+				include(to);
+			}
+		}
+	}
+
+	for (size_t idx = 0; idx < m_nodes.size() && !movingNodes.empty(); idx++) {
+		if (moving[idx])
+			continue;
+		for (auto other: movingNodes) {
+			QPointF delta = starts[idx] - starts[other];
+			if (std::abs(delta.x()) <= reach && std::abs(delta.y()) <= reach) {
+				include(idx);
+				break;
+			}
+		}
+	}
+
+	QRectF area = bounds();
+	m_solver.clear();
+	for (auto idx: local)
+		m_solver.addNode(starts[idx], !moving[idx], sizes[idx]);
+
+	for (auto *list: {&m_connections, &m_subconnections}) {
+		for (auto& conn: *list) {
+			size_t from = m_nodeIndex[conn.from], to = m_nodeIndex[conn.to];
+			if (moving[from] || moving[to])
+				m_solver.addEdge(localOf[from], localOf[to]);
+		}
+	}
+
+	m_solver.solve(area, idealLength, s_warmIterations, idealLength / 2);
+	m_solver.separate(area, s_spacing, s_separationPasses);
+
+	for (auto id: change.removed())
+		m_positions.erase(id);
+	for (auto idx: movingNodes)
+		m_positions.insert_or_assign(m_nodes[idx]->id(), m_solver.position(localOf[idx]));
+
+	// Unmodified thoughts keep their items as they were.
+	for (size_t idx = 0; idx < m_nodes.size(); idx++) {
+		ThoughtId id = m_nodes[idx]->id();
+		if (moving[idx] || touched.count(id) > 0) {
+			m_layout.insert_or_assign(id, makeItem(idx, m_positions.at(id), sizes[idx]));
+		} else {
+			m_layout.insert_or_assign(id, previous.at(id));
+		}
+	}
+
+	// Items that were modified, moved, or gained or lost a connection.
+	m_partial = true;
+	m_changed = touched;
+	for (auto idx: movingNodes)
+		m_changed.insert(m_nodes[idx]->id());
+	for (auto& [id, item]: previous) {
+		if (m_layout.count(id) == 0)
+			m_changed.insert(id);
+	}
+	diffConnections(previousConnections, m_connections, m_changed);
+	diffConnections(previousSubconnections, m_subconnections, m_changed);
+
+	if (onUpdated != nullptr)
+		onUpdated();
+}
+
+// Helpers.
+
+/**
+ * Collects thoughts in breadth-first order from the central one, so when there
+ * are more than maxItems, the farthest ones are dropped.
+ */
+void ForceLayout::collectNodes() {
+	m_nodes.clear();
+	m_nodeIndex.clear();
+
+	const Thought *central = m_state->centralThought();
+	const std::unordered_map<ThoughtId, Thought*> *thoughts = m_state->thoughts();
+
+	std::deque<const Thought*> queue;
+	auto visit = [this, &queue](const Thought *thought) {
+		if ((int)m_nodes.size() >= m_maxItems)
+			return;
+		if (m_nodeIndex.insert({thought->id(), m_nodes.size()}).second) {
+			m_nodes.push_back(thought);
+			queue.push_back(thought);
+		}
+	};
+
+	visit(central);
+	while (!queue.empty()) {
+		const Thought *thought = queue.front();
+		queue.pop_front();
+
+		for (auto *ids: {&thought->parents(), &thought->children(), &thought->links()}) {
+			for (auto id: *ids) {
+				if (auto found = thoughts->find(id); found != thoughts->end())
+					visit(found->second);
+			}
+		}
+	}
+
+	// Parents are only listed for the central thought, so thoughts farther
+	// away can be reachable only through their children.
+	for (auto& [id, thought]: *thoughts)
+		visit(thought);
+}
+
+/**
+ * Connections between placed thoughts. The ones of the central thought are
+ * drawn as main connections, the rest as subconnections.
+ */
+void ForceLayout::collectConnections() {
+	ThoughtId mainId = m_state->centralThought()->id();
+	std::set<std::pair<ThoughtId, ThoughtId>> added;
+
+	auto add = [this, mainId, &added](ThoughtId from, ThoughtId to, ConnectionType type) {
+		if (from == to || m_nodeIndex.count(from) == 0 || m_nodeIndex.count(to) == 0)
+			return;
+		if (!added.insert({std::min(from, to), std::max(from, to)}).second)
+			return;
+
+		ItemConnection conn{.from = from, .to = to, .type = type};
+		if (from == mainId || to == mainId) {
+			m_connections.push_back(conn);
+		} else {
+			m_subconnections.push_back(conn);
+		}
+	};
+
+	for (auto *thought: m_nodes) {
+		for (auto id: thought->children())
+			add(thought->id(), id, ConnectionType::child);
+		for (auto id: thought->parents())
+			add(id, thought->id(), ConnectionType::child);
+		for (auto id: thought->links())
+			add(thought->id(), id, ConnectionType::link);
+	}
+}
+
+/**
+ * Start position of a thought without remembered placement: next to the
+ * first already placed neighbor, or around the center. Direction depends on
+ * the id, so the result is the same for the same graph.
+ */
+QPointF ForceLayout::startPosition(
+	ThoughtId id,
+	size_t idx,
+	QPointF center,
+	const std::vector<QPointF>& positions,
+	const std::vector<bool>& placed
+) {
+	QPointF anchor = center;
+	const Thought *thought = m_nodes[idx];
+	bool anchored = false;
+
+	for (auto *ids: {&thought->parents(), &thought->children(), &thought->links()}) {
+		for (auto other: *ids) {
+			auto found = m_nodeIndex.find(other);
+			if (!anchored && found != m_nodeIndex.end() && placed[found->second]) {
+				anchor = positions[found->second];
+				anchored = true;
+			}
+		}
+	}
+
+	// Golden angle spreads consecutive ids evenly.
+	qreal angle = (qreal)(id % 1024) * 2.39996;
+	qreal distance = m_widgetWidth;
+	return anchor + QPointF(std::cos(angle), std::sin(angle)) * distance;
+}
+
+/**
+ * Area the centers of widgets are kept in, so whole widgets fit the canvas.
+ */
+QRectF ForceLayout::bounds() const {
+	return QRectF(
+		m_widgetWidth / 2.0,
+		m_widgetHeight / 2.0,
+		std::max(0, m_size.width() - m_widgetWidth),
+		std::max(0, m_size.height() - m_widgetHeight)
+	);
+}
+
+QSize ForceLayout::nodeSize(size_t idx) {
+	// Central thought gets more room for its label.
+	return widgetSize(
+		m_nodes[idx]->name(),
+		idx == 0 ? m_size.width() * 0.4 : m_widgetWidth * 2
+	);
+}
+
+ItemLayout ForceLayout::makeItem(size_t idx, QPointF pos, QSize size) const {
+	const Thought *thought = m_nodes[idx];
+
+	return ItemLayout(
+		thought->id(),
+		thought->name(),
+		(int)std::round(pos.x() - size.width() / 2.0),
+		(int)std::round(pos.y() - size.height() / 2.0),
+		size.width(),
+		size.height(),
+		true,
+		thought->hasParents(),
+		thought->hasChildren(),
+		thought->hasLinks(),
+		false,
+		idx != 0 && thought->id() != m_state->rootId()
+	);
+}
+
+QSize ForceLayout::widgetSize(const std::string& text, int maxWidth) {
+	QSize sizeHint = ThoughtWidget::sizeHintForText(
+		m_style,
+		QString::fromStdString(text)
+	);
+
+	return QSize(
+		std::min(maxWidth, sizeHint.width()),
+		sizeHint.height()
+	);
+}
+
+// Getters.
+
+const ThoughtId* ForceLayout::rootId() const {
+	if (m_state == nullptr)
+		return nullptr;
+	return m_state->centralThought()->idPtr();
+}
+
+const std::unordered_map<ThoughtId, ItemLayout>* ForceLayout::items() const {
+	return &m_layout;
+}
+
+const std::unordered_map<unsigned int, ScrollAreaLayout>* ForceLayout::scrollAreas() const {
+	return &m_scrollAreas;
+}
+
+const std::vector<ItemConnection>* ForceLayout::connections() const {
+	return &m_connections;
+}
+
+const std::vector<ItemConnection>* ForceLayout::subconnections() const {
+	return &m_subconnections;
+}
+
+const std::unordered_set<ThoughtId>* ForceLayout::changedItems() const {
+	return m_partial ? &m_changed : nullptr;
+}
+
+const QSize ForceLayout::defaultWidgetSize() const {
+	return QSize(
+		m_widgetWidth,
+		m_widgetHeight
+	);
+}
@@ -0,0 +1,80 @@
+#ifndef H_FORCE_LAYOUT
+#define H_FORCE_LAYOUT
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <QPointF>
+#include <QRectF>
+
+#include "layout/base_layout.h"
+#include "layout/item_layout.h"
+#include "layout/scroll_area_layout.h"
+#include "layout/item_connection.h"
+#include "layout/force_solver.h"
+
+/**
+ * Places every loaded thought with a force-directed solver instead of the
+ * fixed sides of DefaultLayout, so connections between parents, children,
+ * links and siblings are all shown as one graph around the central thought.
+ *
+ * Positions are remembered between updates. When another thought is selected,
+ * known thoughts start from where they were, new ones start next to a placed
+ * neighbor, and the solver only runs a few iterations to settle them. When the
+ * state is patched, only the added and modified thoughts are placed again,
+ * among the thoughts around them, and everything else stays where it was.
+ */
+class ForceLayout: public BaseLayout {
+public:
+	ForceLayout(Style*);
+	~ForceLayout() override;
+	void reload() override;
+	void applyChange(const StateChange&) override;
+	const ThoughtId* rootId() const override;
+	const std::unordered_map<ThoughtId, ItemLayout>* items() const override;
+	const std::unordered_map<unsigned int, ScrollAreaLayout>* scrollAreas() const override;
+	const std::vector<ItemConnection>* connections() const override;
+	const std::vector<ItemConnection>* subconnections() const override;
+	const std::unordered_set<ThoughtId>* changedItems() const override;
+	const QSize defaultWidgetSize() const override;
+	// Max number of thoughts placed, closest to the central one first.
+	int maxItems() const { return m_maxItems; }
+	void setMaxItems(int);
+
+private:
+	// Helpers.
+	void collectNodes();
+	void collectConnections();
+	QPointF startPosition(ThoughtId, size_t, QPointF, const std::vector<QPointF>&, const std::vector<bool>&);
+	QRectF bounds() const;
+	ItemLayout makeItem(size_t, QPointF, QSize) const;
+	// Sizing helpers.
+	QSize nodeSize(size_t);
+	QSize widgetSize(const std::string&, int);
+	// State.
+	std::vector<const Thought*> m_nodes;
+	std::unordered_map<ThoughtId, size_t> m_nodeIndex;
+	std::unordered_map<ThoughtId, QPointF> m_positions;
+	ForceSolver m_solver;
+	std::unordered_map<ThoughtId, ItemLayout> m_layout;
+	std::unordered_map<unsigned int, ScrollAreaLayout> m_scrollAreas;
+	std::vector<ItemConnection> m_connections;
+	std::vector<ItemConnection> m_subconnections;
+	// Items changed by the last partial update.
+	bool m_partial = false;
+	std::unordered_set<ThoughtId> m_changed;
+	// Layout settings.
+	int m_maxItems = 300;
+	int m_widgetWidth = 0;
+	int m_widgetHeight = 0;
+	static constexpr int s_coldIterations = 200;
+	static constexpr int s_warmIterations = 40;
+	// Patches placing more thoughts than this part of the graph lay it all out.
+	static constexpr float s_patchRatio = 0.25;
+	// Min space between widgets, kept as long as the canvas has room.
+	static constexpr int s_spacing = 8;
+	static constexpr int s_separationPasses = 50;
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <QPointF>
+#include <QSizeF>
+#include <QRectF>
+
+#include "layout/force_solver.h"
+
+void ForceSolver::clear() {
+	m_positions.clear();
+	m_sizes.clear();
+	m_pinned.clear();
+	m_edges.clear();
+	m_maxExtent = 0;
+}
+
+size_t ForceSolver::addNode(QPointF pos, bool pinned, QSizeF size) {
+	m_positions.push_back(pos);
+	m_sizes.push_back(size);
+	m_pinned.push_back(pinned);
+	m_maxExtent = std::max({m_maxExtent, size.width(), size.height()});
+	return m_positions.size() - 1;
+}
+
+void ForceSolver::addEdge(size_t from, size_t to) {
+	if (from != to)
+		m_edges.push_back({(uint32_t)from, (uint32_t)to});
+}
+
+void ForceSolver::solve(QRectF bounds, qreal idealLength, int iterations, qreal step) {
+	if (m_positions.size() == 0 || iterations <= 0 || idealLength <= 0)
+		return;
+
+	for (int iteration = 0; iteration < iterations; iteration++) {
+		m_forces.assign(m_positions.size(), QPointF(0, 0));
+		repulse(bounds, idealLength);
+		attract(idealLength);
+
+		// Max movement cools down linearly.
+		qreal limit = step * (1.0 - (qreal)iteration / (qreal)iterations);
+
+		for (size_t idx = 0; idx < m_positions.size(); idx++) {
+			if (m_pinned[idx])
+				continue;
+
+			QPointF force = m_forces[idx];
+			qreal length = std::sqrt(QPointF::dotProduct(force, force));
+			if (length > limit)
+				force *= limit / length;
+
+			moveNode(idx, force, bounds);
+		}
+	}
+}
+
+bool ForceSolver::separate(QRectF bounds, qreal gap, int passes) {
+	const size_t count = m_positions.size();
+
+	for (int pass = 0; pass < passes; pass++) {
+		// Overlapping nodes are closer than the largest extent plus the gap,
+		// so they are in the same or neighboring cells.
+		bucket(bounds, m_maxExtent + gap);
+		bool moved = false;
+
+		for (size_t idx = 0; idx < count; idx++) {
+			int column = columnOf(m_positions[idx]), row = rowOf(m_positions[idx]);
+
+			for (int r = std::max(0, row - 1); r <= std::min(m_rows - 1, row + 1); r++) {
+				for (int c = std::max(0, column - 1); c <= std::min(m_columns - 1, column + 1); c++) {
+					uint32_t cell = r * m_columns + c;
+
+					for (uint32_t at = m_cellStart[cell]; at < m_cellStart[cell + 1]; at++) {
+						uint32_t other = m_sorted[at];
+						if (other <= idx || (m_pinned[idx] && m_pinned[other]))
+							continue;
+
+						QPointF delta = m_positions[idx] - m_positions[other];
+						qreal overlapX = (m_sizes[idx].width() + m_sizes[other].width()) / 2
+							+ gap - std::abs(delta.x());
+						qreal overlapY = (m_sizes[idx].height() + m_sizes[other].height()) / 2
+							+ gap - std::abs(delta.y());
+						if (overlapX <= 0 || overlapY <= 0)
+							continue;
+
+						// Push apart along the axis that needs the shorter move,
+						// pinned nodes stay where they are.
+						QPointF push = overlapX < overlapY
+							? QPointF(delta.x() <= 0 ? -overlapX : overlapX, 0)
+							: QPointF(0, delta.y() <= 0 ? -overlapY : overlapY);
+						qreal share = (m_pinned[idx] || m_pinned[other]) ? 1.0 : 0.5;
+
+						if (!m_pinned[idx])
+							moveNode(idx, push * share, bounds);
+						if (!m_pinned[other])
+							moveNode(other, -push * share, bounds);
+						moved = true;
+					}
+				}
+			}
+		}
+
+		if (!moved)
+			return true;
+	}
+
+	return false;
+}
+
+// Helpers.
+
+/**
+ * Counting sort of nodes into a grid of square cells covering the bounds.
+ */
+void ForceSolver::bucket(QRectF bounds, qreal cellSize) {
+	const size_t count = m_positions.size();
+
+	m_gridBounds = bounds;
+	m_cellSize = std::max(cellSize, 1.0);
+	m_columns = std::max(1, (int)std::ceil(bounds.width() / m_cellSize));
+	m_rows = std::max(1, (int)std::ceil(bounds.height() / m_cellSize));
+	size_t cells = (size_t)m_columns * m_rows;
+
+	m_cellOf.resize(count);
+	m_cellStart.assign(cells + 1, 0);
+	for (size_t idx = 0; idx < count; idx++) {
+		m_cellOf[idx] = rowOf(m_positions[idx]) * m_columns + columnOf(m_positions[idx]);
+		m_cellStart[m_cellOf[idx] + 1]++;
+	}
+	for (size_t cell = 0; cell < cells; cell++)
+		m_cellStart[cell + 1] += m_cellStart[cell];
+
+	m_sorted.resize(count);
+	m_cellNext.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (size_t idx = 0; idx < count; idx++)
+		m_sorted[m_cellNext[m_cellOf[idx]]++] = idx;
+}
+
+void ForceSolver::moveNode(size_t idx, QPointF delta, QRectF bounds) {
+	QPointF& pos = m_positions[idx];
+	pos += delta;
+	pos.setX(std::clamp(pos.x(), bounds.left(), bounds.right()));
+	pos.setY(std::clamp(pos.y(), bounds.top(), bounds.bottom()));
+}
+
+int ForceSolver::columnOf(QPointF pos) const {
+	return std::clamp((int)((pos.x() - m_gridBounds.left()) / m_cellSize), 0, m_columns - 1);
+}
+
+int ForceSolver::rowOf(QPointF pos) const {
+	return std::clamp((int)((pos.y() - m_gridBounds.top()) / m_cellSize), 0, m_rows - 1);
+}
+
+void ForceSolver::repulse(QRectF bounds, qreal k) {
+	const qreal cutoff = 2 * k;
+	const size_t count = m_positions.size();
+
+	// Extents count as a part of the distance, so the cells have to fit the
+	// cutoff plus the largest node on both sides.
+	bucket(bounds, cutoff + m_maxExtent);
+
+	const qreal k2 = k * k;
+	for (size_t idx = 0; idx < count; idx++) {
+		QPointF pos = m_positions[idx];
+		qreal radius = (m_sizes[idx].width() + m_sizes[idx].height()) / 4;
+		int column = columnOf(pos), row = rowOf(pos);
+
+		for (int r = std::max(0, row - 1); r <= std::min(m_rows - 1, row + 1); r++) {
+			for (int c = std::max(0, column - 1); c <= std::min(m_columns - 1, column + 1); c++) {
+				uint32_t cell = r * m_columns + c;
+
+				for (uint32_t at = m_cellStart[cell]; at < m_cellStart[cell + 1]; at++) {
+					uint32_t other = m_sorted[at];
+					if (other == idx)
+						continue;
+
+					QPointF delta = pos - m_positions[other];
+					qreal dist2 = QPointF::dotProduct(delta, delta);
+
+					// Nodes at the same spot are pushed apart in a fixed
+					// direction, so they don't stay stuck together.
+					if (dist2 < 0.01) {
+						delta = QPointF(idx < other ? -0.1 : 0.1, 0);
+						dist2 = 0.01;
+					}
+
+					// Distance between the edges of the two nodes, each taken
+					// as a circle of its average half extent.
+					qreal dist = std::sqrt(dist2);
+					qreal otherRadius = (m_sizes[other].width() + m_sizes[other].height()) / 4;
+					qreal gap = std::max(dist - radius - otherRadius, 1.0);
+					if (gap > cutoff)
+						continue;
+
+					// k^2 / gap along the unit vector.
+					m_forces[idx] += delta * (k2 / (gap * dist));
+				}
+			}
+		}
+	}
+}
+
+void ForceSolver::attract(qreal k) {
+	for (auto& [from, to]: m_edges) {
+		QPointF delta = m_positions[to] - m_positions[from];
+		qreal dist = std::sqrt(QPointF::dotProduct(delta, delta));
+		if (dist < 0.01)
+			continue;
+
+		// d^2 / k along the unit vector.
+		QPointF force = delta * (dist / k);
+		m_forces[from] += force;
+		m_forces[to] -= force;
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef H_FORCE_SOLVER
+#define H_FORCE_SOLVER
+
+#include <vector>
+#include <cstdint>
+
+#include <QPointF>
+#include <QSizeF>
+#include <QRectF>
+
+/**
+ * Force-directed placement of a graph (Fruchterman-Reingold).
+ *
+ * Connected nodes pull each other to the ideal distance, all nodes push each
+ * other apart. Distances for repulsion are measured between node extents
+ * rather than centers, so wide nodes keep more room around them. Repulsion
+ * only acts within two ideal distances, so nodes are bucketed into a uniform
+ * grid of that cell size and each node only looks at the neighboring cells.
+ * An iteration costs O(nodes + edges) for evenly spread graphs, which keeps
+ * thousands of nodes interactive.
+ *
+ * Forces alone don't guarantee that nodes don't overlap, so separate() moves
+ * overlapping nodes apart afterwards, using the same grid.
+ *
+ * Positions are kept between solves, so a graph that changes a little can be
+ * solved again with a few iterations starting from the previous placement.
+ */
+class ForceSolver {
+public:
+	void clear();
+	size_t addNode(QPointF, bool pinned = false, QSizeF size = QSizeF(0, 0));
+	void addEdge(size_t, size_t);
+	size_t size() const { return m_positions.size(); }
+	QPointF position(size_t idx) const { return m_positions[idx]; }
+	// Runs the given number of iterations, keeping nodes inside the bounds.
+	// Step is the max distance a node can move in the first iteration.
+	void solve(QRectF bounds, qreal idealLength, int iterations, qreal step);
+	// Moves overlapping nodes apart until there's at least the gap between
+	// them, for at most the given number of passes. Returns whether no
+	// overlaps are left.
+	bool separate(QRectF bounds, qreal gap, int passes);
+
+private:
+	std::vector<QPointF> m_positions;
+	std::vector<QSizeF> m_sizes;
+	std::vector<bool> m_pinned;
+	std::vector<std::pair<uint32_t, uint32_t>> m_edges;
+	// Largest width or height of a node.
+	qreal m_maxExtent = 0;
+	// Scratch buffers, kept to avoid allocations between iterations.
+	std::vector<QPointF> m_forces;
+	std::vector<uint32_t> m_cellOf;
+	std::vector<uint32_t> m_cellStart;
+	std::vector<uint32_t> m_cellNext;
+	std::vector<uint32_t> m_sorted;
+	// Grid the nodes are bucketed into.
+	QRectF m_gridBounds;
+	qreal m_cellSize = 1;
+	int m_columns = 1;
+	int m_rows = 1;
+	// Helpers.
+	void bucket(QRectF, qreal);
+	void moveNode(size_t, QPointF, QRectF);
+	int columnOf(QPointF) const;
+	int rowOf(QPointF) const;
+	void repulse(QRectF, qreal);
+	void attract(qreal);
+};
+
+#endif
@@ -27,3 +27,16 @@ ItemLayout::ItemLayout(
 	rightSideLink = _rightSideLink;
 	canDelete = _canDelete;
 }
+
+bool ItemLayout::operator==(const ItemLayout& other) const {
+	return id == other.id
+		&& name == other.name
+		&& x == other.x && y == other.y
+		&& w == other.w && h == other.h
+		&& visible == other.visible
+		&& hasParents == other.hasParents
+		&& hasChildren == other.hasChildren
+		&& hasLinks == other.hasLinks
+		&& rightSideLink == other.rightSideLink
+		&& canDelete == other.canDelete;
+}
@@ -19,6 +19,7 @@ public:
 		bool rightSideLink,
 		bool canDelete
 	);
+	bool operator==(const ItemLayout&) const;
 	ThoughtId id;
 	QString name;
 	int x, y, w, h;
@@ -0,0 +1,150 @@
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+#include <QPointF>
+#include <QPolygonF>
+
+#include "layout/path_index.h"
+
+PathIndex::PathIndex(qreal cellSize) : m_cellSize(cellSize) {}
+
+void PathIndex::clear() {
+	m_segments.clear();
+	m_free.clear();
+	m_paths.clear();
+	m_cells.clear();
+}
+
+void PathIndex::add(int id, const QPolygonF& polyline) {
+	std::vector<uint32_t>& owned = m_paths[id];
+
+	for (int idx = 1; idx < polyline.size(); idx++) {
+		Segment added = Segment{polyline[idx - 1], polyline[idx], id};
+		uint32_t segment;
+		if (m_free.empty()) {
+			segment = m_segments.size();
+			m_segments.push_back(added);
+		} else {
+			segment = m_free.back();
+			m_free.pop_back();
+			m_segments[segment] = added;
+		}
+		owned.push_back(segment);
+
+		forEachCell(added, [this, segment](uint64_t cellKey) {
+			m_cells[cellKey].push_back(segment);
+		});
+	}
+}
+
+void PathIndex::remove(int id) {
+	auto found = m_paths.find(id);
+	if (found == m_paths.end())
+		return;
+
+	for (auto segment: found->second) {
+		forEachCell(m_segments[segment], [this, segment](uint64_t cellKey) {
+			auto cellIt = m_cells.find(cellKey);
+			if (cellIt == m_cells.end())
+				return;
+
+			std::vector<uint32_t>& list = cellIt->second;
+			for (size_t idx = 0; idx < list.size(); idx++) {
+				if (list[idx] == segment) {
+					list[idx] = list.back();
+					list.pop_back();
+					break;
+				}
+			}
+			if (list.empty())
+				m_cells.erase(cellIt);
+		});
+
+		m_segments[segment].id = -1;
+		m_free.push_back(segment);
+	}
+
+	m_paths.erase(found);
+}
+
+void PathIndex::renumber(int from, int to) {
+	auto found = m_paths.find(from);
+	if (found == m_paths.end())
+		return;
+
+	std::vector<uint32_t> owned = std::move(found->second);
+	m_paths.erase(found);
+
+	for (auto segment: owned)
+		m_segments[segment].id = to;
+	m_paths[to] = std::move(owned);
+}
+
+int PathIndex::nearest(QPointF point, qreal radius) const {
+	int result = -1;
+	qreal best = std::numeric_limits<qreal>::max();
+
+	int minX = cell(point.x() - radius), maxX = cell(point.x() + radius);
+	int minY = cell(point.y() - radius), maxY = cell(point.y() + radius);
+
+	for (int cx = minX; cx <= maxX; cx++) {
+		for (int cy = minY; cy <= maxY; cy++) {
+			auto found = m_cells.find(key(cx, cy));
+			if (found == m_cells.end())
+				continue;
+
+			for (auto idx: found->second) {
+				const Segment& segment = m_segments[idx];
+				qreal dist = distance(point, segment);
+				if (dist <= radius && dist < best) {
+					best = dist;
+					result = segment.id;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+// Helpers.
+
+template<typename F>
+void PathIndex::forEachCell(const Segment& segment, F callback) const {
+	int minX = cell(std::min(segment.from.x(), segment.to.x()));
+	int maxX = cell(std::max(segment.from.x(), segment.to.x()));
+	int minY = cell(std::min(segment.from.y(), segment.to.y()));
+	int maxY = cell(std::max(segment.from.y(), segment.to.y()));
+
+	for (int cx = minX; cx <= maxX; cx++) {
+		for (int cy = minY; cy <= maxY; cy++)
+			callback(key(cx, cy));
+	}
+}
+
+int PathIndex::cell(qreal coord) const {
+	return (int)std::floor(coord / m_cellSize);
+}
+
+uint64_t PathIndex::key(int x, int y) {
+	return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+qreal PathIndex::distance(QPointF point, const Segment& segment) {
+	QPointF dir = segment.to - segment.from;
+	qreal length = QPointF::dotProduct(dir, dir);
+
+	// Projection of the point onto the segment, clamped to its ends.
+	qreal t = 0;
+	if (length > 0) {
+		t = QPointF::dotProduct(point - segment.from, dir) / length;
+		t = std::max(0.0, std::min(1.0, t));
+	}
+
+	QPointF closest = segment.from + dir * t;
+	QPointF diff = point - closest;
+	return std::sqrt(QPointF::dotProduct(diff, diff));
+}
@@ -0,0 +1,50 @@
+#ifndef H_PATH_INDEX
+#define H_PATH_INDEX
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <QPointF>
+#include <QPolygonF>
+
+/**
+ * Uniform grid over the canvas for finding connections under the cursor.
+ *
+ * Connections are added as polylines. Each segment is put into every cell
+ * its bounding box touches, so a lookup only has to check the few segments
+ * stored in cells around the point, no matter how many connections there are.
+ * Paths can be removed or renumbered one by one, touching only their own
+ * cells, so the index can follow a few moved connections without a rebuild.
+ */
+class PathIndex {
+public:
+	PathIndex(qreal cellSize = 32.0);
+	void clear();
+	void add(int id, const QPolygonF&);
+	void remove(int id);
+	// Gives the path another ID, which must not be in use.
+	void renumber(int from, int to);
+	// ID of the path closest to the point within the radius, or -1.
+	int nearest(QPointF, qreal radius) const;
+
+private:
+	struct Segment {
+		QPointF from, to;
+		int id;
+	};
+
+	qreal m_cellSize;
+	std::vector<Segment> m_segments;
+	// Slots of removed segments, reused by new ones.
+	std::vector<uint32_t> m_free;
+	std::unordered_map<int, std::vector<uint32_t>> m_paths;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;
+	// Helpers.
+	template<typename F> void forEachCell(const Segment&, F) const;
+	int cell(qreal) const;
+	static uint64_t key(int, int);
+	static qreal distance(QPointF, const Segment&);
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include <climits>
+#include <unordered_map>
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QHash>
+#include <QMutexLocker>
+#include <QRect>
+#include <QSize>
+#include <QString>
+
+#include "layout/text_metrics.h"
+
+TextMetrics& TextMetrics::shared() {
+	static TextMetrics metrics;
+	return metrics;
+}
+
+QSize TextMetrics::wrappedSize(const QFont& font, const QString& text, int width) {
+	Key key = Key{
+		.font = font.key(),
+		.text = text,
+		.width = width,
+	};
+
+	{
+		QMutexLocker locker(&m_mutex);
+		if (auto found = m_sizes.find(key); found != m_sizes.end())
+			return found->second;
+	}
+
+	QFontMetrics metrics(font);
+	QRect bounds = metrics.boundingRect(
+		QRect(0, 0, width, INT_MAX),
+		Qt::AlignHCenter | Qt::TextWordWrap,
+		text
+	);
+
+	QMutexLocker locker(&m_mutex);
+	if (m_sizes.size() >= maxEntries)
+		m_sizes.clear();
+
+	m_sizes.insert({key, bounds.size()});
+	return bounds.size();
+}
+
+void TextMetrics::clear() {
+	QMutexLocker locker(&m_mutex);
+	m_sizes.clear();
+}
+
+size_t TextMetrics::size() const {
+	QMutexLocker locker(&m_mutex);
+	return m_sizes.size();
+}
+
+// Keys.
+
+bool TextMetrics::Key::operator==(const Key& other) const {
+	return width == other.width && text == other.text && font == other.font;
+}
+
+size_t TextMetrics::KeyHash::operator()(const Key& key) const {
+	return qHashMulti(0, key.font, key.text, key.width);
+}
@@ -0,0 +1,48 @@
+#ifndef H_TEXT_METRICS
+#define H_TEXT_METRICS
+
+#include <unordered_map>
+
+#include <QFont>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+
+/**
+ * Cache of text measurements shared by all canvases.
+ *
+ * Layouts measure every visible label on each reload, and every resize causes
+ * a reload. Measured sizes only depend on the text, the font and the width,
+ * so they are kept here and reused across reloads, widgets and tabs.
+ *
+ * Layouts can run on worker threads, so the cache is guarded by a mutex.
+ * Text itself is measured outside of the lock.
+ */
+class TextMetrics {
+public:
+	static TextMetrics& shared();
+	// Size of the text wrapped by words and centered within the given width.
+	QSize wrappedSize(const QFont&, const QString&, int width);
+	// Drops all measurements, e.g. when fonts or styles change.
+	void clear();
+	size_t size() const;
+
+private:
+	struct Key {
+		QString font;
+		QString text;
+		int width;
+		bool operator==(const Key&) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key&) const;
+	};
+
+	mutable QMutex m_mutex;
+	std::unordered_map<Key, QSize, KeyHash> m_sizes;
+	// Cache is dropped when it gets this big, to keep memory bounded.
+	static constexpr size_t maxEntries = 20000;
+};
+
+#endif
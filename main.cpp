@@ -2,11 +2,14 @@
 #include <QString>
 #include <QStyleFactory>
 #include <QIcon>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
 
 #include "widgets/tabs_widget.h"
 #include "presenters/tabs_presenter.h"
 #include "infra/database_module_factory.h"
 #include "infra/system_resource_provider.h"
+#include "infra/canvas_profile.h"
 
 int main(int argc, char **argv) {
 	QApplication app(argc, argv);
@@ -14,10 +17,30 @@ int main(int argc, char **argv) {
 	app.setApplicationDisplayName("Brainlet");
 	app.setWindowIcon(QIcon(":/icons/app.png"));
 
+	// Canvas settings.
+	QCommandLineParser parser;
+	QCommandLineOption forceLayout(
+		"force-layout",
+		"Place all loaded thoughts with a force-directed layout."
+	);
+	QCommandLineOption immediateRenderer(
+		"immediate-renderer",
+		"Draw every connection on each repaint of the canvas."
+	);
+	parser.addHelpOption();
+	parser.addOption(forceLayout);
+	parser.addOption(immediateRenderer);
+	parser.process(app);
+
+	CanvasProfile canvas = CanvasProfile::defaultProfile();
+	canvas.forceLayout = parser.isSet(forceLayout);
+	if (parser.isSet(immediateRenderer))
+		canvas.renderer = CanvasRenderer::Immediate;
+
 	Style& style = Style::defaultStyle();
 
 	SystemResourceProvider provider = SystemResourceProvider();
-	DatabaseModuleFactory factory = DatabaseModuleFactory(&style, &provider);
+	DatabaseModuleFactory factory = DatabaseModuleFactory(&style, &provider, canvas);
 	TabsWidget *widget = new TabsWidget(nullptr, &style);
 	TabsPresenter *presenter = new TabsPresenter(widget, &factory);
 
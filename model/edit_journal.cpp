@@ -0,0 +1,105 @@
+#include <QList>
+
+#include "model/new_text_model.h"
+#include "model/edit_journal.h"
+
+EditJournal::EditJournal(size_t limit)
+	: m_limit(limit) {}
+
+bool EditJournal::canUndo() const {
+	return m_index > 0;
+}
+
+bool EditJournal::canRedo() const {
+	return m_index < m_steps.size();
+}
+
+void EditJournal::clear() {
+	m_steps.clear();
+	m_index = 0;
+	m_open = false;
+	m_bytes = 0;
+}
+
+void EditJournal::record(
+	const QList<text::Edit>& edits,
+	StaticCursor before,
+	StaticCursor after
+) {
+	if (edits.isEmpty())
+		return;
+
+	// New edits make undone steps unreachable.
+	while (m_steps.size() > m_index) {
+		m_bytes -= m_steps.last().bytes;
+		m_steps.removeLast();
+		m_open = false;
+	}
+
+	if (!m_open) {
+		m_steps.push_back(Step{
+			.before = before,
+			.after = after,
+			.bytes = sizeof(Step)
+		});
+		m_bytes += sizeof(Step);
+		m_index += 1;
+		m_open = true;
+	}
+
+	Step& step = m_steps.last();
+	for (auto& edit: edits) {
+		if (edit.isEmpty())
+			continue;
+
+		if (!step.edits.isEmpty()) {
+			text::Edit& last = step.edits.last();
+			size_t oldBytes = last.memoryUsage();
+			if (last.merge(edit)) {
+				size_t newBytes = last.memoryUsage();
+				step.bytes = step.bytes - oldBytes + newBytes;
+				m_bytes = m_bytes - oldBytes + newBytes;
+				continue;
+			}
+		}
+
+		size_t bytes = edit.memoryUsage();
+		step.edits.push_back(edit);
+		step.bytes += bytes;
+		m_bytes += bytes;
+	}
+	step.after = after;
+
+	trim();
+}
+
+void EditJournal::close() {
+	m_open = false;
+}
+
+const EditJournal::Step *EditJournal::undo() {
+	close();
+
+	if (!canUndo())
+		return nullptr;
+
+	m_index -= 1;
+	return &m_steps.at(m_index);
+}
+
+const EditJournal::Step *EditJournal::redo() {
+	if (!canRedo())
+		return nullptr;
+
+	m_index += 1;
+	return &m_steps.at(m_index - 1);
+}
+
+void EditJournal::trim() {
+	// The last step is kept even if it doesn't fit on its own.
+	while (m_bytes > m_limit && m_steps.size() > 1) {
+		m_bytes -= m_steps.first().bytes;
+		m_steps.removeFirst();
+		m_index -= 1;
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef H_EDIT_JOURNAL_MODEL
+#define H_EDIT_JOURNAL_MODEL
+
+#include <QList>
+
+#include "model/new_text_model.h"
+
+// Cursor position stored as paragraph, line and character indices.
+struct StaticCursor {
+	int block;
+	int line;
+	int position;
+};
+
+/**
+ * EditJournal is the undo history of a text. Every step holds the edits made
+ * to the text, along with cursor positions before and after them. New edits
+ * go into the last step until it is closed, and edits continuing each other,
+ * like a run of typed characters, are merged into one. Steps are undone by
+ * applying inverse edits in reverse order. Oldest steps are dropped once
+ * the journal takes more memory than the limit.
+ */
+class EditJournal {
+public:
+	struct Step {
+		QList<text::Edit> edits;
+		StaticCursor before;
+		StaticCursor after;
+		size_t bytes;
+	};
+
+	EditJournal(size_t limit = 1024 * 1024);
+	// Properties.
+	bool canUndo() const;
+	bool canRedo() const;
+	bool isOpen() const { return m_open; }
+	qsizetype size() const { return m_steps.size(); }
+	size_t memoryUsage() const { return m_bytes; }
+	// Recording.
+	void clear();
+	void record(const QList<text::Edit>&, StaticCursor, StaticCursor);
+	void close();
+	// Navigation.
+	const Step *undo();
+	const Step *redo();
+
+private:
+	QList<Step> m_steps;
+	// Number of steps currently applied to the text.
+	qsizetype m_index = 0;
+	bool m_open = false;
+	size_t m_bytes = 0;
+	size_t m_limit;
+	// Helpers.
+	void trim();
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "model/thought.h"
 #include "model/state.h"
+#include "model/state_change.h"
 #include "model/brain.h"
 #include "model/brain_list.h"
 #include "model/new_text_model.h"
@@ -1,6 +1,10 @@
+#include <algorithm>
+
 #include <QString>
 #include <QRegularExpression>
 #include <QList>
+#include <QPair>
+#include <QStringView>
 #include <QFont>
 #include <QTextCharFormat>
 
@@ -113,362 +117,399 @@ int text::FormatRange::endOffset() const {
 	}
 }
 
-// Line parsing.
+// Inline markup.
 
-text::Line::Line(QString& input, bool preformatted, int lvl) : level(lvl) {
-	setText(input, preformatted);
-}
-
-void text::Line::parseLinks(QString *input) {
-	QRegularExpression expr("\\[(.+?)\\]\\(((.+?)://(.+?))\\)");
-	QRegularExpressionMatch match = expr.match(*input);
-	int offset;
-
-	while (match.hasMatch()) {
-		// Calcualate offset in the folded string by counting offsets applied
-		// from previous folding operations.
-		offset = 0;
-		for (auto& format: foldedFormats) {
-			if (format.from < match.capturedStart())
-				offset += format.startOffset();
-			if (format.to < match.capturedStart())
-				offset += format.endOffset();
+namespace text_utils {
+	// Pieces of a line found by the tokenizer.
+	enum InlineKind {
+		InlineText,
+		InlineEscape,
+		InlineCode,
+		InlineStars,
+		InlineCheckbox,
+		InlinePlainLink,
+		InlineLink
+	};
+
+	// Role of a run of stars after matching.
+	enum StarsRole {
+		StarsText,
+		StarsOpen,
+		StarsClose
+	};
+
+	struct InlineItem {
+		InlineKind kind;
+		// Position in the unfolded text.
+		int from, to;
+		// Links: end of the title, `](` follows it.
+		int titleTo = -1;
+		// Stars: emphasis opened or closed by the run.
+		StarsRole role = StarsText;
+		text::BlockFormat format = text::Italic;
+	};
+
+	/**
+	 * Single pass parser of inline markup. Splits the line into items,
+	 * pairs emphasis markers, then builds folded text and format ranges for
+	 * both representations in one walk over the items. Code spans and links
+	 * are atomic, so markers inside them are ignored. Link titles are parsed
+	 * as nested ranges.
+	 */
+	class InlineParser {
+	public:
+		InlineParser(text::Line *line) : m_line(line), m_text(line->text) {}
+
+		void parse(int from) {
+			QList<InlineItem> items = tokenize(from, m_text.size());
+			matchStars(items, 0, items.size());
+			fold(items);
 		}
 
-		folded
-			.remove(match.capturedStart() - offset, 1)
-			.remove(
-				match.capturedEnd()
-					- offset
-					- 4
-					- match.captured(2).size(),
-				match.captured(2).size() + 3
-			);
-
-		text::BlockFormat linkType = BlockFormat::Link;
-		if (match.captured(3) == "node")
-			linkType = BlockFormat::NodeLink;
-
-		// Folded text highlights the link title.
-		FormatRange foldedRange = FormatRange(
-			match.capturedStart() - offset,
-			match.capturedStart() - offset + match.captured(1).size(),
-			linkType,
-			text::LinkFormat(match.captured(2))
-		);
+	private:
+		text::Line *m_line;
+		const QString& m_text;
+		// Last lookups of link parts. Brackets are checked from left to
+		// right, so a lookup is reused until the position passes its result.
+		// This way runs of brackets don't scan the rest of the line over and
+		// over.
+		struct Lookup {
+			int from = -1;
+			int found = -1;
+		};
+		Lookup m_middle, m_end, m_scheme;
+
+		QList<InlineItem> tokenize(int from, int to) {
+			QList<InlineItem> items;
+			int idx = from, textFrom = from;
+
+			while (idx < to) {
+				InlineItem item = InlineItem{.kind = InlineText, .from = idx, .to = idx + 1};
+				bool found = false;
+				QChar ch = m_text[idx];
+
+				if (ch == '\\') {
+					// Only stars can be escaped.
+					if (idx + 1 < to && m_text[idx + 1] == '*') {
+						item = InlineItem{.kind = InlineEscape, .from = idx, .to = idx + 2};
+						found = true;
+					}
+				} else if (ch == '`') {
+					int end = find('`', idx + 1, to);
+					if (end != -1) {
+						item = InlineItem{.kind = InlineCode, .from = idx, .to = end + 1};
+						found = true;
+					}
+				} else if (ch == '*') {
+					int end = idx;
+					while (end < to && m_text[end] == '*')
+						end++;
+					item = InlineItem{.kind = InlineStars, .from = idx, .to = end};
+					found = true;
+				} else if (ch == '[') {
+					found = checkbox(idx, to, &item) || link(idx, to, &item);
+				} else if (idx == 0 || m_text[idx - 1] == ' ') {
+					// Plain link has to start a word. Otherwise the word is
+					// skipped as a whole.
+					int wordEnd = idx;
+					found = plainLink(idx, to, &item, &wordEnd);
+					if (!found && wordEnd > idx) {
+						idx = wordEnd;
+						continue;
+					}
+				}
 
-		// Unfolded text highlights the link target and title brackets.
-		formats.push_back(
-			FormatRange(
-				match.capturedStart() + 3 + match.captured(1).size(),
-				match.capturedEnd() - 1,
-				linkType,
-				text::LinkFormat(match.captured(2))
-			)
-		);
-		// Brackets highlight.
-		formats.push_back(
-			FormatRange(
-				match.capturedStart(),
-				match.capturedStart() + 1,
-				text::BlockFormat::Bold
-			)
-		);
-		formats.push_back(
-			FormatRange(
-				match.capturedStart() + 1 + match.captured(1).size(),
-				match.capturedStart() + 1 + match.captured(1).size() + 2,
-				text::BlockFormat::Bold
-			)
-		);
-		formats.push_back(
-			FormatRange(
-				match.capturedEnd() - 1,
-				match.capturedEnd(),
-				text::BlockFormat::Bold
-			)
-		);
+				if (!found) {
+					idx++;
+					continue;
+				}
 
-		// Shift other formats.
-		for (auto& format: foldedFormats) {
-			if (format.from > foldedRange.from)
-				format.from -= foldedRange.startOffset();
-			if (format.to > foldedRange.from)
-				format.to -= foldedRange.startOffset();
-			if (format.from > foldedRange.to)
-				format.from -= foldedRange.endOffset();
-			if (format.to > foldedRange.to) {
-				format.to -= foldedRange.endOffset();
+				if (textFrom < idx)
+					items.push_back(InlineItem{.kind = InlineText, .from = textFrom, .to = idx});
+				items.push_back(item);
+				idx = item.to;
+				textFrom = idx;
 			}
-		}
 
-		foldedFormats.push_back(foldedRange);
+			if (textFrom < to)
+				items.push_back(InlineItem{.kind = InlineText, .from = textFrom, .to = to});
 
-		match = expr.match(*input, match.capturedEnd());
-	}
-}
+			return items;
+		}
 
-void text::Line::parseCheckboxes(QString *input) {
-	QRegularExpression expr("(^| )(\\[[ x]\\])($| )");
-	QRegularExpressionMatch match = expr.match(*input);
-	QString fullCheckbox(QChar(0xf14a));
-	QString emptyCheckbox(QChar(0xf0c8));
-	int offset;
-
-	while (match.hasMatch()) {
-		// Calcualate offset in the folded string by counting offsets applied
-		// from previous folding operations.
-		offset = 0;
-		for (auto& format: foldedFormats) {
-			if (format.from < match.capturedStart())
-				offset += format.startOffset();
-			if (format.to < match.capturedStart())
-				offset += format.endOffset();
+		int find(Lookup *lookup, QStringView needle, int from) {
+			if (
+				lookup->from == -1 || lookup->from > from ||
+				(lookup->found != -1 && lookup->found < from)
+			) {
+				lookup->from = from;
+				lookup->found = m_text.indexOf(needle, from);
+			}
+			return lookup->found;
 		}
 
-		folded
-			.replace(
-				match.capturedStart() - offset + match.captured(1).size(),
-				match.captured(2).size(),
-				match.captured(2) == "[ ]" ? emptyCheckbox : fullCheckbox
-			);
-
-		// Folded text range.
-		FormatRange foldedRange = FormatRange(
-			match.capturedStart() - offset + match.captured(1).size(),
-			match.capturedStart() - offset + match.captured(1).size() + 1,
-			BlockFormat::Checkbox
-		);
+		int find(QChar ch, int from, int to) {
+			for (int idx = from; idx < to; idx++) {
+				if (m_text[idx] == ch)
+					return idx;
+			}
+			return -1;
+		}
 
-		// Open bracket.
-		formats.push_back(
-			FormatRange(
-				match.capturedStart() + match.captured(1).size(),
-				match.capturedStart() + match.captured(1).size() + 1,
-				text::BlockFormat::Bold
-			)
-		);
-		// Checkbox symbol.
-		formats.push_back(
-			FormatRange(
-				match.capturedStart() + match.captured(1).size() + 1,
-				match.capturedStart() + match.captured(1).size() + 2,
-				text::BlockFormat::Highlight
-			)
-		);
-		// Close bracket.
-		formats.push_back(
-			FormatRange(
-				match.capturedStart() + match.captured(1).size() + 2,
-				match.capturedStart() + match.captured(1).size() + 3,
-				text::BlockFormat::Bold
-			)
-		);
+		bool checkbox(int idx, int to, InlineItem *item) {
+			// Checkbox is a separate word: "[ ]" or "[x]".
+			if (idx + 3 > to || m_text[idx + 2] != ']')
+				return false;
+			if (m_text[idx + 1] != ' ' && m_text[idx + 1] != 'x')
+				return false;
+			if (idx > 0 && m_text[idx - 1] != ' ')
+				return false;
+			if (idx + 3 < m_text.size() && m_text[idx + 3] != ' ')
+				return false;
+
+			*item = InlineItem{.kind = InlineCheckbox, .from = idx, .to = idx + 3};
+			return true;
+		}
 
-		// Shift other formats.
-		for (auto& format: foldedFormats) {
-			if (format.from > foldedRange.from)
-				format.from -= foldedRange.startOffset();
-			if (format.to > foldedRange.from)
-				format.to -= foldedRange.startOffset();
-			if (format.from > foldedRange.to)
-				format.from -= foldedRange.endOffset();
-			if (format.to > foldedRange.to) {
-				format.to -= foldedRange.endOffset();
+		bool link(int idx, int to, InlineItem *item) {
+			// Title is not empty and ends at the first "](".
+			int middle = find(&m_middle, u"](", idx + 2);
+			if (middle == -1 || middle + 2 >= to)
+				return false;
+
+			// Target ends at the first ")" and has a non-empty scheme.
+			int end = find(&m_end, u")", middle + 2);
+			if (end == -1 || end >= to)
+				return false;
+
+			int scheme = find(&m_scheme, u"://", middle + 3);
+			if (scheme == -1 || scheme + 3 >= end)
+				return false;
+
+			*item = InlineItem{
+				.kind = InlineLink,
+				.from = idx,
+				.to = end + 1,
+				.titleTo = middle
+			};
+			return true;
+		}
+
+		bool plainLink(int idx, int to, InlineItem *item, int *wordEnd) {
+			// Scheme made of word characters, followed by "://".
+			int end = idx;
+			while (end < to && (m_text[end].isLetterOrNumber() || m_text[end] == '_'))
+				end++;
+			*wordEnd = end;
+
+			if (end == idx || end + 3 >= to || QStringView(m_text).mid(end, 3) != QLatin1String("://"))
+				return false;
+
+			// Link lasts until a space, or punctuation followed by a space.
+			static const QString punctuation = ".,;!?-";
+			end += 4;
+			while (end < to && m_text[end] != ' ') {
+				if (
+					punctuation.contains(m_text[end]) &&
+					end + 1 < to &&
+					m_text[end + 1] == ' '
+				) {
+					break;
+				}
+				end++;
 			}
+
+			*item = InlineItem{.kind = InlinePlainLink, .from = idx, .to = end};
+			return true;
 		}
 
-		// Save current format.
-		foldedFormats.push_back(foldedRange);
+		void matchStars(QList<InlineItem>& items, qsizetype from, qsizetype to) {
+			for (qsizetype idx = from; idx < to; idx++) {
+				InlineItem& opener = items[idx];
+				int count = opener.to - opener.from;
+
+				// Longer runs and runs after an escaped star can't open
+				// emphasis.
+				if (opener.kind != InlineStars || count > 3)
+					continue;
+				if (opener.from > 0 && m_text[opener.from - 1] == '*')
+					continue;
+
+				// Closing run should have at least as many stars, the rest
+				// of them are text. Italic can't contain stars at all.
+				qsizetype closer = -1;
+				for (qsizetype next = idx + 1; next < to; next++) {
+					if (items[next].kind != InlineStars)
+						continue;
+
+					int length = items[next].to - items[next].from;
+					if (length >= count && (count > 1 || length == 1))
+						closer = next;
+					if (closer != -1 || count == 1)
+						break;
+				}
 
-		// Find next match.
-		match = expr.match(*input, match.capturedEnd());
-	}
-}
+				if (closer == -1)
+					continue;
 
-void text::Line::parseSimpleLinks(QString *input) {
-	// TODO: Hacky URL matching. Feels like covering the full URL spec and
-	// detecting link text within normal text properly is almost impossible...
-	QRegularExpression expr("(^| )(\\w+?://.+?)($| |[\\.,;!?\\-] )");
-	QRegularExpressionMatch match = expr.match(*input);
-	int offset;
-
-	while (match.hasMatch()) {
-		// Get offset from formats before.
-		offset = 0;
-		for (auto& format: foldedFormats) {
-			if (format.from < match.capturedStart())
-				offset += format.startOffset();
-			if (format.to < match.capturedStart())
-				offset += format.endOffset();
-		}
+				text::BlockFormat format = count == 3
+					? text::BoldItalic
+					: (count == 2 ? text::Bold : text::Italic);
+				opener.role = StarsOpen;
+				opener.format = format;
+				items[closer].role = StarsClose;
+				items[closer].format = format;
 
-		FormatRange foldedRange = FormatRange(
-			match.capturedStart() - offset + match.captured(1).size(),
-			match.capturedStart() - offset + match.captured(1).size() + match.captured(2).size(),
-			text::BlockFormat::PlainLink,
-			text::LinkFormat(match.captured(2))
-		);
+				// Shorter emphasis can be nested.
+				matchStars(items, idx + 1, closer);
+				idx = closer;
+			}
+		}
 
-		formats.push_back(
-			FormatRange(
-				match.capturedStart() + match.captured(1).size(),
-				match.capturedStart() + match.captured(1).size() + match.captured(2).size(),
-				text::BlockFormat::PlainLink,
-				text::LinkFormat(match.captured(2))
-			)
-		);
+		void fold(const QList<InlineItem>& items) {
+			QList<text::FormatRange> *formats = &m_line->formats;
+			QList<text::FormatRange> *foldedFormats = &m_line->foldedFormats;
+			QString *folded = &m_line->folded;
+			// Indices of unfolded and folded formats of emphasis that is not
+			// closed yet.
+			QList<QPair<qsizetype, qsizetype>> open;
+
+			for (auto& item: items) {
+				int start = folded->size();
+				QStringView chunk = QStringView(m_text).mid(item.from, item.to - item.from);
+
+				switch (item.kind) {
+					case InlineText:
+						folded->append(chunk);
+						break;
 
-		foldedFormats.push_back(foldedRange);
+					case InlineEscape:
+						folded->append(chunk.mid(1));
+						formats->push_back(text::FormatRange(item.from, item.to, text::Escape));
+						foldedFormats->push_back(text::FormatRange(start, start + 1, text::Escape));
+						break;
 
-		match = expr.match(*input, match.capturedEnd());
-	}
-}
+					case InlineCode:
+						folded->append(chunk.mid(1, chunk.size() - 2));
+						formats->push_back(text::FormatRange(item.from, item.to, text::CodeSpan));
+						foldedFormats->push_back(text::FormatRange(start, folded->size(), text::CodeSpan));
+						break;
 
-void text::Line::apply(
-	QString *input,
-	text::BlockFormat fmt,
-	QRegularExpression expr
-) {
-	int offset = 0;
-	int prefix = text_utils::blockStartOffset(fmt);
-	int suffix = text_utils::blockEndOffset(fmt);
-	QRegularExpressionMatch match = expr.match(*input);
-
-	while (match.hasMatch()) {
-		// Get offset from formats before.
-		offset = 0;
-		for (auto& format: foldedFormats) {
-			if (format.from < match.capturedStart())
-				offset += format.startOffset();
-			if (format.to < match.capturedStart())
-				offset += format.endOffset();
-		}
+					case InlineStars:
+						if (item.role == StarsText) {
+							folded->append(chunk);
+						} else if (item.role == StarsOpen) {
+							open.push_back({formats->size(), foldedFormats->size()});
+							formats->push_back(text::FormatRange(item.from, item.to, item.format));
+							foldedFormats->push_back(text::FormatRange(start, start, item.format));
+						} else {
+							// Extra stars of the closing run stay in the text.
+							int markers = text_utils::blockEndOffset(item.format);
+							folded->append(chunk.left(chunk.size() - markers));
+							auto opened = open.takeLast();
+							(*formats)[opened.first].to = item.to;
+							(*foldedFormats)[opened.second].to = folded->size();
+						}
+						break;
 
-		folded
-			.remove(match.capturedStart() - offset + match.captured(1).size(), prefix);
-		folded
-			.remove(
-				match.capturedEnd()
-					- match.captured(2).size()
-					- offset - prefix - suffix,
-				suffix
-			);
-
-		FormatRange foldedRange = FormatRange(
-			match.capturedStart() - offset + match.captured(1).size(),
-			match.capturedEnd() - offset - prefix - suffix - match.captured(2).size(),
-			fmt
-		);
+					case InlineCheckbox:
+						folded->append(QChar(chunk[1] == 'x' ? 0xf14a : 0xf0c8));
+						formats->push_back(text::FormatRange(item.from, item.from + 1, text::Bold));
+						formats->push_back(text::FormatRange(item.from + 1, item.from + 2, text::Highlight));
+						formats->push_back(text::FormatRange(item.from + 2, item.to, text::Bold));
+						foldedFormats->push_back(text::FormatRange(start, start + 1, text::Checkbox));
+						break;
 
-		formats.push_back(
-			FormatRange(
-				match.capturedStart() + match.captured(1).size(),
-				match.capturedEnd() - match.captured(2).size(),
-				fmt
-			)
-		);
+					case InlinePlainLink:
+						folded->append(chunk);
+						formats->push_back(text::FormatRange(
+							item.from, item.to, text::PlainLink, text::LinkFormat(chunk.toString())
+						));
+						foldedFormats->push_back(text::FormatRange(
+							start, folded->size(), text::PlainLink, text::LinkFormat(chunk.toString())
+						));
+						break;
 
-		// Shift other formats.
-		for (auto& format: foldedFormats) {
-			if (format.from > foldedRange.from)
-				format.from -= foldedRange.startOffset();
-			if (format.to > foldedRange.from)
-				format.to -= foldedRange.startOffset();
-			if (format.from > foldedRange.to)
-				format.from -= foldedRange.endOffset();
-			if (format.to > foldedRange.to) {
-				format.to -= foldedRange.endOffset();
+					case InlineLink:
+						foldLink(item);
+						break;
+				}
 			}
 		}
 
-		foldedFormats.push_back(foldedRange);
+		void foldLink(const InlineItem& item) {
+			QList<text::FormatRange> *formats = &m_line->formats;
+			QList<text::FormatRange> *foldedFormats = &m_line->foldedFormats;
+			int start = m_line->folded.size();
+
+			QString target = m_text.mid(item.titleTo + 2, item.to - item.titleTo - 3);
+			text::BlockFormat linkType = target.startsWith("node://")
+				? text::NodeLink
+				: text::Link;
+
+			// Unfolded text highlights the link target and title brackets.
+			formats->push_back(text::FormatRange(
+				item.titleTo + 2, item.to - 1, linkType, text::LinkFormat(target)
+			));
+			formats->push_back(text::FormatRange(item.from, item.from + 1, text::Bold));
+			formats->push_back(text::FormatRange(item.titleTo, item.titleTo + 2, text::Bold));
+			formats->push_back(text::FormatRange(item.to - 1, item.to, text::Bold));
+
+			// Folded text highlights the link title, which can have its own
+			// markup.
+			qsizetype range = foldedFormats->size();
+			foldedFormats->push_back(text::FormatRange(
+				start, start, linkType, text::LinkFormat(target)
+			));
+
+			QList<InlineItem> title = tokenize(item.from + 1, item.titleTo);
+			matchStars(title, 0, title.size());
+			fold(title);
+
+			(*foldedFormats)[range].to = m_line->folded.size();
+		}
+	};
+}
+
+// Line parsing.
 
-		match = expr.match(*input, match.capturedEnd());
-	}
+text::Line::Line(QString& input, bool preformatted, int lvl) : level(lvl) {
+	setText(input, preformatted);
 }
 
 void text::Line::setText(QString& input, bool preformatted) {
 	text = input;
-	folded = input;
 
 	formats.clear();
 	foldedFormats.clear();
 
 	if (preformatted) {
+		folded = input;
 		return;
 	}
 
+	folded.clear();
+	folded.reserve(input.size());
+
 	// Headings.
-	if (input.startsWith("# ")) {
-		folded = input.right(folded.size() - 2);
-		foldedFormats.push_back(FormatRange(0, folded.size(), text::BlockFormat::Heading1));
-		formats.push_back(FormatRange(0, input.size(), text::BlockFormat::Heading1));
-	} else if (input.startsWith("## ")) {
-		folded = input.right(folded.size() - 3);
-		foldedFormats.push_back(FormatRange(0, folded.size(), text::BlockFormat::Heading2));
-		formats.push_back(FormatRange(0, input.size(), text::BlockFormat::Heading2));
-	} else if (input.startsWith("### ")) {
-		folded = input.right(folded.size() - 4);
-		foldedFormats.push_back(FormatRange(0, folded.size(), text::BlockFormat::Heading3));
-		formats.push_back(FormatRange(0, input.size(), text::BlockFormat::Heading3));
-	} else if (input.startsWith("#### ")) {
-		folded = input.right(folded.size() - 5);
-		foldedFormats.push_back(FormatRange(0, folded.size(), text::BlockFormat::Heading4));
-		formats.push_back(FormatRange(0, input.size(), text::BlockFormat::Heading4));
-	} else if (input.startsWith("##### ")) {
-		folded = input.right(folded.size() - 6);
-		foldedFormats.push_back(FormatRange(0, folded.size(), text::BlockFormat::Heading5));
-		formats.push_back(FormatRange(0, input.size(), text::BlockFormat::Heading5));
-	} else if (input.startsWith("###### ")) {
-		folded = input.right(folded.size() - 7);
-		foldedFormats.push_back(FormatRange(0, folded.size(), text::BlockFormat::Heading6));
-		formats.push_back(FormatRange(0, input.size(), text::BlockFormat::Heading6));
+	int hashes = 0;
+	while (hashes < input.size() && hashes < 7 && input[hashes] == '#')
+		hashes++;
+
+	bool heading = hashes > 0 && hashes < 7 &&
+		hashes < input.size() && input[hashes] == ' ';
+	if (heading) {
+		BlockFormat format = static_cast<BlockFormat>(Heading1 + hashes - 1);
+		formats.push_back(FormatRange(0, input.size(), format));
+		foldedFormats.push_back(FormatRange(0, 0, format));
 	}
 
-	// Escaping.
-	apply(
-		&text,
-		BlockFormat::Escape,
-		QRegularExpression("()\\\\[\\*]()")
-	);
-
-	// Code.
-	apply(
-		&text,
-		BlockFormat::CodeSpan,
-		QRegularExpression("()`[^\n]*?`()")
-	);
-
-	// Bold italic.
-	apply(
-		&text,
-		BlockFormat::BoldItalic,
-		QRegularExpression("(^|[^\\*\\\\])\\*\\*\\*[^\n]*?\\*\\*\\*($|[^\\*])")
-	);
-
-	// Bold.
-	apply(
-		&text,
-		BlockFormat::Bold,
-		QRegularExpression("(^|[^\\*\\\\])\\*\\*[^\\*][^\n]*?\\*\\*($|[^\\*])")
-	);
-
-	// Italic.
-	apply(
-		&text,
-		BlockFormat::Italic,
-		QRegularExpression("(^|[^\\*\\\\])\\*[^\\*\n]+?\\*($|[^\\*])")
-	);
-
-	// Remaining Links.
-	parseSimpleLinks(&text);
-
-	// Links.
-	parseLinks(&text);
-
-	// Checkboxes.
-	parseCheckboxes(&text);
+	// Inline markup.
+	text_utils::InlineParser parser(this);
+	parser.parse(heading ? hashes + 1 : 0);
+
+	if (heading)
+		foldedFormats[0].to = folded.size();
 }
 
 // Paragraphs.
@@ -511,6 +552,10 @@ int text::Paragraph::indexOfLine(text::Line* line) {
 	return -1;
 }
 
+text::Paragraph text::Paragraph::clone() const {
+	return Paragraph(m_type, QList<Line>(m_lines.constBegin(), m_lines.constEnd()));
+}
+
 // Text model.
 
 text::TextModel::TextModel() {}
@@ -702,3 +747,174 @@ QString text::TextModel::text() {
 	return result.join("\n\n");
 }
 
+// Edits.
+
+/**
+ * Edit turning `before` into `after`: the range between their common prefix
+ * and common suffix. Takes time proportional to the length of the line only.
+ */
+text::Edit text::Edit::lineEdit(
+	int paragraph,
+	int line,
+	const QString& before,
+	const QString& after
+) {
+	int prefix = 0, suffix = 0;
+	int shortest = std::min(before.length(), after.length());
+
+	while (prefix < shortest && before[prefix] == after[prefix])
+		prefix++;
+	while (
+		suffix < shortest - prefix &&
+		before[before.length() - suffix - 1] == after[after.length() - suffix - 1]
+	) {
+		suffix++;
+	}
+
+	return Edit{
+		.type = LineEdit,
+		.paragraph = paragraph,
+		.line = line,
+		.from = prefix,
+		.removed = before.mid(prefix, before.length() - suffix - prefix),
+		.inserted = after.mid(prefix, after.length() - suffix - prefix),
+	};
+}
+
+/**
+ * Edit replacing lines within a paragraph. Lines are values sharing their
+ * text with the model, so copies are cheap and later changes don't leak into
+ * the edit.
+ */
+text::Edit text::Edit::linesEdit(
+	int paragraph,
+	int line,
+	QList<text::Line> removed,
+	QList<text::Line> inserted
+) {
+	return Edit{
+		.type = LinesEdit,
+		.paragraph = paragraph,
+		.line = line,
+		.from = 0,
+		.removedLines = removed,
+		.insertedLines = inserted,
+	};
+}
+
+text::Edit text::Edit::levelEdit(
+	int paragraph,
+	int line,
+	unsigned int before,
+	unsigned int after
+) {
+	return Edit{
+		.type = LevelEdit,
+		.paragraph = paragraph,
+		.line = line,
+		.from = 0,
+		.removedLevel = before,
+		.insertedLevel = after,
+	};
+}
+
+/**
+ * Edit replacing paragraphs. Keeps its own copies of them, so changes made to
+ * the model afterwards don't leak into the edit.
+ */
+text::Edit text::Edit::paragraphEdit(
+	int paragraph,
+	QList<text::Paragraph> removed,
+	QList<text::Paragraph> inserted
+) {
+	Edit edit = Edit{
+		.type = ParagraphEdit,
+		.paragraph = paragraph,
+		.line = 0,
+		.from = 0,
+	};
+
+	for (auto& par: removed)
+		edit.removedParagraphs.push_back(par.clone());
+	for (auto& par: inserted)
+		edit.insertedParagraphs.push_back(par.clone());
+
+	return edit;
+}
+
+bool text::Edit::isEmpty() const {
+	if (type == LineEdit)
+		return removed == inserted;
+	if (type == LinesEdit)
+		return removedLines.isEmpty() && insertedLines.isEmpty();
+	if (type == LevelEdit)
+		return removedLevel == insertedLevel;
+	return removedParagraphs.isEmpty() && insertedParagraphs.isEmpty();
+}
+
+bool text::Edit::merge(const text::Edit& next) {
+	if (
+		type != LineEdit || next.type != LineEdit ||
+		paragraph != next.paragraph || line != next.line
+	) {
+		return false;
+	}
+
+	if (next.removed.isEmpty() && next.from == from + inserted.length()) {
+		// Typing after inserted text.
+		inserted += next.inserted;
+		return true;
+	} else if (!next.inserted.isEmpty()) {
+		return false;
+	}
+
+	if (
+		next.from >= from &&
+		next.from + next.removed.length() == from + inserted.length()
+	) {
+		// Erasing inserted text from its end.
+		inserted.chop(next.removed.length());
+		return true;
+	} else if (inserted.isEmpty() && next.from + next.removed.length() == from) {
+		// Erasing backwards.
+		from = next.from;
+		removed = next.removed + removed;
+		return true;
+	} else if (inserted.isEmpty() && next.from == from) {
+		// Erasing forward.
+		removed += next.removed;
+		return true;
+	}
+
+	return false;
+}
+
+static size_t lineMemoryUsage(const text::Line& line) {
+	return sizeof(text::Line)
+		+ (line.text.size() + line.folded.size()) * sizeof(QChar)
+		+ (line.formats.size() + line.foldedFormats.size()) * sizeof(text::FormatRange);
+}
+
+static size_t paragraphMemoryUsage(text::Paragraph par) {
+	size_t result = sizeof(text::Paragraph);
+	const QList<text::Line>& lines = *par.getLines();
+	for (const text::Line& line: lines)
+		result += lineMemoryUsage(line);
+	return result;
+}
+
+size_t text::Edit::memoryUsage() const {
+	size_t result = sizeof(Edit)
+		+ (removed.size() + inserted.size()) * sizeof(QChar);
+
+	for (auto& par: removedParagraphs)
+		result += paragraphMemoryUsage(par);
+	for (auto& par: insertedParagraphs)
+		result += paragraphMemoryUsage(par);
+	for (auto& line: removedLines)
+		result += lineMemoryUsage(line);
+	for (auto& line: insertedLines)
+		result += lineMemoryUsage(line);
+
+	return result;
+}
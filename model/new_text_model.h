@@ -76,11 +76,6 @@ namespace text {
 		inline bool operator!=(const Line rhs) const {
 			return text != rhs.text;
 		}
-	private:
-		void parseLinks(QString*);
-		void parseSimpleLinks(QString*);
-		void parseCheckboxes(QString*);
-		void apply(QString*, BlockFormat, QRegularExpression);
 	};
 
 	// Paragraph model. Can consist of one or more lines.
@@ -95,6 +90,8 @@ namespace text {
 		void setLine(int, Line);
 		void setLines(QList<Line>);
 		int indexOfLine(Line*);
+		// Copy that doesn't share lines with this one.
+		Paragraph clone() const;
 	private:
 		ParagraphType m_type = Text;
 		QList<Line> m_lines;
@@ -117,6 +114,53 @@ namespace text {
 	private:
 		QList<Paragraph> m_data;
 	};
+
+	// Kinds of edits.
+	enum EditType {
+		LineEdit,
+		LinesEdit,
+		LevelEdit,
+		ParagraphEdit
+	};
+
+	// Single change made to the model by the editor. Line edits replace
+	// `removed` text starting at `from` in a line with `inserted` text.
+	// Lines edits replace `removedLines` starting at `line` in a paragraph
+	// with `insertedLines`. Level edits change list level of a line from
+	// `removedLevel` to `insertedLevel`. Paragraph edits replace
+	// `removedParagraphs` starting at `paragraph` with `insertedParagraphs`,
+	// and cover everything else: paragraph types, added or removed
+	// paragraphs.
+	struct Edit {
+		EditType type;
+		int paragraph;
+		// Line edits.
+		int line;
+		int from;
+		QString removed;
+		QString inserted;
+		// Paragraph edits.
+		QList<Paragraph> removedParagraphs;
+		QList<Paragraph> insertedParagraphs;
+		// Lines edits.
+		QList<Line> removedLines;
+		QList<Line> insertedLines;
+		// Level edits.
+		unsigned int removedLevel = 0;
+		unsigned int insertedLevel = 0;
+		// Constructors.
+		static Edit lineEdit(int, int, const QString&, const QString&);
+		static Edit linesEdit(int, int, QList<Line>, QList<Line>);
+		static Edit levelEdit(int, int, unsigned int, unsigned int);
+		static Edit paragraphEdit(int, QList<Paragraph>, QList<Paragraph>);
+		// Whether the edit doesn't change anything.
+		bool isEmpty() const;
+		// Appends the next edit to this one, if they touch adjacent text
+		// in the same line.
+		bool merge(const Edit&);
+		// Approximate number of bytes used by the edit.
+		size_t memoryUsage() const;
+	};
 }
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "model/thought.h"
 #include "model/state.h"
+#include "model/state_change.h"
 
 State::State(
 	ThoughtId root,
@@ -14,6 +15,74 @@ State::State(
 	m_thoughts = thoughts;
 }
 
+State *State::copy() const {
+	std::unordered_map<ThoughtId, Thought*> *thoughts =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	if (m_thoughts) {
+		thoughts->reserve(m_thoughts->size());
+		for (auto& [id, thought]: *m_thoughts)
+			thoughts->insert({id, new Thought(*thought)});
+	}
+
+	return new State(
+		m_rootId,
+		m_centralThought ? new Thought(*m_centralThought) : nullptr,
+		thoughts
+	);
+}
+
+State *State::copyChanged(const StateChange& change) const {
+	std::unordered_map<ThoughtId, Thought*> *thoughts =
+		new std::unordered_map<ThoughtId, Thought*>();
+	Thought *center = nullptr;
+
+	for (auto *ids: {&change.added(), &change.updated()}) {
+		for (auto id: *ids) {
+			if (m_centralThought && m_centralThought->id() == id && !center)
+				center = new Thought(*m_centralThought);
+
+			if (!m_thoughts)
+				continue;
+			if (auto found = m_thoughts->find(id); found != m_thoughts->end())
+				thoughts->insert({id, new Thought(*found->second)});
+		}
+	}
+
+	return new State(m_rootId, center, thoughts);
+}
+
+void State::merge(const StateChange& change, State *patch) {
+	if (patch == nullptr)
+		return;
+
+	if (m_thoughts) {
+		for (auto id: change.removed()) {
+			if (auto found = m_thoughts->find(id); found != m_thoughts->end()) {
+				delete found->second;
+				m_thoughts->erase(found);
+			}
+		}
+	}
+
+	if (m_centralThought && patch->m_centralThought)
+		*m_centralThought = *patch->m_centralThought;
+
+	if (m_thoughts && patch->m_thoughts) {
+		for (auto& [id, thought]: *patch->m_thoughts) {
+			if (auto found = m_thoughts->find(id); found != m_thoughts->end()) {
+				*found->second = *thought;
+			} else {
+				// Taken over from the patch.
+				m_thoughts->insert({id, thought});
+				thought = nullptr;
+			}
+		}
+	}
+
+	delete patch;
+}
+
 State::~State() {
 	if (m_centralThought) {
 		delete m_centralThought;
@@ -4,21 +4,35 @@
 #include <unordered_map>
 
 #include "model/thought.h"
+#include "model/state_change.h"
 
 /**
  * State holds currently loaded chunk of a brain.
  * When constructing State with a central Thought and peripheral Thoughs map,
  * it assumes ownerwhip of those objects, and deletes them when destroyed.
+ *
+ * Repositories may patch a State in place through the non-const accessors
+ * instead of rebuilding it, reporting what was touched with a StateChange.
  */
 class State {
 public:
 	// Constructor and destructor.
 	State(ThoughtId, Thought*, std::unordered_map<ThoughtId, Thought*>*);
 	~State();
+	// Deep copy, e.g. to be read by another thread while this one is patched.
+	State *copy() const;
+	// Copies of the thoughts the change added or modified. Passed to merge()
+	// of a copy of this state, it brings the copy up to date.
+	State *copyChanged(const StateChange&) const;
+	// Applies a patch made by copyChanged() and takes ownership of it.
+	// Modified thoughts keep their objects.
+	void merge(const StateChange&, State*);
 	// Properties.
 	const ThoughtId rootId() const { return m_rootId; }
 	const Thought *centralThought() const { return m_centralThought; }
+	Thought *centralThought() { return m_centralThought; }
 	const std::unordered_map<ThoughtId, Thought*>* thoughts() const { return m_thoughts; }
+	std::unordered_map<ThoughtId, Thought*>* thoughts() { return m_thoughts; }
 
 private:
 	ThoughtId m_rootId;
@@ -0,0 +1,33 @@
+#include <vector>
+
+#include "model/thought.h"
+#include "model/state_change.h"
+
+StateChange::StateChange(bool reloaded)
+	: m_reloaded(reloaded) {}
+
+bool StateChange::isEmpty() const {
+	return !m_reloaded
+		&& m_added.empty()
+		&& m_removed.empty()
+		&& m_updated.empty();
+}
+
+void StateChange::add(ThoughtId id) {
+	append(m_added, id);
+}
+
+void StateChange::remove(ThoughtId id) {
+	append(m_removed, id);
+}
+
+void StateChange::update(ThoughtId id) {
+	append(m_updated, id);
+}
+
+void StateChange::append(std::vector<ThoughtId>& list, ThoughtId id) {
+	for (auto& existing: list)
+		if (existing == id)
+			return;
+	list.push_back(id);
+}
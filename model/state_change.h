@@ -0,0 +1,38 @@
+#ifndef H_STATE_CHANGE_MODEL
+#define H_STATE_CHANGE_MODEL
+
+#include <vector>
+
+#include "model/thought.h"
+
+/**
+ * StateChange describes how the last repository operation modified the
+ * loaded State. Repositories try to patch the State in place, in which case
+ * the lists contain IDs of thoughts that were added to, removed from, or
+ * modified in the State. If the State had to be rebuilt from scratch, or was
+ * replaced by a different one, `reloaded` is set and the lists are empty.
+ */
+class StateChange {
+public:
+	StateChange(bool reloaded = true);
+	// Properties.
+	bool reloaded() const { return m_reloaded; }
+	const std::vector<ThoughtId>& added() const { return m_added; }
+	const std::vector<ThoughtId>& removed() const { return m_removed; }
+	const std::vector<ThoughtId>& updated() const { return m_updated; }
+	bool isEmpty() const;
+	// Filling.
+	void add(ThoughtId);
+	void remove(ThoughtId);
+	void update(ThoughtId);
+
+private:
+	bool m_reloaded;
+	std::vector<ThoughtId> m_added;
+	std::vector<ThoughtId> m_removed;
+	std::vector<ThoughtId> m_updated;
+	// Helpers.
+	static void append(std::vector<ThoughtId>&, ThoughtId);
+};
+
+#endif
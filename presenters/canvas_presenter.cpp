@@ -2,6 +2,7 @@
 
 #include "entity/graph_repository.h"
 #include "presenters/canvas_presenter.h"
+#include "presenters/search_engine.h"
 
 CanvasPresenter::CanvasPresenter(
 	BaseLayout *layout,
@@ -11,6 +12,20 @@ CanvasPresenter::CanvasPresenter(
 ) : m_repo(repo), m_search(search), m_view(view) {
 	m_layout = layout;
 
+	if (search != nullptr) {
+		m_suggestions = new SearchEngine(search, SuggestionLimit, SearchScopeNames);
+		m_suggestions->setParent(this);
+
+		connect(
+			m_suggestions, &SearchEngine::resultsChanged,
+			this, &CanvasPresenter::onSuggestionsChanged
+		);
+		connect(
+			m_suggestions, &SearchEngine::failed,
+			this, &CanvasPresenter::onSuggestionsFailed
+		);
+	}
+
 	connect(
 		view, SIGNAL(textChanged(ThoughtId, QString, std::function<void(bool)>)),
 		this, SLOT(onThoughtChanged(ThoughtId, QString, std::function<void(bool)>))
@@ -58,9 +73,15 @@ CanvasPresenter::~CanvasPresenter() {
 }
 
 void CanvasPresenter::setThought(ThoughtId id) {
-	if (m_repo->select(id)) {
-		reloadState();
-	}
+	m_repo->selectAsync(id, m_depth, m_budget, this, [this](bool result) {
+		if (result)
+			reloadState();
+	});
+}
+
+void CanvasPresenter::setSelectionDepth(int depth, size_t budget) {
+	m_depth = depth;
+	m_budget = budget;
 }
 
 // Slots.
@@ -77,7 +98,12 @@ void CanvasPresenter::onShown() {
 }
 
 void CanvasPresenter::onThoughtSelected(ThoughtId id) {
-	if (m_repo->select(id)) {
+	// Canvas stays responsive while the next state is loaded. Only the last
+	// selection calls back.
+	m_repo->selectAsync(id, m_depth, m_budget, this, [this](bool result) {
+		if (!result)
+			return;
+
 		reloadState();
 
 		if (auto state = m_repo->getState(); state != nullptr) {
@@ -85,7 +111,7 @@ void CanvasPresenter::onThoughtSelected(ThoughtId id) {
 				emit thoughtSelected(center->id(), QString::fromStdString(center->name()));
 			}
 		}
-	}
+	});
 }
 
 void CanvasPresenter::onThoughtChanged(
@@ -93,14 +119,17 @@ void CanvasPresenter::onThoughtChanged(
 	QString text,
 	std::function<void(bool)> callback
 ) {
+	// Edits are made on the repository's thread, state is updated right
+	// before the callback.
 	std::string value = text.toStdString();
-	bool result = m_repo->updateThought(id, value);
-	callback(result);
+	m_repo->updateThoughtAsync(id, value, this, [this, id, text, callback](bool result) {
+		callback(result);
 
-	if (result) {
-		reloadState();
-		emit thoughtRenamed(id, text);
-	}
+		if (result) {
+			applyChange();
+			emit thoughtRenamed(id, text);
+		}
+	});
 }
 
 void CanvasPresenter::onThoughtCreated(
@@ -111,12 +140,17 @@ void CanvasPresenter::onThoughtCreated(
 	std::function<void(bool, ThoughtId)> callback
 ) {
 	std::string value = text.toStdString();
-	CreateResult result = m_repo->createThought(fromId, connection, incoming, value);
-	callback(result.success, result.id);
-
-	if (result.success) {
-		reloadState();
-	}
+	m_repo->createThoughtAsync(
+		fromId, connection, incoming, value,
+		this,
+		[this, callback](CreateResult result) {
+			callback(result.success, result.id);
+
+			if (result.success) {
+				applyChange();
+			}
+		}
+	);
 }
 
 void CanvasPresenter::onThoughtConnected(
@@ -125,88 +159,114 @@ void CanvasPresenter::onThoughtConnected(
 	ConnectionType type,
 	std::function<void(bool)> callback
 ) {
-	bool result = m_repo->connectThoughts(fromId, toId, type);
-	callback(result);
+	m_repo->connectThoughtsAsync(fromId, toId, type, this, [this, callback](bool result) {
+		callback(result);
 
-	if (result) {
-		if (m_view != nullptr)
-			m_view->hideSuggestions();
-		reloadState();
-	}
+		if (result) {
+			if (m_view != nullptr)
+				m_view->hideSuggestions();
+			applyChange();
+		}
+	});
 }
 
 void CanvasPresenter::onThoughtDeleted(ThoughtId id) {
-	bool result = m_repo->deleteThought(id);
-	if (result) {
-		reloadState();
-	}
+	m_repo->deleteThoughtAsync(id, this, [this](bool result) {
+		if (result) {
+			applyChange();
+		}
+	});
 }
 
 void CanvasPresenter::onThoughtsDisconnected(ThoughtId from, ThoughtId to) {
-	bool result = m_repo->disconnectThoughts(from, to);
-	if (result) {
-		reloadState();
-	}
+	m_repo->disconnectThoughtsAsync(from, to, this, [this](bool result) {
+		if (result) {
+			applyChange();
+		}
+	});
 }
 
 void CanvasPresenter::onNewThoughtTextChanged(QString text) {
 	if (m_view == nullptr)
 		return;
-	if (m_search == nullptr)
+	if (m_suggestions == nullptr)
 		return;
 
-	if (text.length() < 3) {
+	m_suggestions->setTerm(text);
+}
+
+void CanvasPresenter::onSuggestionsChanged(
+	QString term,
+	std::vector<SearchItem> results
+) {
+	if (m_view == nullptr)
+		return;
+
+	if (term.length() < 3) {
 		m_view->hideSuggestions();
 		return;
 	}
 
+	// State may have changed while searching.
 	const State *state = m_repo->getState();
 	if (state == nullptr)
 		return;
 	const std::unordered_map<ThoughtId, Thought*>* thoughts = state->thoughts();
 
-	std::string term = text.toStdString();
-	SearchResult result = m_search->search(term);
+	std::vector<ConnectionItem> items;
 
-	if (result.error != SearchErrorNone) {
-		switch (result.error) {
-			case SearchErrorIO:
-				m_view->showError(tr("Could not read from the database."));
-				break;
-			case SearchErrorNone:
-				break;
+	for (auto it = results.begin(); it != results.end(); it++) {
+		// Don't show currently visible items in suggestions.
+		// Can potentially change later if we'll make "full graph" layout.
+		if (auto found = thoughts->find((*it).id); found != thoughts->end()) {
+			continue;
 		}
-	} else {
-		std::vector<ConnectionItem> items;
 
-		for (auto it = result.items.begin(); it != result.items.end(); it++) {
-			// Don't show currently visible items in suggestions.
-			// Can potentially change later if we'll make "full graph" layout.
-			if (auto found = thoughts->find((*it).id); found != thoughts->end()) {
-				continue;
-			}
+		ConnectionItem item = {
+			.id = (*it).id,
+			.name = QString::fromStdString((*it).name)
+		};
+		items.push_back(item);
+	}
 
-			ConnectionItem item = {
-				.id = (*it).id,
-				.name = QString::fromStdString((*it).name)
-			};
-			items.push_back(item);
-		}
+	m_view->showSuggestions(items);
+}
 
-		m_view->showSuggestions(items);
-	}
+void CanvasPresenter::onSuggestionsFailed(QString) {
+	if (m_view != nullptr)
+		m_view->showError(tr("Could not read from the database."));
 }
 
 void CanvasPresenter::reload() {
-	reloadState();
+	applyChange();
 }
 
 // Helpers.
 
 void CanvasPresenter::reloadState() {
 	if (const State *state = m_repo->getState(); state != nullptr) {
-		m_layout->setState(state);
+		// Canvas keeps the current arrangement until the new one is ready.
+		m_layout->setStateAsync(state);
 		emit stateUpdated(state);
 	}
 }
 
+void CanvasPresenter::applyChange() {
+	const State *state = m_repo->getState();
+	if (state == nullptr)
+		return;
+
+	// Repository reports whether the state was rebuilt or patched in place by
+	// the last operation.
+	const StateChange *change = m_repo->getChange();
+	if (change == nullptr || change->reloaded()) {
+		m_layout->setState(state);
+	} else if (!change->isEmpty()) {
+		m_layout->applyChange(*change);
+	} else {
+		return;
+	}
+
+	emit stateUpdated(state);
+}
+
@@ -9,6 +9,7 @@
 #include "entity/graph_repository.h"
 #include "entity/search_repository.h"
 #include "widgets/canvas_widget.h"
+#include "presenters/search_engine.h"
 
 class CanvasPresenter: public QObject {
 	Q_OBJECT
@@ -17,6 +18,9 @@ public:
 	CanvasPresenter(BaseLayout*, GraphRepository*, SearchRepository*, CanvasWidget*);
 	~CanvasPresenter();
 	void setThought(ThoughtId id);
+	// How far around the selected thought the state is loaded, see
+	// GraphRepository::select(ThoughtId, int, size_t).
+	void setSelectionDepth(int depth, size_t budget);
 
 signals:
 	void thoughtSelected(ThoughtId, QString);
@@ -47,6 +51,8 @@ private slots:
 	void onShown();
 	// Connection suggestions.
 	void onNewThoughtTextChanged(QString);
+	void onSuggestionsChanged(QString, std::vector<SearchItem>);
+	void onSuggestionsFailed(QString);
 
 private:
 	// State.
@@ -54,8 +60,14 @@ private:
 	GraphRepository *m_repo;
 	SearchRepository *m_search;
 	CanvasWidget *m_view;
+	SearchEngine *m_suggestions = nullptr;
+	int m_depth = 1;
+	size_t m_budget = 0;
 	// Helpers.
 	void reloadState();
+	void applyChange();
+	// Constants.
+	static constexpr size_t SuggestionLimit = 50;
 };
 
 #endif
@@ -0,0 +1,217 @@
+#include <vector>
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QRegularExpression>
+
+#include "presenters/search_engine.h"
+
+SearchEngine::SearchEngine(
+	SearchRepository *repo,
+	size_t limit,
+	SearchScope scope,
+	int delay
+) : m_repo(repo), m_limit(limit), m_scope(scope) {
+	m_timer.setSingleShot(true);
+	m_timer.setInterval(delay);
+
+	connect(
+		&m_timer, &QTimer::timeout,
+		this, &SearchEngine::onTimeout
+	);
+}
+
+// Control.
+
+void SearchEngine::setTerm(QString term) {
+	term = term.trimmed();
+	if (term == m_term)
+		return;
+
+	// Whatever is in flight is for an old term now.
+	m_term = term;
+	m_generation++;
+	if (m_repo != nullptr)
+		m_repo->cancelSearches(this);
+
+	if (term.length() < MinLength) {
+		m_timer.stop();
+		m_resultTerm = QString();
+		m_results.clear();
+		m_complete = false;
+		emit resultsChanged(term, std::vector<SearchItem>());
+		return;
+	}
+
+	if (narrow(term)) {
+		m_timer.stop();
+		return;
+	}
+
+	m_timer.start();
+}
+
+void SearchEngine::cancel() {
+	m_timer.stop();
+	m_generation++;
+	if (m_repo != nullptr)
+		m_repo->cancelSearches(this);
+	m_term = QString();
+	m_resultTerm = QString();
+	m_results.clear();
+	m_complete = false;
+}
+
+// Slots.
+
+void SearchEngine::onTimeout() {
+	query();
+}
+
+// Helpers.
+
+void SearchEngine::query() {
+	if (m_repo == nullptr)
+		return;
+
+	uint64_t generation = m_generation;
+	QString term = m_term;
+
+	m_repo->searchAsync(
+		term.toStdString(),
+		m_limit,
+		m_scope,
+		this,
+		[this, generation, term](SearchResult result) {
+			if (generation != m_generation)
+				return;
+
+			if (result.error != SearchErrorNone) {
+				emit failed(term);
+				return;
+			}
+
+			m_resultTerm = term;
+			m_results = result.items;
+			m_complete = result.items.size() < m_limit;
+			emit resultsChanged(term, m_results);
+		}
+	);
+}
+
+/**
+ * Filters previous results by the new term, matching names the way the
+ * repository does.
+ *
+ * When only names are searched, names containing the term are exactly the
+ * new results. SQLite's LIKE ignores case of ASCII letters only, so other
+ * terms are left to the query.
+ *
+ * Otherwise items whose names have a word starting with each word of the
+ * term are certainly in the new results. Words are compared without case and
+ * diacritics, like the full text index does. Others may still match by their
+ * note text, which we don't have, or by a part of a word in the name, so only
+ * the query can tell.
+ *
+ * Returns true if the narrowed results are final.
+ */
+bool SearchEngine::narrow(QString term) {
+	if (m_resultTerm.isEmpty())
+		return false;
+	if (!term.startsWith(m_resultTerm, Qt::CaseInsensitive))
+		return false;
+
+	if (m_scope == SearchScopeNames && !isPlain(term))
+		return false;
+
+	// Index matches words with punctuation inside as phrases, which word by
+	// word matching can't tell apart.
+	QStringList termWords;
+	if (m_scope == SearchScopeAll) {
+		for (auto& part: term.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts)) {
+			QStringList partWords = words(part);
+			if (partWords.size() != 1)
+				return false;
+			termWords.push_back(partWords[0]);
+		}
+	}
+
+	std::vector<SearchItem> narrowed;
+	// LIKE wildcards in the term may match names that don't contain it.
+	bool exact = m_complete && !term.contains('%') && !term.contains('_');
+
+	for (auto& item: m_results) {
+		QString name = QString::fromStdString(item.name);
+		if (m_scope == SearchScopeNames) {
+			if (name.contains(term, Qt::CaseInsensitive))
+				narrowed.push_back(item);
+		} else if (nameMatches(item, termWords)) {
+			narrowed.push_back(item);
+		} else if (
+			!item.snippet.empty() ||
+			name.contains(term, Qt::CaseInsensitive)
+		) {
+			exact = false;
+		}
+	}
+
+	emit resultsChanged(term, narrowed);
+
+	if (exact) {
+		m_resultTerm = term;
+		m_results = narrowed;
+	}
+
+	return exact;
+}
+
+/**
+ * Returns true if names are matched by LIKE the same way as by
+ * QString::contains: the term is ASCII only, without LIKE wildcards.
+ */
+bool SearchEngine::isPlain(QString term) {
+	for (QChar ch: term) {
+		if (ch.unicode() > 127 || ch == '%' || ch == '_')
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Splits text into lower case words without diacritics, which is how the
+ * unicode61 tokenizer with remove_diacritics 2 sees it.
+ */
+QStringList SearchEngine::words(QString text) {
+	QString decomposed = text.normalized(QString::NormalizationForm_D);
+	QString folded;
+	folded.reserve(decomposed.size());
+	for (QChar ch: decomposed) {
+		if (!ch.isMark())
+			folded.push_back(ch);
+	}
+
+	return folded.toCaseFolded().split(
+		QRegularExpression("\\W+", QRegularExpression::UseUnicodePropertiesOption),
+		Qt::SkipEmptyParts
+	);
+}
+
+bool SearchEngine::nameMatches(const SearchItem& item, const QStringList& term) {
+	QStringList nameWords = words(QString::fromStdString(item.name));
+
+	for (auto& word: term) {
+		bool found = false;
+		for (auto& nameWord: nameWords) {
+			if (nameWord.startsWith(word)) {
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,68 @@
+#ifndef H_SEARCH_ENGINE
+#define H_SEARCH_ENGINE
+
+#include <vector>
+#include <cstdint>
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include "entity/search_repository.h"
+
+/**
+ * Search-as-you-type on top of a SearchRepository.
+ *
+ * Queries are sent only after the user stops typing for a moment, and only
+ * the last one counts: results of any earlier query are dropped. At most
+ * `limit` best matches are requested from the given scope.
+ *
+ * When the new term extends the previous one, previous results are narrowed
+ * down and reported right away. If that's enough to know the full answer,
+ * the repository is not queried at all. Otherwise the query results follow,
+ * so results for a single term may arrive more than once.
+ */
+class SearchEngine: public QObject {
+	Q_OBJECT
+
+public:
+	SearchEngine(
+		SearchRepository*,
+		size_t limit,
+		SearchScope,
+		int delay = 150
+	);
+	void setTerm(QString);
+	void cancel();
+
+signals:
+	void resultsChanged(QString term, std::vector<SearchItem> items);
+	void failed(QString term);
+
+private slots:
+	void onTimeout();
+
+private:
+	SearchRepository *m_repo = nullptr;
+	size_t m_limit;
+	SearchScope m_scope;
+	QTimer m_timer;
+	// Last requested term. Only results for it are reported.
+	QString m_term;
+	uint64_t m_generation = 0;
+	// Last received results.
+	QString m_resultTerm;
+	std::vector<SearchItem> m_results;
+	bool m_complete = false;
+	// Helpers.
+	void query();
+	bool narrow(QString);
+	static bool isPlain(QString);
+	static QStringList words(QString);
+	static bool nameMatches(const SearchItem&, const QStringList&);
+	// Constants.
+	static constexpr int MinLength = 3;
+};
+
+#endif
@@ -3,12 +3,27 @@
 #include <QObject>
 
 #include "presenters/search_presenter.h"
+#include "presenters/search_engine.h"
 #include "widgets/connection_list_widget.h"
 
 SearchPresenter::SearchPresenter(
 	SearchRepository *repo,
 	SearchWidget *widget
 ) : m_repo(repo), m_widget(widget) {
+	if (repo != nullptr) {
+		m_engine = new SearchEngine(repo, ResultLimit, SearchScopeAll);
+		m_engine->setParent(this);
+
+		connect(
+			m_engine, &SearchEngine::resultsChanged,
+			this, &SearchPresenter::onResultsChanged
+		);
+		connect(
+			m_engine, &SearchEngine::failed,
+			this, &SearchPresenter::onSearchFailed
+		);
+	}
+
 	connect(
 		widget, SIGNAL(textChanged(SearchWidget*, QString)),
 		this, SLOT(onTextChanged(SearchWidget*, QString))
@@ -37,33 +52,30 @@ SearchPresenter::SearchPresenter(
 	);
 }
 
-void SearchPresenter::onTextChanged(SearchWidget *widget, QString text) {
-	if (m_repo == nullptr)
-		return;
-	if (text.length() < 3) {
-		std::vector<ConnectionItem> empty;
-		widget->setItems(empty);
+void SearchPresenter::onTextChanged(SearchWidget*, QString text) {
+	if (m_engine == nullptr)
 		return;
-	}
-
-	std::string term = text.toStdString();
-	SearchResult result = m_repo->search(term);
 
-	if (result.error == SearchErrorIO) {
-		emit onError(tr("Failed to read from the database"));
-	} else if (result.error == SearchErrorNone) {
-		std::vector<ConnectionItem> items;
+	m_engine->setTerm(text);
+}
 
-		for (auto it = result.items.begin(); it != result.items.end(); it++) {
-			ConnectionItem item = {
-				.id = (*it).id,
-				.name = QString::fromStdString((*it).name)
-			};
-			items.push_back(item);
-		}
+void SearchPresenter::onResultsChanged(QString, std::vector<SearchItem> results) {
+	std::vector<ConnectionItem> items;
 
-		widget->setItems(items);
+	for (auto it = results.begin(); it != results.end(); it++) {
+		ConnectionItem item = {
+			.id = (*it).id,
+			.name = QString::fromStdString((*it).name),
+			.snippet = QString::fromStdString((*it).snippet)
+		};
+		items.push_back(item);
 	}
+
+	m_widget->setItems(items);
+}
+
+void SearchPresenter::onSearchFailed(QString) {
+	emit onError(tr("Failed to read from the database"));
 }
 
 void SearchPresenter::onThoughtSelected(
@@ -75,6 +87,9 @@ void SearchPresenter::onThoughtSelected(
 }
 
 void SearchPresenter::onSearchCanceled(SearchWidget*) {
+	if (m_engine != nullptr)
+		m_engine->cancel();
+
 	emit searchCanceled();
 }
 
@@ -91,12 +106,18 @@ void SearchPresenter::onConnectionSelected(
 // State manipulation.
 
 void SearchPresenter::clear() {
+	if (m_engine != nullptr)
+		m_engine->cancel();
+
 	if (m_widget != nullptr) {
 		m_widget->clear();
 	}
 }
 
 void SearchPresenter::reset() {
+	if (m_engine != nullptr)
+		m_engine->cancel();
+
 	if (m_widget != nullptr) {
 		m_widget->reset();
 	}
@@ -8,6 +8,7 @@
 #include "widgets/search_widget.h"
 #include "widgets/connection_list_widget.h"
 #include "entity/search_repository.h"
+#include "presenters/search_engine.h"
 
 class SearchPresenter: public QObject {
 	Q_OBJECT
@@ -30,10 +31,15 @@ private slots:
 	void onThoughtSelected(SearchWidget*, ThoughtId, QString);
 	void onSearchCanceled(SearchWidget*);
 	void onConnectionSelected(SearchWidget*, ThoughtId, QString, ConnectionType, bool);
+	void onResultsChanged(QString, std::vector<SearchItem>);
+	void onSearchFailed(QString);
 
 private:
 	SearchRepository *m_repo = nullptr;
 	SearchWidget *m_widget = nullptr;
+	SearchEngine *m_engine = nullptr;
+	// Constants.
+	static constexpr size_t ResultLimit = 20;
 };
 
 #endif
@@ -50,11 +50,12 @@ void TextEditorPresenter::setThought(ThoughtId id) {
 		onTextChanged(text);
 	}
 
-	// Set ID.
-	m_id = id;
+	// Nothing is saved until the new text is loaded.
+	m_id = InvalidThoughtId;
+	m_pendingId = id;
 
 	// Empty state.
-	if (m_id == InvalidThoughtId) {
+	if (id == InvalidThoughtId) {
 		QString empty = QString();
 		m_editView->load(empty);
 		return;
@@ -64,16 +65,21 @@ void TextEditorPresenter::setThought(ThoughtId id) {
 		return;
 
 	// Valid state.
-	GetResult result = m_repository->getText(m_id);
-	if (result.error != TextRepositoryError::TextRepositoryErrorNone) {
-		m_id = InvalidThoughtId;
-		emit textError(MarkdownScrollError::MarkdownScrollIOError);
-		return;
-	}
-
-	QString text = result.result;
-	qDebug() << "loaded" << text;
-	m_editView->load(text);
+	m_repository->getTextAsync(id, this, [this, id](GetResult result) {
+		// User has already moved on to another thought.
+		if (m_pendingId != id)
+			return;
+
+		if (result.error != TextRepositoryError::TextRepositoryErrorNone) {
+			emit textError(MarkdownScrollError::MarkdownScrollIOError);
+			return;
+		}
+
+		m_id = id;
+		QString text = result.result;
+		qDebug() << "loaded" << text;
+		m_editView->load(text);
+	});
 }
 
 // Events.
@@ -84,11 +90,11 @@ void TextEditorPresenter::onTextChanged(QString& text) {
 	if (m_id == InvalidThoughtId)
 		return;
 
-	SaveResult result = m_repository->saveText(m_id, text);
-
-	if (result.error != TextRepositoryError::TextRepositoryErrorNone) {
-		emit textError(MarkdownScrollError::MarkdownScrollIOError);
-	}
+	m_repository->saveTextAsync(m_id, text, this, [this](SaveResult result) {
+		if (result.error != TextRepositoryError::TextRepositoryErrorNone) {
+			emit textError(MarkdownScrollError::MarkdownScrollIOError);
+		}
+	});
 }
 
 void TextEditorPresenter::onNodeInsertion(QPoint point) {
@@ -143,25 +149,24 @@ void TextEditorPresenter::onConnectionSelected(
 	ConnectionType type,
 	bool incoming
 ) {
-	bool result = false;
-
 	if (m_repository == nullptr)
 		return;
+	if (m_id == InvalidThoughtId)
+		return;
 
-	if (incoming) {
-		result = m_repository->connectThoughts(id, m_id, type);
-	} else {
-		result = m_repository->connectThoughts(m_id, id, type);
-	}
-
-	if (result) {
-		m_editView->hideSearchWidget();
-		m_editView->insertNodeLink(id, name);
-		m_editView->setFocus();
-		emit connectionCreated();
-	} else {
-		m_view->onError(MarkdownScrollIOError);
-	}
+	ThoughtId fromId = incoming ? id : m_id;
+	ThoughtId toId = incoming ? m_id : id;
+
+	m_repository->connectThoughtsAsync(fromId, toId, type, this, [this, id, name](bool result) {
+		if (result) {
+			m_editView->hideSearchWidget();
+			m_editView->insertNodeLink(id, name);
+			m_editView->setFocus();
+			emit connectionCreated();
+		} else {
+			m_view->onError(MarkdownScrollIOError);
+		}
+	});
 }
 
 void TextEditorPresenter::onThoughtSelected(
@@ -41,6 +41,8 @@ private slots:
 
 private:
 	ThoughtId m_id = InvalidThoughtId;
+	// Thought which text is being loaded.
+	ThoughtId m_pendingId = InvalidThoughtId;
 	// Dependencies.
 	TextRepository *m_repository = nullptr;
 	MarkdownScrollWidget *m_view = nullptr;
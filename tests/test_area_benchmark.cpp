@@ -0,0 +1,202 @@
+#include <map>
+#include <set>
+#include <random>
+#include <vector>
+#include <cassert>
+#include <iostream>
+
+#include <QDir>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "entity/database_brain_repository.h"
+#include "entity/memory_repository.h"
+
+// Benchmark for loading states further than the direct neighborhood. Builds a
+// brain with a power-law degree distribution (every new thought connects to
+// two existing ones, picked in proportion to the number of their connections),
+// then selects a hub and a leaf with different depths and budgets. Checks that
+// the database, the graph cache and the memory repository load the same
+// thoughts, and reports the time of each selection.
+
+static const int thoughtCount = 5000;
+static const int budget = 500;
+
+static void generate(
+	std::vector<ThoughtEntity>& thoughts,
+	std::vector<ConnectionEntity>& connections
+) {
+	std::mt19937 rng(7);
+	std::vector<ThoughtId> ends = {0};
+	std::set<std::pair<ThoughtId, ThoughtId>> added;
+
+	thoughts.push_back(ThoughtEntity(0, "Thought 0"));
+	for (ThoughtId id = 1; id < thoughtCount; id++) {
+		thoughts.push_back(ThoughtEntity(id, "Thought " + std::to_string(id)));
+
+		for (int idx = 0; idx < 2; idx++) {
+			ThoughtId other = ends[rng() % ends.size()];
+			if (other == id || added.count({other, id}) > 0)
+				continue;
+
+			added.insert({other, id});
+			ConnectionType type = (rng() % 5 == 0)
+				? ConnectionType::link
+				: ConnectionType::child;
+			connections.push_back(ConnectionEntity(other, id, type));
+			ends.push_back(other);
+			ends.push_back(id);
+		}
+	}
+}
+
+static void populate(
+	const std::vector<ThoughtEntity>& thoughts,
+	const std::vector<ConnectionEntity>& connections
+) {
+	QSqlDatabase db = QSqlDatabase::database();
+	db.transaction();
+
+	QSqlQuery query(db);
+	query.prepare("INSERT INTO thoughts (id, name) VALUES (:id, :name);");
+	for (auto& thought: thoughts) {
+		// Root thought is created with the brain.
+		if (thought.id == 0)
+			continue;
+
+		query.bindValue(":id", (qlonglong)thought.id);
+		query.bindValue(":name", QString::fromStdString(thought.name));
+		bool result = query.exec();
+		assert(result);
+	}
+
+	query.prepare(
+		"INSERT INTO connections (conn_from, conn_to, conn_type) "
+		"VALUES (:from, :to, :type);"
+	);
+	for (auto& conn: connections) {
+		query.bindValue(":from", (qlonglong)conn.from);
+		query.bindValue(":to", (qlonglong)conn.to);
+		query.bindValue(":type", conn.type);
+		bool result = query.exec();
+		assert(result);
+	}
+
+	db.commit();
+}
+
+static std::set<ThoughtId> loadedIds(const State *state) {
+	std::set<ThoughtId> result;
+	result.insert(state->centralThought()->id());
+	for (auto& [id, thought]: *state->thoughts())
+		result.insert(id);
+	return result;
+}
+
+static std::set<ThoughtId> select(
+	GraphRepository *repo,
+	ThoughtId id,
+	int depth,
+	qint64 *elapsed
+) {
+	QElapsedTimer timer;
+	timer.start();
+	bool result = repo->select(id, depth, budget);
+	*elapsed = timer.nsecsElapsed();
+	assert(result);
+
+	const State *state = repo->getState();
+	assert(state->centralThought()->id() == id);
+
+	// Every connection of a loaded thought leads to a loaded thought or
+	// outside of the area, never to itself.
+	for (auto& [thoughtId, thought]: *state->thoughts()) {
+		for (auto child: thought->children())
+			assert(child != thoughtId);
+		for (auto link: thought->links())
+			assert(link != thoughtId);
+	}
+
+	return loadedIds(state);
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_area");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	std::vector<ThoughtEntity> thoughts;
+	std::vector<ConnectionEntity> connections;
+	generate(thoughts, connections);
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+	populate(thoughts, connections);
+
+	// Keeps its own copy of the graph, and has the default root name.
+	thoughts[0].name = repo->getState()->centralThought()->name();
+	MemoryRepository memory(thoughts, connections, 0);
+
+	// The first thought is the biggest hub, the last one is a leaf.
+	ThoughtId roots[] = {0, thoughtCount - 1};
+	const int maxDepth = 4;
+	std::map<std::pair<ThoughtId, int>, std::set<ThoughtId>> areas;
+
+	for (ThoughtId root: roots) {
+		repo->select(root);
+		std::set<ThoughtId> hood = loadedIds(repo->getState());
+
+		for (int depth = 1; depth <= maxDepth; depth++) {
+			qint64 elapsed = 0;
+			unsigned long queries = repo->queryCount();
+
+			std::set<ThoughtId> area = select(repo, root, depth, &elapsed);
+			assert(repo->queryCount() - queries == 2);
+			areas[{root, depth}] = area;
+
+			// Neighborhood is always loaded, the rest fits in the budget.
+			for (auto id: hood)
+				assert(area.count(id) > 0);
+			assert(area.size() <= std::max(hood.size(), (size_t)budget));
+			if (depth == 1)
+				assert(area == hood);
+
+			qint64 memoryTime = 0;
+			assert(select(&memory, root, depth, &memoryTime) == area);
+
+			std::cout << "root " << root << ", depth " << depth
+				<< ": " << area.size() << " thoughts, "
+				<< (elapsed / 1000) << " us in database"
+				<< std::endl;
+		}
+	}
+
+	// Repositories share the default connection, so only one is open at a time.
+	delete repo;
+	StorageProfile profile = StorageProfile::defaultProfile();
+	profile.graphCache = true;
+	repo = DatabaseBrainRepository::fromDir(dir, profile);
+	assert(repo != nullptr);
+
+	for (ThoughtId root: roots) {
+		for (int depth = 1; depth <= maxDepth; depth++) {
+			qint64 elapsed = 0;
+			unsigned long queries = repo->queryCount();
+
+			assert(select(repo, root, depth, &elapsed) == areas[{root, depth}]);
+			assert(repo->queryCount() == queries);
+
+			std::cout << "root " << root << ", depth " << depth
+				<< ": " << (elapsed / 1000) << " us in cache"
+				<< std::endl;
+		}
+	}
+
+	delete repo;
+	dir.removeRecursively();
+	return 0;
+}
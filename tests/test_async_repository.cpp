@@ -0,0 +1,176 @@
+#include <cassert>
+
+#include <QDir>
+#include <QThread>
+#include <QObject>
+#include <QApplication>
+#include <QElapsedTimer>
+
+#include <QDebug>
+
+#include "entity/async_brain_repository.h"
+
+// Checks that asynchronous requests run off the GUI thread, call back on it,
+// and are dropped when their context object is destroyed, the search is
+// canceled or another selection is requested. Edits update the GUI's copy of
+// the state right before calling back.
+
+static void waitFor(std::function<bool()> condition) {
+	QElapsedTimer timer;
+	timer.start();
+	while (!condition()) {
+		assert(timer.elapsed() < 5000);
+		QApplication::processEvents(QEventLoop::AllEvents, 10);
+	}
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_async");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	AsyncBrainRepository *repo = AsyncBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+
+	CreateResult created = repo->createThought(0, ConnectionType::child, false, "Async child");
+	assert(created.success);
+	assert(repo->getState()->centralThought()->children().size() == 1);
+
+	QThread *gui = QThread::currentThread();
+
+	// Search.
+	bool searched = false;
+	QObject context;
+	repo->searchAsync("Async", 10, SearchScopeAll, &context, [&](SearchResult result) {
+		assert(QThread::currentThread() == gui);
+		assert(result.error == SearchErrorNone);
+		assert(result.items.size() == 1);
+		searched = true;
+	});
+	assert(!searched);
+	waitFor([&]() { return searched; });
+
+	// Text round trip. Jobs run in order, so the load sees the saved text.
+	bool saved = false, loaded = false;
+	repo->saveTextAsync(created.id, "Some text", &context, [&](SaveResult result) {
+		assert(result.error == TextRepositoryErrorNone);
+		saved = true;
+	});
+	repo->getTextAsync(created.id, &context, [&](GetResult result) {
+		assert(saved);
+		assert(result.error == TextRepositoryErrorNone);
+		assert(result.result == "Some text");
+		loaded = true;
+	});
+	waitFor([&]() { return loaded; });
+
+	// Dropped result.
+	bool dropped = true;
+	QObject *gone = new QObject();
+	repo->searchAsync("Async", 10, SearchScopeAll, gone, [&](SearchResult) {
+		dropped = false;
+	});
+	delete gone;
+
+	bool after = false;
+	repo->searchAsync("Async", 10, SearchScopeAll, &context, [&](SearchResult) {
+		after = true;
+	});
+	waitFor([&]() { return after; });
+	assert(dropped);
+
+	// Canceled and replaced searches.
+	bool canceled = false, replaced = false, last = false;
+	repo->searchAsync("Async", 10, SearchScopeAll, &context, [&](SearchResult) {
+		canceled = true;
+	});
+	repo->cancelSearches(&context);
+	repo->searchAsync("Async", 10, SearchScopeAll, &context, [&](SearchResult) {
+		replaced = true;
+	});
+	repo->searchAsync("Async", 10, SearchScopeAll, &context, [&](SearchResult) {
+		last = true;
+	});
+	waitFor([&]() { return last; });
+	assert(!canceled && !replaced);
+
+	// Selections. The current state stays until the callback, and only the
+	// last selection calls back.
+	const State *before = repo->getState();
+	bool first = false, selected = false;
+	repo->selectAsync(0, &context, [&](bool) {
+		first = true;
+	});
+	repo->selectAsync(created.id, &context, [&](bool result) {
+		assert(QThread::currentThread() == gui);
+		assert(result);
+		selected = true;
+	});
+	assert(repo->getState() == before);
+	waitFor([&]() { return selected; });
+	assert(!first);
+	assert(repo->getState()->centralThought()->id() == created.id);
+	assert(repo->getState()->centralThought()->parents().size() == 1);
+
+	// Edit made while the selection loads is not lost.
+	bool reselected = false;
+	repo->selectAsync(0, &context, [&](bool result) {
+		assert(result);
+		reselected = true;
+	});
+	CreateResult sibling = repo->createThought(0, ConnectionType::child, false, "Async sibling");
+	assert(sibling.success);
+	waitFor([&]() { return reselected; });
+	assert(repo->getState()->centralThought()->id() == 0);
+	assert(repo->getState()->centralThought()->children().size() == 2);
+
+	// Edits are queued as well. The state is patched in place right before
+	// the callback.
+	const State *current = repo->getState();
+	bool renamed = false;
+	repo->updateThoughtAsync(created.id, "Renamed child", &context, [&](bool result) {
+		assert(QThread::currentThread() == gui);
+		assert(result);
+		assert(repo->getState() == current);
+		assert(repo->getState()->thoughts()->at(created.id)->name() == "Renamed child");
+		renamed = true;
+	});
+	assert(repo->getState()->thoughts()->at(created.id)->name() == "Async child");
+	waitFor([&]() { return renamed; });
+
+	// State is updated even if the context of the edit is gone.
+	bool deleted = false, flushed = false;
+	QObject *closed = new QObject();
+	repo->deleteThoughtAsync(sibling.id, closed, [&](bool) {
+		deleted = true;
+	});
+	delete closed;
+	repo->getTextAsync(created.id, &context, [&](GetResult) {
+		flushed = true;
+	});
+	waitFor([&]() { return flushed; });
+	assert(!deleted);
+	assert(repo->getState() == current);
+	assert(repo->getState()->thoughts()->count(sibling.id) == 0);
+	assert(repo->getState()->centralThought()->children().size() == 1);
+
+	// Deeper selection loads thoughts past the neighborhood.
+	CreateResult grandchild = repo->createThought(created.id, ConnectionType::child, false, "Async grandchild");
+	assert(grandchild.success);
+	assert(repo->getState()->thoughts()->count(grandchild.id) == 0);
+	bool deep = false;
+	repo->selectAsync(0, 3, 50, &context, [&](bool result) {
+		assert(result);
+		deep = true;
+	});
+	waitFor([&]() { return deep; });
+	assert(repo->getState()->centralThought()->id() == 0);
+	assert(repo->getState()->thoughts()->count(grandchild.id) > 0);
+
+	delete repo;
+	dir.removeRecursively();
+	qDebug() << "OK";
+	return 0;
+}
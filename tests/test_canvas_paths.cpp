@@ -0,0 +1,132 @@
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QImage>
+
+#include "widgets/canvas_widget.h"
+#include "layout/default_layout.h"
+
+// Scrolls a side of a thought whose children link to each other, so that
+// only paths of changed items are updated, and checks that the canvas looks
+// the same as one whose paths were all made again after a full reload.
+// Reports the time per scroll step and per reload.
+
+static const int childCount = 2000;
+static const int scrollSteps = 100;
+
+static State *makeState() {
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	Thought *central = new Thought(0, "Hub", true, true, false);
+	Thought *parent = new Thought(1, "Parent", false, true, false);
+	central->parents().push_back(1);
+	parent->children().push_back(0);
+	map->insert({1, parent});
+
+	for (ThoughtId id = 10; id < 10 + childCount; id++) {
+		Thought *child = new Thought(
+			id, QString("Child %1").arg(id).toStdString(), true, false, true
+		);
+		if (id + 1 < 10 + childCount)
+			child->links().push_back(id + 1);
+		if (id > 10)
+			child->links().push_back(id - 1);
+		map->insert({id, child});
+		central->children().push_back(id);
+
+		// Every tenth child is a sibling too.
+		if (id % 10 == 0)
+			parent->children().push_back(id);
+	}
+
+	return new State(0, central, map);
+}
+
+static QImage render(CanvasWidget& canvas) {
+	QCoreApplication::processEvents();
+	return canvas.grab().toImage().convertToFormat(QImage::Format_ARGB32);
+}
+
+// Paths of the same color may be blended in another order, which can round
+// differently.
+static bool sameImage(const QImage& a, const QImage& b) {
+	if (a.size() != b.size())
+		return false;
+
+	for (int y = 0; y < a.height(); y++) {
+		for (int x = 0; x < a.width(); x++) {
+			QRgb pa = a.pixel(x, y), pb = b.pixel(x, y);
+			if (
+				std::abs(qRed(pa) - qRed(pb)) > 2 ||
+				std::abs(qGreen(pa) - qGreen(pb)) > 2 ||
+				std::abs(qBlue(pa) - qBlue(pb)) > 2 ||
+				std::abs(qAlpha(pa) - qAlpha(pb)) > 2
+			) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+	QSize size(1000, 800);
+
+	State *state = makeState();
+
+	DefaultLayout layout(&style);
+	CanvasWidget canvas(nullptr, &style, &layout);
+	canvas.setAnimated(false);
+	canvas.resize(size);
+	layout.setState(state);
+	layout.setSize(size);
+
+	DefaultLayout reference(&style);
+	CanvasWidget referenceCanvas(nullptr, &style, &reference);
+	referenceCanvas.setAnimated(false);
+	referenceCanvas.resize(size);
+	reference.setState(state);
+	reference.setSize(size);
+
+	assert(sameImage(render(canvas), render(referenceCanvas)));
+
+	// Scrolling lays out areas again, so their IDs are copied first.
+	std::vector<unsigned int> scrollIds;
+	for (auto& [scrollId, area]: *reference.scrollAreas())
+		scrollIds.push_back(scrollId);
+	assert(scrollIds.size() > 0);
+
+	for (auto scrollId: scrollIds) {
+		QElapsedTimer timer;
+		timer.start();
+		for (int step = 0; step < scrollSteps; step++) {
+			layout.onScroll(scrollId, 1);
+			assert(layout.changedItems() != nullptr);
+		}
+		qint64 scrollTime = timer.nsecsElapsed();
+
+		for (int step = 0; step < scrollSteps; step++)
+			reference.onScroll(scrollId, 1);
+
+		timer.restart();
+		reference.reload();
+		qint64 reloadTime = timer.nsecsElapsed();
+		assert(reference.changedItems() == nullptr);
+
+		assert(sameImage(render(canvas), render(referenceCanvas)));
+
+		std::cout << "side " << scrollId << ": "
+			<< (scrollTime / scrollSteps / 1000) << " us per scroll step, "
+			<< (reloadTime / 1000) << " us per reload" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+
+#include "widgets/canvas_widget.h"
+#include "widgets/thought_widget.h"
+#include "layout/default_layout.h"
+
+// Scrolls through a thought with thousands of children and checks that the
+// canvas keeps a bounded number of widgets around, no matter how many items
+// were shown. Reports the time per scroll step.
+
+static const int childCount = 5000;
+static const int scrollSteps = 500;
+
+static int widgetCount() {
+	// Widgets released with deleteLater() are still alive until this.
+	QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+	int count = 0;
+	for (auto *widget: QApplication::allWidgets()) {
+		if (qobject_cast<ThoughtWidget*>(widget) != nullptr)
+			count++;
+	}
+	return count;
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+
+	DefaultLayout layout(&style);
+	CanvasWidget canvas(nullptr, &style, &layout);
+
+	Thought *central = new Thought(0, "Hub", false, true, false);
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	for (ThoughtId id = 1; id <= childCount; id++) {
+		Thought *child = new Thought(
+			id, QString("Child %1").arg(id).toStdString(), true, false, false
+		);
+		map->insert({id, child});
+		central->children().push_back(id);
+	}
+
+	State state(0, central, map);
+	layout.setState(&state);
+	layout.setSize(QSize(800, 800));
+
+	assert(layout.scrollAreas()->size() > 0);
+	unsigned int scrollId = layout.scrollAreas()->begin()->first;
+
+	int initial = widgetCount();
+	int maxCount = initial;
+
+	QElapsedTimer timer;
+	timer.start();
+	for (int step = 0; step < scrollSteps; step++) {
+		layout.onScroll(scrollId, 1);
+		if (step % 50 == 0)
+			maxCount = std::max(maxCount, widgetCount());
+	}
+	qint64 elapsed = timer.nsecsElapsed();
+	maxCount = std::max(maxCount, widgetCount());
+
+	// Visible items, the layout's template widget and the recycle pool.
+	int limit = (int)layout.items()->size() + 1 + 32;
+	assert(maxCount <= limit);
+
+	std::cout << "visible items: " << layout.items()->size()
+		<< ", widgets: " << initial << " initially, " << maxCount << " max"
+		<< std::endl;
+	std::cout << "scroll step: "
+		<< (elapsed / scrollSteps / 1000) << " us" << std::endl;
+
+	return 0;
+}
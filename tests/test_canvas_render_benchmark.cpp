@@ -0,0 +1,121 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QMouseEvent>
+
+#include "widgets/canvas_widget.h"
+#include "layout/default_layout.h"
+
+// Frame time benchmark for the canvas renderers. Lays out a thought with
+// parents, children, links and siblings crossing each other, then for every
+// renderer sweeps the cursor over the canvas, so connections get highlighted
+// and unhighlighted, and also repaints the whole canvas. Reports the average
+// time per frame.
+
+static const int sideCount = 30;
+static const int sweepSteps = 400;
+static const int fullFrames = 100;
+
+static void addThoughts(
+	std::unordered_map<ThoughtId, Thought*> *map,
+	std::vector<ThoughtId>& list,
+	ThoughtId& next,
+	const char *name
+) {
+	for (int idx = 0; idx < sideCount; idx++) {
+		ThoughtId id = next++;
+		map->insert({id, new Thought(
+			id, QString("%1 %2").arg(name).arg(idx).toStdString(),
+			true, true, true
+		)});
+		list.push_back(id);
+	}
+}
+
+static qint64 sweep(QApplication& app, CanvasWidget& canvas) {
+	QElapsedTimer timer;
+	timer.start();
+
+	for (int step = 0; step < sweepSteps; step++) {
+		QPointF pos(
+			canvas.width() * step / (qreal)sweepSteps,
+			canvas.height() * (0.2 + 0.6 * ((step * 7) % sweepSteps) / (qreal)sweepSteps)
+		);
+		QMouseEvent event(
+			QEvent::MouseMove, pos, canvas.mapToGlobal(pos),
+			Qt::NoButton, Qt::NoButton, Qt::NoModifier
+		);
+		QApplication::sendEvent(&canvas, &event);
+		app.processEvents();
+	}
+
+	return timer.nsecsElapsed() / sweepSteps;
+}
+
+static qint64 repaint(CanvasWidget& canvas) {
+	QElapsedTimer timer;
+	timer.start();
+
+	for (int frame = 0; frame < fullFrames; frame++)
+		canvas.repaint();
+
+	return timer.nsecsElapsed() / fullFrames;
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+
+	DefaultLayout layout(&style);
+	CanvasWidget canvas(nullptr, &style, &layout);
+	canvas.resize(1400, 1000);
+	canvas.show();
+
+	Thought *central = new Thought(0, "Center", true, true, true);
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	ThoughtId next = 1;
+	addThoughts(map, central->parents(), next, "Parent");
+	addThoughts(map, central->children(), next, "Child");
+	addThoughts(map, central->links(), next, "Link");
+
+	// Siblings under the first parent, and links across the sides.
+	Thought *parent = map->at(central->parents()[0]);
+	addThoughts(map, parent->children(), next, "Sibling");
+	for (int idx = 0; idx < sideCount; idx++) {
+		map->at(central->children()[idx])->links().push_back(
+			central->links()[sideCount - idx - 1]
+		);
+	}
+
+	State state(0, central, map);
+	layout.setState(&state);
+	app.processEvents();
+
+	struct {
+		const char *name;
+		CanvasRenderer renderer;
+	} renderers[] = {
+		{"immediate", CanvasRenderer::Immediate},
+		{"retained", CanvasRenderer::Retained},
+	};
+
+	for (auto& item: renderers) {
+		canvas.setRenderer(item.renderer);
+		assert(canvas.renderer() == item.renderer);
+		app.processEvents();
+
+		qint64 hover = sweep(app, canvas);
+		qint64 full = repaint(canvas);
+
+		std::cout << item.name << ": "
+			<< (hover / 1000) << " us per hover frame, "
+			<< (full / 1000) << " us per full frame"
+			<< std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "widgets/canvas_widget.h"
+#include "widgets/thought_widget.h"
+#include "layout/default_layout.h"
+
+// Switches the central thought back and forth, interrupting transitions
+// midway, and checks that widgets always end up where the layout puts them,
+// also when the layout is made on a worker thread.
+// Reports the longest time the event loop was blocked during transitions.
+
+static State *makeState(ThoughtId root, ThoughtId other) {
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	Thought *central = new Thought(root, QString("Root %1").arg(root).toStdString(), true, true, false);
+	Thought *parent = new Thought(other, QString("Root %1").arg(other).toStdString(), false, true, false);
+	central->parents().push_back(other);
+	parent->children().push_back(root);
+	map->insert({other, parent});
+
+	for (ThoughtId id = 10; id < 40; id++) {
+		Thought *child = new Thought(id, QString("Child %1").arg(id).toStdString(), true);
+		map->insert({id, child});
+		central->children().push_back(id);
+	}
+
+	return new State(root, central, map);
+}
+
+static qint64 run(QApplication& app, int ms) {
+	QElapsedTimer timer, step;
+	qint64 longest = 0;
+
+	timer.start();
+	while (timer.elapsed() < ms) {
+		step.start();
+		app.processEvents();
+		longest = std::max(longest, step.nsecsElapsed());
+		QThread::msleep(1);
+	}
+
+	return longest;
+}
+
+static void checkPlaced(CanvasWidget& canvas, DefaultLayout& layout) {
+	for (auto *widget: canvas.findChildren<ThoughtWidget*>(Qt::FindDirectChildrenOnly)) {
+		auto found = layout.items()->find(widget->id());
+		if (found == layout.items()->end() || widget->isActive())
+			continue;
+
+		const ItemLayout& item = found->second;
+		assert(widget->geometry() == QRect(item.x, item.y, item.w, item.h));
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+
+	DefaultLayout layout(&style);
+	CanvasWidget canvas(nullptr, &style, &layout);
+	canvas.resize(1000, 800);
+	canvas.show();
+	assert(canvas.animated());
+
+	State *first = makeState(1, 2);
+	State *second = makeState(2, 1);
+
+	layout.setState(first);
+	run(app, 50);
+	checkPlaced(canvas, layout);
+
+	// Interrupt every transition halfway through.
+	qint64 longest = 0;
+	for (int idx = 0; idx < 10; idx++) {
+		layout.setState(idx % 2 == 0 ? second : first);
+		longest = std::max(longest, run(app, 100));
+	}
+
+	// Let the last one finish.
+	longest = std::max(longest, run(app, 400));
+	checkPlaced(canvas, layout);
+
+	// Without animation widgets are placed right away.
+	canvas.setAnimated(false);
+	layout.setState(first);
+	checkPlaced(canvas, layout);
+
+	// Selections laid out on the worker thread keep the current arrangement
+	// until the next one is ready, and a newer one replaces an older one.
+	layout.setStateAsync(first);
+	layout.setStateAsync(second);
+	assert(*layout.rootId() == 1);
+	run(app, 400);
+	assert(*layout.rootId() == 2);
+	checkPlaced(canvas, layout);
+
+	std::cout << "longest event loop iteration during transitions: "
+		<< (longest / 1000) << " us" << std::endl;
+
+	return 0;
+}
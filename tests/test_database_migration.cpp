@@ -0,0 +1,87 @@
+#include <cassert>
+
+#include <QDir>
+#include <QApplication>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include <QDebug>
+
+#include "entity/database_brain_repository.h"
+
+// Checks that a brain created before schema versioning gets its schema
+// upgraded when opened, and keeps its data.
+
+static void createLegacyBrain(QDir dir) {
+	dir.mkpath(".");
+
+	{
+		QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "legacy");
+		db.setDatabaseName(dir.filePath("brain.sqlite"));
+		bool result = db.open();
+		assert(result);
+
+		QSqlQuery query = QSqlQuery(db);
+		result = query.exec("CREATE TABLE thoughts (id INTEGER PRIMARY KEY, name TEXT);");
+		assert(result);
+		result = query.exec("CREATE TABLE connections (conn_from INTEGER, conn_to INTEGER, conn_type INTEGER, PRIMARY KEY (conn_from, conn_to));");
+		assert(result);
+		result = query.exec("INSERT INTO thoughts (id, name) VALUES (0, 'Root'), (1, 'Child');");
+		assert(result);
+		result = query.exec("INSERT INTO connections (conn_from, conn_to, conn_type) VALUES (0, 1, 0);");
+		assert(result);
+
+		db.close();
+	}
+
+	QSqlDatabase::removeDatabase("legacy");
+}
+
+static bool hasIndex(QString name) {
+	QSqlQuery query = QSqlQuery(QSqlDatabase::database());
+	query.prepare("SELECT 1 FROM sqlite_master WHERE type == 'index' AND name == :name;");
+	query.bindValue(":name", name);
+	bool result = query.exec();
+	assert(result);
+	return query.first();
+}
+
+static int userVersion() {
+	QSqlQuery query = QSqlQuery("PRAGMA user_version;", QSqlDatabase::database());
+	bool result = query.exec() && query.first();
+	assert(result);
+	return query.value(0).toInt();
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_migration");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	createLegacyBrain(dir);
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+
+	assert(hasIndex("conn_to_type"));
+	assert(hasIndex("conn_from_type"));
+	int version = userVersion();
+	assert(version > 0);
+
+	const State *state = repo->getState();
+	assert(state->centralThought()->name() == "Root");
+	assert(state->centralThought()->children().size() == 1);
+	delete repo;
+
+	// Reopening doesn't run migrations again.
+	repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+	assert(userVersion() == version);
+	delete repo;
+
+	qDebug() << "Migrated to version" << version;
+	dir.removeRecursively();
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include <set>
+#include <map>
+#include <string>
+#include <cassert>
+
+#include <QDir>
+#include <QApplication>
+
+#include <QDebug>
+
+#include "entity/database_brain_repository.h"
+
+// Checks that states patched in place by the repository after each edit are
+// identical to the states loaded from scratch.
+
+struct ThoughtSnapshot {
+	std::string name;
+	bool hasParents, hasChildren, hasLinks;
+	std::set<ThoughtId> parents, children, links;
+
+	bool operator==(const ThoughtSnapshot& other) const {
+		return name == other.name
+			&& hasParents == other.hasParents
+			&& hasChildren == other.hasChildren
+			&& hasLinks == other.hasLinks
+			&& parents == other.parents
+			&& children == other.children
+			&& links == other.links;
+	}
+};
+
+struct StateSnapshot {
+	ThoughtSnapshot center;
+	std::map<ThoughtId, ThoughtSnapshot> thoughts;
+
+	bool operator==(const StateSnapshot& other) const {
+		return center == other.center && thoughts == other.thoughts;
+	}
+};
+
+static ThoughtSnapshot snapshot(const Thought *thought) {
+	return ThoughtSnapshot{
+		.name = thought->name(),
+		.hasParents = thought->hasParents(),
+		.hasChildren = thought->hasChildren(),
+		.hasLinks = thought->hasLinks(),
+		.parents = std::set<ThoughtId>(
+			thought->parents().begin(), thought->parents().end()
+		),
+		.children = std::set<ThoughtId>(
+			thought->children().begin(), thought->children().end()
+		),
+		.links = std::set<ThoughtId>(
+			thought->links().begin(), thought->links().end()
+		),
+	};
+}
+
+static StateSnapshot snapshot(const State *state) {
+	StateSnapshot result;
+	result.center = snapshot(state->centralThought());
+	for (auto& [id, thought]: *state->thoughts())
+		result.thoughts.insert({id, snapshot(thought)});
+	return result;
+}
+
+static void check(
+	DatabaseBrainRepository *repo,
+	const char *step,
+	bool patched,
+	int depth = 1,
+	size_t budget = 0
+) {
+	const StateChange *change = repo->getChange();
+	assert(change->reloaded() != patched);
+
+	StateSnapshot current = snapshot(repo->getState());
+	repo->select(repo->getState()->centralThought()->id(), depth, budget);
+	StateSnapshot loaded = snapshot(repo->getState());
+
+	if (!(current == loaded)) {
+		qDebug() << "State mismatch after" << step;
+		assert(false);
+	}
+
+	qDebug() << "OK:" << step;
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_delta");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+	bool result = false;
+
+	// First parent changes the list of siblings, so the state is reloaded.
+	CreateResult parent1 = repo->createThought(0, ConnectionType::child, true, "Parent 1");
+	assert(parent1.success);
+	check(repo, "first parent", false);
+
+	CreateResult child1 = repo->createThought(0, ConnectionType::child, false, "Child 1");
+	assert(child1.success);
+	check(repo, "child", true);
+
+	CreateResult link1 = repo->createThought(0, ConnectionType::link, false, "Link 1");
+	assert(link1.success);
+	check(repo, "link", true);
+
+	CreateResult sibling1 = repo->createThought(parent1.id, ConnectionType::child, false, "Sibling 1");
+	assert(sibling1.success);
+	check(repo, "sibling", true);
+
+	CreateResult grandchild = repo->createThought(child1.id, ConnectionType::child, false, "Grandchild");
+	assert(grandchild.success);
+	check(repo, "grandchild", true);
+
+	CreateResult siblingLink = repo->createThought(sibling1.id, ConnectionType::link, true, "Sibling link");
+	assert(siblingLink.success);
+	check(repo, "sibling link", true);
+
+	CreateResult parent2 = repo->createThought(0, ConnectionType::child, true, "Parent 2");
+	assert(parent2.success);
+	check(repo, "second parent", true);
+
+	CreateResult childParent = repo->createThought(child1.id, ConnectionType::child, true, "Child parent");
+	assert(childParent.success);
+	check(repo, "parent of child", true);
+
+	result = repo->connectThoughts(child1.id, sibling1.id, ConnectionType::link);
+	assert(result);
+	check(repo, "cross-link", true);
+
+	result = repo->connectThoughts(link1.id, child1.id, ConnectionType::child);
+	assert(result);
+	check(repo, "link to child", true);
+
+	result = repo->connectThoughts(sibling1.id, link1.id, ConnectionType::link);
+	assert(result);
+	check(repo, "sibling to link", true);
+
+	std::string name = "Child renamed";
+	result = repo->updateThought(child1.id, name);
+	assert(result);
+	check(repo, "rename", true);
+
+	result = repo->disconnectThoughts(child1.id, sibling1.id);
+	assert(result);
+	check(repo, "disconnect", true);
+
+	result = repo->deleteThought(grandchild.id);
+	assert(result);
+	check(repo, "delete grandchild", true);
+
+	result = repo->deleteThought(link1.id);
+	assert(result);
+	check(repo, "delete link", true);
+
+	// Connections of the central thought and its parents are reloaded.
+	result = repo->connectThoughts(0, sibling1.id, ConnectionType::link);
+	assert(result);
+	check(repo, "link to sibling", false);
+
+	result = repo->deleteThought(parent2.id);
+	assert(result);
+	check(repo, "delete parent", false);
+
+	// Areas further than the neighborhood are loaded again, and the loaded
+	// state is patched with the difference.
+	result = repo->select(0, 3, 50);
+	assert(result);
+	const State *area = repo->getState();
+
+	CreateResult far = repo->createThought(childParent.id, ConnectionType::child, false, "Far thought");
+	assert(far.success);
+	assert(repo->getState() == area);
+	assert(repo->getState()->thoughts()->count(far.id) > 0);
+	assert(repo->getChange()->added().size() == 1);
+	assert(repo->getChange()->added()[0] == far.id);
+	check(repo, "far thought", true, 3, 50);
+
+	area = repo->getState();
+	result = repo->connectThoughts(far.id, sibling1.id, ConnectionType::link);
+	assert(result);
+	assert(repo->getState() == area);
+	assert(repo->getChange()->added().empty() && repo->getChange()->removed().empty());
+	check(repo, "far link", true, 3, 50);
+
+	area = repo->getState();
+	result = repo->deleteThought(far.id);
+	assert(result);
+	assert(repo->getState() == area);
+	assert(repo->getState()->thoughts()->count(far.id) == 0);
+	check(repo, "delete far thought", true, 3, 50);
+
+	delete repo;
+	dir.removeRecursively();
+	return 0;
+}
@@ -0,0 +1,67 @@
+#include <cassert>
+
+#include <QDir>
+#include <QApplication>
+#include <QEventLoop>
+#include <QTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include <QDebug>
+
+#include "entity/database_brain_repository.h"
+
+// Checks that storage profiles are applied to brain databases, and that the
+// background checkpoint doesn't get in the way of further edits.
+
+static QString pragma(QString name) {
+	QSqlQuery query = QSqlQuery(QSqlDatabase::database());
+	bool result = query.exec(QString("PRAGMA %1;").arg(name)) && query.first();
+	assert(result);
+	return query.value(0).toString().toLower();
+}
+
+static void wait(int msec) {
+	QEventLoop loop;
+	QTimer::singleShot(msec, &loop, &QEventLoop::quit);
+	loop.exec();
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_profile");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	// Default profile.
+	StorageProfile profile = StorageProfile::defaultProfile();
+	profile.checkpointInterval = 50;
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir, profile);
+	assert(repo != nullptr);
+	assert(pragma("journal_mode") == "wal");
+	assert(pragma("synchronous") == "1");
+
+	CreateResult first = repo->createThought(0, ConnectionType::child, false, "First");
+	assert(first.success);
+
+	// Let the checkpoint run, then keep editing.
+	wait(200);
+	CreateResult second = repo->createThought(0, ConnectionType::child, false, "Second");
+	assert(second.success);
+	assert(repo->getState()->centralThought()->children().size() == 2);
+	delete repo;
+
+	// Compatible profile switches the same brain back.
+	repo = DatabaseBrainRepository::fromDir(dir, StorageProfile::compatibleProfile());
+	assert(repo != nullptr);
+	assert(pragma("journal_mode") == "delete");
+	assert(pragma("synchronous") == "2");
+	assert(repo->getState()->centralThought()->children().size() == 2);
+	delete repo;
+
+	qDebug() << "OK";
+	dir.removeRecursively();
+	return 0;
+}
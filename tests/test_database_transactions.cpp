@@ -0,0 +1,132 @@
+#include <cassert>
+#include <iostream>
+
+#include <QDir>
+#include <QFile>
+#include <QApplication>
+#include <QElapsedTimer>
+
+#include <QDebug>
+
+#include "entity/database_brain_repository.h"
+
+// Checks that graph operations grouped in a transaction are saved or dropped
+// together, that text files of thoughts deleted in a transaction are only
+// removed once it's committed, and reports how long a batch of inserts takes with and without
+// the enclosing transaction.
+
+static const size_t batchSize = 200;
+
+static size_t found(DatabaseBrainRepository *repo, std::string term) {
+	SearchResult result = repo->search(term);
+	assert(result.error == SearchErrorNone);
+	return result.items.size();
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_transactions");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+	bool result = false;
+
+	// Rolled back batch leaves nothing behind.
+	result = repo->beginTransaction();
+	assert(result);
+	CreateResult child = repo->createThought(0, ConnectionType::child, false, "Dropped child");
+	assert(child.success);
+	CreateResult link = repo->createThought(child.id, ConnectionType::link, false, "Dropped link");
+	assert(link.success);
+	result = repo->rollbackTransaction();
+	assert(result);
+
+	assert(found(repo, "Dropped") == 0);
+	assert(repo->getState()->centralThought()->children().empty());
+
+	// Rolling back a nested transaction dooms the outer one.
+	result = repo->beginTransaction();
+	assert(result);
+	child = repo->createThought(0, ConnectionType::child, false, "Doomed child");
+	assert(child.success);
+	result = repo->beginTransaction();
+	assert(result);
+	result = repo->rollbackTransaction();
+	assert(result);
+	result = repo->commitTransaction();
+	assert(!result);
+	assert(found(repo, "Doomed") == 0);
+
+	// Deleting a thought in a nested transaction keeps its text file until
+	// the outermost commit.
+	CreateResult noted = repo->createThought(0, ConnectionType::child, false, "Noted");
+	assert(noted.success);
+	assert(repo->saveText(noted.id, "Some text").error == TextRepositoryErrorNone);
+	QString notePath = dir.filePath(QString("documents/Noted_%1.md").arg(noted.id));
+	assert(QFile::exists(notePath));
+
+	result = repo->beginTransaction();
+	assert(result);
+	result = repo->beginTransaction();
+	assert(result);
+	result = repo->deleteThought(noted.id);
+	assert(result);
+	result = repo->commitTransaction();
+	assert(result);
+	assert(QFile::exists(notePath));
+	result = repo->rollbackTransaction();
+	assert(result);
+
+	assert(QFile::exists(notePath));
+	assert(found(repo, "Noted") == 1);
+	GetResult text = repo->getText(noted.id);
+	assert(text.error == TextRepositoryErrorNone && text.result.contains("Some text"));
+
+	result = repo->beginTransaction();
+	assert(result);
+	result = repo->deleteThought(noted.id);
+	assert(result);
+	assert(QFile::exists(notePath));
+	result = repo->commitTransaction();
+	assert(result);
+	assert(!QFile::exists(notePath));
+	assert(found(repo, "Noted") == 0);
+
+	// Committed batch is saved in full.
+	QElapsedTimer timer;
+	timer.start();
+	result = repo->beginTransaction();
+	assert(result);
+	for (size_t idx = 0; idx < batchSize; idx++) {
+		CreateResult res = repo->createThought(0, ConnectionType::child, false, "Batched");
+		assert(res.success);
+	}
+	result = repo->commitTransaction();
+	assert(result);
+	qint64 batched = timer.nsecsElapsed();
+
+	assert(found(repo, "Batched") == batchSize);
+	assert(repo->getState()->centralThought()->children().size() == batchSize);
+
+	// Same inserts, each committed on its own.
+	timer.restart();
+	for (size_t idx = 0; idx < batchSize; idx++) {
+		CreateResult res = repo->createThought(0, ConnectionType::child, false, "Single");
+		assert(res.success);
+	}
+	qint64 single = timer.nsecsElapsed();
+
+	assert(found(repo, "Single") == batchSize);
+
+	std::cout << batchSize << " thoughts in one transaction: "
+		<< (batched / 1000) << " us" << std::endl;
+	std::cout << batchSize << " thoughts in separate transactions: "
+		<< (single / 1000) << " us" << std::endl;
+
+	delete repo;
+	dir.removeRecursively();
+	return 0;
+}
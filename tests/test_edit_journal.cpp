@@ -0,0 +1,127 @@
+#include <cassert>
+#include <iostream>
+
+#include <QString>
+#include <QList>
+#include <QStringList>
+
+#include "model/new_text_model.h"
+#include "model/edit_journal.h"
+
+// Checks undo journal bookkeeping: merging of typed text, undo and redo
+// order, dropping of undone steps, the memory limit, and that line edits
+// within a list don't copy the whole paragraph.
+
+static StaticCursor cursor(int position) {
+	return StaticCursor{.block = 0, .line = 0, .position = position};
+}
+
+static QString undo(QString text, const EditJournal::Step *step) {
+	for (auto edit = step->edits.crbegin(); edit != step->edits.crend(); edit++)
+		text.replace(edit->from, edit->inserted.length(), edit->removed);
+	return text;
+}
+
+static QString redo(QString text, const EditJournal::Step *step) {
+	for (auto& edit: step->edits)
+		text.replace(edit.from, edit.removed.length(), edit.inserted);
+	return text;
+}
+
+int main(int argc, char *argv[]) {
+	EditJournal journal;
+	QString text = "Hello";
+
+	// Typing a word is a single edit.
+	QString typed = " world";
+	for (int idx = 0; idx < typed.length(); idx++) {
+		QString next = text + typed[idx];
+		journal.record(
+			{text::Edit::lineEdit(0, 0, text, next)},
+			cursor(text.length()),
+			cursor(next.length())
+		);
+		text = next;
+	}
+	assert(journal.size() == 1);
+
+	// Erasing typed text is merged into it.
+	QString erased = text.left(text.length() - 2);
+	journal.record(
+		{text::Edit::lineEdit(0, 0, text, erased)},
+		cursor(text.length()),
+		cursor(erased.length())
+	);
+	text = erased;
+	assert(journal.size() == 1);
+
+	// Closed step starts a new one.
+	journal.close();
+	QString replaced = "Help" + text.mid(4);
+	journal.record(
+		{text::Edit::lineEdit(0, 0, text, replaced)},
+		cursor(3),
+		cursor(4)
+	);
+	text = replaced;
+	assert(journal.size() == 2);
+
+	const EditJournal::Step *step = journal.undo();
+	assert(step != nullptr && step->before.position == 3);
+	text = undo(text, step);
+	assert(text == "Hello wor");
+
+	step = journal.undo();
+	assert(step != nullptr && step->edits.size() == 1);
+	text = undo(text, step);
+	assert(text == "Hello");
+	assert(!journal.canUndo() && journal.undo() == nullptr);
+
+	step = journal.redo();
+	assert(step != nullptr);
+	text = redo(text, step);
+	assert(text == "Hello wor");
+
+	// New edits drop undone steps.
+	QString next = text + "!";
+	journal.record({text::Edit::lineEdit(0, 0, text, next)}, cursor(9), cursor(10));
+	assert(!journal.canRedo());
+	assert(journal.size() == 2);
+
+	// Oldest steps are dropped to fit the limit.
+	EditJournal limited(16 * 1024);
+	QString line = "";
+	for (int idx = 0; idx < 1000; idx++) {
+		QString changed = line + QString("Step %1. ").arg(idx);
+		limited.record({text::Edit::lineEdit(0, 0, line, changed)}, cursor(0), cursor(0));
+		limited.close();
+		line = changed;
+	}
+	assert(limited.memoryUsage() <= 16 * 1024);
+	assert(limited.size() < 1000 && limited.size() > 0);
+	assert(limited.canUndo() && !limited.canRedo());
+
+	// Adding a line or changing its level keeps only that line.
+	QStringList items;
+	for (int idx = 0; idx < 1000; idx++)
+		items.push_back(QString("- item %1").arg(idx));
+	text::TextModel model(items);
+	text::Paragraph list = (*model.paragraphs())[0];
+	assert(list.getType() == text::BulletList && list.getLines()->size() == 1000);
+
+	QString item = "new item";
+	text::Edit added = text::Edit::linesEdit(0, 1, {}, {text::Line(item, false)});
+	text::Edit snapshot = text::Edit::paragraphEdit(0, {list}, {list});
+	assert(!added.isEmpty());
+	assert(added.memoryUsage() * 100 < snapshot.memoryUsage());
+
+	text::Edit level = text::Edit::levelEdit(0, 1, 0, 1);
+	assert(!level.isEmpty() && level.memoryUsage() == sizeof(text::Edit));
+	assert(text::Edit::levelEdit(0, 1, 1, 1).isEmpty());
+	assert(!added.merge(level));
+
+	std::cout << "journal of " << limited.size() << " steps takes "
+		<< limited.memoryUsage() << " bytes" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QRect>
+
+#include "layout/force_layout.h"
+#include "layout/force_solver.h"
+#include "model/state_change.h"
+
+// Lays out a few hundred loaded thoughts with ForceLayout, checks that all of
+// them are inside the canvas with their connections and that they don't
+// overlap when there's room, then selects a neighbor and checks that the warm
+// start keeps thoughts close to where they were. Patches of the state only
+// move the thoughts they touch. Also reports the time of solver iterations
+// for thousands of nodes.
+
+static const int childCount = 40;
+static const int grandchildCount = 5;
+
+// Tree around `root`: a parent with siblings, children with their own
+// children, and links between consecutive children. Every thought knows its
+// connections, the way a state loaded deep enough would.
+static State *makeState(ThoughtId root) {
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+	std::unordered_map<ThoughtId, Thought*> all;
+
+	auto add = [&all](ThoughtId id, QString name) {
+		Thought *thought = new Thought(id, name.toStdString(), true, true, true);
+		all.insert({id, thought});
+		return thought;
+	};
+	auto connect = [&all](ThoughtId from, ThoughtId to) {
+		all[from]->children().push_back(to);
+		all[to]->parents().push_back(from);
+	};
+
+	add(0, "Root");
+	add(1, "Parent");
+	connect(1, 0);
+
+	ThoughtId next = 2;
+	for (int idx = 0; idx < childCount; idx++) {
+		ThoughtId child = next++;
+		add(child, QString("Child %1").arg(idx));
+		connect(0, child);
+
+		if (idx > 0) {
+			all[child - grandchildCount - 1]->links().push_back(child);
+			all[child]->links().push_back(child - grandchildCount - 1);
+		}
+
+		for (int sub = 0; sub < grandchildCount; sub++) {
+			ThoughtId grandchild = next++;
+			add(grandchild, QString("Grandchild %1").arg(grandchild));
+			connect(child, grandchild);
+		}
+	}
+
+	Thought *central = all[root];
+	all.erase(root);
+	map->insert(all.begin(), all.end());
+
+	return new State(0, central, map);
+}
+
+static QPointF centerOf(const ItemLayout& item) {
+	return QPointF(item.x + item.w / 2.0, item.y + item.h / 2.0);
+}
+
+static void checkLayout(ForceLayout& layout, const State *state, QSize size) {
+	const std::unordered_map<ThoughtId, ItemLayout> *items = layout.items();
+	assert(items->size() == state->thoughts()->size() + 1);
+
+	for (auto& [id, item]: *items) {
+		QPointF pos = centerOf(item);
+		assert(pos.x() >= 0 && pos.x() <= size.width());
+		assert(pos.y() >= 0 && pos.y() <= size.height());
+	}
+
+	// Central thought is in the middle.
+	QPointF center = centerOf(items->at(state->centralThought()->id()));
+	assert(std::abs(center.x() - size.width() / 2.0) <= 1);
+	assert(std::abs(center.y() - size.height() / 2.0) <= 1);
+
+	// Every connection is between placed thoughts, and only the ones of the
+	// central thought are main connections.
+	ThoughtId mainId = state->centralThought()->id();
+	for (auto& conn: *layout.connections()) {
+		assert(conn.from == mainId || conn.to == mainId);
+		assert(items->count(conn.from) > 0 && items->count(conn.to) > 0);
+	}
+	for (auto& conn: *layout.subconnections()) {
+		assert(conn.from != mainId && conn.to != mainId);
+		assert(items->count(conn.from) > 0 && items->count(conn.to) > 0);
+	}
+	assert(layout.scrollAreas()->empty());
+}
+
+static void checkOverlaps(const std::unordered_map<ThoughtId, ItemLayout>& items) {
+	std::vector<QRect> rects;
+	for (auto& [id, item]: items)
+		rects.push_back(QRect(item.x, item.y, item.w, item.h));
+
+	for (size_t idx = 0; idx < rects.size(); idx++) {
+		for (size_t other = idx + 1; other < rects.size(); other++)
+			assert(!rects[idx].intersects(rects[other]));
+	}
+}
+
+static qreal averageShift(
+	const std::unordered_map<ThoughtId, ItemLayout>& before,
+	const std::unordered_map<ThoughtId, ItemLayout>& after,
+	ThoughtId oldRoot,
+	ThoughtId newRoot
+) {
+	// Compare placements relative to the central thought, since the whole
+	// graph is moved to put the new one in the middle.
+	QPointF oldCenter = centerOf(before.at(newRoot)), newCenter = centerOf(after.at(newRoot));
+	qreal total = 0;
+	int count = 0;
+
+	for (auto& [id, item]: before) {
+		if (id == oldRoot || id == newRoot)
+			continue;
+		QPointF delta = (centerOf(after.at(id)) - newCenter) - (centerOf(item) - oldCenter);
+		total += std::sqrt(QPointF::dotProduct(delta, delta));
+		count++;
+	}
+
+	return total / count;
+}
+
+// Only the given thoughts moved, and every item that differs is reported.
+static void checkPatch(
+	ForceLayout& layout,
+	const std::unordered_map<ThoughtId, ItemLayout>& before,
+	std::initializer_list<ThoughtId> touched
+) {
+	const std::unordered_map<ThoughtId, ItemLayout> *items = layout.items();
+	const std::unordered_set<ThoughtId> *changed = layout.changedItems();
+	assert(changed != nullptr);
+
+	for (auto& [id, item]: before) {
+		auto found = items->find(id);
+		bool same = found != items->end() && found->second == item;
+		if (std::find(touched.begin(), touched.end(), id) == touched.end())
+			assert(same);
+		if (!same)
+			assert(changed->count(id) > 0);
+	}
+	for (auto& [id, item]: *items) {
+		if (before.find(id) == before.end())
+			assert(changed->count(id) > 0);
+	}
+}
+
+static void benchmarkSolver() {
+	int sizes[] = {500, 2000, 5000};
+	qreal idealLength = 60;
+
+	for (int size: sizes) {
+		// Same density for every size.
+		qreal side = std::sqrt((qreal)size) * idealLength * 1.5;
+		QRectF bounds(0, 0, side, side);
+
+		ForceSolver solver;
+		for (int idx = 0; idx < size; idx++) {
+			// Deterministic scatter.
+			qreal x = std::fmod(idx * 7919.0, side), y = std::fmod(idx * 104723.0 / 7, side);
+			solver.addNode(QPointF(x, y), idx == 0);
+			if (idx > 0)
+				solver.addEdge(idx, (idx * 31) % idx);
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		solver.solve(bounds, idealLength, 100, side / 4);
+		qint64 elapsed = timer.nsecsElapsed();
+
+		for (int idx = 0; idx < size; idx++)
+			assert(bounds.contains(solver.position(idx)));
+
+		std::cout << size << " nodes: "
+			<< (elapsed / 100 / 1000) << " us per iteration" << std::endl;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+	QSize size(1400, 1000);
+
+	State *state = makeState(0);
+	ForceLayout layout(&style);
+	layout.setSize(size);
+
+	QElapsedTimer timer;
+	timer.start();
+	layout.setState(state);
+	qint64 cold = timer.nsecsElapsed();
+	checkLayout(layout, state, size);
+	assert(layout.connections()->size() == childCount + 1);
+
+	std::unordered_map<ThoughtId, ItemLayout> before = *layout.items();
+
+	// With enough room, widgets don't overlap.
+	QSize roomy(3200, 2400);
+	ForceLayout spacious(&style);
+	spacious.setSize(roomy);
+	spacious.setState(state);
+	checkLayout(spacious, state, roomy);
+	checkOverlaps(*spacious.items());
+
+	// Select the first child. All thoughts are known, so only a few
+	// iterations run, and the graph keeps its shape.
+	State *next = makeState(2);
+	timer.restart();
+	layout.setState(next);
+	qint64 warm = timer.nsecsElapsed();
+	checkLayout(layout, next, size);
+
+	// Laying out the same state from scratch moves thoughts much more.
+	ForceLayout fresh(&style);
+	fresh.setSize(size);
+	fresh.setState(next);
+	qreal shift = averageShift(before, *layout.items(), 0, 2);
+	qreal coldShift = averageShift(before, *fresh.items(), 0, 2);
+	assert(shift < coldShift);
+
+	// Placement is the same for the same input.
+	ForceLayout other(&style);
+	other.setSize(size);
+	other.setState(state);
+	for (auto& [id, item]: before)
+		assert(other.items()->at(id) == item);
+
+	// Renamed thought is the only one placed again.
+	before = *layout.items();
+	next->thoughts()->at(3)->name() = "Renamed grandchild";
+	StateChange renamed(false);
+	renamed.update(3);
+	layout.applyChange(renamed);
+	checkLayout(layout, next, size);
+	checkPatch(layout, before, {3});
+
+	// New thought is placed next to its parent, the rest stays.
+	before = *layout.items();
+	ThoughtId addedId = 1000;
+	Thought *added = new Thought(addedId, "New grandchild", true, false, false);
+	added->parents().push_back(4);
+	next->thoughts()->at(4)->children().push_back(addedId);
+	next->thoughts()->insert({addedId, added});
+	StateChange inserted(false);
+	inserted.add(addedId);
+	inserted.update(4);
+	layout.applyChange(inserted);
+	checkLayout(layout, next, size);
+	checkPatch(layout, before, {addedId, 4});
+	assert(layout.changedItems()->count(addedId) > 0);
+
+	// Removed thought goes away with its connection.
+	before = *layout.items();
+	auto& siblings = next->thoughts()->at(4)->children();
+	siblings.erase(std::find(siblings.begin(), siblings.end(), addedId));
+	delete next->thoughts()->at(addedId);
+	next->thoughts()->erase(addedId);
+	StateChange removed(false);
+	removed.remove(addedId);
+	removed.update(4);
+	layout.applyChange(removed);
+	checkLayout(layout, next, size);
+	checkPatch(layout, before, {4});
+	assert(layout.items()->count(addedId) == 0);
+	assert(layout.changedItems()->count(addedId) > 0);
+
+	// Patch compared to laying out the whole graph again.
+	timer.restart();
+	for (int step = 0; step < 100; step++) {
+		next->thoughts()->at(3)->name() = QString("Renamed grandchild %1").arg(step).toStdString();
+		layout.applyChange(renamed);
+	}
+	qint64 patch = timer.nsecsElapsed() / 100;
+
+	timer.restart();
+	for (int step = 0; step < 100; step++)
+		layout.setState(next);
+	qint64 relayout = timer.nsecsElapsed() / 100;
+
+	// Cap drops the farthest thoughts.
+	layout.setMaxItems(50);
+	assert(layout.items()->size() == 50);
+	assert(layout.items()->count(2) > 0 && layout.items()->count(0) > 0);
+
+	std::cout << "cold layout: " << (cold / 1000) << " us, "
+		<< "warm layout: " << (warm / 1000) << " us, "
+		<< "average shift: " << shift << " px "
+		<< "(" << coldShift << " px from scratch)" << std::endl;
+	std::cout << "patch: " << (patch / 1000) << " us, "
+		<< "warm relayout: " << (relayout / 1000) << " us" << std::endl;
+
+	benchmarkSolver();
+
+	delete state;
+	delete next;
+	return 0;
+}
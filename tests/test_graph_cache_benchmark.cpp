@@ -0,0 +1,135 @@
+#include <map>
+#include <random>
+#include <chrono>
+#include <cassert>
+#include <iostream>
+
+#include <QDir>
+#include <QApplication>
+
+#include "entity/graph_cache.h"
+#include "entity/database_brain_repository.h"
+
+// Checks that states built from the graph cache match the ones loaded from
+// the database, then reports memory footprint and neighborhood build time of
+// the cache for brains of 10k, 100k and 1M thoughts.
+
+struct Counts {
+	size_t parents, children, links, thoughts;
+
+	bool operator==(const Counts& other) const {
+		return parents == other.parents
+			&& children == other.children
+			&& links == other.links
+			&& thoughts == other.thoughts;
+	}
+};
+
+static Counts counts(DatabaseBrainRepository *repo, ThoughtId id) {
+	bool result = repo->select(id);
+	assert(result);
+	const State *state = repo->getState();
+	return Counts{
+		.parents = state->centralThought()->parents().size(),
+		.children = state->centralThought()->children().size(),
+		.links = state->centralThought()->links().size(),
+		.thoughts = state->thoughts()->size(),
+	};
+}
+
+static void checkConsistency() {
+	QDir dir = QDir("test_brain_cache");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	StorageProfile profile = StorageProfile::defaultProfile();
+	profile.graphCache = true;
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir, profile);
+	assert(repo != nullptr);
+
+	std::vector<ThoughtId> ids = {0};
+	std::mt19937 rng(1);
+	for (int idx = 0; idx < 100; idx++) {
+		ThoughtId from = ids[rng() % ids.size()];
+		CreateResult res = repo->createThought(
+			from, ConnectionType(rng() % 2), rng() % 4 == 0, "Thought"
+		);
+		assert(res.success);
+		ids.push_back(res.id);
+	}
+
+	for (int idx = 0; idx < 50; idx++) {
+		ThoughtId from = ids[rng() % ids.size()], to = ids[rng() % ids.size()];
+		repo->connectThoughts(from, to, ConnectionType(rng() % 2));
+	}
+
+	for (int idx = 0; idx < 10; idx++) {
+		size_t pos = 1 + rng() % (ids.size() - 1);
+		bool result = repo->deleteThought(ids[pos]);
+		assert(result);
+		ids.erase(ids.begin() + pos);
+	}
+
+	std::map<ThoughtId, Counts> cached;
+	for (auto id: ids)
+		cached.insert({id, counts(repo, id)});
+	delete repo;
+
+	repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+	for (auto id: ids)
+		assert(counts(repo, id) == cached.at(id));
+	delete repo;
+
+	dir.removeRecursively();
+}
+
+static void measure(size_t size) {
+	std::mt19937 rng(1);
+	std::vector<ThoughtEntity> thoughts;
+	std::vector<ConnectionEntity> connections;
+	thoughts.reserve(size);
+
+	// Tree with a link for every third thought.
+	for (size_t idx = 0; idx < size; idx++) {
+		thoughts.push_back(ThoughtEntity(idx, "Thought " + std::to_string(idx)));
+		if (idx == 0)
+			continue;
+
+		connections.push_back(ConnectionEntity(rng() % idx, idx, ConnectionType::child));
+		if (idx % 3 == 0)
+			connections.push_back(ConnectionEntity(rng() % idx, idx, ConnectionType::link));
+	}
+
+	GraphCache cache;
+	cache.build(thoughts, connections);
+
+	const int iterations = 1000;
+	auto start = std::chrono::steady_clock::now();
+	for (int idx = 0; idx < iterations; idx++) {
+		NeighborhoodEntity hood(rng() % size);
+		bool result = cache.loadNeighborhood(hood.rootId(), &hood);
+		assert(result);
+	}
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start
+	).count();
+
+	std::cout << size << " thoughts, " << connections.size() << " connections: "
+		<< (cache.memoryUsage() / 1024) << " KiB, "
+		<< (elapsed / iterations / 1000.0) << " us per neighborhood"
+		<< std::endl;
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+
+	checkConsistency();
+
+	for (size_t size: {10000, 100000, 1000000})
+		measure(size);
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+#include <cassert>
+#include <iostream>
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QElapsedTimer>
+
+#include "model/new_text_model.h"
+
+// Checks folding of inline markup: folded text, format ranges in both
+// representations, and mapping of folded positions back to the unfolded
+// text. Then reports time spent on parsing lines of a large note.
+
+static const int benchmarkLines = 20000;
+
+static bool hasFormat(
+	const QList<text::FormatRange>& formats,
+	int from,
+	int to,
+	text::BlockFormat format
+) {
+	for (auto& range: formats) {
+		if (range.from == from && range.to == to && range.format == format)
+			return true;
+	}
+	return false;
+}
+
+static text::Line parse(QString input) {
+	return text::Line(input, false);
+}
+
+// Same mapping the editor uses to place the cursor in unfolded text.
+static int unfold(const text::Line& line, int pos) {
+	int offset = 0;
+	for (auto& range: line.foldedFormats) {
+		if (range.to <= pos)
+			offset += range.endOffset();
+		if (range.from < pos)
+			offset += range.startOffset();
+	}
+	return pos + offset;
+}
+
+int main(int argc, char *argv[]) {
+	// Plain text.
+	text::Line line = parse("plain text");
+	assert(line.folded == "plain text");
+	assert(line.formats.isEmpty() && line.foldedFormats.isEmpty());
+
+	// Preformatted text is left as is.
+	QString code = "**not bold**";
+	line = text::Line(code, true);
+	assert(line.folded == code && line.formats.isEmpty());
+
+	// Emphasis.
+	line = parse("*it* and **bold** and ***both***");
+	assert(line.folded == "it and bold and both");
+	assert(hasFormat(line.formats, 0, 4, text::Italic));
+	assert(hasFormat(line.formats, 9, 17, text::Bold));
+	assert(hasFormat(line.formats, 22, 32, text::BoldItalic));
+	assert(hasFormat(line.foldedFormats, 0, 2, text::Italic));
+	assert(hasFormat(line.foldedFormats, 7, 11, text::Bold));
+	assert(hasFormat(line.foldedFormats, 16, 20, text::BoldItalic));
+
+	// Nested emphasis.
+	line = parse("**a *b* c**");
+	assert(line.folded == "a b c");
+	assert(hasFormat(line.foldedFormats, 0, 5, text::Bold));
+	assert(hasFormat(line.foldedFormats, 2, 3, text::Italic));
+
+	// Unmatched markers stay in the text.
+	line = parse("**open *it*");
+	assert(line.folded == "**open it");
+	assert(line.foldedFormats.size() == 1);
+
+	line = parse("a****b");
+	assert(line.folded == "a****b" && line.foldedFormats.isEmpty());
+
+	// Escaping.
+	line = parse("\\*not\\* *yes*");
+	assert(line.folded == "*not* yes");
+	assert(hasFormat(line.formats, 0, 2, text::Escape));
+	assert(hasFormat(line.foldedFormats, 6, 9, text::Italic));
+
+	// Code span content is not parsed.
+	line = parse("`code *x*` after");
+	assert(line.folded == "code *x* after");
+	assert(line.foldedFormats.size() == 1);
+	assert(hasFormat(line.foldedFormats, 0, 8, text::CodeSpan));
+
+	// Headings.
+	line = parse("## Head **b**");
+	assert(line.folded == "Head b");
+	assert(hasFormat(line.formats, 0, 13, text::Heading2));
+	assert(hasFormat(line.foldedFormats, 0, 6, text::Heading2));
+	assert(hasFormat(line.foldedFormats, 5, 6, text::Bold));
+
+	// Links.
+	line = parse("[title](http://x.com) and [**n**](node://12)");
+	assert(line.folded == "title and n");
+	assert(hasFormat(line.formats, 8, 20, text::Link));
+	assert(hasFormat(line.foldedFormats, 0, 5, text::Link));
+	assert(hasFormat(line.foldedFormats, 10, 11, text::NodeLink));
+	assert(hasFormat(line.foldedFormats, 10, 11, text::Bold));
+	assert(line.foldedFormats[0].link.target == "http://x.com");
+
+	// Targets without a scheme are not links.
+	line = parse("[a](b) [c](d) [e](f://g)");
+	assert(line.folded == "[a](b) [c](d) e");
+	assert(line.foldedFormats.size() == 1);
+
+	line = parse("see http://example.com/a_b, ok");
+	assert(line.folded == line.text);
+	assert(hasFormat(line.foldedFormats, 4, 26, text::PlainLink));
+	assert(line.foldedFormats[0].link.target == "http://example.com/a_b");
+
+	// Checkboxes.
+	line = parse("[ ] task [x] done");
+	assert(line.folded == QString(QChar(0xf0c8)) + " task " + QChar(0xf14a) + " done");
+	assert(hasFormat(line.formats, 1, 2, text::Highlight));
+	assert(hasFormat(line.foldedFormats, 7, 8, text::Checkbox));
+
+	// Every visible character maps back to the same unfolded character.
+	QStringList mapped = {
+		"*it* and **bold** and ***both***",
+		"**a *b* c** \\* `code` end",
+		"# [**b** t](https://a.b/c) and *i*",
+	};
+	for (auto& input: mapped) {
+		line = parse(input);
+		for (int pos = 1; pos <= line.folded.size(); pos++) {
+			int unfolded = unfold(line, pos);
+			QChar ch = line.text[unfolded - 1];
+			assert(ch == line.folded[pos - 1] || ch == '*' || ch == '`' || ch == ')');
+		}
+	}
+
+	// Benchmark.
+	QStringList note;
+	for (int idx = 0; idx < benchmarkLines; idx++) {
+		note.push_back(QString(
+			"Line %1 with **bold**, *italic*, `code`, [a link](http://x.com/%1) "
+			"and a plain one http://example.com/%1 - [x] done"
+		).arg(idx));
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	int folded = 0;
+	for (auto& input: note) {
+		text::Line parsed = text::Line(input, false);
+		folded += parsed.folded.size();
+	}
+	qint64 elapsed = timer.nsecsElapsed();
+	assert(folded > 0);
+
+	std::cout << "note of " << benchmarkLines << " lines: "
+		<< (elapsed / benchmarkLines) << " ns per line" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "layout/default_layout.h"
+#include "model/state_change.h"
+
+// Checks that DefaultLayout made on its worker thread matches one made on
+// the calling thread, that the previous arrangement is kept until the new
+// one arrives, and that resizes and patches made in the meantime win over
+// the pending layout. Reports how long the calling thread is blocked.
+
+static const int childCount = 4000;
+
+static State *makeState(ThoughtId root) {
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	Thought *central = new Thought(root, QString("Root %1").arg(root).toStdString(), true, true, true);
+	Thought *parent = new Thought(1, "Parent", false, true, false);
+	central->parents().push_back(1);
+	parent->children().push_back(root);
+	map->insert({1, parent});
+
+	for (ThoughtId id = 10; id < 10 + childCount; id++) {
+		Thought *child = new Thought(
+			id, QString("Child %1 of %2").arg(id).arg(root).toStdString(), true
+		);
+		map->insert({id, child});
+		central->children().push_back(id);
+		if (id % 3 == 0)
+			parent->children().push_back(id);
+	}
+
+	return new State(root, central, map);
+}
+
+static bool wait(QApplication& app, int& updates, int count, int ms) {
+	QElapsedTimer timer;
+	timer.start();
+	while (updates < count && timer.elapsed() < ms) {
+		app.processEvents();
+		QThread::msleep(1);
+	}
+	return updates >= count;
+}
+
+static void compare(DefaultLayout& layout, const State *state, QSize size) {
+	DefaultLayout reference(&Style::defaultStyle());
+	reference.setState(state);
+	reference.setSize(size);
+
+	assert(*layout.rootId() == *reference.rootId());
+	assert(layout.items()->size() == reference.items()->size());
+	for (auto& [id, item]: *reference.items()) {
+		auto found = layout.items()->find(id);
+		assert(found != layout.items()->end() && found->second == item);
+	}
+	assert(layout.scrollAreas()->size() == reference.scrollAreas()->size());
+	assert(layout.connections()->size() == reference.connections()->size());
+	assert(layout.subconnections()->size() == reference.subconnections()->size());
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+	QSize size(1400, 1000);
+
+	State *first = makeState(2);
+	State *second = makeState(3);
+
+	DefaultLayout layout(&style);
+	int updates = 0;
+	layout.onUpdated = [&updates]() { updates++; };
+	layout.setSize(size);
+	layout.setState(first);
+	updates = 0;
+
+	// Previous arrangement stays until the new one arrives.
+	QElapsedTimer timer;
+	timer.start();
+	layout.setStateAsync(second);
+	qint64 asyncTime = timer.nsecsElapsed();
+	assert(*layout.rootId() == 2);
+	assert(updates == 0);
+
+	assert(wait(app, updates, 1, 5000));
+	assert(updates == 1);
+	compare(layout, second, size);
+
+	// Resize while a layout is pending makes it at once, and the pending one
+	// is dropped.
+	layout.setStateAsync(first);
+	QSize smaller(1000, 800);
+	layout.setSize(smaller);
+	assert(*layout.rootId() == 2);
+	compare(layout, first, smaller);
+	updates = 0;
+	wait(app, updates, 1, 500);
+	assert(updates == 0);
+
+	// Patched state wins over a pending layout as well.
+	layout.setStateAsync(second);
+	second->thoughts()->at(10)->name() = "Renamed child";
+	StateChange renamed(false);
+	renamed.update(10);
+	layout.applyChange(renamed);
+	compare(layout, second, smaller);
+	updates = 0;
+	wait(app, updates, 1, 500);
+	assert(updates == 0);
+
+	// Benchmark.
+	timer.restart();
+	layout.setState(first);
+	qint64 syncTime = timer.nsecsElapsed();
+
+	std::cout << childCount << " children: "
+		<< (asyncTime / 1000) << " us blocked by a layout on the worker, "
+		<< (syncTime / 1000) << " us by a layout in place" << std::endl;
+
+	delete first;
+	delete second;
+
+	return 0;
+}
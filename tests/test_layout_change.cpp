@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <tuple>
+
+#include <QApplication>
+#include <QElapsedTimer>
+
+#include "layout/default_layout.h"
+#include "model/state_change.h"
+
+// Checks that DefaultLayout patched with changes of the state gives the same
+// layout as one made from scratch, that every item that differs is reported
+// as changed, and reports the time of a patch compared to a full relayout.
+
+static const int childCount = 400;
+static const int linkCount = 20;
+
+static bool lessConnection(const ItemConnection& a, const ItemConnection& b) {
+	return std::tie(a.from, a.to, a.type) < std::tie(b.from, b.to, b.type);
+}
+
+static bool sameConnections(
+	std::vector<ItemConnection> a,
+	std::vector<ItemConnection> b
+) {
+	if (a.size() != b.size())
+		return false;
+
+	std::sort(a.begin(), a.end(), lessConnection);
+	std::sort(b.begin(), b.end(), lessConnection);
+	for (size_t idx = 0; idx < a.size(); idx++) {
+		if (lessConnection(a[idx], b[idx]) || lessConnection(b[idx], a[idx]))
+			return false;
+	}
+
+	return true;
+}
+
+static void compare(
+	DefaultLayout& layout,
+	const std::unordered_map<ThoughtId, ItemLayout>& before,
+	const State *state,
+	Style *style,
+	QSize size
+) {
+	DefaultLayout reference(style);
+	reference.setState(state);
+	reference.setSize(size);
+
+	// Same items as after a full relayout.
+	const std::unordered_map<ThoughtId, ItemLayout> *items = layout.items();
+	assert(items->size() == reference.items()->size());
+	for (auto& [id, item]: *reference.items()) {
+		auto found = items->find(id);
+		assert(found != items->end() && found->second == item);
+	}
+	assert(layout.scrollAreas()->size() == reference.scrollAreas()->size());
+	assert(sameConnections(*layout.connections(), *reference.connections()));
+	assert(sameConnections(*layout.subconnections(), *reference.subconnections()));
+
+	// Every item that differs is reported.
+	const std::unordered_set<ThoughtId> *changed = layout.changedItems();
+	assert(changed != nullptr);
+	for (auto& [id, item]: before) {
+		auto found = items->find(id);
+		if (found == items->end() || !(found->second == item))
+			assert(changed->count(id) > 0);
+	}
+	for (auto& [id, item]: *items) {
+		if (before.find(id) == before.end())
+			assert(changed->count(id) > 0);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+	QSize size(1400, 1000);
+
+	Thought *central = new Thought(0, "Center", true, true, true);
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	Thought *parent = new Thought(1, "Parent", false, true, false);
+	parent->children().push_back(0);
+	central->parents().push_back(1);
+	map->insert({1, parent});
+
+	ThoughtId next = 10;
+	for (int idx = 0; idx < childCount; idx++, next++) {
+		map->insert({next, new Thought(
+			next, QString("Child %1").arg(idx, 4, 10, QChar('0')).toStdString(),
+			true, false, false
+		)});
+		central->children().push_back(next);
+	}
+	for (int idx = 0; idx < linkCount; idx++, next++) {
+		map->insert({next, new Thought(
+			next, QString("Link %1").arg(idx).toStdString(), false, false, true
+		)});
+		central->links().push_back(next);
+	}
+
+	State state(0, central, map);
+	DefaultLayout layout(&style);
+	layout.setState(&state);
+	layout.setSize(size);
+
+	// Renaming the first link keeps other sides in place.
+	std::unordered_map<ThoughtId, ItemLayout> before = *layout.items();
+	ThoughtId linkId = 10 + childCount;
+	map->at(linkId)->name() = "Renamed link";
+	StateChange renamed(false);
+	renamed.update(linkId);
+	layout.applyChange(renamed);
+	compare(layout, before, &state, &style, size);
+	for (auto id: *layout.changedItems())
+		assert(id >= linkId);
+
+	// New child.
+	before = *layout.items();
+	ThoughtId addedId = next++;
+	map->insert({addedId, new Thought(addedId, "Child 0000a", true, false, false)});
+	central->children().push_back(addedId);
+	StateChange added(false);
+	added.add(addedId);
+	added.update(0);
+	layout.applyChange(added);
+	compare(layout, before, &state, &style, size);
+	assert(layout.changedItems()->count(addedId) > 0);
+
+	// Removed child.
+	before = *layout.items();
+	ThoughtId removedId = 10;
+	auto& children = central->children();
+	children.erase(std::find(children.begin(), children.end(), removedId));
+	delete map->at(removedId);
+	map->erase(removedId);
+	StateChange removed(false);
+	removed.remove(removedId);
+	removed.update(0);
+	layout.applyChange(removed);
+	compare(layout, before, &state, &style, size);
+	assert(layout.changedItems()->count(removedId) > 0);
+
+	// Link between two children is reported for both of its ends.
+	before = *layout.items();
+	map->at(11)->links().push_back(12);
+	map->at(12)->links().push_back(11);
+	map->at(11)->hasLinks() = true;
+	map->at(12)->hasLinks() = true;
+	StateChange connected(false);
+	connected.update(11);
+	connected.update(12);
+	layout.applyChange(connected);
+	compare(layout, before, &state, &style, size);
+	assert(layout.changedItems()->count(11) > 0);
+	assert(layout.changedItems()->count(12) > 0);
+
+	// Benchmark.
+	QElapsedTimer timer;
+	timer.start();
+	for (int step = 0; step < 100; step++) {
+		map->at(linkId)->name() = QString("Renamed link %1").arg(step).toStdString();
+		layout.applyChange(renamed);
+	}
+	qint64 patchTime = timer.nsecsElapsed();
+
+	timer.restart();
+	for (int step = 0; step < 100; step++)
+		layout.setState(&state);
+	qint64 reloadTime = timer.nsecsElapsed();
+
+	std::cout << (patchTime / 100 / 1000) << " us per rename, "
+		<< (reloadTime / 100 / 1000) << " us per full relayout" << std::endl;
+
+	return 0;
+}
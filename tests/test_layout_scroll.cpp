@@ -0,0 +1,104 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+
+#include "layout/default_layout.h"
+
+// Checks that scrolling one side of DefaultLayout gives the same layout as a
+// full reload, that only the items of that side are reported as changed, and
+// reports the time of a scroll step compared to a full reload.
+
+static const int sideCount = 400;
+static const int steps = 200;
+
+static void addThoughts(
+	std::unordered_map<ThoughtId, Thought*> *map,
+	std::vector<ThoughtId>& list,
+	ThoughtId& next,
+	const char *name
+) {
+	for (int idx = 0; idx < sideCount; idx++) {
+		ThoughtId id = next++;
+		map->insert({id, new Thought(
+			id, QString("%1 %2").arg(name).arg(idx).toStdString()
+		)});
+		list.push_back(id);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+
+	Thought *central = new Thought(0, "Center", true, true, true);
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+
+	ThoughtId next = 1;
+	addThoughts(map, central->parents(), next, "Parent");
+	addThoughts(map, central->children(), next, "Child");
+	addThoughts(map, central->links(), next, "Link");
+
+	State state(0, central, map);
+	DefaultLayout layout(&style);
+	layout.setState(&state);
+	layout.setSize(QSize(1400, 1000));
+	assert(layout.changedItems() == nullptr);
+
+	DefaultLayout reference(&style);
+	reference.setState(&state);
+	reference.setSize(QSize(1400, 1000));
+
+	assert(layout.scrollAreas()->size() == 3);
+
+	for (auto& [scrollId, area]: *layout.scrollAreas()) {
+		std::unordered_map<ThoughtId, ItemLayout> before = *layout.items();
+
+		layout.onScroll(scrollId, 1);
+		reference.onScroll(scrollId, 1);
+		reference.reload();
+
+		// Same items as after a full reload.
+		const std::unordered_map<ThoughtId, ItemLayout> *items = layout.items();
+		assert(items->size() == reference.items()->size());
+		for (auto& [id, item]: *reference.items()) {
+			auto found = items->find(id);
+			assert(found != items->end() && found->second == item);
+		}
+
+		// Exactly the items that differ are reported.
+		const std::unordered_set<ThoughtId> *changed = layout.changedItems();
+		assert(changed != nullptr && changed->size() > 0);
+		for (auto& [id, item]: before) {
+			auto found = items->find(id);
+			bool differs = found == items->end() || !(found->second == item);
+			assert(differs == (changed->count(id) > 0));
+		}
+		for (auto& [id, item]: *items) {
+			if (before.find(id) == before.end())
+				assert(changed->count(id) > 0);
+		}
+	}
+
+	// Benchmark.
+	unsigned int scrollId = layout.scrollAreas()->begin()->first;
+	QElapsedTimer timer;
+
+	timer.start();
+	for (int step = 0; step < steps; step++)
+		layout.onScroll(scrollId, (step / 20) % 2 == 0 ? 1 : -1);
+	qint64 scrollTime = timer.nsecsElapsed();
+
+	timer.restart();
+	for (int step = 0; step < steps; step++)
+		layout.reload();
+	qint64 reloadTime = timer.nsecsElapsed();
+
+	std::cout << layout.items()->size() << " visible items: "
+		<< (scrollTime / steps / 1000) << " us per scroll, "
+		<< (reloadTime / steps / 1000) << " us per reload" << std::endl;
+
+	return 0;
+}
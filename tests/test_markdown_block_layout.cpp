@@ -0,0 +1,65 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+#include "model/new_text_model.h"
+#include "widgets/style.h"
+#include "widgets/markdown_block_widget.h"
+
+// Checks that a block breaks into lines only the lines that have changed:
+// an edit of one line, a relayout without changes and a height change keep
+// line breaking of the rest, a width change redoes all of it.
+
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	Style& style = Style::defaultStyle();
+
+	text::TextModel model = text::TextModel(QStringList{
+		"- first item with **bold** text",
+		"- second item with *italic* text",
+		"- third item with a [link](http://example.com)",
+	});
+	text::Paragraph *par = &((*model.paragraphs())[0]);
+	QList<text::Line> *lines = par->getLines();
+	assert(par->getType() == text::BulletList);
+	assert(lines->size() == 3);
+
+	MarkdownBlock block(nullptr, &style, nullptr);
+	block.resize(400, 100);
+	block.setParagraph(par);
+	block.layoutHeight();
+	assert(block.lineBreakCount() == 3);
+
+	// Reloading the same paragraph keeps everything.
+	block.setParagraph(par);
+	block.layoutHeight();
+	assert(block.lineBreakCount() == 3);
+
+	// Typing in one line breaks only that line.
+	text::Line *line = &((*lines)[1]);
+	QString typed = line->text + " and more";
+	line->setText(typed, false);
+	block.setParagraph(par);
+	int height = block.layoutHeight();
+	assert(block.lineBreakCount() == 4);
+	assert(height > 0);
+
+	// Height doesn't affect line breaking.
+	block.resize(400, height);
+	block.setParagraph(par);
+	block.layoutHeight();
+	assert(block.lineBreakCount() == 4);
+
+	// New width breaks all lines again.
+	block.resize(300, height);
+	block.layoutHeight();
+	assert(block.lineBreakCount() == 7);
+
+	std::cout << "lines broken: " << block.lineBreakCount() << std::endl;
+
+	return 0;
+}
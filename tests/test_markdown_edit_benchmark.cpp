@@ -0,0 +1,84 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QString>
+
+#include "widgets/markdown_edit_widget.h"
+#include "widgets/markdown_scroll_widget.h"
+
+// Benchmark for loading and typing. For every document size it loads and shows
+// a document with that many lines, puts the cursor at the start of the first
+// line and types a few characters, reporting the load time and the average
+// time per keystroke. Both should stay about the same no matter how large the
+// document is.
+
+static const int keystrokes = 200;
+
+static QString document(int lines) {
+	QStringList result;
+	for (int idx = 0; idx < lines; idx++) {
+		if (idx % 10 == 9) {
+			result.push_back("");
+		} else if (idx % 10 >= 6) {
+			result.push_back(QString("- List item %1 with *emphasis*").arg(idx));
+		} else {
+			result.push_back(QString("Line %1 with some **bold** text").arg(idx));
+		}
+	}
+	return result.join("\n");
+}
+
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	Style& style = Style::defaultStyle();
+	int sizes[] = {1000, 5000, 20000};
+
+	for (int size: sizes) {
+		QString text = document(size);
+		QElapsedTimer timer;
+		timer.start();
+
+		MarkdownEditWidget *widget = new MarkdownEditWidget(nullptr, &style);
+		widget->load(text);
+
+		MarkdownScrollWidget *window = new MarkdownScrollWidget(nullptr, &style);
+		window->setMarkdownWidgets(widget, nullptr);
+		window->setWidgetResizable(true);
+		window->resize(800, 600);
+		window->show();
+		QCoreApplication::processEvents();
+		qint64 loadTime = timer.nsecsElapsed();
+
+		// Put the cursor at the start of the document.
+		QPointF point(1, 1);
+		QMouseEvent press(
+			QEvent::MouseButtonPress, point, widget->mapToGlobal(point),
+			Qt::LeftButton, Qt::LeftButton, Qt::NoModifier
+		);
+		QApplication::sendEvent(widget, &press);
+		assert(widget->currentCursor()->block != nullptr);
+
+		timer.restart();
+		for (int idx = 0; idx < keystrokes; idx++) {
+			QKeyEvent key(QEvent::KeyPress, Qt::Key_A, Qt::NoModifier, "a");
+			QApplication::sendEvent(widget, &key);
+		}
+		qint64 elapsed = timer.nsecsElapsed();
+
+		assert(widget->isDirty());
+		assert(widget->text().startsWith(QString(keystrokes, 'a')));
+
+		std::cout << "document of " << size << " lines: "
+			<< (loadTime / 1000000) << " ms to load, "
+			<< (elapsed / keystrokes / 1000) << " us per keystroke"
+			<< std::endl;
+
+		delete window;
+	}
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QScrollBar>
+#include <QString>
+#include <QStringList>
+
+#include "widgets/markdown_edit_widget.h"
+#include "widgets/markdown_scroll_widget.h"
+
+// Checks that the editor keeps blocks only around the viewport: after load and
+// after scrolling the number of blocks stays bounded, clicks and cursor keys
+// reach paragraphs that had no blocks, and content in view doesn't jump when
+// blocks above it replace estimated heights with real ones.
+
+static const int paragraphs = 2000;
+static const int maxBlocks = 200;
+
+static QString document() {
+	QStringList result;
+	QString words = "some words of varying length to wrap the paragraph ";
+	for (int idx = 0; idx < paragraphs; idx++) {
+		// Paragraphs of different lengths make estimates differ from real
+		// heights.
+		result.push_back(QString("Paragraph %1 ").arg(idx) + words.repeated(idx % 7));
+		result.push_back("");
+	}
+	return result.join("\n");
+}
+
+static QList<MarkdownBlock*> liveBlocks(MarkdownEditWidget *widget) {
+	QList<MarkdownBlock*> result;
+	for (auto block: widget->findChildren<MarkdownBlock*>(Qt::FindDirectChildrenOnly)) {
+		if (!block->isHidden())
+			result.push_back(block);
+	}
+	return result;
+}
+
+static MarkdownBlock *blockAtPoint(MarkdownEditWidget *widget, QPoint point) {
+	for (auto block: liveBlocks(widget)) {
+		if (block->geometry().contains(point))
+			return block;
+	}
+	return nullptr;
+}
+
+static void click(MarkdownEditWidget *widget, QPoint point) {
+	QPointF pos(point);
+	QMouseEvent press(
+		QEvent::MouseButtonPress, pos, widget->mapToGlobal(pos),
+		Qt::LeftButton, Qt::LeftButton, Qt::NoModifier
+	);
+	QApplication::sendEvent(widget, &press);
+	QMouseEvent release(
+		QEvent::MouseButtonRelease, pos, widget->mapToGlobal(pos),
+		Qt::LeftButton, Qt::NoButton, Qt::NoModifier
+	);
+	QApplication::sendEvent(widget, &release);
+}
+
+static QString cursorText(MarkdownEditWidget *widget) {
+	MarkdownCursor *cursor = widget->currentCursor();
+	assert(cursor->block != nullptr && cursor->block->paragraph() != nullptr);
+	return cursor->block->paragraph()->getLines()->at(0).text;
+}
+
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	Style& style = Style::defaultStyle();
+
+	MarkdownEditWidget *widget = new MarkdownEditWidget(nullptr, &style);
+	widget->load(document());
+
+	MarkdownScrollWidget *window = new MarkdownScrollWidget(nullptr, &style);
+	window->setMarkdownWidgets(widget, nullptr);
+	window->setWidgetResizable(true);
+	window->resize(800, 600);
+	window->show();
+	QCoreApplication::processEvents();
+
+	// Only blocks around the first viewport exist after load.
+	int loaded = liveBlocks(widget).size();
+	assert(loaded > 0 && loaded <= maxBlocks);
+
+	// Click at the end of the document lands on the last paragraph, which
+	// had no block.
+	click(widget, QPoint(1, widget->height() - 1));
+	assert(cursorText(widget).startsWith(QString("Paragraph %1 ").arg(paragraphs - 1)));
+
+	// Cursor moves up into the paragraph before it.
+	MarkdownBlock *last = widget->currentCursor()->block;
+	QKeyEvent up(QEvent::KeyPress, Qt::Key_Up, Qt::NoModifier);
+	for (int idx = 0; idx < 10 && widget->currentCursor()->block == last; idx++)
+		QApplication::sendEvent(widget, &up);
+	assert(cursorText(widget).startsWith(QString("Paragraph %1 ").arg(paragraphs - 2)));
+
+	// Scrolling to the middle keeps the number of blocks bounded.
+	QScrollBar *bar = window->verticalScrollBar();
+	bar->setValue(bar->maximum() / 2);
+	QCoreApplication::processEvents();
+	int scrolled = liveBlocks(widget).size();
+	assert(scrolled > 0 && scrolled <= maxBlocks);
+
+	// Block in the middle of the viewport stays in place when blocks above
+	// it are created. Scrolling by half a viewport keeps it alive.
+	QPoint center(10, window->viewport()->height() / 2);
+	MarkdownBlock *anchor = blockAtPoint(widget, widget->mapFrom(window->viewport(), center));
+	assert(anchor != nullptr);
+	int before = anchor->mapTo(window->viewport(), QPoint(0, 0)).y();
+
+	int step = window->viewport()->height() / 2;
+	bar->setValue(bar->value() - step);
+	QCoreApplication::processEvents();
+	int after = anchor->mapTo(window->viewport(), QPoint(0, 0)).y();
+	assert(after == before + step);
+
+	// Clicking in view puts the cursor into a block that is shown there.
+	click(widget, widget->mapFrom(window->viewport(), center));
+	MarkdownBlock *clicked = widget->currentCursor()->block;
+	assert(clicked != nullptr && liveBlocks(widget).contains(clicked));
+
+	std::cout << "blocks after load: " << loaded
+		<< ", after scroll: " << scrolled
+		<< " of " << paragraphs << " paragraphs" << std::endl;
+
+	delete window;
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include <cassert>
+#include <iostream>
+
+#include <QDir>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "entity/database_brain_repository.h"
+
+// Benchmark for loading hub nodes. For every hub size it builds a brain where
+// the root has a parent and `size` children, the parent has `size / 10` other
+// children (root's siblings), and each child has two children of its own and
+// a link to the next child. Then it selects the root and reports the number of
+// statements and the time it took to build the State.
+
+static void insertThought(QSqlQuery& query, qlonglong id, QString name) {
+	query.bindValue(":id", id);
+	query.bindValue(":name", name);
+	bool result = query.exec();
+	assert(result);
+}
+
+static void insertConnection(
+	QSqlQuery& query,
+	qlonglong from,
+	qlonglong to,
+	ConnectionType type
+) {
+	query.bindValue(":from", from);
+	query.bindValue(":to", to);
+	query.bindValue(":type", type);
+	bool result = query.exec();
+	assert(result);
+}
+
+static void populate(int size) {
+	QSqlDatabase db = QSqlDatabase::database();
+	db.transaction();
+
+	QSqlQuery thoughts(db);
+	thoughts.prepare("INSERT INTO thoughts (id, name) VALUES (:id, :name);");
+	QSqlQuery conns(db);
+	conns.prepare(
+		"INSERT INTO connections (conn_from, conn_to, conn_type) "
+		"VALUES (:from, :to, :type);"
+	);
+
+	qlonglong next = 1;
+	qlonglong parent = next++;
+	insertThought(thoughts, parent, "Parent");
+	insertConnection(conns, parent, 0, ConnectionType::child);
+
+	for (int idx = 0; idx < size / 10; idx++) {
+		qlonglong sibling = next++;
+		insertThought(thoughts, sibling, QString("Sibling %1").arg(idx));
+		insertConnection(conns, parent, sibling, ConnectionType::child);
+	}
+
+	qlonglong prev = -1;
+	for (int idx = 0; idx < size; idx++) {
+		qlonglong child = next++;
+		insertThought(thoughts, child, QString("Child %1").arg(idx));
+		insertConnection(conns, 0, child, ConnectionType::child);
+
+		for (int sub = 0; sub < 2; sub++) {
+			qlonglong grandchild = next++;
+			insertThought(thoughts, grandchild, QString("Grandchild %1").arg(sub));
+			insertConnection(conns, child, grandchild, ConnectionType::child);
+		}
+
+		if (prev != -1)
+			insertConnection(conns, prev, child, ConnectionType::link);
+		prev = child;
+	}
+
+	db.commit();
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	int sizes[] = {10, 100, 1000, 5000};
+
+	for (int size: sizes) {
+		QDir dir = QDir("test_brain_benchmark");
+		if (dir.exists()) {
+			dir.removeRecursively();
+		}
+
+		DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+		assert(repo != nullptr);
+		populate(size);
+
+		QElapsedTimer timer;
+		unsigned long queries = repo->queryCount();
+		timer.start();
+
+		bool result = repo->select(0);
+		qint64 elapsed = timer.nsecsElapsed();
+
+		assert(result);
+		const State *state = repo->getState();
+		assert(state != nullptr);
+		assert(state->centralThought()->children().size() == (size_t)size);
+		assert(state->centralThought()->parents().size() == 1);
+
+		std::cout << "hub size " << size
+			<< ": " << (repo->queryCount() - queries) << " queries, "
+			<< (elapsed / 1000) << " us, "
+			<< state->thoughts()->size() << " thoughts"
+			<< std::endl;
+
+		delete repo;
+	}
+
+	QDir("test_brain_benchmark").removeRecursively();
+	return 0;
+}
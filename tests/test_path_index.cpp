@@ -0,0 +1,132 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include <cassert>
+#include <iostream>
+
+#include <QPointF>
+#include <QPolygonF>
+#include <QElapsedTimer>
+
+#include "layout/path_index.h"
+
+// Checks PathIndex against a linear scan over all segments of random
+// polylines, also after some of them are removed, renumbered and replaced,
+// then reports the time per lookup for both.
+
+static const int pathCount = 2000;
+static const int lookups = 20000;
+static const qreal radius = 10.0;
+
+static qreal distance(QPointF point, QPointF from, QPointF to) {
+	QPointF dir = to - from;
+	qreal length = QPointF::dotProduct(dir, dir);
+	qreal t = 0;
+	if (length > 0) {
+		t = QPointF::dotProduct(point - from, dir) / length;
+		t = std::max(0.0, std::min(1.0, t));
+	}
+	QPointF diff = point - (from + dir * t);
+	return std::sqrt(QPointF::dotProduct(diff, diff));
+}
+
+static QPolygonF randomPath(
+	std::mt19937& random,
+	std::uniform_real_distribution<qreal>& coord,
+	std::uniform_real_distribution<qreal>& step
+) {
+	QPolygonF polyline;
+	QPointF point(coord(random), coord(random));
+	for (int idx = 0; idx < 20; idx++) {
+		polyline << point;
+		point += QPointF(step(random), step(random));
+	}
+	return polyline;
+}
+
+static int linearNearest(const std::vector<QPolygonF>& paths, QPointF point) {
+	int result = -1;
+	qreal best = std::numeric_limits<qreal>::max();
+
+	for (size_t id = 0; id < paths.size(); id++) {
+		const QPolygonF& polyline = paths[id];
+		for (int idx = 1; idx < polyline.size(); idx++) {
+			qreal dist = distance(point, polyline[idx - 1], polyline[idx]);
+			if (dist <= radius && dist < best) {
+				best = dist;
+				result = id;
+			}
+		}
+	}
+
+	return result;
+}
+
+int main(int argc, char **argv) {
+	std::mt19937 random(42);
+	std::uniform_real_distribution<qreal> coord(-2000.0, 2000.0);
+	std::uniform_real_distribution<qreal> step(-40.0, 40.0);
+
+	std::vector<QPolygonF> paths;
+	PathIndex index;
+
+	for (int id = 0; id < pathCount; id++) {
+		QPolygonF polyline = randomPath(random, coord, step);
+		paths.push_back(polyline);
+		index.add(id, polyline);
+	}
+
+	std::vector<QPointF> points;
+	for (int idx = 0; idx < lookups; idx++)
+		points.push_back(QPointF(coord(random), coord(random)));
+
+	QElapsedTimer timer;
+	std::vector<int> expected;
+
+	timer.start();
+	for (auto& point: points)
+		expected.push_back(linearNearest(paths, point));
+	qint64 linearTime = timer.nsecsElapsed();
+
+	int hits = 0;
+	timer.restart();
+	for (int idx = 0; idx < lookups; idx++) {
+		int found = index.nearest(points[idx], radius);
+		assert(found == expected[idx]);
+		if (found >= 0)
+			hits++;
+	}
+	qint64 indexTime = timer.nsecsElapsed();
+
+	assert(hits > 0);
+
+	// Every third path is removed and the last one takes its ID, the way the
+	// canvas keeps its paths, then new paths take the freed space.
+	for (int id = (int)paths.size() - 1; id >= 0; id -= 3) {
+		int last = paths.size() - 1;
+		index.remove(id);
+		if (id != last) {
+			index.renumber(last, id);
+			paths[id] = paths[last];
+		}
+		paths.pop_back();
+	}
+	for (int idx = 0; idx < pathCount / 6; idx++) {
+		paths.push_back(randomPath(random, coord, step));
+		index.add(paths.size() - 1, paths.back());
+	}
+	for (auto& point: points)
+		assert(index.nearest(point, radius) == linearNearest(paths, point));
+
+	index.clear();
+	assert(index.nearest(paths[0][0], radius) == -1);
+
+	std::cout << hits << " hits in " << lookups << " lookups" << std::endl;
+	std::cout << "linear scan: "
+		<< (linearTime / lookups) << " ns per lookup" << std::endl;
+	std::cout << "path index: "
+		<< (indexTime / lookups) << " ns per lookup" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include <vector>
+#include <string>
+#include <cassert>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QString>
+
+#include <QDebug>
+
+#include "entity/search_repository.h"
+#include "presenters/search_engine.h"
+
+// Checks debouncing, dropping of stale results and narrowing of previous
+// results in SearchEngine.
+
+class CountingRepository: public SearchRepository {
+public:
+	CountingRepository(std::vector<SearchItem> items): m_items(items) {}
+	int queries = 0;
+
+	SearchResult search(std::string term) override {
+		queries++;
+		QString qterm = QString::fromStdString(term);
+		std::vector<SearchItem> result;
+		for (auto& item: m_items) {
+			if (QString::fromStdString(item.name).contains(qterm, Qt::CaseInsensitive))
+				result.push_back(item);
+		}
+		return SearchResult{ .error = SearchErrorNone, .items = result };
+	}
+
+private:
+	std::vector<SearchItem> m_items;
+};
+
+static void wait(int msec) {
+	QElapsedTimer timer;
+	timer.start();
+	while (timer.elapsed() < msec)
+		QApplication::processEvents(QEventLoop::AllEvents, 10);
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+
+	CountingRepository repo({
+		SearchItem{ .id = 1, .name = "Garden plan" },
+		SearchItem{ .id = 2, .name = "Garage sale" },
+		SearchItem{ .id = 3, .name = "Gardening notes", .snippet = "Tomatoes" },
+		SearchItem{ .id = 4, .name = "Paper" },
+		SearchItem{ .id = 5, .name = "Café plans" },
+	});
+
+	SearchEngine engine(&repo, 10, SearchScopeAll, 50);
+	QString lastTerm;
+	std::vector<SearchItem> lastItems;
+	int updates = 0;
+	QObject::connect(
+		&engine, &SearchEngine::resultsChanged,
+		[&](QString term, std::vector<SearchItem> items) {
+			lastTerm = term;
+			lastItems = items;
+			updates++;
+		}
+	);
+
+	// Typing quickly sends one query for the last term.
+	engine.setTerm("gar");
+	engine.setTerm("gard");
+	engine.setTerm("garde");
+	wait(200);
+	assert(repo.queries == 1);
+	assert(lastTerm == "garde");
+	assert(lastItems.size() == 2);
+
+	// Narrowing: item 3 has note text, so it can't be ruled out locally
+	// and the repository is asked again after showing narrowed results.
+	updates = 0;
+	engine.setTerm("garden p");
+	assert(updates == 1);
+	assert(lastItems.size() == 1);
+	assert(lastItems[0].id == 1);
+	wait(200);
+	assert(repo.queries == 2);
+
+	// Narrowing without note texts in results is final.
+	engine.setTerm("garden pla");
+	assert(lastItems.size() == 1);
+	wait(200);
+	assert(repo.queries == 2);
+
+	// Words are narrowed without diacritics, like the index matches them.
+	engine.setTerm("caf");
+	wait(200);
+	assert(repo.queries == 3);
+	assert(lastItems.size() == 1);
+	engine.setTerm("cafe");
+	assert(lastItems.size() == 1);
+	assert(lastItems[0].id == 5);
+	wait(200);
+	assert(repo.queries == 3);
+
+	// Short term clears results without a query.
+	engine.setTerm("ga");
+	assert(lastItems.empty());
+	wait(200);
+	assert(repo.queries == 3);
+
+	// Canceled term never reports.
+	updates = 0;
+	engine.setTerm("paper");
+	engine.cancel();
+	wait(200);
+	assert(updates == 0);
+	assert(repo.queries == 3);
+
+	// Names are matched by any part, and narrowing them is final even with
+	// note texts in results.
+	SearchEngine names(&repo, 10, SearchScopeNames, 50);
+	QObject::connect(
+		&names, &SearchEngine::resultsChanged,
+		[&](QString term, std::vector<SearchItem> items) {
+			lastTerm = term;
+			lastItems = items;
+		}
+	);
+	names.setTerm("arde");
+	wait(200);
+	assert(repo.queries == 4);
+	assert(lastItems.size() == 2);
+
+	names.setTerm("ardeni");
+	assert(lastItems.size() == 1);
+	assert(lastItems[0].id == 3);
+	wait(200);
+	assert(repo.queries == 4);
+
+	qDebug() << "OK";
+	return 0;
+}
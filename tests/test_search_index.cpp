@@ -0,0 +1,140 @@
+#include <cassert>
+#include <iostream>
+
+#include <QDir>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "entity/database_brain_repository.h"
+
+// Checks that the full text search index follows thought edits and note
+// texts, that names still match by any part, that a stale index is rebuilt on
+// open, then reports search latency on a brain with 100k notes.
+
+static const int noteCount = 100000;
+static const int iterations = 100;
+
+static bool contains(SearchResult result, ThoughtId id) {
+	assert(result.error == SearchErrorNone);
+	for (auto& item: result.items) {
+		if (item.id == id)
+			return true;
+	}
+	return false;
+}
+
+static void populate() {
+	QSqlDatabase db = QSqlDatabase::database();
+	db.transaction();
+
+	QSqlQuery thoughts(db);
+	thoughts.prepare("INSERT INTO thoughts (id, name) VALUES (:id, :name);");
+	QSqlQuery index(db);
+	index.prepare("INSERT INTO search_index (rowid, name, body) VALUES (:id, :name, :body);");
+
+	const char *words[] = {"river", "mountain", "graph", "notes", "coffee", "engine", "garden", "paper"};
+	for (int idx = 1; idx <= noteCount; idx++) {
+		QString name = QString("Note %1 %2").arg(idx).arg(words[idx % 8]);
+		QString body = QString("Some %1 text about %2 and %3.")
+			.arg(words[(idx / 8) % 8]).arg(words[(idx / 64) % 8]).arg(idx);
+
+		thoughts.bindValue(":id", (qlonglong)idx);
+		thoughts.bindValue(":name", name);
+		bool result = thoughts.exec();
+		assert(result);
+
+		index.bindValue(":id", (qlonglong)idx);
+		index.bindValue(":name", name);
+		index.bindValue(":body", body);
+		result = index.exec();
+		assert(result);
+	}
+
+	db.commit();
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_search");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+
+	// Names.
+	CreateResult thought = repo->createThought(0, ConnectionType::child, false, "Weekly planning");
+	assert(thought.success);
+	assert(contains(repo->search("plan"), thought.id));
+
+	std::string name = "Monthly review";
+	bool result = repo->updateThought(thought.id, name);
+	assert(result);
+	assert(!contains(repo->search("planning"), thought.id));
+	assert(contains(repo->search("month rev"), thought.id));
+
+	// Parts of words in names.
+	assert(contains(repo->search("onthl"), thought.id));
+	assert(contains(repo->searchTop("onthl", 10, SearchScopeNames), thought.id));
+
+	// Texts.
+	SaveResult saved = repo->saveText(thought.id, "Budget and \"quoted\" travel plans");
+	assert(saved.error == TextRepositoryErrorNone);
+	SearchResult found = repo->search("travel");
+	assert(contains(found, thought.id));
+	assert(found.items[0].snippet.find("travel") != std::string::npos);
+	assert(contains(repo->search("\"quoted"), thought.id));
+
+	// Only names when asked for.
+	assert(!contains(repo->searchTop("travel", 10, SearchScopeNames), thought.id));
+
+	// Name matches come first.
+	CreateResult other = repo->createThought(0, ConnectionType::child, false, "Budget");
+	assert(other.success);
+	found = repo->search("budget");
+	assert(found.items.size() == 2);
+	assert(found.items[0].id == other.id);
+
+	result = repo->deleteThought(thought.id);
+	assert(result);
+	assert(!contains(repo->search("travel"), thought.id));
+
+	// Stale index is rebuilt on open.
+	saved = repo->saveText(other.id, "Groceries for the week");
+	assert(saved.error == TextRepositoryErrorNone);
+	delete repo;
+	QSqlQuery stale(QSqlDatabase::database());
+	result = stale.exec("DELETE FROM search_index;");
+	assert(result);
+	stale.finish();
+
+	repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+	assert(contains(repo->search("groceries"), other.id));
+
+	// Latency.
+	populate();
+
+	const char *terms[] = {"river", "moun", "gra not", "Note 4242", "coffee engine"};
+	for (auto term: terms) {
+		QElapsedTimer timer;
+		size_t count = 0;
+		timer.start();
+		for (int idx = 0; idx < iterations; idx++) {
+			SearchResult res = repo->search(term);
+			assert(res.error == SearchErrorNone);
+			count = res.items.size();
+		}
+		qint64 elapsed = timer.nsecsElapsed();
+
+		std::cout << "\"" << term << "\": " << count << " results, "
+			<< (elapsed / iterations / 1000) << " us per search" << std::endl;
+	}
+
+	delete repo;
+	dir.removeRecursively();
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include <cassert>
+#include <iostream>
+
+#include <QDir>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlTableModel>
+
+#include "entity/database_brain_repository.h"
+
+// Benchmark for repeated lookups. Fills a brain with a few thousand thoughts
+// and runs the same search many times, first through a QSqlTableModel built
+// for every call (the way the repository used to do it), then through the
+// repository's prepared statement. Reports the average time per call.
+
+static const int thoughtCount = 5000;
+static const int iterations = 1000;
+
+static void populate() {
+	QSqlDatabase db = QSqlDatabase::database();
+	db.transaction();
+
+	QSqlQuery query(db);
+	query.prepare("INSERT INTO thoughts (id, name) VALUES (:id, :name);");
+
+	// Repository searches through the full text index when there is one.
+	QSqlQuery index(db);
+	bool indexed = index.exec(
+		"SELECT 1 FROM sqlite_master WHERE name == 'search_index';"
+	) && index.first();
+	index.prepare("INSERT INTO search_index (rowid, name, body) VALUES (:id, :name, '');");
+
+	for (int idx = 1; idx <= thoughtCount; idx++) {
+		query.bindValue(":id", (qlonglong)idx);
+		query.bindValue(":name", QString("Thought %1").arg(idx));
+		bool result = query.exec();
+		assert(result);
+
+		if (indexed) {
+			index.bindValue(":id", (qlonglong)idx);
+			index.bindValue(":name", QString("Thought %1").arg(idx));
+			result = index.exec();
+			assert(result);
+		}
+	}
+
+	db.commit();
+}
+
+static size_t modelSearch(QString term) {
+	QSqlTableModel model(nullptr, QSqlDatabase::database());
+	model.setTable("thoughts");
+	model.setFilter(QString("name LIKE '%%%1%%'").arg(term));
+	model.select();
+
+	size_t count = 0;
+	for (int idx = 0; idx < model.rowCount(); idx++) {
+		QSqlRecord record = model.record(idx);
+		if (record.value("id").toULongLong() != InvalidThoughtId)
+			count++;
+	}
+
+	return count;
+}
+
+int main(int argc, char **argv) {
+	QApplication app(argc, argv);
+	QDir dir = QDir("test_brain_statements");
+	if (dir.exists()) {
+		dir.removeRecursively();
+	}
+
+	DatabaseBrainRepository *repo = DatabaseBrainRepository::fromDir(dir);
+	assert(repo != nullptr);
+	populate();
+
+	QElapsedTimer timer;
+	size_t expected = modelSearch("Thought 421");
+	assert(expected > 0);
+
+	// Table model per call.
+	timer.start();
+	for (int idx = 0; idx < iterations; idx++) {
+		size_t count = modelSearch("Thought 421");
+		assert(count == expected);
+	}
+	qint64 modelTime = timer.nsecsElapsed();
+
+	// Prepared statement.
+	timer.restart();
+	for (int idx = 0; idx < iterations; idx++) {
+		SearchResult found = repo->search("Thought 421");
+		assert(found.error == SearchErrorNone);
+		assert(found.items.size() == expected);
+	}
+	qint64 preparedTime = timer.nsecsElapsed();
+
+	std::cout << "table model: "
+		<< (modelTime / iterations / 1000) << " us per search" << std::endl;
+	std::cout << "prepared statement: "
+		<< (preparedTime / iterations / 1000) << " us per search" << std::endl;
+
+	delete repo;
+	dir.removeRecursively();
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+
+#include "widgets/canvas_widget.h"
+#include "layout/default_layout.h"
+
+// Frame time against the number of subconnections. Lays out a thought with
+// links on one side and children on the other, where every child links to
+// `density` of the links, and repaints the canvas with and without level of
+// detail.
+
+static const int sideCount = 40;
+static const int frames = 50;
+
+static State *makeState(int density) {
+	std::unordered_map<ThoughtId, Thought*> *map =
+		new std::unordered_map<ThoughtId, Thought*>();
+	Thought *central = new Thought(0, "Center", false, true, true);
+
+	ThoughtId next = 1;
+	std::vector<Thought*> links;
+	for (int idx = 0; idx < sideCount; idx++) {
+		Thought *link = new Thought(next, QString("Link %1").arg(idx).toStdString());
+		map->insert({next, link});
+		central->links().push_back(next++);
+		links.push_back(link);
+	}
+
+	for (int idx = 0; idx < sideCount; idx++) {
+		Thought *child = new Thought(next, QString("Child %1").arg(idx).toStdString(), true);
+		map->insert({next, child});
+		central->children().push_back(next++);
+
+		for (int link = 0; link < density; link++)
+			child->links().push_back(links[(idx + link) % sideCount]->id());
+	}
+
+	return new State(0, central, map);
+}
+
+static qint64 frameTime(CanvasWidget& canvas) {
+	QElapsedTimer timer;
+	timer.start();
+	for (int frame = 0; frame < frames; frame++)
+		canvas.repaint();
+	return timer.nsecsElapsed() / frames;
+}
+
+int main(int argc, char *argv[]) {
+	Style& style = Style::defaultStyle();
+	QApplication app(argc, argv);
+
+	DefaultLayout layout(&style);
+	CanvasWidget canvas(nullptr, &style, &layout);
+	canvas.setAnimated(false);
+	canvas.resize(1400, 1000);
+	canvas.show();
+
+	int densities[] = {1, 5, 10, 20, 40};
+	for (int density: densities) {
+		State *state = makeState(density);
+		layout.setState(state);
+		app.processEvents();
+
+		canvas.setLevelOfDetail(false);
+		qint64 full = frameTime(canvas);
+
+		canvas.setLevelOfDetail(true);
+		qint64 lod = frameTime(canvas);
+
+		std::cout << layout.subconnections()->size() << " subconnections: "
+			<< (full / 1000) << " us per frame, "
+			<< (lod / 1000) << " us with level of detail" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+#include <cassert>
+#include <iostream>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFontMetrics>
+
+#include "widgets/style.h"
+#include "layout/text_metrics.h"
+#include "widgets/thought_widget.h"
+
+// Checks that cached measurements match QFontMetrics, that fonts and widths
+// are kept apart, and reports the time of measuring a few hundred labels
+// with and without the cache.
+
+static const int labelCount = 300;
+
+static QSize measure(const QFont& font, const QString& text, int width) {
+	return QFontMetrics(font).boundingRect(
+		QRect(0, 0, width, INT_MAX),
+		Qt::AlignHCenter | Qt::TextWordWrap,
+		text
+	).size();
+}
+
+int main(int argc, char *argv[]) {
+	QApplication app(argc, argv);
+	Style& style = Style::defaultStyle();
+	TextMetrics& metrics = TextMetrics::shared();
+	metrics.clear();
+
+	QFont font = style.browser.browseFont;
+	QFont bigFont = font;
+	bigFont.setPixelSize(font.pixelSize() * 2);
+	QString text = "Lorem ipsum dolor sit amet, consectetur adipiscing elit";
+
+	// Same results as direct measurement.
+	assert(metrics.wrappedSize(font, text, 100) == measure(font, text, 100));
+	assert(metrics.wrappedSize(font, text, 9000) == measure(font, text, 9000));
+	assert(metrics.wrappedSize(bigFont, text, 100) == measure(bigFont, text, 100));
+	assert(metrics.size() == 3);
+
+	// Repeated lookups don't add entries.
+	assert(metrics.wrappedSize(font, text, 100) == measure(font, text, 100));
+	assert(metrics.size() == 3);
+
+	// Widgets and layouts measure through the same cache.
+	ThoughtWidget widget(nullptr, &style, 1, true, text, false, false, false);
+	assert(widget.sizeHint() == ThoughtWidget::sizeHintForText(&style, text));
+
+	metrics.clear();
+	assert(metrics.size() == 0);
+
+	// Benchmark.
+	std::vector<QString> labels;
+	for (int idx = 0; idx < labelCount; idx++)
+		labels.push_back(QString("Thought number %1 with a longer name").arg(idx));
+
+	QElapsedTimer timer;
+	timer.start();
+	for (auto& label: labels)
+		measure(font, label, 200);
+	qint64 direct = timer.nsecsElapsed();
+
+	for (auto& label: labels)
+		metrics.wrappedSize(font, label, 200);
+
+	timer.restart();
+	for (auto& label: labels)
+		metrics.wrappedSize(font, label, 200);
+	qint64 cached = timer.nsecsElapsed();
+
+	std::cout << labelCount << " labels: "
+		<< (direct / 1000) << " us measured, "
+		<< (cached / 1000) << " us cached" << std::endl;
+
+	return 0;
+}
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <iostream>
+#include <unordered_set>
 
 #include <QColor>
 #include <QPainter>
@@ -7,6 +8,8 @@
 #include <QWidget>
 #include <QShowEvent>
 #include <QMenu>
+#include <QPixmap>
+#include <QEasingCurve>
 #include <QTranslator>
 
 #include "layout/base_layout.h"
@@ -31,6 +34,31 @@ CanvasWidget::CanvasWidget(
 	// Enable mouse tracking for highlighting connections when moving the mouse.
 	setMouseTracking(true);
 
+	// Pens are shared by all paths.
+	m_connectionPen = QPen(style->browser.anchorActive, 1);
+	m_subconnectionPen = QPen(style->browser.anchorActive, 0.5);
+	m_subconnectionPen.setStyle(Qt::DashLine);
+	m_subconnectionPen.setDashPattern({4, 2});
+	m_highlightPen = QPen(style->browser.anchorHighlight, 1, Qt::DashLine);
+	QColor meshColor = style->browser.anchorActive;
+	meshColor.setAlphaF(0.5);
+	m_meshPen = QPen(meshColor, 0);
+
+	// Detail is restored when scrolling stops.
+	m_scrollTimer.setSingleShot(true);
+	m_scrollTimer.setInterval(scrollSettleDelay);
+	connect(
+		&m_scrollTimer, SIGNAL(timeout()),
+		this, SLOT(onScrollSettled())
+	);
+
+	// Transitions between layouts.
+	m_transitionTimer.setInterval(transitionInterval);
+	connect(
+		&m_transitionTimer, SIGNAL(timeout()),
+		this, SLOT(onTransitionStep())
+	);
+
 	setStyleSheet(
 		QString("background-color: %1").arg(
 			style->browser.background.name(QColor::HexRgb)
@@ -52,6 +80,10 @@ CanvasWidget::~CanvasWidget() {
 		delete wi->second;
 	}
 
+	for (auto *widget: m_recycled) {
+		delete widget;
+	}
+
 	std::unordered_map<unsigned int, ScrollAreaWidget*>::iterator sc;
 	for (sc = m_scrollAreas.begin(); sc != m_scrollAreas.end(); sc++) {
 		delete sc->second;
@@ -62,6 +94,38 @@ QSize CanvasWidget::sizeHint() const {
 	return QSize(100, 100);
 }
 
+const CanvasRenderer CanvasWidget::renderer() const {
+	return m_renderer;
+}
+
+const bool CanvasWidget::levelOfDetail() const {
+	return m_levelOfDetail;
+}
+
+void CanvasWidget::setLevelOfDetail(bool enabled) {
+	m_levelOfDetail = enabled;
+	updateSubconnectionMesh();
+	m_connectionLayerValid = false;
+	update();
+}
+
+const bool CanvasWidget::animated() const {
+	return m_animated;
+}
+
+void CanvasWidget::setAnimated(bool animated) {
+	m_animated = animated;
+	if (!animated)
+		finishTransition();
+}
+
+void CanvasWidget::setRenderer(CanvasRenderer renderer) {
+	m_renderer = renderer;
+	m_connectionLayer = QPixmap();
+	m_connectionLayerValid = false;
+	update();
+}
+
 void CanvasWidget::showSuggestions(std::vector<ConnectionItem> items) {
 	if (m_newThought == nullptr)
 		return;
@@ -126,47 +190,21 @@ void CanvasWidget::mouseMoveEvent(QMouseEvent *event) {
 		return;
 	}
 
-	QPoint pos = event->pos();
+	// Closest connection within the capture distance from the cursor.
+	int found = m_pathIndex.nearest(event->position(), pathCaptureDistance);
 
-	// Rectangle around cursor to capture connections.
-	QRectF activeRect = QRectF(
-		pos.x() - 10,
-		pos.y() - 10,
-		20,
-		20
-	);
-
-	std::vector<Path> intersects;
-	for (auto& p: m_paths) {
-		// Not very smart. We just sample the curve along the path and check if
-		// some point gets inside the capture rectangle. But it still might be
-		// better than trying to solve a polinomial equation of fifth order...
-		//
-		// As a potential optimization, pre-sample the curve at the point of
-		// construction, i. e. in makePath() method.
-		for (int i = 0; i <= 25; i++) {
-			qreal percent = (qreal)i / 25.0;
-			QPointF point = p.path.pointAtPercent(percent);
-			if (activeRect.contains(point)) {
-				intersects.push_back(p);
-			}
-		}
-	}
-
-	if (intersects.size() == 0 && m_pathHighlight.has_value()) {
+	if (found < 0 && m_pathHighlight.has_value()) {
+		updatePathRegion(m_paths[m_pathHighlight.value()]);
 		m_pathHighlight = std::nullopt;
-		update();
 	} else if (
-		intersects.size() > 0 &&
-		(
-			!m_pathHighlight.has_value() ||
-			m_pathHighlight.value().path != intersects[0].path)
-		)
-	{
-		// TODO: take closest.
-		QPen pen(m_style->browser.anchorHighlight, 1, Qt::DashLine);
-		m_pathHighlight = Path(intersects[0].from, intersects[0].to, pen, intersects[0].path);
-		update();
+		found >= 0 &&
+		(!m_pathHighlight.has_value() || m_pathHighlight.value() != (size_t)found)
+	) {
+		if (m_pathHighlight.has_value())
+			updatePathRegion(m_paths[m_pathHighlight.value()]);
+
+		m_pathHighlight = found;
+		updatePathRegion(m_paths[found]);
 	}
 }
 
@@ -193,6 +231,9 @@ void CanvasWidget::mousePressEvent(QMouseEvent *event) {
 void CanvasWidget::resizeEvent(QResizeEvent *event) {
 	QWidget::resizeEvent(event);
 
+	// Layout might not produce new paths, but the layer has to match the size.
+	m_connectionLayerValid = false;
+
 	if (m_layout != nullptr) {
 		m_layout->setSize(event->size());
 	}
@@ -208,8 +249,17 @@ void CanvasWidget::paintEvent(QPaintEvent *event) {
 	QPainter painter(this);
 	painter.setRenderHint(QPainter::Antialiasing, true);
 
-	for (auto& path: m_paths) {
-		drawConnection(painter, path);
+	if (m_renderer == CanvasRenderer::Retained) {
+		if (!m_connectionLayerValid)
+			renderConnectionLayer();
+
+		// Only the damaged part of the layer is copied.
+		painter.save();
+		painter.setClipRect(event->rect());
+		painter.drawPixmap(0, 0, m_connectionLayer);
+		painter.restore();
+	} else {
+		drawConnections(painter);
 	}
 
 	// Editing.
@@ -225,7 +275,7 @@ void CanvasWidget::paintEvent(QPaintEvent *event) {
 
 	// Highlight.
 	if (m_pathHighlight.has_value()) {
-		drawConnection(painter, m_pathHighlight.value());
+		drawConnection(painter, m_paths[m_pathHighlight.value()], m_highlightPen);
 	}
 }
 
@@ -251,8 +301,7 @@ void CanvasWidget::drawAnchorConnection(QPainter& painter) {
 		.dy = -incoming.dy,
 	};
 
-	QPen pen(m_style->browser.anchorHighlight, 1, Qt::DashLine);
-	Path path = makePath(m_anchorSource->widget, nullptr, outgoing, incoming, pen);
+	Path path = makePath(m_anchorSource->widget, nullptr, outgoing, incoming, &m_highlightPen);
 
 	drawConnection(
 		painter,
@@ -275,8 +324,7 @@ void CanvasWidget::drawNewThoughtConnection(QPainter& painter) {
 		m_anchorSource->type
 	);
 
-	QPen pen(m_style->browser.anchorHighlight, 1, Qt::DashLine);
-	Path path = makePath(m_anchorSource->widget, m_newThought, outgoing, incoming, pen);
+	Path path = makePath(m_anchorSource->widget, m_newThought, outgoing, incoming, &m_highlightPen);
 
 	drawConnection(
 		painter,
@@ -299,8 +347,7 @@ void CanvasWidget::drawOverThoughtConnection(QPainter& painter) {
 		m_anchorSource->type
 	);
 
-	QPen pen(m_style->browser.anchorHighlight, 1, Qt::DashLine);
-	Path path = makePath(m_anchorSource->widget, m_overThought, outgoing, incoming, pen);
+	Path path = makePath(m_anchorSource->widget, m_overThought, outgoing, incoming, &m_highlightPen);
 
 	drawConnection(
 		painter,
@@ -311,7 +358,7 @@ void CanvasWidget::drawOverThoughtConnection(QPainter& painter) {
 Path CanvasWidget::makePath(
 	ThoughtWidget *from, ThoughtWidget *to,
 	AnchorPoint outgoing, AnchorPoint incoming,
-	QPen& pen
+	const QPen *pen
 ) {
 	QPainterPath path;
 
@@ -368,17 +415,123 @@ Path CanvasWidget::makePath(
 		incoming.y
 	);
 
-	return Path(from, to, pen, path);
+	Path result = Path(from, to, pen, path);
+	result.outgoing = outgoing;
+	result.incoming = incoming;
+
+	return result;
 }
 
 inline void CanvasWidget::drawConnection(
 	QPainter& painter,
-	Path& path
+	const Path& path
 ) {
-	painter.setPen(path.pen);
+	drawConnection(painter, path, *path.pen);
+}
+
+inline void CanvasWidget::drawConnection(
+	QPainter& painter,
+	const Path& path,
+	const QPen& pen
+) {
+	painter.setPen(pen);
 	painter.drawPath(path.path);
 }
 
+void CanvasWidget::renderConnectionLayer() {
+	qreal ratio = devicePixelRatioF();
+	QSize layerSize = size() * ratio;
+
+	if (m_connectionLayer.size() != layerSize)
+		m_connectionLayer = QPixmap(layerSize);
+
+	m_connectionLayer.setDevicePixelRatio(ratio);
+	m_connectionLayer.fill(Qt::transparent);
+
+	QPainter painter(&m_connectionLayer);
+	drawConnections(painter);
+
+	m_connectionLayerValid = true;
+}
+
+void CanvasWidget::drawConnections(QPainter& painter) {
+	// Smooth curves are not worth their cost while the content keeps moving.
+	painter.setRenderHint(QPainter::Antialiasing, !m_scrolling);
+
+	// Paths are kept in no particular order, subconnections go on top.
+	for (auto& path: m_paths) {
+		if (!path.sub)
+			drawConnection(painter, path);
+	}
+	if (!m_subconnectionMesh.has_value()) {
+		for (auto& path: m_paths) {
+			if (path.sub)
+				drawConnection(painter, path);
+		}
+	}
+
+	// Dense subconnections are stroked at once, with a solid pen and without
+	// antialiasing.
+	if (m_subconnectionMesh.has_value()) {
+		painter.setRenderHint(QPainter::Antialiasing, false);
+		painter.setPen(m_meshPen);
+		painter.drawPath(m_subconnectionMesh.value());
+	}
+
+	painter.setRenderHint(QPainter::Antialiasing, true);
+}
+
+void CanvasWidget::updateSubconnectionMesh() {
+	m_subconnectionMesh = std::nullopt;
+	if (!m_levelOfDetail)
+		return;
+
+	size_t count = 0, segments = 0;
+	for (auto& path: m_paths) {
+		if (!path.sub)
+			continue;
+		count++;
+		segments += std::max((qsizetype)1, path.polyline.size() - 1);
+	}
+
+	if (count <= meshThreshold)
+		return;
+
+	// Flattened curves as long as they fit into the budget, straight lines
+	// between the ends otherwise.
+	bool straight = segments > segmentBudget;
+	QPainterPath mesh;
+
+	for (auto& path: m_paths) {
+		if (!path.sub || path.polyline.size() == 0)
+			continue;
+
+		if (straight) {
+			mesh.moveTo(path.polyline.first());
+			mesh.lineTo(path.polyline.last());
+		} else {
+			mesh.addPolygon(path.polyline);
+		}
+	}
+
+	m_subconnectionMesh = mesh;
+}
+
+void CanvasWidget::updatePathRegion(const Path& path) {
+	if (m_renderer != CanvasRenderer::Retained) {
+		update();
+		return;
+	}
+
+	// Pen width plus a pixel on each side for antialiasing.
+	qreal margin = std::max(path.pen->widthF(), m_highlightPen.widthF()) + 1.0;
+	update(
+		path.path.boundingRect()
+			.adjusted(-margin, -margin, margin, margin)
+			.toAlignedRect()
+	);
+}
+
 void CanvasWidget::updateLayout() {
 	if (m_layout == nullptr)
 		return;
@@ -389,145 +542,412 @@ void CanvasWidget::updateLayout() {
 
 	QPoint cursor = mapFromGlobal(QCursor::pos());
 	const std::unordered_map<ThoughtId, ItemLayout> *items = m_layout->items();
+	const std::unordered_set<ThoughtId> *changed = m_layout->changedItems();
 
 	// Layout scroll areas first.
 	layoutScrollAreas();
 
+	// Partial update, only touch widgets of changed items.
+	if (changed != nullptr) {
+		finishTransition();
+
+		for (auto id: *changed) {
+			if (auto found = items->find(id); found != items->end()) {
+				layoutWidget(found->second, id == *main, cursor);
+			} else if (auto widget = m_widgets.find(id); widget != m_widgets.end()) {
+				if (id != *main)
+					releaseWidget(widget);
+			}
+		}
+
+		updatePaths(changed);
+		return;
+	}
+
+	// When another thought gets selected, widgets move to their new places
+	// from wherever they are now, even in the middle of another transition.
+	bool transition = m_animated && isVisible() &&
+		m_lastRoot != InvalidThoughtId && m_lastRoot != *main;
+	std::unordered_map<ThoughtWidget*, QRect> starts;
+	QRect origin;
+
+	if (transition) {
+		for (auto& [id, widget]: m_widgets) {
+			if (widget->parent() != nullptr)
+				starts.insert({widget, widget->geometry()});
+		}
+		if (auto *widget = cachedWidget(*main); widget != nullptr)
+			origin = widget->geometry();
+
+		// Current transition is replaced by the new one.
+		m_transitionTimer.stop();
+		m_transitions.clear();
+	} else {
+		finishTransition();
+	}
+
 	// Layout all widgets.
 	std::unordered_map<ThoughtId, ItemLayout>::const_iterator it;
 	for (it = items->begin(); it != items->end(); it++) {
-		ThoughtWidget *widget = cachedWidget(it->first);
+		layoutWidget(it->second, it->first == *main, cursor);
+	}
 
-		if (widget == nullptr) {
-			widget = createWidget(it->second, it->first != *main);
-		} else {
-			// Important: remove focus BEFORE setting read-only state,
-			// otherwise widget will retain "hidden" focus and will get
-			// automatically reactivated when selected again.
-			if (it->first != *main && widget->isActive())
-				widget->removeFocus();
-			if (it->first != *main)
-				widget->removeHover();
-
-			widget->setReadOnly(it->first != *main);
-
-			if (widget->text() != it->second.name)
-				widget->setText(it->second.name);
+	// Remove unused widgets. Only items in the visible part of the layout have
+	// widgets, the rest are released so their number stays bounded no matter
+	// how many thoughts are scrolled through.
+	std::unordered_map<ThoughtId, ThoughtWidget*>::iterator wit;
+	for (wit = m_widgets.begin(); wit != m_widgets.end();) {
+		if (wit->first == *main || items->find(wit->first) != items->end()) {
+			wit++;
+			continue;
 		}
 
-		// Save the widget to the cache.
-		m_widgets.insert_or_assign(it->first, widget);
+		wit = releaseWidget(wit);
+	}
 
-		const ItemLayout& layout = it->second;
+	m_lastRoot = *main;
+	if (transition)
+		startTransition(starts, origin);
 
-		// Set widget's link orientation and connection markers.
-		widget->setRightSideLink(layout.rightSideLink);
-		widget->setHasParent(layout.hasParents);
-		widget->setHasChild(layout.hasChildren);
-		widget->setHasLink(layout.hasLinks);
-		widget->setCanDelete(layout.canDelete);
-		widget->setFocused(it->first == *main);
+	// Recalculate paths.
+	updatePaths();
+}
 
-		// Place the widget in the canvas.
-		widget->setGeometry(
-			layout.x, layout.y,
-			layout.w, layout.h
-		);
-		if (widget->isActive() || (
-			(cursor.x() >= layout.x) && (cursor.x() <= layout.x + layout.w) &&
-			(cursor.y() >= layout.y) && (cursor.y() <= layout.y + layout.h)
-		)) {
-			onWidgetActivated(widget);
-		}
+void CanvasWidget::layoutWidget(
+	const ItemLayout& layout,
+	bool isMain,
+	QPoint cursor
+) {
+	ThoughtWidget *widget = cachedWidget(layout.id);
+
+	if (widget == nullptr) {
+		widget = reuseWidget(layout, !isMain);
+	} else {
+		// Important: remove focus BEFORE setting read-only state,
+		// otherwise widget will retain "hidden" focus and will get
+		// automatically reactivated when selected again.
+		if (!isMain && widget->isActive())
+			widget->removeFocus();
+		if (!isMain)
+			widget->removeHover();
+
+		widget->setReadOnly(!isMain);
+
+		if (widget->text() != layout.name)
+			widget->setText(layout.name);
+	}
 
-		// We raise the widget to prevent it being obstructed by scroll areas and
-		// any decorator/background view.
-		widget->raise();
+	// Save the widget to the cache.
+	m_widgets.insert_or_assign(layout.id, widget);
 
-		// Reset the parent in case the widget is a newly created one.
-		widget->setParent(this);
+	// Set widget's link orientation and connection markers.
+	widget->setRightSideLink(layout.rightSideLink);
+	widget->setHasParent(layout.hasParents);
+	widget->setHasChild(layout.hasChildren);
+	widget->setHasLink(layout.hasLinks);
+	widget->setCanDelete(layout.canDelete);
+	widget->setFocused(isMain);
 
-		// Trigger visiblility/repaint in case the wieget is a newly created one.
-		widget->show();
+	// Place the widget in the canvas.
+	widget->setGeometry(
+		layout.x, layout.y,
+		layout.w, layout.h
+	);
+	if (widget->isActive() || (
+		(cursor.x() >= layout.x) && (cursor.x() <= layout.x + layout.w) &&
+		(cursor.y() >= layout.y) && (cursor.y() <= layout.y + layout.h)
+	)) {
+		onWidgetActivated(widget);
 	}
 
-	// Remove unused widgets.
-	std::unordered_map<ThoughtId, ThoughtWidget*>::iterator wit;
-	for (wit = m_widgets.begin(); wit != m_widgets.end(); wit++) {
-		if (wit->first == *main) {
-			continue;
+	// We raise the widget to prevent it being obstructed by scroll areas and
+	// any decorator/background view.
+	widget->raise();
+
+	// Reset the parent in case the widget is a newly created one.
+	widget->setParent(this);
+
+	// Trigger visiblility/repaint in case the wieget is a newly created one.
+	widget->show();
+}
+
+/**
+ * Makes paths for connections between widgets on the canvas. Paths whose ends
+ * haven't moved are reused. When the layout tells which items have changed,
+ * only paths attached to them are removed and made again, so the update
+ * costs as much as the number of moved widgets, not of all connections.
+ */
+void CanvasWidget::updatePaths(const std::unordered_set<ThoughtId> *changed) {
+	if (m_layout == nullptr) {
+		return;
+	}
+
+	// Highlight is kept if its connection is still there.
+	std::optional<PathKey> highlight;
+	if (m_pathHighlight.has_value()) {
+		highlight = keyOf(m_paths[m_pathHighlight.value()]);
+		m_pathHighlight = std::nullopt;
+	}
+
+	PathMap previous;
+	bool updated = false, subUpdated = false;
+
+	if (changed == nullptr) {
+		// Clear old paths.
+		for (auto& path: m_paths)
+			previous.insert_or_assign(keyOf(path), std::move(path));
+		m_paths.clear();
+		m_pathSlots.clear();
+		m_thoughtPaths.clear();
+		m_pathIndex.clear();
+		updated = subUpdated = true;
+
+		// Main connections.
+		const std::vector<ItemConnection> *connections = m_layout->connections();
+		if (connections != nullptr) {
+			for (auto& connection: *connections)
+				addPath(connection, false, previous);
 		}
 
-		if (items->find(wit->first) != items->end()) {
-			continue;
+		// These connect nodes placed around the main node with each other.
+		const std::vector<ItemConnection> *subconnections = m_layout->subconnections();
+		if (subconnections != nullptr) {
+			for (auto& connection: *subconnections)
+				addPath(connection, true, previous);
+		}
+	} else {
+		for (auto id: *changed) {
+			auto found = m_thoughtPaths.find(id);
+			if (found == m_thoughtPaths.end())
+				continue;
+
+			// Removal edits the set.
+			std::vector<PathKey> keys(found->second.begin(), found->second.end());
+			for (auto& key: keys) {
+				if (removePath(key, &previous)) {
+					updated = true;
+					subUpdated = subUpdated || key.sub;
+				}
+			}
 		}
 
-		// Hide.
-		wit->second->setParent(nullptr);
+		std::vector<ItemConnection> connections, subconnections;
+		for (auto id: *changed) {
+			connections.clear();
+			subconnections.clear();
+			m_layout->connectionsOf(id, &connections, &subconnections);
+
+			for (auto& connection: connections)
+				updated = addPath(connection, false, previous) || updated;
+			for (auto& connection: subconnections) {
+				if (addPath(connection, true, previous))
+					updated = subUpdated = true;
+			}
+		}
 	}
 
-	// Recalculate paths.
-	updatePaths();
+	if (subUpdated)
+		updateSubconnectionMesh();
+	if (updated)
+		m_connectionLayerValid = false;
+
+	if (highlight.has_value()) {
+		if (auto found = m_pathSlots.find(highlight.value()); found != m_pathSlots.end())
+			m_pathHighlight = found->second;
+	}
 }
 
-void CanvasWidget::updatePaths() {
-	if (m_layout == nullptr) {
-		return;
+/**
+ * Adds the path of the connection if both of its widgets are on the canvas,
+ * reusing the previous one if it connects the same widgets at the same
+ * anchors. Returns false if the path wasn't added.
+ */
+bool CanvasWidget::addPath(
+	const ItemConnection& connection,
+	bool sub,
+	PathMap& previous
+) {
+	PathKey key = PathKey{connection.from, connection.to, sub};
+	if (m_pathSlots.find(key) != m_pathSlots.end())
+		return false;
+
+	auto fromIt = m_widgets.find(connection.from);
+	if (fromIt == m_widgets.end() || fromIt->second->parent() == nullptr)
+		return false;
+
+	auto toIt = m_widgets.find(connection.to);
+	if (toIt == m_widgets.end() || toIt->second->parent() == nullptr)
+		return false;
+
+	const QPen *pen = sub ? &m_subconnectionPen : &m_connectionPen;
+	AnchorPoint outgoing = fromIt->second->getAnchorFrom(connection.type);
+	AnchorPoint incoming = toIt->second->getAnchorTo(connection.type);
+
+	// Reuse the path if it connects the same widgets at the same anchors.
+	auto found = previous.find(key);
+	if (found != previous.end()) {
+		const Path& path = found->second;
+		if (
+			path.from == fromIt->second &&
+			path.to == toIt->second &&
+			path.pen == pen &&
+			sameAnchor(path.outgoing, outgoing) &&
+			sameAnchor(path.incoming, incoming)
+		) {
+			insertPath(std::move(found->second));
+			previous.erase(found);
+			return true;
+		}
 	}
 
-	// Main connections.
-	const std::vector<ItemConnection> *connections = m_layout->connections();
-	if (connections == nullptr || connections->size() == 0) {
-		return;
+	Path path = makePath(fromIt->second, toIt->second, outgoing, incoming, pen);
+	path.fromId = connection.from;
+	path.toId = connection.to;
+	path.sub = sub;
+
+	// Flatten the curve once for hit testing.
+	for (auto& polygon: path.path.toSubpathPolygons())
+		path.polyline += polygon;
+
+	insertPath(std::move(path));
+	return true;
+}
+
+void CanvasWidget::insertPath(Path path) {
+	PathKey key = keyOf(path);
+	size_t idx = m_paths.size();
+
+	m_pathSlots.insert({key, idx});
+	m_thoughtPaths[key.from].insert(key);
+	m_thoughtPaths[key.to].insert(key);
+	m_pathIndex.add(idx, path.polyline);
+	m_paths.push_back(std::move(path));
+}
+
+/**
+ * Moves the path out to `removed`. The last path takes its place, so paths
+ * stay packed for painting.
+ */
+bool CanvasWidget::removePath(PathKey key, PathMap *removed) {
+	auto found = m_pathSlots.find(key);
+	if (found == m_pathSlots.end())
+		return false;
+
+	size_t idx = found->second;
+	m_pathSlots.erase(found);
+
+	for (ThoughtId end: {key.from, key.to}) {
+		auto paths = m_thoughtPaths.find(end);
+		if (paths == m_thoughtPaths.end())
+			continue;
+
+		paths->second.erase(key);
+		if (paths->second.empty())
+			m_thoughtPaths.erase(paths);
+	}
+
+	m_pathIndex.remove(idx);
+	removed->insert_or_assign(key, std::move(m_paths[idx]));
+
+	size_t last = m_paths.size() - 1;
+	if (idx != last) {
+		m_paths[idx] = std::move(m_paths[last]);
+		m_pathSlots[keyOf(m_paths[idx])] = idx;
+		m_pathIndex.renumber(last, idx);
 	}
+	m_paths.pop_back();
 
-	// Clear old paths.
-	m_paths.clear();
+	return true;
+}
+
+CanvasWidget::PathKey CanvasWidget::keyOf(const Path& path) {
+	return PathKey{path.fromId, path.toId, path.sub};
+}
 
-	QColor color = m_style->browser.anchorActive;
-	QPen pen = QPen(color, 1);
+// Transitions.
 
-	for (auto& connection: *connections) {
-		auto fromIt = m_widgets.find(connection.from);
-		if (fromIt == m_widgets.end() || fromIt->second->parent() == nullptr)
+void CanvasWidget::startTransition(
+	const std::unordered_map<ThoughtWidget*, QRect>& starts,
+	QRect origin
+) {
+	m_transitions.clear();
+
+	for (auto& [id, widget]: m_widgets) {
+		if (widget->parent() == nullptr)
 			continue;
 
-		auto toIt = m_widgets.find(connection.to);
-		if (toIt == m_widgets.end() || toIt->second->parent() == nullptr)
+		QRect to = widget->geometry();
+		QRect from;
+
+		// Widgets that weren't on the canvas come out of the selected thought.
+		if (auto found = starts.find(widget); found != starts.end()) {
+			from = found->second;
+		} else if (origin.isValid()) {
+			from = QRect(QPoint(0, 0), to.size());
+			from.moveCenter(origin.center());
+		} else {
 			continue;
+		}
 
-		AnchorPoint outgoing = fromIt->second->getAnchorFrom(connection.type);
-		AnchorPoint incoming = toIt->second->getAnchorTo(connection.type);
+		if (from == to)
+			continue;
 
-		Path path = makePath(fromIt->second, toIt->second, outgoing, incoming, pen);
-		m_paths.push_back(path);
+		m_transitions.push_back(Transition{.widget = widget, .from = from, .to = to});
+		widget->setGeometry(from);
 	}
 
-	// These connect nodes placed around the main node with each other.
-	const std::vector<ItemConnection> *subconnections = m_layout->subconnections();
-	if (subconnections == nullptr || subconnections->size() == 0) {
+	if (m_transitions.size() == 0) {
+		m_transitionTimer.stop();
 		return;
 	}
 
-	QPen subPen = QPen(color, 0.5);
-	subPen.setStyle(Qt::DashLine);
-	subPen.setDashPattern({4, 2});
+	m_transitionClock.start();
+	m_transitionTimer.start();
+}
 
-	for (auto& connection: *subconnections) {
-		auto fromIt = m_widgets.find(connection.from);
-		if (fromIt == m_widgets.end() || fromIt->second->parent() == nullptr)
-			continue;
+void CanvasWidget::finishTransition() {
+	if (m_transitions.size() == 0)
+		return;
 
-		auto toIt = m_widgets.find(connection.to);
-		if (toIt == m_widgets.end() || toIt->second->parent() == nullptr)
-			continue;
+	m_transitionTimer.stop();
+	for (auto& transition: m_transitions)
+		transition.widget->setGeometry(transition.to);
+	m_transitions.clear();
 
-		AnchorPoint outgoing = fromIt->second->getAnchorFrom(connection.type);
-		AnchorPoint incoming = toIt->second->getAnchorTo(connection.type);
+	updatePaths();
+	update();
+}
+
+void CanvasWidget::onTransitionStep() {
+	qreal progress = std::min(
+		1.0,
+		(qreal)m_transitionClock.elapsed() / (qreal)transitionDuration
+	);
 
-		Path path = makePath(fromIt->second, toIt->second, outgoing, incoming, subPen);
-		m_paths.push_back(path);
+	if (progress >= 1.0) {
+		finishTransition();
+		return;
 	}
+
+	qreal value = QEasingCurve(QEasingCurve::OutCubic).valueForProgress(progress);
+	auto lerp = [value](int from, int to) {
+		return (int)std::round(from + (to - from) * value);
+	};
+
+	for (auto& transition: m_transitions) {
+		const QRect& from = transition.from;
+		const QRect& to = transition.to;
+		transition.widget->setGeometry(
+			lerp(from.x(), to.x()),
+			lerp(from.y(), to.y()),
+			lerp(from.width(), to.width()),
+			lerp(from.height(), to.height())
+		);
+	}
+
+	// Connections follow the widgets.
+	updatePaths();
+	update();
 }
 
 // Scroll areas.
@@ -571,6 +991,20 @@ void CanvasWidget::layoutScrollAreas() {
 
 // Caching widgets.
 
+CanvasWidget::WidgetMap::iterator CanvasWidget::releaseWidget(
+	WidgetMap::iterator it
+) {
+	// Connection editing keeps a pointer to the source widget, so it's only
+	// hidden until the editing is over.
+	if (m_anchorSource != nullptr && m_anchorSource->widget == it->second) {
+		it->second->setParent(nullptr);
+		return ++it;
+	}
+
+	recycleWidget(it->second);
+	return m_widgets.erase(it);
+}
+
 ScrollAreaWidget *CanvasWidget::cachedScrollArea(unsigned int id) {
 	if (auto search = m_scrollAreas.find(id); search != m_scrollAreas.end()) {
 		return search->second;
@@ -617,6 +1051,60 @@ ThoughtWidget *CanvasWidget::createWidget(
 	return widget;
 }
 
+ThoughtWidget *CanvasWidget::reuseWidget(
+	const ItemLayout& layout,
+	bool readonly
+) {
+	if (m_recycled.size() == 0)
+		return createWidget(layout, readonly);
+
+	ThoughtWidget *widget = m_recycled.back();
+	m_recycled.pop_back();
+
+	// Same as the update of a cached widget, and the rest of the properties are
+	// set by the layout.
+	widget->removeFocus();
+	widget->removeHover();
+	widget->setId(layout.id);
+	widget->setReadOnly(readonly);
+	widget->setText(layout.name);
+
+	return widget;
+}
+
+void CanvasWidget::recycleWidget(ThoughtWidget *widget) {
+	// Drop everything that refers to the widget by pointer, it can represent a
+	// different thought after it's reused.
+	if (m_overThought == widget) {
+		m_overThought->setHighlight(false);
+		m_overThought = nullptr;
+	}
+	if (m_menuThought == widget)
+		m_menuThought = nullptr;
+	if (m_pathHighlight.has_value()) {
+		const Path& path = m_paths[m_pathHighlight.value()];
+		if (path.from == widget || path.to == widget)
+			m_pathHighlight = std::nullopt;
+	}
+	for (auto it = m_transitions.begin(); it != m_transitions.end();) {
+		if (it->widget == widget) {
+			it = m_transitions.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	// Hide.
+	widget->setParent(nullptr);
+
+	if (m_recycled.size() < recycleLimit) {
+		m_recycled.push_back(widget);
+	} else {
+		// The widget can be the sender of the signal that caused this update.
+		widget->deleteLater();
+	}
+}
+
 void CanvasWidget::connectWidget(ThoughtWidget *widget) {
 	connect(
 		widget, SIGNAL(clicked(ThoughtWidget*)),
@@ -677,6 +1165,9 @@ void CanvasWidget::onWidgetClicked(ThoughtWidget* widget) {
 }
 
 void CanvasWidget::onWidgetActivated(ThoughtWidget* widget) {
+	// Expanding a widget while it moves would be undone by the next step.
+	finishTransition();
+
 	QPoint wpos = widget->pos();
 	QSize wsize = widget->size();
 	QSize center = QSize(
@@ -711,8 +1202,9 @@ void CanvasWidget::onWidgetActivated(ThoughtWidget* widget) {
 		fullSize.width(), fullSize.height()
 	);
 
-	// Repaint to update connections.
-	updatePaths();
+	// Repaint to update connections of the widget.
+	std::unordered_set<ThoughtId> changed = {widget->id()};
+	updatePaths(&changed);
 	update();
 }
 
@@ -729,8 +1221,9 @@ void CanvasWidget::onWidgetDeactivated(ThoughtWidget* widget) {
 		);
 	}
 
-	// Repaint to update connections.
-	updatePaths();
+	// Repaint to update connections of the widget.
+	std::unordered_set<ThoughtId> changed = {widget->id()};
+	updatePaths(&changed);
 	update();
 }
 
@@ -759,10 +1252,20 @@ void CanvasWidget::onScrollAreaScroll(unsigned int id, int value) {
 	if (m_layout == nullptr)
 		return;
 
+	// Draw faster until scrolling settles.
+	m_scrolling = true;
+	m_scrollTimer.start();
+
 	// Reload layout to update visible widgets.
 	m_layout->onScroll(id, value);
 }
 
+void CanvasWidget::onScrollSettled() {
+	m_scrolling = false;
+	m_connectionLayerValid = false;
+	update();
+}
+
 void CanvasWidget::onAnchorEntered(
 	ThoughtWidget* widget,
 	AnchorType type,
@@ -1015,6 +1518,8 @@ void CanvasWidget::onCreateConfirmed(
 			// Set widget's ID and add it to the list of widgets.
 			widget->setId(id);
 			widget->setAnchorsActive(true);
+			if (auto *old = this->cachedWidget(id); old != nullptr && old != widget)
+				this->recycleWidget(old);
 			this->m_widgets.insert_or_assign(id, widget);
 			this->m_newThought = nullptr;
 			// Clear editing widgets and connections.
@@ -1095,12 +1600,12 @@ void CanvasWidget::onDisconnect() {
 		return;
 	}
 
-	Path path = m_pathHighlight.value();
+	const Path& path = m_paths[m_pathHighlight.value()];
 	if (path.from == nullptr || path.to == nullptr) {
 		return;
 	}
 
-	emit thoughtsDisconnected(path.from->id(), path.to->id());
+	emit thoughtsDisconnected(path.fromId, path.toId);
 
 	// Cleanup.
 	m_pathHighlight = std::nullopt;
@@ -1131,6 +1636,10 @@ void CanvasWidget::clearAnchor() {
 	update();
 }
 
+inline bool CanvasWidget::sameAnchor(const AnchorPoint& a, const AnchorPoint& b) {
+	return a.x == b.x && a.y == b.y && a.dx == b.dx && a.dy == b.dy;
+}
+
 inline AnchorType CanvasWidget::reverseAnchorType(AnchorType type) {
 	switch (type) {
 		case AnchorType::AnchorParent:
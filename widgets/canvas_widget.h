@@ -2,13 +2,18 @@
 #define H_BASE_CANVAS_WIDGET
 
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <QWidget>
 #include <QResizeEvent>
 #include <QWheelEvent>
 #include <QPainterPath>
+#include <QPolygonF>
+#include <QPixmap>
 #include <QMouseEvent>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include "layout/base_layout.h"
 #include "widgets/style.h"
@@ -18,6 +23,7 @@
 #include "widgets/thought_widget.h"
 #include "widgets/scroll_area_widget.h"
 #include "widgets/connection_list_widget.h"
+#include "layout/path_index.h"
 
 struct AnchorSource {
 	ThoughtWidget *widget;
@@ -25,11 +31,29 @@ struct AnchorSource {
 	AnchorSource(ThoughtWidget *w, AnchorType t): widget(w), type(t) {}
 };
 
+/**
+ * How connections are painted.
+ *
+ * Immediate: every connection is drawn on each paint event.
+ * Retained: connections are rasterized into a layer once per layout change,
+ * paint events copy the damaged part of it, and the hover highlight only
+ * repaints the area around the affected connections.
+ */
+enum CanvasRenderer { Immediate, Retained };
+
 struct Path {
 	ThoughtWidget *from, *to;
-	QPen pen;
+	// Pen owned by the canvas.
+	const QPen *pen;
 	QPainterPath path;
-	Path(ThoughtWidget *_l, ThoughtWidget *_r, QPen& _pen, QPainterPath& _path)
+	// Flattened path for hit testing, only for connection paths.
+	QPolygonF polyline;
+	// Connection and anchors the path was made for. The path is reused as long
+	// as they stay the same.
+	ThoughtId fromId = InvalidThoughtId, toId = InvalidThoughtId;
+	bool sub = false;
+	AnchorPoint outgoing = {}, incoming = {};
+	Path(ThoughtWidget *_l, ThoughtWidget *_r, const QPen *_pen, QPainterPath& _path)
 		: from(_l), to(_r), pen(_pen), path(_path) {}
 };
 
@@ -40,6 +64,15 @@ public:
 	CanvasWidget(QWidget*, Style*, BaseLayout*);
 	~CanvasWidget();
 	QSize sizeHint() const override;
+	// Rendering.
+	const CanvasRenderer renderer() const;
+	void setRenderer(CanvasRenderer);
+	// Simplified drawing of dense subconnections and of scrolling content.
+	const bool levelOfDetail() const;
+	void setLevelOfDetail(bool);
+	// Animated transitions when another thought gets selected.
+	const bool animated() const;
+	void setAnimated(bool);
 	// Suggestions.
 	void showSuggestions(std::vector<ConnectionItem>);
 	void hideSuggestions();
@@ -68,10 +101,32 @@ protected:
 private:
 	BaseLayout *m_layout = nullptr;
 	// Main content widgets.
-	std::unordered_map<ThoughtId, ThoughtWidget*> m_widgets;
+	typedef std::unordered_map<ThoughtId, ThoughtWidget*> WidgetMap;
+	WidgetMap m_widgets;
+	// Widgets released by the layout, ready to be reused for other thoughts.
+	std::vector<ThoughtWidget*> m_recycled;
 	std::unordered_map<unsigned int, ScrollAreaWidget*> m_scrollAreas;
 	// Connections.
 	std::vector<Path> m_paths;
+	PathIndex m_pathIndex;
+	// Rendering.
+	CanvasRenderer m_renderer = CanvasRenderer::Immediate;
+	QPixmap m_connectionLayer;
+	bool m_connectionLayerValid = false;
+	void renderConnectionLayer();
+	void updatePathRegion(const Path&);
+	// Transitions.
+	struct Transition {
+		ThoughtWidget *widget;
+		QRect from, to;
+	};
+	bool m_animated = true;
+	ThoughtId m_lastRoot = InvalidThoughtId;
+	std::vector<Transition> m_transitions;
+	QTimer m_transitionTimer;
+	QElapsedTimer m_transitionClock;
+	void startTransition(const std::unordered_map<ThoughtWidget*, QRect>&, QRect);
+	void finishTransition();
 	// Anchor highlight.
 	AnchorHighlightWidget m_anchorHighlight;
 	// Thought/connection creation.
@@ -80,7 +135,8 @@ private:
 	ThoughtWidget *m_overThought = nullptr;
 	ThoughtWidget *m_menuThought = nullptr;
 	QWidget m_overlay;
-	std::optional<Path> m_pathHighlight;
+	// Index of the highlighted path in m_paths.
+	std::optional<size_t> m_pathHighlight;
 	// Errors
 	ToastWidget *m_error = nullptr;
 	// Suggestions.
@@ -89,29 +145,83 @@ private:
 	void layoutSuggestions();
 	// Layout.
 	void updateLayout();
-	void updatePaths();
-	Path makePath(ThoughtWidget*, ThoughtWidget*, AnchorPoint, AnchorPoint, QPen&);
+	void layoutWidget(const ItemLayout&, bool, QPoint);
+	WidgetMap::iterator releaseWidget(WidgetMap::iterator);
+	// Paths.
+	struct PathKey {
+		ThoughtId from, to;
+		bool sub;
+		bool operator==(const PathKey& other) const {
+			return from == other.from && to == other.to && sub == other.sub;
+		}
+	};
+	struct PathKeyHash {
+		size_t operator()(const PathKey& key) const {
+			return std::hash<ThoughtId>()(key.from) * 31
+				^ std::hash<ThoughtId>()(key.to) * 2
+				^ key.sub;
+		}
+	};
+	typedef std::unordered_map<PathKey, Path, PathKeyHash> PathMap;
+	// Position of every path in m_paths, which is also its ID in the index,
+	// and paths attached to every thought.
+	std::unordered_map<PathKey, size_t, PathKeyHash> m_pathSlots;
+	std::unordered_map<ThoughtId, std::unordered_set<PathKey, PathKeyHash>> m_thoughtPaths;
+	QPen m_connectionPen;
+	QPen m_subconnectionPen;
+	QPen m_highlightPen;
+	// Level of detail.
+	bool m_levelOfDetail = true;
+	bool m_scrolling = false;
+	QTimer m_scrollTimer;
+	QPen m_meshPen;
+	// Subconnections merged into one path when there are too many of them.
+	std::optional<QPainterPath> m_subconnectionMesh;
+	void updateSubconnectionMesh();
+	void drawConnections(QPainter&);
+	void updatePaths(const std::unordered_set<ThoughtId>* = nullptr);
+	bool addPath(const ItemConnection&, bool, PathMap&);
+	void insertPath(Path);
+	bool removePath(PathKey, PathMap*);
+	static PathKey keyOf(const Path&);
+	Path makePath(ThoughtWidget*, ThoughtWidget*, AnchorPoint, AnchorPoint, const QPen*);
 	void layoutScrollAreas();
 	void drawAnchorConnection(QPainter&);
 	void drawNewThoughtConnection(QPainter& painter);
 	void drawOverThoughtConnection(QPainter& painter);
-	void drawConnection(QPainter& painter, Path&);
+	void drawConnection(QPainter& painter, const Path&);
+	void drawConnection(QPainter& painter, const Path&, const QPen&);
 	ThoughtWidget *cachedWidget(ThoughtId id);
 	ThoughtWidget *createWidget(const ItemLayout&, bool);
+	ThoughtWidget *reuseWidget(const ItemLayout&, bool);
+	void recycleWidget(ThoughtWidget*);
 	void connectWidget(ThoughtWidget*);
 	ScrollAreaWidget *cachedScrollArea(unsigned int id);
 	ScrollAreaWidget *createScrollArea(unsigned int id, ScrollBarPos);
 	// Helpers.
 	void clearAnchor();
 	AnchorType reverseAnchorType(AnchorType type);
+	static bool sameAnchor(const AnchorPoint&, const AnchorPoint&);
 	ThoughtWidget *widgetUnder(QPoint);
 	void setupNewThought();
 	void updateConnection();
 	// Layout constants.
 	static constexpr qreal controlPointRatio = 0.5;
 	static constexpr int minAnchorDistance = 25;
+	static constexpr qreal pathCaptureDistance = 10.0;
+	// Max number of released widgets kept for reuse.
+	static constexpr size_t recycleLimit = 32;
+	// Level of detail limits.
+	static constexpr size_t meshThreshold = 200;
+	static constexpr size_t segmentBudget = 20000;
+	static constexpr int scrollSettleDelay = 150;
+	// Transition timing, in milliseconds.
+	static constexpr int transitionDuration = 200;
+	static constexpr int transitionInterval = 16;
 
 private slots:
+	void onTransitionStep();
+	void onScrollSettled();
 	void onWidgetClicked(ThoughtWidget*);
 	void onWidgetActivated(ThoughtWidget*);
 	void onWidgetDeactivated(ThoughtWidget*);
@@ -2,6 +2,8 @@
 #include <QString>
 #include <QPushButton>
 #include <QLabel>
+#include <QVBoxLayout>
+#include <QColor>
 #include <QPaintEvent>
 #include <QPainter>
 #include <QStyle>
@@ -19,7 +21,8 @@ ConnectionItemWidget::ConnectionItemWidget(
 	Style *style,
 	bool showButtons,
 	ThoughtId id,
-	QString name
+	QString name,
+	QString snippet
 ) : BaseWidget(parent, style),
 	m_id(id),
 	m_name(name),
@@ -40,7 +43,30 @@ ConnectionItemWidget::ConnectionItemWidget(
 	);
 	titleLabel->setMinimumWidth(40);
 	titleLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
-	m_layout.addWidget(titleLabel);
+	QVBoxLayout *textLayout = new QVBoxLayout();
+	textLayout->setContentsMargins(QMargins(0, 0, 0, 0));
+	textLayout->setSpacing(2);
+	textLayout->addWidget(titleLabel);
+
+	// Setup snippet.
+	if (!snippet.isEmpty()) {
+		QColor color = style->editor.text;
+		ElidedLabelWidget *snippetLabel = new ElidedLabelWidget(
+			nullptr, snippet.simplified(), false
+		);
+		snippetLabel->setStyleSheet(
+			QString("color: rgba(%1, %2, %3, 60%); font: %4px \"%5\"")
+				.arg(color.red())
+				.arg(color.green())
+				.arg(color.blue())
+				.arg(style->editor.textFont.pixelSize() - 2)
+				.arg(style->editor.textFont.family())
+		);
+		snippetLabel->setMinimumWidth(40);
+		snippetLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+		textLayout->addWidget(snippetLabel);
+	}
+	m_layout.addLayout(textLayout);
 
 	// Setup buttons.
 	if (showButtons) {
@@ -186,6 +212,13 @@ const std::vector<ConnectionItem> &ConnectionListWidget::items() {
 }
 
 void ConnectionListWidget::setItems(std::vector<ConnectionItem> items) {
+	// Results for the same search can arrive more than once. Keep widgets
+	// and selection if they'd look the same anyway.
+	if (showsSameItems(items)) {
+		m_items = items;
+		return;
+	}
+
 	m_items = items;
 	m_selectedIdx = -1;
 
@@ -203,7 +236,7 @@ void ConnectionListWidget::setItems(std::vector<ConnectionItem> items) {
 
 		ConnectionItemWidget *widget = new ConnectionItemWidget(
 			nullptr, m_style, m_showButtons,
-			item.id, item.name
+			item.id, item.name, item.snippet
 		);
 
 		connect(
@@ -235,6 +268,32 @@ void ConnectionListWidget::setItems(std::vector<ConnectionItem> items) {
 	adjustSize();
 }
 
+bool ConnectionListWidget::showsSameItems(
+	const std::vector<ConnectionItem>& items
+) {
+	int visible = std::min((int)items.size(), MaxItems);
+	if (visible != (int)m_widgets.size())
+		return false;
+
+	// Last visible item has no separator only if it's the last one overall.
+	bool hasMore = items.size() > (size_t)MaxItems;
+	bool hadMore = m_items.size() > (size_t)MaxItems;
+	if (hasMore != hadMore)
+		return false;
+
+	for (int idx = 0; idx < visible; idx++) {
+		if (
+			items[idx].id != m_items[idx].id ||
+			items[idx].name != m_items[idx].name ||
+			items[idx].snippet != m_items[idx].snippet
+		) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 QWidget *ConnectionListWidget::makeSeparator() {
 	QWidget *separator = new QWidget(nullptr);
 
@@ -18,6 +18,8 @@ struct ConnectionItem {
 public:
 	ThoughtId id;
 	QString name;
+	// Fragment of the note text that matched, shown under the name.
+	QString snippet;
 };
 
 // Item widget.
@@ -32,7 +34,7 @@ class ConnectionItemWidget: public BaseWidget {
 	Q_OBJECT
 
 public:
-	ConnectionItemWidget(QWidget*, Style*, bool, ThoughtId, QString);
+	ConnectionItemWidget(QWidget*, Style*, bool, ThoughtId, QString, QString);
 	// Highlighting.
 	void activate();
 	void deactivate();
@@ -104,6 +106,7 @@ private:
 	std::vector<ConnectionItem> m_items;
 	// Helpers.
 	QWidget *makeSeparator();
+	bool showsSameItems(const std::vector<ConnectionItem>&);
 	// Constants.
 	static constexpr int MaxItems = 3;
 };
@@ -44,14 +44,15 @@ text::Paragraph *MarkdownBlock::paragraph() {
 
 void MarkdownBlock::setParagraph(Paragraph *par) {
 	m_par = par;
+	m_layoutDirty = true;
 
-	// Clear previous layouts.
-	for (auto layout: m_layouts)
-		delete layout;
-	m_layouts.clear();
-
-	if (m_par == nullptr)
+	if (m_par == nullptr) {
+		for (auto layout: m_layouts)
+			delete layout;
+		m_layouts.clear();
+		m_sources.clear();
 		return;
+	}
 
 	MarkdownCursor *cursor = nullptr;
 	if (m_provider != nullptr)
@@ -72,30 +73,64 @@ void MarkdownBlock::setParagraph(Paragraph *par) {
 	QList<Line> *lines = par->getLines();
 	assert(lines->size() > 0);
 
+	QFont font = (type == Code)
+		? m_style->editor.monoFont
+		: m_style->editor.textFont;
+
+	// Layouts are kept between updates. Lines that haven't changed keep
+	// their line breaking, see `layoutLines`.
+	while (m_layouts.size() > lines->size()) {
+		delete m_layouts.takeLast();
+		m_sources.removeLast();
+	}
+
 	for (qsizetype i = 0; i < lines->size(); ++i) {
-		QTextLayout *layout = new QTextLayout();
-		layout->setTextOption(opt);
-		layout->setCacheEnabled(true);
-
-		if (par->getType() == Code)
-			layout->setFont(m_style->editor.monoFont);
-		else
-			layout->setFont(m_style->editor.textFont);
-
-		Line line = lines->at(i);
-		if (cursor != nullptr && cursor->block == this && cursor->line == i) {
-			QList<QTextLayout::FormatRange> formats = convertRanges(line.formats);
-			layout->setText(line.text);
+		if (i == m_layouts.size()) {
+			QTextLayout *layout = new QTextLayout();
+			layout->setTextOption(opt);
+			layout->setCacheEnabled(true);
+			m_layouts.push_back(layout);
+			m_sources.push_back({});
+		}
+
+		QTextLayout *layout = m_layouts[i];
+		const Line& line = lines->at(i);
+		bool unfolded = cursor != nullptr && cursor->block == this && cursor->line == i;
+
+		const QString& text = unfolded ? line.text : line.folded;
+		const QList<FormatRange>& source = unfolded ? line.formats : line.foldedFormats;
+
+		// Lines that weren't edited still share data with the text and formats
+		// their layouts were built from, so they are skipped without
+		// comparing or converting anything.
+		if (
+			layout->text().isSharedWith(text) &&
+			m_sources[i].isSharedWith(source) &&
+			layout->font() == font
+		) {
+			continue;
+		}
+
+		m_sources[i] = source;
+		QList<QTextLayout::FormatRange> formats = convertRanges(source);
+
+		// Setting text drops line breaking, other changes need explicit reset.
+		if (layout->text() != text) {
+			layout->setText(text);
 			layout->setFormats(formats);
-		} else {
-			QList<QTextLayout::FormatRange> formats = convertRanges(line.foldedFormats);
-			layout->setText(line.folded);
+		} else if (layout->formats() != formats) {
 			layout->setFormats(formats);
+			layout->clearLayout();
 		}
 
-		m_layouts.push_back(layout);
+		if (layout->font() != font) {
+			layout->setFont(font);
+			layout->clearLayout();
+		}
 	}
 
+	// Let the parent know that the height might have changed.
+	updateGeometry();
 	update();
 }
 
@@ -349,7 +384,7 @@ QSize MarkdownBlock::sizeHint() const {
 	qreal start = margins.left() + formatMargins.left();
 
 	for (qsizetype i = 0; i < m_layouts.size(); i++) {
-		qreal lineY = 0, offset = 0;
+		qreal offset = 0;
 		const QTextLayout *item = m_layouts.at(i);
 
 		text::Line *parLine = &((*m_par->getLines())[i]);
@@ -359,20 +394,7 @@ QSize MarkdownBlock::sizeHint() const {
 
 		QTextLayout *layout = (QTextLayout*)item;
 		layout->setPosition(QPoint(start + offset, height));
-		layout->beginLayout();
-
-		while (true) {
-			QTextLine line = layout->createLine();
-			if (!line.isValid())
-				break;
-
-			line.setLineWidth(lineWidth - offset);
-			line.setPosition(QPointF(0, lineY));
-			height += line.height();
-			lineY += line.height();
-		}
-
-		layout->endLayout();
+		height += layoutLines(layout, lineWidth - offset);
 	}
 
 	return QSize(
@@ -382,6 +404,78 @@ QSize MarkdownBlock::sizeHint() const {
 	);
 }
 
+qreal MarkdownBlock::layoutLines(QTextLayout *layout, qreal width) const {
+	qreal height = 0;
+
+	// Line breaking is still valid if it was done for the same width. Layout
+	// loses its lines when text changes.
+	if (layout->lineCount() > 0 && layout->lineAt(0).width() == width) {
+		for (int idx = 0; idx < layout->lineCount(); idx++)
+			height += layout->lineAt(idx).height();
+		return height;
+	}
+
+	m_lineBreaks++;
+	layout->beginLayout();
+
+	while (true) {
+		QTextLine line = layout->createLine();
+		if (!line.isValid())
+			break;
+
+		line.setLineWidth(width);
+		line.setPosition(QPointF(0, height));
+		height += line.height();
+	}
+
+	layout->endLayout();
+
+	return height;
+}
+
+int MarkdownBlock::layoutHeight() {
+	if (m_layoutDirty || m_layoutWidth != width()) {
+		m_layoutHeight = sizeHint().height();
+		m_layoutWidth = width();
+		m_layoutDirty = false;
+	}
+
+	return m_layoutHeight;
+}
+
+int MarkdownBlock::estimateHeight(text::Paragraph *par, Style *style, int width) {
+	QMargins formatMargins = QMargins(0, 0, 0, 0);
+	text::ParagraphType type = par->getType();
+
+	QFontMetrics fontMetrics = QFontMetrics(style->editor.textFont);
+	if (type == text::Code) {
+		fontMetrics = QFontMetrics(style->editor.monoFont);
+		formatMargins = codeMargins;
+	} else if (type == text::BulletList || type == text::NumberList) {
+		formatMargins = listMargins;
+	}
+
+	int lineWidth = width - formatMargins.left() - formatMargins.right();
+	qreal charWidth = std::max(fontMetrics.averageCharWidth(), 1);
+	int height = formatMargins.top() + formatMargins.bottom();
+
+	// Assume that wrapped lines are filled with characters of average width.
+	// Until the width is known, lines are not wrapped at all.
+	for (auto& line: std::as_const(*par->getLines())) {
+		int offset = (type == text::BulletList || type == text::NumberList)
+			? line.level * listLevelOffset
+			: 0;
+		int wrapped = 1;
+		if (lineWidth - offset > 0) {
+			int chars = std::max(1.0, (lineWidth - offset) / charWidth);
+			wrapped = std::max(1, (int)((line.folded.length() + chars - 1) / chars));
+		}
+		height += wrapped * fontMetrics.height();
+	}
+
+	return height;
+}
+
 void MarkdownBlock::resizeEvent(QResizeEvent *event) {
 	QFrame::resizeEvent(event);
 	updateGeometry();
@@ -391,6 +485,9 @@ void MarkdownBlock::paintEvent(QPaintEvent *event) {
 	if (m_par == nullptr)
 		return;
 
+	// Parent might not have measured the block since the last change.
+	layoutHeight();
+
 	QMargins margins = contentsMargins();
 	QMargins formatMargins = QMargins(0, 0, 0, 0);
 	text::ParagraphType type = m_par->getType();
@@ -547,7 +644,8 @@ void MarkdownBlock::onCursorMove(
 
 	QList<text::Line> *lines = m_par->getLines();
 
-	// TODO: don't relayout everything?
+	// Only lines switching between folded and unfolded text are laid out
+	// again.
 	if (from.line != -1 && from.block == this && from.line < lines->size()) {
 		setParagraph(m_par);
 	} else if (to.line != -1 && to.block == this && to.line < lines->size()) {
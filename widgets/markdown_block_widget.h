@@ -44,6 +44,10 @@ public:
 	void resizeEvent(QResizeEvent*) override;
 	// Geometry.
 	QSize sizeHint() const override;
+	int layoutHeight();
+	// Number of times lines were broken since creation.
+	int lineBreakCount() const { return m_lineBreaks; }
+	static int estimateHeight(text::Paragraph*, Style*, int);
 
 public slots:
 	void onCursorMove(MarkdownCursor, MarkdownCursor);
@@ -55,6 +59,13 @@ private:
 	Style *m_style = nullptr;
 	MarkdownCursorProvider *m_provider = nullptr;
 	QString m_placeholder = "";
+	// Text layout is redone only after changes to paragraph or width.
+	bool m_layoutDirty = true;
+	int m_layoutWidth = -1;
+	int m_layoutHeight = 0;
+	mutable int m_lineBreaks = 0;
+	// Formats each layout was built from.
+	QList<QList<text::FormatRange>> m_sources;
 	// Helpers.
 	QList<QTextLayout::FormatRange> convertRanges(
 		QList<text::FormatRange>
@@ -65,6 +76,7 @@ private:
 		QTextCharFormat
 	);
 	inline int indexOfLine(text::Line*);
+	qreal layoutLines(QTextLayout*, qreal) const;
 	// Layout constants.
 	static constexpr QMargins codeMargins = QMargins(10, 10, 10, 10);
 	static constexpr QMargins listMargins = QMargins(40, 0, 0, 0);
@@ -1,5 +1,7 @@
+#include <functional>
+#include <algorithm>
+
 #include <QWidget>
-#include <QVBoxLayout>
 #include <QScrollArea>
 #include <QColor>
 #include <QMouseEvent>
@@ -12,6 +14,7 @@
 #include <QMenu>
 #include <QDesktopServices>
 #include <QTime>
+#include <QEvent>
 
 #include "model/thought.h"
 #include "widgets/style.h"
@@ -29,11 +32,6 @@ MarkdownEditWidget::MarkdownEditWidget(QWidget *widget, Style *style)
 		QString("background-color: %1;")
 			.arg(style->editor.background.name(QColor::HexRgb))
 	);
-
-	m_layout = new QVBoxLayout(nullptr);
-	m_layout->setSpacing(16);
-	m_layout->setContentsMargins(QMargins(0, 0, 0, 0));
-	setLayout(m_layout);
 }
 
 MarkdownEditWidget::~MarkdownEditWidget() {
@@ -41,9 +39,8 @@ MarkdownEditWidget::~MarkdownEditWidget() {
 		delete m_saveTimer;
 		m_saveTimer = nullptr;
 	}
-	for (auto block: m_blocks)
-		(*block).deleteLater();
-	delete m_layout;
+	for (auto block: m_blockSet)
+		block->deleteLater();
 }
 
 void MarkdownEditWidget::load(QString data) {
@@ -58,21 +55,18 @@ void MarkdownEditWidget::loadInternal(QString& data, bool clearHistory) {
 	m_model = text::TextModel(lines);
 
 	// Clear old blocks.
-	QLayoutItem *child;
-	while (m_layout->count() != 0) {
-		child = m_layout->takeAt(0);
-		if (child->widget() != nullptr) {
-			delete child->widget();
-		}
-		delete child;
-	}
+	for (auto block: m_blockSet)
+		delete block;
 	m_blocks.clear();
+	m_blockSet.clear();
+	m_edits.clear();
 
 	// Reset cursor.
 	m_cursor = MarkdownCursor::empty();
 	m_lastCursor = MarkdownCursor::empty();
+	m_selection.reset();
 
-	// Create blocks.
+	// Prepare blocks.
 	QList<text::Paragraph> *list = m_model.paragraphs();
 
 	if (list->size() == 0) {
@@ -82,31 +76,22 @@ void MarkdownEditWidget::loadInternal(QString& data, bool clearHistory) {
 		list->push_back(emptyParagraph);
 	}
 
+	// Blocks are only created for paragraphs around the viewport. The rest
+	// get estimated heights until they are scrolled to.
+	m_blocks = QList<MarkdownBlock*>(list->size(), nullptr);
+	m_heights.clear();
+	m_heights.reserve(list->size());
 	for (qsizetype i = 0; i < list->size(); ++i) {
-		text::Paragraph *p = &((*list)[i]);
-		QList<text::Line> *lines = p->getLines();
-
-		MarkdownBlock *block = new MarkdownBlock(nullptr, m_style, this);
-		connect(
-			this, &MarkdownEditWidget::onCursorMove,
-			block, &MarkdownBlock::onCursorMove
+		m_heights.push_back(
+			MarkdownBlock::estimateHeight(&((*list)[i]), m_style, width())
 		);
-
-		if (i == 0)
-			block->setPlaceholder(tr("Start typing here..."));
-		block->setParagraph(p);
-
-		m_blocks.push_back(block);
-		m_layout->addWidget(block);
 	}
+	m_topsDirty = true;
 
-	if (clearHistory) {
-		m_textStates.clear();
-		m_textStates.push_back(TextState{.text = data});
-	}
+	if (clearHistory)
+		m_journal.clear();
 
-	m_layout->addStretch();
-	updateGeometry();
+	layoutBlocks();
 }
 
 void MarkdownEditWidget::setPresenter(MarkdownEditPresenter *p) {
@@ -125,10 +110,46 @@ Style *MarkdownEditWidget::style() {
 	return m_style;
 }
 
+void MarkdownEditWidget::setViewport(QRect rect) {
+	if (rect == m_viewport)
+		return;
+
+	// Blocks created above the viewport replace estimates with real heights,
+	// the content in view has to stay where it was.
+	m_viewport = rect;
+	int anchor = anchorParagraph();
+	int anchorTop = blockTop(anchor);
+	if (updateVisibleBlocks())
+		placeBlocks();
+	keepAnchor(anchor, anchorTop);
+}
+
 // Events.
 
+bool MarkdownEditWidget::event(QEvent *event) {
+	// Blocks ask for a relayout when their contents or width change.
+	if (event->type() == QEvent::LayoutRequest)
+		layoutBlocks();
+
+	return BaseWidget::event(event);
+}
+
 void MarkdownEditWidget::resizeEvent(QResizeEvent *event) {
 	BaseWidget::resizeEvent(event);
+
+	if (event->size().width() == event->oldSize().width())
+		return;
+
+	// Estimates depend on the width, so they have to be redone for
+	// paragraphs without blocks.
+	QList<text::Paragraph> *pars = m_model.paragraphs();
+	for (qsizetype idx = 0; idx < m_blocks.size(); idx++) {
+		if (m_blocks[idx] == nullptr)
+			m_heights[idx] = MarkdownBlock::estimateHeight(&((*pars)[idx]), m_style, width());
+	}
+	m_topsDirty = true;
+
+	layoutBlocks();
 }
 
 void MarkdownEditWidget::mousePressEvent(QMouseEvent *event) {
@@ -232,7 +253,8 @@ void MarkdownEditWidget::mouseReleaseEvent(QMouseEvent *event) {
 		if (cursorInsideCheckbox(cursor, &range) &&
 			(m_cursor.block != cursor.block || m_cursor.line != cursor.line)
 		) {
-			QString lastState = m_model.text();
+			StaticCursor undoCursor = staticCursor(m_cursor);
+			m_edits.clear();
 
 			text::Paragraph *par = cursor.block->paragraph();
 			text::Line *line = &((*par->getLines())[cursor.line]);
@@ -250,10 +272,10 @@ void MarkdownEditWidget::mouseReleaseEvent(QMouseEvent *event) {
 			}
 
 			// Update text.
-			line->setText(newText, par->getType() == text::Code);
+			setLineText(par, line, newText);
 			cursor.block->setParagraph(par);
 			// Update state stack.
-			updateState(lastState, m_cursor, false);
+			updateState(undoCursor, false);
 		} else if (hasFocus()) {
 			// Check for double-clicks.
 			if (
@@ -295,8 +317,15 @@ void MarkdownEditWidget::handleInput(
 	MarkdownBlock *block = m_cursor.block;
 	MarkdownCursor prev = m_cursor;
 	MarkdownCursor cursor = m_cursor;
-	QString lastState = m_model.text();
 	text::FormatRange range(0,0,text::Highlight);
+	bool isCopyPaste = (seq == QKeySequence::Cut)
+		|| (seq == QKeySequence::Paste)
+		|| (mouseButton == Qt::MiddleButton);
+
+	// Changes are tracked through edits made to the model. Cursor is saved
+	// before any of them, while its block index is still valid for undo.
+	StaticCursor undoCursor = staticCursor(m_cursor);
+	m_edits.clear();
 
 	if (
 		key == Qt::Key_Z && mods & Qt::ControlModifier
@@ -463,7 +492,7 @@ void MarkdownEditWidget::handleInput(
 		} else if (cursor.position != 0) {
 			QString newText = line->text;
 			newText.remove(cursor.position - 1, 1);
-			line->setText(newText, par->getType() == text::Code);
+			setLineText(par, line, newText);
 
 			// Update text and adjust cursor.
 			cursor.block->setParagraph(par);
@@ -482,7 +511,7 @@ void MarkdownEditWidget::handleInput(
 		} else if (cursor.position != line->text.length()) {
 			QString newText = line->text;
 			newText.remove(cursor.position, 1);
-			line->setText(newText, par->getType() == text::Code);
+			setLineText(par, line, newText);
 
 			// Update text and adjust cursor.
 			cursor.block->setParagraph(par);
@@ -532,7 +561,7 @@ void MarkdownEditWidget::handleInput(
 		(par->getType() == text::BulletList || par->getType() == text::NumberList)
 	) {
 		if (line->level < 4) {
-			line->level = line->level + 1;
+			setLineLevel(par, line, line->level + 1);
 			block->setParagraph(par);
 		}
 	} else if (
@@ -551,7 +580,7 @@ void MarkdownEditWidget::handleInput(
 		}
 
 		// Update text.
-		line->setText(newText, par->getType() == text::Code);
+		setLineText(par, line, newText);
 		cursor.block->setParagraph(par);
 	} else if (!text.isEmpty()) {
 		if (m_selection.active) {
@@ -572,8 +601,10 @@ void MarkdownEditWidget::handleInput(
 		newText.insert(cursor.position, text);
 		if (newText == "```" && par->getType() != text::Code) {
 			// Transform to code.
+			text::Paragraph before = par->clone();
 			line->setText(empty, true);
 			par->setType(text::Code);
+			markParagraphChanged(indexOfParagraph(par), before);
 			block->setParagraph(par);
 
 			cursor.position = 0;
@@ -584,8 +615,10 @@ void MarkdownEditWidget::handleInput(
 		) {
 			// Transform to numbered list.
 			auto truncated = newText.last(newText.size() - m.capturedEnd());
+			text::Paragraph before = par->clone();
 			line->setText(truncated, false);
 			par->setType(text::NumberList);
+			markParagraphChanged(indexOfParagraph(par), before);
 			block->setParagraph(par);
 
 			cursor.position = 0;
@@ -596,15 +629,17 @@ void MarkdownEditWidget::handleInput(
 		) {
 			// Transform to bullet list.
 			auto truncated = newText.last(newText.size() - m.capturedEnd());
+			text::Paragraph before = par->clone();
 			line->setText(truncated, false);
 			par->setType(text::BulletList);
+			markParagraphChanged(indexOfParagraph(par), before);
 			block->setParagraph(par);
 
 			cursor.position = 0;
 			processCursorMove(prev, cursor);
 		} else {
 			// Update text.
-			line->setText(newText, par->getType() == text::Code);
+			setLineText(par, line, newText);
 
 			// Update text and adjust cursor.
 			cursor.block->setParagraph(par);
@@ -633,10 +668,7 @@ void MarkdownEditWidget::handleInput(
 	}
 
 	if (!isMovementKey(key)) {
-		updateState(
-			lastState, prev, 
-			(seq == QKeySequence::Cut) || (seq == QKeySequence::Paste) || (mouseButton == Qt::MiddleButton)
-		);
+		updateState(undoCursor, isCopyPaste);
 	}
 
 	// I don't like this. Have to wait for widgets to redraw to avoid
@@ -671,60 +703,31 @@ void MarkdownEditWidget::handleInput(
 }
 
 void MarkdownEditWidget::updateState(
-	QString& lastState,
-	MarkdownCursor prev,
+	StaticCursor before,
 	bool isCopyPaste
 ) {
-	QString newState = m_model.text();
-
 	// Undo stack logic below. Only applies if there were any actual changes
 	// to the data.
-	if (lastState != newState) {
-		if (!m_stateDirty) {
-			// If this is a new state change, update cursor position in last state
-			// to current position. This way undo will restore the cursor to the
-			// position before new changes.
-			TextState state = m_textStates.last();
-			state.cursor = StaticCursor{
-				.block = indexOfBlock(prev.block),
-				.line = prev.line,
-				.position = prev.position
-			};
-			m_textStates.replace(m_textStates.length() - 1, state);
-		}
-
+	if (!m_edits.isEmpty()) {
 		if (isCopyPaste) {
-			if (m_stateDirty) {
-				// If there were "unsaved" changes, save them first into the Undo
-				// stack. This way we can revert to state right before cut/paste.
-				saveState(
-					lastState,
-					StaticCursor{
-						.block = indexOfBlock(prev.block),
-						.line = prev.line,
-						.position = prev.position
-					}
-				);
-			}
-
-			// Immediately push state after cut or paste onto the stack.
-			// This is usually how Undo stack behaves, from what I remember.
-			saveState(
-				newState,
-				StaticCursor{
-					.block = indexOfBlock(m_cursor.block),
-					.line = m_cursor.line,
-					.position = m_cursor.position
-				}
-			);
-			m_stateDirty = false;
+			// Cut and paste get a step of their own. This way we can revert to
+			// state right before cut/paste. This is usually how Undo stack
+			// behaves, from what I remember.
+			m_journal.close();
+			m_journal.record(m_edits, before, staticCursor(m_cursor));
+			m_journal.close();
 		} else {
-			m_stateDirty = true;
+			// Other changes are added to the current step. Its cursor before
+			// the changes is only set by the first of them, so undo restores
+			// the cursor to the position before new changes.
+			m_journal.record(m_edits, before, staticCursor(m_cursor));
 		}
 
 		m_isDirty = true;
 		throttleSave();
 	}
+
+	m_edits.clear();
 }
 
 void MarkdownEditWidget::focusInEvent(QFocusEvent*) {
@@ -1023,19 +1026,15 @@ MarkdownCursor MarkdownEditWidget::deleteSelection() {
 	// Delete all lines in start paragraph after starting line.
 	if (startIdx != endIdx) {
 		QList<text::Line> *startLines = startPar->getLines();
-		if (startLines->size() > startLineIdx + 1) {
-			startLines->remove(
-				startLineIdx + 1,
-				startLines->size() - startLineIdx - 1
-			);
-		}
+		removeLines(
+			startPar,
+			startLineIdx + 1,
+			startLines->size() - startLineIdx - 1
+		);
 		start.block->setParagraph(startPar);
 
 		// Delete all lines in end paragraph before ending line.
-		QList<text::Line> *endLines = endPar->getLines();
-		if (endLineIdx > 0) {
-			endLines->remove(0, endLineIdx);
-		}
+		removeLines(endPar, 0, endLineIdx);
 		// Readjust end line index after deletion.
 		endLineIdx = 0;
 		endLine = &((*endPar->getLines())[endLineIdx]);
@@ -1043,8 +1042,8 @@ MarkdownCursor MarkdownEditWidget::deleteSelection() {
 		end.block->setParagraph(endPar);
 	} else if (startLineIdx < endLineIdx - 1) {
 		// Delete all lines between selection.
-		QList<text::Line> *startLines = startPar->getLines();
-		startLines->remove(
+		removeLines(
+			startPar,
 			startLineIdx + 1,
 			endLineIdx - startLineIdx - 1
 		);
@@ -1061,12 +1060,12 @@ MarkdownCursor MarkdownEditWidget::deleteSelection() {
 	if (startLine != endLine) {
 		// Delete text from start of selection to end of first line.
 		QString newStartText = startLine->text.left(start.position);
-		startLine->setText(newStartText, startPar->getType() == text::Code);
+		setLineText(startPar, startLine, newStartText);
 		start.block->setParagraph(startPar);
 
 		// Delete text from start of last line to end of selection.
 		QString newEndText = endLine->text.right(endLine->text.length() - end.position);
-		endLine->setText(newEndText, endPar->getType() == text::Code);
+		setLineText(endPar, endLine, newEndText);
 		end.block->setParagraph(endPar);
 	} else {
 		// Delete the selected text within the line.
@@ -1074,7 +1073,7 @@ MarkdownCursor MarkdownEditWidget::deleteSelection() {
 		QString newText =
 			line->text.left(start.position)
 			+ line->text.right(line->text.length() - end.position);
-		line->setText(newText, startPar->getType() == text::Code);
+		setLineText(startPar, line, newText);
 		start.block->setParagraph(startPar);
 	}
 
@@ -1127,7 +1126,7 @@ MarkdownCursor MarkdownEditWidget::pasteString(QString text) {
 		QString newText = textBefore
 			+ text
 			+ textAfter;
-		line->setText(newText, m_cursor.block->paragraph()->getType() == text::Code);
+		setLineText(m_cursor.block->paragraph(), line, newText);
 		m_cursor.block->setParagraph(m_cursor.block->paragraph());
 
 		cursor = MarkdownCursor(
@@ -1141,7 +1140,6 @@ MarkdownCursor MarkdownEditWidget::pasteString(QString text) {
 		int pos = 0;
 
 		text::Paragraph *par = m_cursor.block->paragraph();
-		QList<text::Line> *lines = m_cursor.block->paragraph()->getLines();
 		int lineIdx = m_cursor.line;
 		text::Line *line = &((*par->getLines())[lineIdx]);
 
@@ -1150,20 +1148,23 @@ MarkdownCursor MarkdownEditWidget::pasteString(QString text) {
 			line->text.length() - m_cursor.position
 		);
 
+		// First pasted line goes into the current one, the rest are
+		// inserted after it.
+		QList<text::Line> inserted;
 		for (auto listLine = list.begin(); listLine != list.end(); listLine++) {
 			if (listLine == list.begin()) {
 				QString newText = textBefore + (*listLine);
-				line->setText(newText, true);
+				setLineText(par, line, newText);
 			} else if (listLine + 1 == list.end()) {
 				pos = (*listLine).length();
 				QString lastText = *listLine + textAfter;
-				lines->insert(lineIdx + 1, text::Line(lastText, true));
-				lineIdx += 1;
+				inserted.push_back(text::Line(lastText, true));
 			} else {
-				lines->insert(lineIdx + 1, text::Line(*listLine, true));
-				lineIdx += 1;
+				inserted.push_back(text::Line(*listLine, true));
 			}
 		}
+		insertLines(par, lineIdx + 1, inserted);
+		lineIdx += inserted.size();
 
 		m_cursor.block->setParagraph(m_cursor.block->paragraph());
 		cursor = MarkdownCursor(
@@ -1191,7 +1192,7 @@ MarkdownCursor MarkdownEditWidget::pasteString(QString text) {
 			}
 
 			// Remove lines after current one from old paragraph.
-			lines->remove(lineIdx + 1, lines->size() - lineIdx - 1);
+			removeLines(par, lineIdx + 1, lines->size() - lineIdx - 1);
 
 			// Create a new paragraph with the remainder.
 			if (remainder.size() > 0) {
@@ -1216,7 +1217,7 @@ MarkdownCursor MarkdownEditWidget::pasteString(QString text) {
 		QList<text::Line> *lastLines = lastPar->getLines();
 		text::Line *lastLine = &((*lastLines)[lastLines->size() - 1]);
 		cursor = MarkdownCursor(
-			m_blocks[indexOfParagraph(lastPar)],
+			blockAt(indexOfParagraph(lastPar)),
 			lastLines->size() - 1,
 			lastLine->text.length()
 		);
@@ -1265,6 +1266,8 @@ void MarkdownEditWidget::hideSearchWidget() {
 
 void MarkdownEditWidget::insertNodeLink(ThoughtId id, QString title) {
 	QString linkName = title;
+	StaticCursor undoCursor = staticCursor(m_lastCursor);
+	m_edits.clear();
 
 	// If we have a selection, put it as a link title.
 	if (m_selection.active) {
@@ -1304,8 +1307,8 @@ void MarkdownEditWidget::insertNodeLink(ThoughtId id, QString title) {
 
 	processCursorMove(m_cursor, cursor);
 
-	m_isDirty = true;
-	throttleSave();
+	// Inserted link is undone on its own, like pasted text.
+	updateState(undoCursor, true);
 }
 
 // Context menu.
@@ -1364,7 +1367,7 @@ void MarkdownEditWidget::showContextMenu(QMouseEvent *event) {
 	QString undoMenu = tr("Undo");
 	QAction *undoAction = new QAction(undoMenu, this);
 	undoAction->setShortcut(QKeySequence::Undo);
-	undoAction->setEnabled(m_stateIdx != 0 || m_stateDirty);
+	undoAction->setEnabled(m_journal.canUndo());
 
 	connect(
 		undoAction, SIGNAL(triggered()),
@@ -1376,7 +1379,7 @@ void MarkdownEditWidget::showContextMenu(QMouseEvent *event) {
 	QString redoMenu = tr("Redo");
 	QAction *redoAction = new QAction(redoMenu, this);
 	redoAction->setShortcut(QKeySequence(tr("Ctrl+R")));
-	redoAction->setEnabled(m_stateIdx != (m_textStates.length() - 1));
+	redoAction->setEnabled(m_journal.canRedo());
 
 	connect(
 		redoAction, SIGNAL(triggered()),
@@ -1435,17 +1438,8 @@ void MarkdownEditWidget::saveText() {
 	// Select all text.
 	QString txt = m_model.text();
 
-	// Save state.
-	if (m_stateDirty) {
-		saveState(
-			txt,
-			StaticCursor{
-				.block = indexOfBlock(m_cursor.block),
-				.line = m_cursor.line,
-				.position = m_cursor.position
-			}
-		);
-	}
+	// Changes made after saving go into a new undo step.
+	m_journal.close();
 
 	// Emit text change event.
 	emit textChanged(txt);
@@ -1460,21 +1454,19 @@ void MarkdownEditWidget::saveText() {
 // Helpers
 
 MarkdownBlock *MarkdownEditWidget::blockBefore(MarkdownBlock *block) {
-	for (int idx = 1; idx < m_blocks.size(); idx++) {
-		if (&(*m_blocks[idx]) == block)
-			return &(*m_blocks[idx-1]);
-	}
+	int idx = indexOfBlock(block);
+	if (idx < 1)
+		return nullptr;
 
-	return nullptr;
+	return blockAt(idx - 1);
 }
 
 MarkdownBlock *MarkdownEditWidget::blockAfter(MarkdownBlock *block) {
-	for (int idx = 0; idx < m_blocks.size() - 1; idx++) {
-		if (&(*m_blocks[idx]) == block)
-			return &(*m_blocks[idx+1]);
-	}
+	int idx = indexOfBlock(block);
+	if (idx == -1)
+		return nullptr;
 
-	return nullptr;
+	return blockAt(idx + 1);
 }
 
 bool MarkdownEditWidget::cursorAtBlockBelow(
@@ -1515,26 +1507,26 @@ bool MarkdownEditWidget::cursorAbovePoint(
 	QPoint pos,
 	MarkdownCursor *result
 ) {
-	for (auto it = m_blocks.rbegin(); it != m_blocks.rend(); it++) {
-		QRect geometry = (*it)->geometry();
-
-		// Since there are gaps between blocks, we take the first block
-		// that has the point inside or is located below the point.
-		if (geometry.y() + geometry.height() > pos.y()) {
-			continue;
-		}
+	if (m_blocks.isEmpty())
+		return false;
 
-		QList<text::Line> *lines = (*it)->paragraph()->getLines();
-		text::Line *lastLine = &((*lines)[lines->size() - 1]);
-		*result = MarkdownCursor(
-			(*it),
-			lines->size() - 1,
-			lastLine->text.length()
-		);
-		return true;
-	}
+	// Since there are gaps between blocks, we take the last block located
+	// fully above the point.
+	int idx = paragraphAt(pos.y());
+	if (blockTop(idx) + m_heights[idx] > pos.y())
+		idx -= 1;
+	if (idx < 0)
+		return false;
 
-	return false;
+	MarkdownBlock *block = blockAt(idx);
+	QList<text::Line> *lines = block->paragraph()->getLines();
+	text::Line *lastLine = &((*lines)[lines->size() - 1]);
+	*result = MarkdownCursor(
+		block,
+		lines->size() - 1,
+		lastLine->text.length()
+	);
+	return true;
 }
 
 void MarkdownEditWidget::processCursorMove(
@@ -1567,9 +1559,102 @@ void MarkdownEditWidget::processCursorMove(
 	}
 
 	m_cursor = to;
+	notifyCursorMove(from, to);
+}
+
+void MarkdownEditWidget::notifyCursorMove(
+	MarkdownCursor from,
+	MarkdownCursor to
+) {
+	// Only blocks the cursor leaves or enters have to be redrawn, so they are
+	// notified directly instead of every block in the document.
+	if (from.block != nullptr && m_blockSet.contains(from.block))
+		from.block->onCursorMove(from, to);
+	if (to.block != nullptr && to.block != from.block && m_blockSet.contains(to.block))
+		to.block->onCursorMove(from, to);
+
 	emit onCursorMove(from, to);
 }
 
+// Edits.
+
+void MarkdownEditWidget::setLineText(
+	text::Paragraph *par,
+	text::Line *line,
+	QString& text
+) {
+	text::Edit edit = text::Edit::lineEdit(
+		indexOfParagraph(par),
+		par->indexOfLine(line),
+		line->text,
+		text
+	);
+	if (!edit.isEmpty())
+		m_edits.push_back(edit);
+
+	line->setText(text, par->getType() == text::Code);
+}
+
+void MarkdownEditWidget::setLineLevel(
+	text::Paragraph *par,
+	text::Line *line,
+	unsigned int level
+) {
+	text::Edit edit = text::Edit::levelEdit(
+		indexOfParagraph(par),
+		par->indexOfLine(line),
+		line->level,
+		level
+	);
+	if (!edit.isEmpty())
+		m_edits.push_back(edit);
+
+	line->level = level;
+}
+
+void MarkdownEditWidget::insertLines(
+	text::Paragraph *par,
+	int lineIdx,
+	QList<text::Line> lines
+) {
+	if (lines.isEmpty())
+		return;
+
+	m_edits.push_back(
+		text::Edit::linesEdit(indexOfParagraph(par), lineIdx, {}, lines)
+	);
+
+	QList<text::Line> *target = par->getLines();
+	for (qsizetype idx = 0; idx < lines.size(); idx++)
+		target->insert(lineIdx + idx, lines[idx]);
+}
+
+void MarkdownEditWidget::removeLines(
+	text::Paragraph *par,
+	int lineIdx,
+	int count
+) {
+	if (count <= 0)
+		return;
+
+	QList<text::Line> *lines = par->getLines();
+	m_edits.push_back(text::Edit::linesEdit(
+		indexOfParagraph(par),
+		lineIdx,
+		lines->mid(lineIdx, count),
+		{}
+	));
+	lines->remove(lineIdx, count);
+}
+
+void MarkdownEditWidget::markParagraphChanged(
+	int parIdx,
+	text::Paragraph before
+) {
+	text::Paragraph *par = &((*m_model.paragraphs())[parIdx]);
+	m_edits.push_back(text::Edit::paragraphEdit(parIdx, {before}, {*par}));
+}
+
 MarkdownCursor MarkdownEditWidget::adjustForUnfolding(
 	MarkdownCursor cursor,
 	MarkdownCursor from
@@ -1626,7 +1711,7 @@ MarkdownCursor MarkdownEditWidget::applyStyleToSelection(
 	text::Line *startLine = &((*startPar->getLines())[startCursor.line]);
 	QString newText = startLine->text;
 	newText.insert(startCursor.position, style);
-	startLine->setText(newText, startPar->getType() == text::Code);
+	setLineText(startPar, startLine, newText);
 
 	// Add bold mark after selection.
 	text::Paragraph *endPar = endCursor.block->paragraph();
@@ -1635,7 +1720,7 @@ MarkdownCursor MarkdownEditWidget::applyStyleToSelection(
 		endCursor.position += style.length();
 	newText = endLine->text;
 	newText.insert(endCursor.position, style);
-	endLine->setText(newText, endPar->getType() == text::Code);
+	setLineText(endPar, endLine, newText);
 
 	// Update paragraphs.
 	startCursor.block->setParagraph(startPar);
@@ -1653,22 +1738,26 @@ bool MarkdownEditWidget::cursorAtPoint(
 	QPoint pos,
 	MarkdownCursor *cursor
 ) {
-	for (auto it = m_blocks.begin(); it != m_blocks.end(); it++) {
-		QRect geometry = (*it)->geometry();
+	if (m_blocks.isEmpty())
+		return false;
 
-		// Since there are gaps between blocks, we take the first block
-		// that has the point inside or is located below the point.
-		if (geometry.y() + geometry.height() < pos.y()) {
-			continue;
-		}
+	// Since there are gaps between blocks, we take the first block
+	// that has the point inside or is located below the point.
+	int idx = paragraphAt(pos.y());
+	if (blockTop(idx) + m_heights[idx] < pos.y())
+		idx += 1;
+
+	for (; idx < m_blocks.size(); idx++) {
+		MarkdownBlock *block = blockAt(idx);
+		QRect geometry = block->geometry();
 
 		// Translate inside block.
 		QPoint adjusted = pos;
 		if (geometry.y() > pos.y())
 			adjusted = QPoint(pos.x(), geometry.y());
 
-		QPoint pointInside = (*it)->mapFromParent(adjusted);
-		if (bool found = (*it)->cursorAt(pointInside, cursor); found == true) {
+		QPoint pointInside = block->mapFromParent(adjusted);
+		if (bool found = block->cursorAt(pointInside, cursor); found == true) {
 			return true;
 		}
 	}
@@ -1677,12 +1766,12 @@ bool MarkdownEditWidget::cursorAtPoint(
 }
 
 MarkdownCursor MarkdownEditWidget::documentStart() {
-	MarkdownBlock *block = m_blocks[0];
+	MarkdownBlock *block = blockAt(0);
 	return MarkdownCursor(block, 0, 0);
 }
 
 MarkdownCursor MarkdownEditWidget::documentEnd() {
-	MarkdownBlock *block = m_blocks[m_blocks.size() - 1];
+	MarkdownBlock *block = blockAt(m_blocks.size() - 1);
 	text::Paragraph *par = block->paragraph();
 	QList<text::Line> *lines = par->getLines();
 	text::Line *line = &((*lines)[lines->size() - 1]);
@@ -1690,72 +1779,306 @@ MarkdownCursor MarkdownEditWidget::documentEnd() {
 }
 
 inline int MarkdownEditWidget::indexOfParagraph(text::Paragraph *par) {
+	// Paragraphs are stored contiguously, so the index is just an offset.
 	QList<text::Paragraph> *pars = m_model.paragraphs();
-	for (int idx = 0; idx < pars->size(); idx++) {
-		if (&((*pars)[idx]) == par)
-			return idx;
-	}
+	const text::Paragraph *first = pars->constData();
+	const text::Paragraph *last = first + pars->size();
+	std::less<const text::Paragraph*> less;
 
-	return -1;
+	if (par == nullptr || less(par, first) || !less(par, last))
+		return -1;
+
+	return par - first;
 }
 
 inline int MarkdownEditWidget::indexOfBlock(MarkdownBlock *block) {
-	for (int idx = 0; idx < m_blocks.size(); idx++)
-		if (m_blocks[idx] == block)
-			return idx;
-	return -1;
+	// Blocks of deleted paragraphs don't point to the model anymore.
+	if (!m_blockSet.contains(block))
+		return -1;
+
+	// Blocks go in the same order as paragraphs.
+	int idx = indexOfParagraph(block->paragraph());
+	if (idx != -1 && idx < m_blocks.size() && m_blocks[idx] == block)
+		return idx;
+
+	return m_blocks.indexOf(block);
+}
+
+MarkdownBlock *MarkdownEditWidget::blockAt(int idx) {
+	if (idx < 0 || idx >= m_blocks.size())
+		return nullptr;
+
+	if (m_blocks[idx] != nullptr)
+		return m_blocks[idx];
+
+	MarkdownBlock *block = new MarkdownBlock(this, m_style, this);
+	if (idx == 0)
+		block->setPlaceholder(tr("Start typing here..."));
+
+	m_blocks[idx] = block;
+	m_blockSet.insert(block);
+	block->resize(width(), m_heights[idx]);
+	block->setParagraph(&((*m_model.paragraphs())[idx]));
+
+	measureBlock(idx);
+	block->setGeometry(0, blockTop(idx), width(), m_heights[idx]);
+	block->show();
+
+	return block;
+}
+
+void MarkdownEditWidget::releaseBlock(int idx) {
+	MarkdownBlock *block = m_blocks[idx];
+	if (block == nullptr)
+		return;
+
+	// Measured height stays as the paragraph's estimate.
+	m_blocks[idx] = nullptr;
+	m_blockSet.remove(block);
+	block->hide();
+	block->deleteLater();
+}
+
+void MarkdownEditWidget::reloadBlock(int idx) {
+	text::Paragraph *par = &((*m_model.paragraphs())[idx]);
+
+	if (m_blocks[idx] != nullptr) {
+		m_blocks[idx]->setParagraph(par);
+	} else {
+		setBlockHeight(idx, MarkdownBlock::estimateHeight(par, m_style, width()));
+	}
+}
+
+bool MarkdownEditWidget::isBlockPinned(MarkdownBlock *block) {
+	// Cursor and selection hold pointers to their blocks.
+	return block == m_cursor.block ||
+		block == m_lastCursor.block ||
+		block == m_selection.start.block ||
+		block == m_selection.end.block;
+}
+
+bool MarkdownEditWidget::measureBlock(int idx) {
+	MarkdownBlock *block = m_blocks[idx];
+	if (block->width() != width())
+		block->resize(width(), block->height());
+
+	int height = block->layoutHeight();
+	if (height == m_heights[idx])
+		return false;
+
+	setBlockHeight(idx, height);
+	return true;
+}
+
+void MarkdownEditWidget::layoutBlocks() {
+	int anchor = anchorParagraph();
+	int anchorTop = blockTop(anchor);
+
+	for (auto block: m_blockSet)
+		measureBlock(indexOfBlock(block));
+
+	updateVisibleBlocks();
+	placeBlocks();
+	keepAnchor(anchor, anchorTop);
+}
+
+bool MarkdownEditWidget::updateVisibleBlocks() {
+	if (m_blocks.isEmpty())
+		return false;
+
+	// Blocks are kept for one more viewport above and below the visible
+	// one, so that scrolling doesn't show empty space.
+	QRect area = m_viewport.isNull()
+		? QRect(0, 0, width(), defaultViewportHeight)
+		: m_viewport;
+	int first = paragraphAt(area.top() - area.height());
+	int last = paragraphAt(area.bottom() + area.height());
+
+	for (auto block: m_blockSet.values()) {
+		int idx = indexOfBlock(block);
+		if ((idx < first || idx > last) && !isBlockPinned(block))
+			releaseBlock(idx);
+	}
+
+	// New blocks have replaced estimates with real heights, existing ones
+	// might have to move.
+	bool moved = false;
+	for (int idx = first; idx <= last; idx++) {
+		if (m_blocks[idx] == nullptr) {
+			int estimate = m_heights[idx];
+			blockAt(idx);
+			moved = moved || m_heights[idx] != estimate;
+		}
+	}
+
+	return moved;
+}
+
+void MarkdownEditWidget::placeBlocks() {
+	for (auto block: m_blockSet) {
+		int idx = indexOfBlock(block);
+		QRect geometry(0, blockTop(idx), width(), m_heights[idx]);
+		if (block->geometry() != geometry)
+			block->setGeometry(geometry);
+	}
+
+	int height = documentHeight();
+	if (minimumHeight() != height)
+		setMinimumHeight(height);
+}
+
+int MarkdownEditWidget::anchorParagraph() {
+	// Nothing to keep in place at the top of the document.
+	if (m_viewport.isNull() || m_viewport.top() <= 0 || m_heights.isEmpty())
+		return 0;
+
+	return paragraphAt(m_viewport.top());
+}
+
+void MarkdownEditWidget::keepAnchor(int anchor, int anchorTop) {
+	if (anchor >= m_heights.size())
+		return;
+
+	int shift = blockTop(anchor) - anchorTop;
+	if (shift == 0)
+		return;
+
+	// Viewport is moved right away, so that the scroll caused by the shift
+	// doesn't come back as a change of the viewport.
+	m_viewport.translate(0, shift);
+	emit contentShifted(shift);
+}
+
+void MarkdownEditWidget::setBlockHeight(int idx, int height) {
+	int delta = height - m_heights[idx];
+	if (delta == 0)
+		return;
+
+	m_heights[idx] = height;
+	if (m_topsDirty)
+		return;
+
+	for (qsizetype pos = idx + 1; pos < m_tops.size(); pos += pos & -pos)
+		m_tops[pos] += delta;
+}
+
+void MarkdownEditWidget::updateTops() {
+	if (!m_topsDirty)
+		return;
+
+	// Fenwick tree of heights with spacing, built in linear time.
+	m_tops = QList<int>(m_heights.size() + 1, 0);
+	for (qsizetype pos = 1; pos < m_tops.size(); pos++) {
+		m_tops[pos] += m_heights[pos - 1] + blockSpacing;
+		qsizetype parent = pos + (pos & -pos);
+		if (parent < m_tops.size())
+			m_tops[parent] += m_tops[pos];
+	}
+	m_topsDirty = false;
+}
+
+int MarkdownEditWidget::blockTop(int idx) {
+	updateTops();
+
+	int top = 0;
+	for (qsizetype pos = idx; pos > 0; pos -= pos & -pos)
+		top += m_tops[pos];
+
+	return top;
+}
+
+int MarkdownEditWidget::documentHeight() {
+	if (m_heights.isEmpty())
+		return 0;
+
+	return blockTop(m_heights.size()) - blockSpacing;
+}
+
+int MarkdownEditWidget::paragraphAt(int y) {
+	updateTops();
+
+	// Descend the tree to the number of paragraphs ending at or above the
+	// point, the next one is the last one starting there.
+	qsizetype count = m_heights.size();
+	qsizetype step = 1;
+	while (step * 2 <= count)
+		step *= 2;
+
+	qsizetype idx = 0;
+	int rest = y;
+	for (; step > 0; step /= 2) {
+		qsizetype next = idx + step;
+		if (next <= count && m_tops[next] <= rest) {
+			idx = next;
+			rest -= m_tops[next];
+		}
+	}
+
+	return std::max(0, (int)std::min(idx, count - 1));
 }
 
 inline text::Paragraph *MarkdownEditWidget::insertParagraph(
 	int index,
 	text::Paragraph par
 ) {
+	const text::Paragraph *oldData = m_model.paragraphs()->constData();
 	m_model.insert(index, par);
+	m_edits.push_back(text::Edit::paragraphEdit(index, {}, {par}));
 
-	MarkdownBlock *block = new MarkdownBlock(nullptr, m_style, this);
-	connect(
-		this, &MarkdownEditWidget::onCursorMove,
-		block, &MarkdownBlock::onCursorMove
+	// Block is created when it's needed.
+	m_blocks.insert(index, nullptr);
+	m_heights.insert(
+		index,
+		MarkdownBlock::estimateHeight(&((*m_model.paragraphs())[index]), m_style, width())
 	);
+	m_topsDirty = true;
 
-	block->setParagraph(&((*m_model.paragraphs())[index]));
-	m_blocks.insert(index, block);
-	m_layout->insertWidget(index, block);
-
-	for (int idx = 0; idx < m_model.paragraphs()->size(); idx++) {
-		m_blocks[idx]->updateParagraphWithoutReload(m_model.paragraphs()->data() + idx);
+	// Only paragraphs after the new one have moved, unless the list had to
+	// grow its storage.
+	int from = (m_model.paragraphs()->constData() == oldData) ? index + 1 : 0;
+	for (int idx = from; idx < m_model.paragraphs()->size(); idx++) {
+		if (m_blocks[idx] != nullptr)
+			m_blocks[idx]->updateParagraphWithoutReload(m_model.paragraphs()->data() + idx);
 	}
 
-	m_layout->invalidate();
+	QCoreApplication::postEvent(this, new QEvent(QEvent::LayoutRequest));
 	return &((*m_model.paragraphs())[index]);
 }
 
 inline void MarkdownEditWidget::deleteParagraph(int index) {
 	MarkdownBlock *block = m_blocks[index];
-	block->updateParagraphWithoutReload(nullptr);
-
-	disconnect(
-		this, &MarkdownEditWidget::onCursorMove,
-		block, &MarkdownBlock::onCursorMove
-	);
+	if (block != nullptr) {
+		block->updateParagraphWithoutReload(nullptr);
+		m_blockSet.remove(block);
+	}
 
 	// Delete from model.
+	const text::Paragraph *oldData = m_model.paragraphs()->constData();
+	m_edits.push_back(
+		text::Edit::paragraphEdit(index, {m_model.paragraphs()->at(index)}, {})
+	);
 	m_model.paragraphs()->remove(index, 1);
 
 	// Delete from list of widgets.
 	m_blocks.remove(index, 1);
-
-	// Delete from layout.
-	m_layout->removeWidget(block);
+	m_heights.remove(index, 1);
+	m_topsDirty = true;
 
 	// Delete the object itself.
-	block->deleteLater();
+	if (block != nullptr) {
+		block->hide();
+		block->deleteLater();
+	}
 
-	// Update paragraph pointers for all blocks after new one.
+	// Update paragraph pointers for all blocks after deleted one.
 	QList<text::Paragraph> *pars = m_model.paragraphs();
-	for (int idx = 0; idx < pars->size(); idx++) {
-		m_blocks[idx]->updateParagraphWithoutReload(&((*pars)[idx]));
+	int from = (pars->constData() == oldData) ? index : 0;
+	for (int idx = from; idx < pars->size(); idx++) {
+		if (m_blocks[idx] != nullptr)
+			m_blocks[idx]->updateParagraphWithoutReload(&((*pars)[idx]));
 	}
+
+	QCoreApplication::postEvent(this, new QEvent(QEvent::LayoutRequest));
 }
 
 void MarkdownEditWidget::mergeBlocks(
@@ -1766,21 +2089,21 @@ void MarkdownEditWidget::mergeBlocks(
 	MarkdownCursor cursor = prev;
 	QList<text::Paragraph> *pars = m_model.paragraphs();
 	text::Paragraph *par = &((*pars)[next]);
-	MarkdownBlock *block = m_blocks[next];
+	MarkdownBlock *block = blockAt(next);
 
 	if (par->getType() == text::Text) {
 		int parIdx = indexOfParagraph(par);
 		if (parIdx > 0) {
 			// Get last line of the previous paragraph.
 			text::Paragraph *prevPar = &((*m_model.paragraphs())[parIdx - 1]);
-			MarkdownBlock *prevBlock = m_blocks[parIdx - 1];
+			MarkdownBlock *prevBlock = blockAt(parIdx - 1);
 			QList<text::Line> *lines = prevPar->getLines();
 			text::Line *lastLine = &((*lines)[lines->size() - 1]);
 
 			// Append current text to the last line.
 			int newPosition = lastLine->folded.length();
 			QString newText = lastLine->text + line->text;
-			lastLine->setText(newText, prevPar->getType() == text::Code);
+			setLineText(prevPar, lastLine, newText);
 
 			// Update previous block.
 			prevBlock->setParagraph(prevPar);
@@ -1804,7 +2127,7 @@ void MarkdownEditWidget::mergeBlocks(
 			(par->getType() == text::BulletList || par->getType() == text::NumberList) &&
 			line->level > 0
 		) {
-			line->level = line->level - 1;
+			setLineLevel(par, line, line->level - 1);
 			block->setParagraph(par);
 		} else if (lineIdx == 0) {
 			QList<text::Paragraph> *pars = m_model.paragraphs();
@@ -1813,15 +2136,13 @@ void MarkdownEditWidget::mergeBlocks(
 				(*pars)[parIdx - 1].getType() == par->getType()
 			) {
 				text::Paragraph *prevPar = &((*pars)[parIdx - 1]);
-				MarkdownBlock *prevBlock = m_blocks[parIdx - 1];
+				MarkdownBlock *prevBlock = blockAt(parIdx - 1);
 				QList<text::Line> *prevLines = prevPar->getLines();
 				QList<text::Line> *lines = par->getLines();
 
 				// Copy current paragraph lines to previous one.
 				int oldSize = prevLines->size();
-				for (int idx = 0; idx < lines->size(); idx++) {
-					prevLines->push_back((*lines)[idx]);
-				}
+				insertLines(prevPar, oldSize, *lines);
 
 				// Delete current paragraph.
 				deleteParagraph(parIdx);
@@ -1838,7 +2159,7 @@ void MarkdownEditWidget::mergeBlocks(
 				processCursorMove(prev, cursor);
 			} else if (parIdx > 0) {
 				text::Paragraph *prevPar = &((*pars)[parIdx - 1]);
-				MarkdownBlock *prevBlock = m_blocks[parIdx - 1];
+				MarkdownBlock *prevBlock = blockAt(parIdx - 1);
 				QList<text::Line> *lines = par->getLines();
 				QList<text::Line> *prevLines = prevPar->getLines();
 				text::Line *lastLine = &((*prevLines)[prevLines->size() - 1]);
@@ -1846,7 +2167,7 @@ void MarkdownEditWidget::mergeBlocks(
 				// Update previous paragraph's text.
 				QString newText = lastLine->text + line->text;
 				int newPos = lastLine->folded.length();
-				lastLine->setText(newText, prevPar->getType() == text::Code);
+				setLineText(prevPar, lastLine, newText);
 
 				// Delete current line, or the whole paragraph if it has a
 				// single line.
@@ -1855,7 +2176,7 @@ void MarkdownEditWidget::mergeBlocks(
 					prevPar = &((*m_model.paragraphs())[parIdx - 1]);
 					prevBlock->setParagraph(prevPar);
 				} else {
-					lines->remove(lineIdx);
+					removeLines(par, lineIdx, 1);
 					prevLines = prevPar->getLines();
 					lastLine = &((*prevLines)[prevLines->size() - 1]);
 					// Update blocks.
@@ -1876,10 +2197,10 @@ void MarkdownEditWidget::mergeBlocks(
 			text::Line *prevLine = &((*lines)[lineIdx - 1]);
 			QString newText = prevLine->text + line->text;
 			int newPos = prevLine->folded.length();
-			prevLine->setText(newText, par->getType() == text::Code);
+			setLineText(par, prevLine, newText);
 
 			// Delete current line.
-			lines->remove(lineIdx);
+			removeLines(par, lineIdx, 1);
 			lines = par->getLines();
 			prevLine = &((*lines)[lineIdx - 1]);
 
@@ -1912,7 +2233,7 @@ MarkdownCursor MarkdownEditWidget::splitBlocks(
 
 	if (par->getType() == text::Text) {
 		// Insert new paragraph.
-		line->setText(beforeText, false);
+		setLineText(par, line, beforeText);
 		text::Paragraph newPar = text::Paragraph(
 			text::Text,
 			text::Line(afterText, false)
@@ -1923,7 +2244,7 @@ MarkdownCursor MarkdownEditWidget::splitBlocks(
 		block->setParagraph(&((*m_model.paragraphs())[parIdx]));
 
 		// Update cursor.
-		return MarkdownCursor(m_blocks[parIdx + 1], 0, 0);
+		return MarkdownCursor(blockAt(parIdx + 1), 0, 0);
 	} else {
 		QList<text::Line> *lines = par->getLines();
 
@@ -1939,7 +2260,7 @@ MarkdownCursor MarkdownEditWidget::splitBlocks(
 			}
 
 			// Remove lines after current one from old paragraph.
-			lines->remove(lineIdx, lines->size() - lineIdx);
+			removeLines(par, lineIdx, lines->size() - lineIdx);
 			// Create a new paragraph with the remainder.
 			if (remainder.size() > 0) {
 				text::Paragraph newPar = text::Paragraph(
@@ -1963,25 +2284,28 @@ MarkdownCursor MarkdownEditWidget::splitBlocks(
 				text::Paragraph *ptr = insertParagraph(parIdx + 1, newPar);
 
 				// Update cursor to new paragraph.
-				cursor = MarkdownCursor(m_blocks[parIdx + 1], 0, 0);
+				cursor = MarkdownCursor(blockAt(parIdx + 1), 0, 0);
 			} else {
+				text::Paragraph before = par->clone();
 				par->setType(text::Text);
 				lines->push_back(text::Line(empty, false));
+				markParagraphChanged(parIdx, before);
 				block->setParagraph(par);
 
 				// Update cursor to new current empty line.
-				cursor = MarkdownCursor(m_blocks[parIdx], 0, 0);
+				cursor = MarkdownCursor(blockAt(parIdx), 0, 0);
 			}
 
 			return cursor;
 		} else {
 			QList<text::Line> *lines = par->getLines();
-			line->setText(beforeText, par->getType() == text::Code);
+			setLineText(par, line, beforeText);
 
 			// Insert new line.
-			lines->insert(
+			insertLines(
+				par,
 				lineIdx + 1,
-				text::Line(afterText, par->getType() == text::Code, line->level)
+				{text::Line(afterText, par->getType() == text::Code, line->level)}
 			);
 
 			// Reload current paragraph.
@@ -1989,7 +2313,7 @@ MarkdownCursor MarkdownEditWidget::splitBlocks(
 
 			// Update cursor to new line.
 			return MarkdownCursor(
-				m_blocks[parIdx],
+				blockAt(parIdx),
 				lineIdx + 1,
 				0
 			);
@@ -2004,14 +2328,15 @@ MarkdownCursor MarkdownEditWidget::cursorAtPoint(
 	MarkdownCursor cursor(nullptr, -1, 0);
 	bool found = false;
 
-	for (auto it = m_blocks.begin(); it != m_blocks.end(); it++) {
-		QRect geometry = (*it)->geometry();
-		if (geometry.y() > pos.y() || geometry.y() + geometry.height() < pos.y())
-			continue;
-
-		QPoint pointInside = (*it)->mapFromParent(pos);
-		if (found = (*it)->cursorAt(pointInside, &cursor); found == true) {
-			break;
+	if (!m_blocks.isEmpty()) {
+		int idx = paragraphAt(pos.y());
+		if (
+			blockTop(idx) <= pos.y() &&
+			blockTop(idx) + m_heights[idx] >= pos.y()
+		) {
+			MarkdownBlock *block = blockAt(idx);
+			QPoint pointInside = block->mapFromParent(pos);
+			found = block->cursorAt(pointInside, &cursor);
 		}
 	}
 
@@ -2182,69 +2507,125 @@ void MarkdownEditWidget::onAnchorClicked(QString anchor) {
 
 // Undo/Redo.
 
-void MarkdownEditWidget::saveState(QString& state, StaticCursor cursor) {
-	if (m_stateIdx + 1 < m_textStates.length())
-		m_textStates.remove(m_stateIdx + 1, m_textStates.length() - (m_stateIdx + 1));
+void MarkdownEditWidget::undoIfPossible() {
+	applyStep(m_journal.undo(), true);
+}
 
-	m_textStates.push_back(TextState{.text = state, .cursor = cursor});
-	m_stateIdx += 1;
+void MarkdownEditWidget::redoIfPossible() {
+	applyStep(m_journal.redo(), false);
 }
 
-void MarkdownEditWidget::undoIfPossible() {
-	if (m_stateDirty) {
-		if (m_stateIdx + 1 < m_textStates.length())
-			m_textStates.remove(m_stateIdx + 1, m_textStates.length() - (m_stateIdx + 1));
-
-		TextState currentState = TextState{.text = m_model.text()};
-		if (m_cursor.block != nullptr) {
-			currentState.cursor = StaticCursor{
-				.block = indexOfBlock(m_cursor.block),
-				.line = m_cursor.line,
-				.position = m_cursor.position
-			};
+void MarkdownEditWidget::applyStep(const EditJournal::Step *step, bool undo) {
+	if (step == nullptr)
+		return;
+
+	if (undo) {
+		for (auto edit = step->edits.crbegin(); edit != step->edits.crend(); edit++)
+			applyEdit(*edit, true);
+	} else {
+		for (auto& edit: step->edits)
+			applyEdit(edit, false);
+	}
+
+	// Blocks could have been replaced.
+	m_edits.clear();
+	m_selection.reset();
+	m_lastCursor = MarkdownCursor::empty();
+	if (m_blocks[0] != nullptr)
+		m_blocks[0]->setPlaceholder(tr("Start typing here..."));
+
+	restoreCursor(undo ? step->before : step->after);
+	layoutBlocks();
+
+	m_isDirty = true;
+	throttleSave();
+}
+
+void MarkdownEditWidget::applyEdit(const text::Edit& edit, bool reverse) {
+	QList<text::Paragraph> *pars = m_model.paragraphs();
+
+	if (edit.type == text::LineEdit) {
+		text::Paragraph *par = &((*pars)[edit.paragraph]);
+		text::Line *line = &((*par->getLines())[edit.line]);
+		QString newText = line->text;
+		if (reverse) {
+			newText.replace(edit.from, edit.inserted.length(), edit.removed);
+		} else {
+			newText.replace(edit.from, edit.removed.length(), edit.inserted);
 		}
 
-		m_textStates.push_back(currentState);
-		m_stateDirty = false;
-		m_stateIdx += 1;
+		line->setText(newText, par->getType() == text::Code);
+		reloadBlock(edit.paragraph);
+		return;
 	}
 
-	if (m_stateIdx > 0) {
-		m_stateIdx -= 1;
-		m_stateDirty = false;
+	if (edit.type == text::LinesEdit) {
+		QList<text::Line> *lines = (*pars)[edit.paragraph].getLines();
+		const QList<text::Line>& removed = reverse ? edit.insertedLines : edit.removedLines;
+		const QList<text::Line>& inserted = reverse ? edit.removedLines : edit.insertedLines;
+
+		lines->remove(edit.line, removed.size());
+		for (qsizetype idx = 0; idx < inserted.size(); idx++)
+			lines->insert(edit.line + idx, inserted[idx]);
+
+		reloadBlock(edit.paragraph);
+		return;
+	}
 
-		TextState lastState = m_textStates.at(m_stateIdx);
-		loadInternal(lastState.text, false);
-		restoreCursor(lastState.cursor);
+	if (edit.type == text::LevelEdit) {
+		text::Line *line = &((*(*pars)[edit.paragraph].getLines())[edit.line]);
+		line->level = reverse ? edit.removedLevel : edit.insertedLevel;
+		reloadBlock(edit.paragraph);
+		return;
 	}
-}
 
-void MarkdownEditWidget::redoIfPossible() {
-	if (m_stateIdx < m_textStates.length() - 1) {
-		m_stateIdx += 1;
-		m_stateDirty = false;
+	const QList<text::Paragraph>& removed = reverse
+		? edit.insertedParagraphs
+		: edit.removedParagraphs;
+	const QList<text::Paragraph>& inserted = reverse
+		? edit.removedParagraphs
+		: edit.insertedParagraphs;
+	qsizetype common = std::min(removed.size(), inserted.size());
 
-		TextState lastState = m_textStates.at(m_stateIdx);
-		loadInternal(lastState.text, false);
-		restoreCursor(lastState.cursor);
+	// Replace paragraphs in place where possible, keeping their blocks.
+	for (qsizetype idx = 0; idx < common; idx++) {
+		int parIdx = edit.paragraph + idx;
+		(*pars)[parIdx] = inserted[idx].clone();
+		reloadBlock(parIdx);
 	}
+
+	for (qsizetype idx = common; idx < removed.size(); idx++)
+		deleteParagraph(edit.paragraph + common);
+	for (qsizetype idx = common; idx < inserted.size(); idx++)
+		insertParagraph(edit.paragraph + idx, inserted[idx].clone());
 }
 
 void MarkdownEditWidget::restoreCursor(StaticCursor cursor) {
+	MarkdownCursor prev = m_cursor;
+	MarkdownCursor mcursor = MarkdownCursor::empty();
+
 	// Check for out of bounds cases. Should not really be happening, but...
 	if (
-		cursor.block >= m_blocks.size() ||
-		cursor.line >= m_blocks[cursor.block]->paragraph()->getLines()->size()
+		cursor.block >= 0 && cursor.block < m_blocks.size() &&
+		cursor.line >= 0 &&
+		cursor.line < (*m_model.paragraphs())[cursor.block].getLines()->size()
 	) {
-		return;
+		mcursor = MarkdownCursor(
+			blockAt(cursor.block),
+			cursor.line,
+			cursor.position
+		);
 	}
 
-	MarkdownCursor mcursor = MarkdownCursor(
-		m_blocks[cursor.block],
-		cursor.line,
-		cursor.position
-	);
 	m_cursor = mcursor;
-	emit onCursorMove(MarkdownCursor::empty(), mcursor);
+	notifyCursorMove(prev, mcursor);
+}
+
+StaticCursor MarkdownEditWidget::staticCursor(MarkdownCursor cursor) {
+	return StaticCursor{
+		.block = indexOfBlock(cursor.block),
+		.line = cursor.line,
+		.position = cursor.position
+	};
 }
 
@@ -2,7 +2,6 @@
 #define H_MARKDOWN_EDIT_WIDGET
 
 #include <QWidget>
-#include <QVBoxLayout>
 #include <QScrollArea>
 #include <QResizeEvent>
 #include <QMouseEvent>
@@ -13,23 +12,14 @@
 #include <QFocusEvent>
 #include <QMenu>
 #include <QClipboard>
+#include <QSet>
 
 #include "model/thought.h"
 #include "widgets/style.h"
 #include "widgets/base_widget.h"
 #include "widgets/markdown_block_widget.h"
 #include "model/new_text_model.h"
-
-struct StaticCursor {
-	int block;
-	int line;
-	int position;
-};
-
-struct TextState {
-	QString text;
-	StaticCursor cursor;
-};
+#include "model/edit_journal.h"
 
 class MarkdownEditPresenter;
 
@@ -74,6 +64,8 @@ public:
 	// State.
 	bool isDirty() const;
 	QString text();
+	// Visible part of the widget, in its own coordinates.
+	void setViewport(QRect);
 	// Style.
 	Style *style();
 
@@ -83,8 +75,11 @@ signals:
 	void nodeInsertionActivated(QPoint);
 	void textChanged(QString&);
 	void nodeLinkSelected(ThoughtId);
+	// Content at the top of the viewport has moved by the given offset.
+	void contentShifted(int);
 
 protected:
+	bool event(QEvent*) override;
 	void resizeEvent(QResizeEvent*) override;
 	void mousePressEvent(QMouseEvent*) override;
 	void mouseMoveEvent(QMouseEvent*) override;
@@ -100,8 +95,17 @@ protected slots:
 	void onMenuRedo();
 
 private:
-	QVBoxLayout *m_layout = nullptr;
+	// Blocks of all paragraphs. Only blocks around the viewport are created,
+	// the rest are null.
 	QList<MarkdownBlock*> m_blocks = {};
+	QSet<MarkdownBlock*> m_blockSet = {};
+	// Heights of paragraphs, measured for created blocks and estimated for
+	// the rest. Offsets are prefix sums of heights kept in a Fenwick tree,
+	// which is only rebuilt after paragraphs are added or removed.
+	QList<int> m_heights = {};
+	QList<int> m_tops = {};
+	bool m_topsDirty = true;
+	QRect m_viewport = QRect();
 	MarkdownCursor m_cursor = MarkdownCursor(nullptr, -1, 0);
 	MarkdownEditPresenter *m_presenter = nullptr;
 	// State.
@@ -117,14 +121,14 @@ private:
 	bool m_isDirty = false;
 	QTimer *m_saveTimer = nullptr;
 	// Undo/Redo.
-	QList<TextState> m_textStates;
-	int m_stateIdx = 0;
-	bool m_stateDirty = false;
+	EditJournal m_journal;
+	// Edits made by the current input.
+	QList<text::Edit> m_edits;
 	// Search.
 	QWidget *m_search = nullptr;
 
 	// State saving helper.
-	void updateState(QString& lastState, MarkdownCursor prev, bool isCopyPaste);
+	void updateState(StaticCursor before, bool isCopyPaste);
 	// Selection and clipboard.
 	MarkdownCursor deleteSelection();
 	void copySelectionToClipboard(QClipboard::Mode);
@@ -146,6 +150,7 @@ private:
 	MarkdownCursor cursorAtPoint(QPoint, bool*);
 	bool cursorAfter(MarkdownCursor, MarkdownCursor);
 	void processCursorMove(MarkdownCursor, MarkdownCursor);
+	void notifyCursorMove(MarkdownCursor, MarkdownCursor);
 	bool cursorAtPoint(QPoint, MarkdownCursor*);
 	bool cursorAbovePoint(QPoint, MarkdownCursor*);
 	MarkdownCursor moveCursor(int, MarkdownCursor);
@@ -155,6 +160,22 @@ private:
 	MarkdownCursor documentEnd();
 	inline int indexOfParagraph(text::Paragraph*);
 	inline int indexOfBlock(MarkdownBlock*);
+	// Block virtualization.
+	MarkdownBlock *blockAt(int);
+	void releaseBlock(int);
+	void reloadBlock(int);
+	bool isBlockPinned(MarkdownBlock*);
+	bool measureBlock(int);
+	void layoutBlocks();
+	bool updateVisibleBlocks();
+	void placeBlocks();
+	int anchorParagraph();
+	void keepAnchor(int, int);
+	void setBlockHeight(int, int);
+	void updateTops();
+	int paragraphAt(int);
+	int blockTop(int);
+	int documentHeight();
 	inline text::Paragraph *insertParagraph(int index, text::Paragraph);
 	// Text manipulation.
 	void handleInput(int key, int mouseButton, Qt::KeyboardModifiers mods, QKeySequence seq, QString text);
@@ -163,16 +184,27 @@ private:
 	MarkdownCursor splitBlocks(MarkdownCursor cursor, bool shiftUsed);
 	MarkdownCursor adjustForUnfolding(MarkdownCursor, MarkdownCursor);
 	MarkdownCursor applyStyleToSelection(QString);
+	// Edits.
+	void setLineText(text::Paragraph*, text::Line*, QString&);
+	void setLineLevel(text::Paragraph*, text::Line*, unsigned int);
+	void insertLines(text::Paragraph*, int, QList<text::Line>);
+	void removeLines(text::Paragraph*, int, int);
+	void markParagraphChanged(int, text::Paragraph);
+	void applyEdit(const text::Edit&, bool);
 	// Menu.
 	void showContextMenu(QMouseEvent*);
 	// Undo/Redo.
 	void undoIfPossible();
 	void redoIfPossible();
-	void saveState(QString&, StaticCursor);
+	void applyStep(const EditJournal::Step*, bool);
 	void restoreCursor(StaticCursor);
+	StaticCursor staticCursor(MarkdownCursor);
 	// Misc.
 	bool isMovementKey(int);
 	QKeySequence keySequence(QKeyEvent*);
+	// Layout constants.
+	static constexpr int blockSpacing = 16;
+	static constexpr int defaultViewportHeight = 1000;
 };
 
 class MarkdownEditPresenter {
@@ -4,6 +4,7 @@
 #include <QScrollBar>
 #include <QVBoxLayout>
 #include <QMargins>
+#include <QTimer>
 
 #include "widgets/markdown_scroll_widget.h"
 #include "widgets/markdown_edit_widget.h"
@@ -23,6 +24,12 @@ MarkdownScrollWidget::MarkdownScrollWidget(
 	m_container.setLayout(&m_layout);
 	m_container.setFocusPolicy(Qt::NoFocus);
 	setWidget(&m_container);
+
+	// Editor only creates blocks for the visible part of the document.
+	connect(
+		verticalScrollBar(), &QScrollBar::valueChanged,
+		this, &MarkdownScrollWidget::onViewportChanged
+	);
 }
 
 MarkdownScrollWidget::~MarkdownScrollWidget() {};
@@ -37,6 +44,10 @@ void MarkdownScrollWidget::setMarkdownWidgets(
 		w, &MarkdownEditWidget::cursorMoved,
 		this, &MarkdownScrollWidget::onCursorMoved
 	);
+	connect(
+		w, &MarkdownEditWidget::contentShifted,
+		this, &MarkdownScrollWidget::onContentShifted
+	);
 
 	m_widget = w;
 	m_widget->setPresenter(this);
@@ -46,6 +57,8 @@ void MarkdownScrollWidget::setMarkdownWidgets(
 		m_connections = c;
 		m_layout.addWidget(c);
 	}
+
+	onViewportChanged();
 }
 
 MarkdownEditWidget *MarkdownScrollWidget::markdownWidget() {
@@ -60,6 +73,13 @@ void MarkdownScrollWidget::onCursorMoved(QLine line, bool up) {
 	}
 }
 
+// Events.
+
+void MarkdownScrollWidget::resizeEvent(QResizeEvent *event) {
+	QScrollArea::resizeEvent(event);
+	onViewportChanged();
+}
+
 int MarkdownScrollWidget::getPageOffset(bool down) {
 	QRect viewportRect = viewport()->rect();
 	QScrollBar *bar = verticalScrollBar();
@@ -79,6 +99,37 @@ int MarkdownScrollWidget::getPageOffset(bool down) {
 
 // Slots.
 
+void MarkdownScrollWidget::onViewportChanged() {
+	if (m_widget == nullptr)
+		return;
+
+	QPoint origin = m_widget->mapFrom(viewport(), QPoint(0, 0));
+	m_widget->setViewport(QRect(origin, viewport()->size()));
+}
+
+void MarkdownScrollWidget::onContentShifted(int shift) {
+	// Scroll along with the content, so that it stays in place. Range of the
+	// scroll bar follows the new height of the editor only after the layout
+	// is done, so whatever is out of it is applied later.
+	QScrollBar *bar = verticalScrollBar();
+	int target = bar->value() + m_pendingShift + shift;
+	bar->setValue(target);
+	m_pendingShift = target - bar->value();
+
+	if (m_pendingShift != 0)
+		QTimer::singleShot(0, this, &MarkdownScrollWidget::applyPendingShift);
+}
+
+void MarkdownScrollWidget::applyPendingShift() {
+	if (m_pendingShift == 0)
+		return;
+
+	QScrollBar *bar = verticalScrollBar();
+	int target = bar->value() + m_pendingShift;
+	m_pendingShift = 0;
+	bar->setValue(target);
+}
+
 void MarkdownScrollWidget::onError(MarkdownScrollError error) {
 	if (m_error != nullptr)
 		delete m_error;
@@ -5,6 +5,7 @@
 #include <QScrollArea>
 #include <QVBoxLayout>
 #include <QLine>
+#include <QResizeEvent>
 
 #include "widgets/style.h"
 #include "widgets/markdown_edit_widget.h"
@@ -30,8 +31,14 @@ public:
 public slots:
 	void onError(MarkdownScrollError error);
 
+protected:
+	void resizeEvent(QResizeEvent*) override;
+
 protected slots:
 	void onCursorMoved(QLine, bool);
+	void onViewportChanged();
+	void onContentShifted(int);
+	void applyPendingShift();
 
 private:
 	MarkdownEditWidget *m_widget = nullptr;
@@ -39,6 +46,8 @@ private:
 	QWidget m_container;
 	QVBoxLayout m_layout;
 	Style *m_style = nullptr;
+	// Part of content shift that didn't fit into the scroll range yet.
+	int m_pendingShift = 0;
 	// Error.
 	ToastWidget *m_error = nullptr;
 };
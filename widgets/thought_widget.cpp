@@ -5,6 +5,7 @@
 #include <QPainter>
 
 #include "widgets/thought_widget.h"
+#include "layout/text_metrics.h"
 
 ThoughtWidget::ThoughtWidget(
 	QWidget *parent,
@@ -297,31 +298,31 @@ AnchorPoint ThoughtWidget::getAnchorTo(ConnectionType type) {
 // Size measurements
 
 QSize ThoughtWidget::sizeHint() const {
-	const QSize anchorSize = AnchorWidget::defaultSize;
+	return sizeHintForText(m_style, m_text);
+}
 
-	QFont font = m_style->browser.browseFont;
-	QFontMetrics metrics(font);
+QSize ThoughtWidget::sizeHintForText(Style *style, const QString& text) {
+	const QSize anchorSize = AnchorWidget::defaultSize;
 
 	// Calculate bounding rect for the text.
-	QRect bounds = metrics.boundingRect(
+	QSize textSize = TextMetrics::shared().wrappedSize(
+		style->browser.browseFont,
+		text,
 		// 9000 is set due to a quirk in QFontMetrics measurement. When calling
 		// boundingRect() without a restriction rect or with INT_MAX, it produces
 		// a bounding rect smaller than actually needed to fit the text.
-		QRect(0, 0, 9000, INT_MAX),
-		Qt::AlignHCenter | Qt::TextWordWrap,
-		m_text
+		9000
 	);
-	QSize textSize = bounds.size();
 
 	// Add paddings and anchor sizes and borders.
 	QSize result(
 		textSize.width() +
 			padding.width() * 2 +
-			m_style->browser.hoverBorderWidth * 2 +
+			style->browser.hoverBorderWidth * 2 +
 			anchorSize.width(),
 		textSize.height() +
 			padding.height() * 2 +
-			m_style->browser.hoverBorderWidth * 2 +
+			style->browser.hoverBorderWidth * 2 +
 			anchorSize.height()
 	);
 
@@ -339,18 +340,15 @@ QSize ThoughtWidget::sizeForWidth(int width) const {
 		padding.height() * 2 +
 		m_style->browser.hoverBorderWidth * 2;
 
-	QFont font = m_style->browser.browseFont;
-	QFontMetrics metrics(font);
-
-	QRect bounds = metrics.boundingRect(
-		QRect(0, 0, width - textPadding, INT_MAX),
-		Qt::AlignHCenter | Qt::TextWordWrap,
-		m_text
+	QSize bounds = TextMetrics::shared().wrappedSize(
+		m_style->browser.browseFont,
+		m_text,
+		width - textPadding
 	);
 
 	QSize result = QSize(
-		bounds.size().width() + textPadding,
-		bounds.size().height() + verticalPadding
+		bounds.width() + textPadding,
+		bounds.height() + verticalPadding
 	);
 
 	return result;
@@ -565,17 +563,16 @@ void ThoughtWidget::updateText() {
 	const int availableWidth = size().width() - textPadding;
 
 	QFont font = m_style->browser.browseFont;
-	QFontMetrics metrics(font);
-
-	QRect bounds = metrics.boundingRect(
-		QRect(0, 0, size().width() - textPadding, INT_MAX),
-		Qt::AlignHCenter | Qt::TextWordWrap,
-		m_text
+	QSize bounds = TextMetrics::shared().wrappedSize(
+		font,
+		m_text,
+		size().width() - textPadding
 	);
 
-	if (!isActive() && ((bounds.size().height() > (size().height() - verticalPadding)) ||
-			(bounds.size().width() > availableWidth)))
+	if (!isActive() && ((bounds.height() > (size().height() - verticalPadding)) ||
+			(bounds.width() > availableWidth)))
 	{
+		QFontMetrics metrics(font);
 		QString elided = metrics.elidedText(m_text, Qt::ElideRight, availableWidth);
 		m_textEdit.setPlainText(elided);
 	} else {
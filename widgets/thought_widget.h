@@ -60,6 +60,8 @@ public:
 	void setFocused(bool);
 	// Method override.
 	QSize sizeHint() const override;
+	// Size hint of a widget with the given text, without creating one.
+	static QSize sizeHintForText(Style*, const QString&);
 	// Calculates bounding rect for given width without height restriction.
 	QSize sizeForWidth(int width) const;
 	// Current state.